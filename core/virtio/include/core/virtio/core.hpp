@@ -72,11 +72,17 @@ enum {
 	// Bits of the spec::Descriptor::flags field.
 	VIRTQ_DESC_F_NEXT = 1, // descriptor is part of a chain
 	VIRTQ_DESC_F_WRITE = 2, // buffer is written by device
+	VIRTQ_DESC_F_INDIRECT = 4, // buffer contains a table of descriptors
 
 	// Bits of the spec::UsedRing::flags field.
 	VIRTQ_USED_F_NO_NOTIFY = 1 // no need to notify the device
 };
 
+// Device-independent feature bits.
+enum {
+	VIRTIO_RING_F_INDIRECT_DESC = 28
+};
+
 namespace spec {
 	struct Descriptor {
 		arch::scalar_variable<uint64_t> address;
@@ -183,7 +189,7 @@ struct DeviceSpace {
 		} else {
 			static_assert(sizeof(typename RT::rep_type) == 4,
 					"Unsupported size for DeviceSpace::load()");
-			auto v = _transport->loadConfig16(r.offset());
+			auto v = _transport->loadConfig32(r.offset());
 			return static_cast<typename RT::rep_type>(v);
 		}
 	}
@@ -238,11 +244,53 @@ struct Handle {
 
 	void setupLink(Handle other);
 
+	// Makes this descriptor refer to an indirect descriptor table.
+	// The table must be contiguous in physical memory.
+	void setupIndirect(arch::dma_buffer_view table);
+
 private:
 	Queue *_queue;
 	size_t _tableIndex;
 };
 
+// Helper class to build a descriptor chain inside of an indirect descriptor table
+// (requires VIRTIO_RING_F_INDIRECT_DESC).
+// Unlike Chain, this does not consume any descriptors of the virtq itself.
+struct IndirectChain {
+	IndirectChain(spec::Descriptor *table, size_t capacity)
+	: _table{table}, _capacity{capacity} { }
+
+	IndirectChain(const IndirectChain &) = delete;
+
+	IndirectChain &operator= (const IndirectChain &) = delete;
+
+	// Appends a buffer to the chain. The buffer does not need to be contiguous in
+	// physical memory; physically contiguous pages are merged into a single descriptor.
+	// Returns false if the table is too small to hold the buffer.
+	bool append(HostToDeviceType, arch::dma_buffer_view view) {
+		return _append(view, 0);
+	}
+	bool append(DeviceToHostType, arch::dma_buffer_view view) {
+		return _append(view, VIRTQ_DESC_F_WRITE);
+	}
+
+	size_t size() {
+		return _size;
+	}
+
+	// Returns the part of the table that is in use.
+	arch::dma_buffer_view table() {
+		return arch::dma_buffer_view{nullptr, _table, _size * sizeof(spec::Descriptor)};
+	}
+
+private:
+	bool _append(arch::dma_buffer_view view, uint16_t flags);
+
+	spec::Descriptor *_table;
+	size_t _capacity;
+	size_t _size = 0;
+};
+
 // Helper class to create Handle chains.
 struct Chain {
 	Chain() = default;
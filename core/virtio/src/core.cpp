@@ -752,13 +752,79 @@ void Handle::setupLink(Handle other) {
 	descriptor->flags.store(descriptor->flags.load() | VIRTQ_DESC_F_NEXT);
 }
 
+void Handle::setupIndirect(arch::dma_buffer_view table) {
+	assert(table.size());
+
+	uintptr_t physical;
+	HEL_CHECK(helPointerPhysical(table.data(), &physical));
+
+	auto descriptor = _queue->_table + _tableIndex;
+	descriptor->address.store(physical);
+	descriptor->length.store(table.size());
+	descriptor->flags.store(descriptor->flags.load() | VIRTQ_DESC_F_INDIRECT);
+}
+
+namespace {
+
+// Returns the size of the physically contiguous part of view that starts at offset.
+size_t contiguousChunk(arch::dma_buffer_view view, size_t offset) {
+	constexpr size_t page_size = 0x1000;
+
+	auto address = reinterpret_cast<uintptr_t>(view.data()) + offset;
+	auto chunk = std::min(view.size() - offset, page_size - (address & (page_size - 1)));
+
+	uintptr_t physical;
+	HEL_CHECK(helPointerPhysical(reinterpret_cast<void *>(address), &physical));
+
+	// Merge subsequent pages as long as they are physically adjacent.
+	while(offset + chunk < view.size()) {
+		uintptr_t next_physical;
+		HEL_CHECK(helPointerPhysical(reinterpret_cast<void *>(address + chunk), &next_physical));
+		if(next_physical != physical + chunk)
+			break;
+		chunk += std::min(view.size() - offset - chunk, page_size);
+	}
+
+	return chunk;
+}
+
+} // anonymous namespace
+
+bool IndirectChain::_append(arch::dma_buffer_view view, uint16_t flags) {
+	size_t offset = 0;
+	while(offset < view.size()) {
+		if(_size == _capacity)
+			return false;
+
+		auto chunk = contiguousChunk(view, offset);
+
+		uintptr_t physical;
+		HEL_CHECK(helPointerPhysical(view.subview(offset, chunk).data(), &physical));
+
+		auto descriptor = _table + _size;
+		descriptor->address.store(physical);
+		descriptor->length.store(chunk);
+		descriptor->flags.store(flags);
+		descriptor->next.store(0);
+
+		// Link the previous descriptor to this one.
+		if(_size) {
+			auto previous = _table + _size - 1;
+			previous->next.store(_size);
+			previous->flags.store(previous->flags.load() | VIRTQ_DESC_F_NEXT);
+		}
+
+		_size++;
+		offset += chunk;
+	}
+	return true;
+}
+
 async::result<void> scatterGather(HostToDeviceType, Chain &chain, Queue *queue,
 		arch::dma_buffer_view view) {
-	constexpr size_t page_size = 0x1000;
 	size_t offset = 0;
 	while(offset < view.size()) {
-		auto address = reinterpret_cast<uintptr_t>(view.data()) + offset;
-		auto chunk = std::min(view.size() - offset, page_size - (address & (page_size - 1)));
+		auto chunk = contiguousChunk(view, offset);
 		chain.append(co_await queue->obtainDescriptor());
 		chain.setupBuffer(hostToDevice, view.subview(offset, chunk));
 		offset += chunk;
@@ -767,11 +833,9 @@ async::result<void> scatterGather(HostToDeviceType, Chain &chain, Queue *queue,
 
 async::result<void> scatterGather(DeviceToHostType, Chain &chain, Queue *queue,
 		arch::dma_buffer_view view) {
-	constexpr size_t page_size = 0x1000;
 	size_t offset = 0;
 	while(offset < view.size()) {
-		auto address = reinterpret_cast<uintptr_t>(view.data()) + offset;
-		auto chunk = std::min(view.size() - offset, page_size - (address & (page_size - 1)));
+		auto chunk = contiguousChunk(view, offset);
 		chain.append(co_await queue->obtainDescriptor());
 		chain.setupBuffer(deviceToHost, view.subview(offset, chunk));
 		offset += chunk;
@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <arch/bit.hpp>
 #include <format>
 #include <helix/timer.hpp>
 #include <protocols/mbus/client.hpp>
+#include <thread>
 
 #include "controller.hpp"
 
@@ -94,10 +96,11 @@ async::detached PciExpressController::handleIrqs(helix::UniqueDescriptor irq) {
 }
 
 async::detached PciExpressController::handleMsis(helix::UniqueDescriptor irq, size_t queueId, bool isMsiX) {
-	irqSequence_ = 0;
+	// Each vector has its own sequence; they are not shared between queues.
+	uint64_t sequence = 0;
 
 	while (true) {
-		auto awaitResult = co_await helix_ng::awaitEvent(irq, irqSequence_);
+		auto awaitResult = co_await helix_ng::awaitEvent(irq, sequence);
 
 		auto q = std::ranges::find_if(activeQueues_, [queueId](auto &q) {
 			return q->getQueueId() == queueId;
@@ -112,14 +115,14 @@ async::detached PciExpressController::handleMsis(helix::UniqueDescriptor irq, si
 			regs_.store(regs::intms, 1 << queueId);
 
 		HEL_CHECK(awaitResult.error());
-		irqSequence_ = awaitResult.sequence();
+		sequence = awaitResult.sequence();
 
 		static_cast<PciExpressQueue *>(q->get())->handleIrq();
 
 		if(!isMsiX)
 			regs_.store(regs::intmc, 1 << queueId);
 
-		HEL_CHECK(helAcknowledgeIrq(irq.getHandle(), kHelAckAcknowledge, irqSequence_));
+		HEL_CHECK(helAcknowledgeIrq(irq.getHandle(), kHelAckAcknowledge, sequence));
 	}
 }
 
@@ -146,10 +149,37 @@ async::result<void> PciExpressController::disable() {
 	co_await waitStatus(false);
 }
 
-async::result<void> PciExpressController::setupIOQueueInterrupts(size_t queueId, size_t vector) {
+async::result<helix::UniqueDescriptor>
+PciExpressController::setupIOQueueInterrupts(size_t queueId, size_t vector) {
 	if(irqMode_ == InterruptMode::Msi || irqMode_ == InterruptMode::MsiX) {
 		auto irq = co_await hwDevice_.installMsi(vector);
+		auto dupIrq = irq.dup();
 		handleMsis(std::move(irq), queueId, irqMode_ == InterruptMode::MsiX);
+		co_return dupIrq;
+	}
+	co_return helix::UniqueDescriptor{};
+}
+
+void PciExpressController::setIoQueueAffinities(const std::vector<helix::UniqueDescriptor> &irqs) {
+	assert(irqs.size() == ioQueues_.size());
+	size_t numCpus = std::max(std::thread::hardware_concurrency(), 1u);
+
+	// submitIoCommand() uses I/O queue (cpu % ioQueues_.size()). Route each queue's vector
+	// to the same CPUs such that completions are handled on the submitting CPU.
+	for(size_t i = 0; i < irqs.size(); i++) {
+		if(!irqs[i])
+			continue;
+
+		std::vector<uint8_t> mask((numCpus + 7) / 8);
+		for(size_t cpu = i; cpu < numCpus; cpu += ioQueues_.size())
+			mask[cpu / 8] |= 1 << (cpu % 8);
+
+		auto error = helSetIrqAffinity(irqs[i].getHandle(), mask.data(), mask.size());
+		if(error == kHelErrNoHardwareSupport) {
+			std::cout << "block/nvme: IRQ controller does not support IRQ affinity" << std::endl;
+			return;
+		}
+		HEL_CHECK(error);
 	}
 }
 
@@ -166,6 +196,13 @@ async::result<void> PciExpressController::reset() {
 
 	auto info = co_await hwDevice_.getPciInfo();
 
+	// Try to get one I/O queue per CPU. With MSI(-X), each I/O queue needs its own vector
+	// (vector 0 is used by the admin queue); with legacy IRQs, all queues share the IRQ.
+	size_t wantedIoQueues = std::max(std::thread::hardware_concurrency(), 1u);
+	if(info.numMsis)
+		wantedIoQueues = std::clamp(size_t{info.numMsis} - 1, size_t{1}, wantedIoQueues);
+	wantedIoQueues = std::min(wantedIoQueues, MAX_IO_QUEUES);
+
 	if(info.numMsis) {
 		irqMode_ = info.msiX ? InterruptMode::MsiX : InterruptMode::Msi;
 		co_await hwDevice_.enableMsi();
@@ -190,18 +227,37 @@ async::result<void> PciExpressController::reset() {
 
 	co_await enable();
 
-	requestIoQueues(1, 1);
+	// The controller may grant fewer queues than we asked for.
+	size_t numIoQueues = 1;
+	auto queuesRes = co_await requestIoQueues(wantedIoQueues, wantedIoQueues);
+	if (queuesRes.first.successful()) {
+		size_t grantedSqs = (queuesRes.second.u32 & 0xFFFF) + 1;
+		size_t grantedCqs = (queuesRes.second.u32 >> 16) + 1;
+		numIoQueues = std::min({wantedIoQueues, grantedSqs, grantedCqs});
+	}
 
-	co_await setupIOQueueInterrupts(1, 1);
-	auto ioQ = std::make_unique<PciExpressQueue>(1, queueDepth_, regs_.subspace(doorbellsOffset + 1 * 8 * dbStride_), 1);
-	co_await ioQ->init();
+	std::vector<helix::UniqueDescriptor> ioQueueIrqs;
+	for (size_t qid = 1; qid <= numIoQueues; qid++) {
+		size_t vector = (irqMode_ == InterruptMode::LegacyIrq) ? 0 : qid;
+
+		auto irq = co_await setupIOQueueInterrupts(qid, vector);
+		auto ioQ = std::make_unique<PciExpressQueue>(qid, queueDepth_,
+				regs_.subspace(doorbellsOffset + qid * 8 * dbStride_), vector);
+		co_await ioQ->init();
+
+		if (!(co_await setupIoQueue(ioQ.get())))
+			break;
 
-	if (co_await setupIoQueue(ioQ.get())) {
 		ioQ->run();
+		ioQueues_.push_back(ioQ.get());
+		ioQueueIrqs.push_back(std::move(irq));
 		activeQueues_.push_back(std::move(ioQ));
 	}
 
-	assert(activeQueues_.size() >= 2 && "At least need one IO queue");
+	assert(!ioQueues_.empty() && "At least need one IO queue");
+	setIoQueueAffinities(ioQueueIrqs);
+	std::cout << std::format("block/nvme: Using {} I/O queue(s) for {} CPU(s)",
+			ioQueues_.size(), std::thread::hardware_concurrency()) << std::endl;
 }
 
 async::result<Command::Result> PciExpressController::requestIoQueues(uint16_t sqs, uint16_t cqs) {
@@ -400,7 +456,10 @@ async::result<Command::Result> PciExpressController::submitAdminCommand(std::uni
 }
 
 async::result<Command::Result> PciExpressController::submitIoCommand(std::unique_ptr<Command> cmd) {
-	auto &ioQ = activeQueues_.back();
+	// Submit to the queue of the current CPU to avoid contention on a single SQ/CQ pair.
+	int cpu;
+	HEL_CHECK(helGetCurrentCpu(&cpu));
+	auto ioQ = ioQueues_[cpu % ioQueues_.size()];
 
 	return ioQ->submitCommand(std::move(cmd));
 }
@@ -81,9 +81,14 @@ struct PciExpressController final : public Controller {
 	async::result<Command::Result> submitAdminCommand(std::unique_ptr<Command> cmd) override;
 	async::result<Command::Result> submitIoCommand(std::unique_ptr<Command> cmd) override;
 private:
-	async::result<void> setupIOQueueInterrupts(size_t queueId, size_t vector);
+	// Returns a duplicate of the IRQ descriptor (or an empty descriptor for legacy IRQs).
+	async::result<helix::UniqueDescriptor> setupIOQueueInterrupts(size_t queueId, size_t vector);
+	// Routes the IRQ of each I/O queue to the CPUs that submit to that queue.
+	void setIoQueueAffinities(const std::vector<helix::UniqueDescriptor> &irqs);
 
 	static constexpr int IO_QUEUE_DEPTH = 1024;
+	// Upper bound on the number of I/O queues that we request from the controller.
+	static constexpr size_t MAX_IO_QUEUES = 64;
 
 	protocols::hw::Device hwDevice_;
 	std::string location_;
@@ -96,6 +101,9 @@ private:
 	uint64_t irqSequence_;
 	InterruptMode irqMode_;
 
+	// I/O queues (owned by activeQueues_), indexed by CPU modulo their number.
+	std::vector<PciExpressQueue *> ioQueues_;
+
 	async::result<void> reset();
 
 	async::result<void> waitStatus(bool enabled);
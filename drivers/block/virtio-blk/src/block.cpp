@@ -13,8 +13,201 @@ static bool logInitiateRetire = false;
 // UserRequest
 // --------------------------------------------------------
 
-UserRequest::UserRequest(bool write_, uint64_t sector_, void *buffer_, size_t num_sectors_)
-: write{write_}, sector{sector_}, buffer{buffer_}, numSectors{num_sectors_} { }
+UserRequest::UserRequest(uint32_t type_, uint64_t sector_, void *buffer_, size_t num_sectors_)
+: type{type_}, sector{sector_}, buffer{buffer_}, numSectors{num_sectors_} { }
+
+// --------------------------------------------------------
+// RequestQueue
+// --------------------------------------------------------
+
+RequestQueue::RequestQueue(virtio_core::Queue *queue_, bool useIndirect_)
+: queue{queue_}, useIndirect{useIndirect_} {
+	size_t numBuffers = useIndirect ? numIndirectSlots : queue->numDescriptors();
+	virtRequestBuffer = new VirtRequest[numBuffers];
+	statusBuffer = new uint8_t[numBuffers];
+
+	// natural alignment makes sure that request headers do not cross page boundaries
+	assert((uintptr_t)virtRequestBuffer % sizeof(VirtRequest) == 0);
+
+	if(useIndirect) {
+		// Each table occupies one page, hence it is contiguous in physical memory.
+		size_t size = numIndirectSlots * indirectTableSize * sizeof(virtio_core::spec::Descriptor);
+		HelHandle memory;
+		void *window;
+		HEL_CHECK(helAllocateMemory(size, 0, nullptr, &memory));
+		HEL_CHECK(helMapMemory(memory, kHelNullHandle, nullptr,
+				0, size, kHelMapProtRead | kHelMapProtWrite, &window));
+		HEL_CHECK(helCloseDescriptor(kHelThisUniverse, memory));
+		_indirectTables = reinterpret_cast<virtio_core::spec::Descriptor *>(window);
+
+		for(size_t i = 0; i < numIndirectSlots; i++)
+			_freeIndirectSlots.push_back(i);
+	}
+}
+
+size_t RequestQueue::maxSectors(size_t segMax) {
+	// Number of data descriptors that we allow per request.
+	size_t maxSegments;
+	if(useIndirect) {
+		// The header and the status byte need one descriptor each.
+		maxSegments = indirectTableSize - 2;
+	}else{
+		// Limit to ensure that we don't monopolize the device.
+		maxSegments = queue->numDescriptors() / 4;
+	}
+	if(segMax)
+		maxSegments = std::min(maxSegments, segMax);
+	assert(maxSegments >= 2);
+
+	// In the worst case, each descriptor only covers a single page;
+	// the buffer does not need to be page aligned.
+	return (maxSegments - 1) * (0x1000 / 512);
+}
+
+async::result<size_t> RequestQueue::_obtainIndirectSlot() {
+	while(_freeIndirectSlots.empty())
+		co_await _indirectSlotDoorbell.async_wait();
+
+	auto slot = _freeIndirectSlots.back();
+	_freeIndirectSlots.pop_back();
+	co_return slot;
+}
+
+void RequestQueue::_releaseIndirectSlot(size_t slot) {
+	_freeIndirectSlots.push_back(slot);
+	_indirectSlotDoorbell.raise();
+}
+
+async::detached RequestQueue::processRequests() {
+	while(true) {
+		if(pendingQueue.empty()) {
+			co_await pendingDoorbell.async_wait();
+			continue;
+		}
+
+		auto request = pendingQueue.front();
+		pendingQueue.pop();
+		assert(request->numSectors);
+
+		// Note that we do not wait for completion here; the next request can be
+		// submitted as soon as descriptors are available.
+		// We must notify the device after each request since obtaining descriptors for
+		// the next request may block until the device completes earlier requests.
+		if(useIndirect) {
+			co_await _submitIndirect(request);
+		}else{
+			co_await _submitDirect(request);
+		}
+		queue->notify();
+	}
+}
+
+namespace {
+
+void setupHeader(VirtRequest *header, UserRequest *request) {
+	header->type = request->type;
+	header->reserved = 0;
+	if(request->type == VIRTIO_BLK_T_IN || request->type == VIRTIO_BLK_T_OUT) {
+		header->sector = request->sector;
+	}else{
+		header->sector = 0;
+		request->segment.sector = request->sector;
+		request->segment.numSectors = request->numSectors;
+		request->segment.flags = 0;
+	}
+}
+
+void completeRequest(virtio_core::Request *base_request) {
+	auto request = static_cast<UserRequest *>(base_request);
+	if(logInitiateRetire)
+		std::cout << "Retiring request of " << request->numSectors
+				<< " sectors" << std::endl;
+	request->event.raise();
+}
+
+} // anonymous namespace
+
+async::result<void> RequestQueue::_submitDirect(UserRequest *request) {
+	// Setup the descriptor for the request header.
+	virtio_core::Chain chain;
+	chain.append(co_await queue->obtainDescriptor());
+
+	VirtRequest *header = &virtRequestBuffer[chain.front().tableIndex()];
+	setupHeader(header, request);
+
+	chain.setupBuffer(virtio_core::hostToDevice, arch::dma_buffer_view{nullptr,
+			header, sizeof(VirtRequest)});
+
+	// Setup descriptors for the transfered data.
+	// Physically contiguous sectors are merged into a single descriptor.
+	if(request->type == VIRTIO_BLK_T_IN) {
+		co_await virtio_core::scatterGather(virtio_core::deviceToHost, chain, queue,
+				arch::dma_buffer_view{nullptr, request->buffer, 512 * request->numSectors});
+	}else if(request->type == VIRTIO_BLK_T_OUT) {
+		co_await virtio_core::scatterGather(virtio_core::hostToDevice, chain, queue,
+				arch::dma_buffer_view{nullptr, request->buffer, 512 * request->numSectors});
+	}else{
+		chain.append(co_await queue->obtainDescriptor());
+		chain.setupBuffer(virtio_core::hostToDevice, arch::dma_buffer_view{nullptr,
+				&request->segment, sizeof(DiscardWriteZeroesSegment)});
+	}
+
+	if(logInitiateRetire)
+		std::cout << "Submitting request of " << request->numSectors
+				<< " sectors" << std::endl;
+
+	// Setup a descriptor for the status byte.
+	chain.append(co_await queue->obtainDescriptor());
+	chain.setupBuffer(virtio_core::deviceToHost, arch::dma_buffer_view{nullptr,
+			&statusBuffer[chain.front().tableIndex()], 1});
+
+	// Submit the request to the device
+	queue->postDescriptor(chain.front(), request, completeRequest);
+}
+
+async::result<void> RequestQueue::_submitIndirect(UserRequest *request) {
+	auto slot = co_await _obtainIndirectSlot();
+	request->queue = this;
+	request->indirectSlot = slot;
+
+	virtio_core::IndirectChain chain{_indirectTables + slot * indirectTableSize,
+			indirectTableSize};
+
+	VirtRequest *header = &virtRequestBuffer[slot];
+	setupHeader(header, request);
+
+	bool fits = chain.append(virtio_core::hostToDevice, arch::dma_buffer_view{nullptr,
+			header, sizeof(VirtRequest)});
+
+	if(request->type == VIRTIO_BLK_T_IN) {
+		fits = fits && chain.append(virtio_core::deviceToHost, arch::dma_buffer_view{nullptr,
+				request->buffer, 512 * request->numSectors});
+	}else if(request->type == VIRTIO_BLK_T_OUT) {
+		fits = fits && chain.append(virtio_core::hostToDevice, arch::dma_buffer_view{nullptr,
+				request->buffer, 512 * request->numSectors});
+	}else{
+		fits = fits && chain.append(virtio_core::hostToDevice, arch::dma_buffer_view{nullptr,
+				&request->segment, sizeof(DiscardWriteZeroesSegment)});
+	}
+
+	fits = fits && chain.append(virtio_core::deviceToHost, arch::dma_buffer_view{nullptr,
+			&statusBuffer[slot], 1});
+	assert(fits && "maxSectors() does not fit into the indirect table");
+
+	if(logInitiateRetire)
+		std::cout << "Submitting request of " << request->numSectors
+				<< " sectors using " << chain.size() << " indirect descriptors" << std::endl;
+
+	// The whole request only consumes a single descriptor of the virtq.
+	auto handle = co_await queue->obtainDescriptor();
+	handle.setupIndirect(chain.table());
+
+	queue->postDescriptor(handle, request, [] (virtio_core::Request *base_request) {
+		auto request = static_cast<UserRequest *>(base_request);
+		request->queue->_releaseIndirectSlot(request->indirectSlot);
+		completeRequest(request);
+	});
+}
 
 // --------------------------------------------------------
 // Device
@@ -22,31 +215,98 @@ UserRequest::UserRequest(bool write_, uint64_t sector_, void *buffer_, size_t nu
 
 Device::Device(std::unique_ptr<virtio_core::Transport> transport, int64_t parent_id)
 : blockfs::BlockDevice{512, parent_id}, _transport{std::move(transport)},
-		_requestQueue{nullptr}, _size{0} { }
+		_size{0} { }
 
 void Device::runDevice() {
+	bool useIndirect = false;
+	if(_transport->checkDeviceFeature(virtio_core::VIRTIO_RING_F_INDIRECT_DESC)) {
+		_transport->acknowledgeDriverFeature(virtio_core::VIRTIO_RING_F_INDIRECT_DESC);
+		useIndirect = true;
+	}
+
+	bool useMq = false;
+	if(_transport->checkDeviceFeature(VIRTIO_BLK_F_MQ)) {
+		_transport->acknowledgeDriverFeature(VIRTIO_BLK_F_MQ);
+		useMq = true;
+	}
+
+	bool useSegMax = false;
+	if(_transport->checkDeviceFeature(VIRTIO_BLK_F_SEG_MAX)) {
+		_transport->acknowledgeDriverFeature(VIRTIO_BLK_F_SEG_MAX);
+		useSegMax = true;
+	}
+
+	bool useDiscard = false;
+	if(_transport->checkDeviceFeature(VIRTIO_BLK_F_DISCARD)) {
+		_transport->acknowledgeDriverFeature(VIRTIO_BLK_F_DISCARD);
+		useDiscard = true;
+	}
+
+	bool useWriteZeroes = false;
+	if(_transport->checkDeviceFeature(VIRTIO_BLK_F_WRITE_ZEROES)) {
+		_transport->acknowledgeDriverFeature(VIRTIO_BLK_F_WRITE_ZEROES);
+		useWriteZeroes = true;
+	}
+
 	_transport->finalizeFeatures();
-	_transport->claimQueues(1);
-	_requestQueue = _transport->setupQueue(0);
+
+	size_t numQueues = 1;
+	if(useMq)
+		numQueues = std::max(_transport->space().load(spec::regs::numQueues), uint16_t{1});
+	if(useSegMax)
+		_segMax = _transport->space().load(spec::regs::segMax);
+	if(useDiscard)
+		_maxDiscardSectors = _transport->space().load(spec::regs::maxDiscardSectors);
+	if(useWriteZeroes)
+		_maxWriteZeroesSectors = _transport->space().load(spec::regs::maxWriteZeroesSectors);
+
+	_transport->claimQueues(numQueues);
+	for(size_t i = 0; i < numQueues; i++)
+		_queues.push_back(std::make_unique<RequestQueue>(_transport->setupQueue(i), useIndirect));
 
 	auto size = static_cast<uint64_t>(_transport->space().load(spec::regs::capacity[0]))
 			| (static_cast<uint64_t>(_transport->space().load(spec::regs::capacity[1])) << 32);
-	std::cout << "virtio: Disk size: " << size << " sectors" << std::endl;
+	std::cout << "virtio: Disk size: " << size << " sectors, " << numQueues << " queue(s)"
+			<< (useIndirect ? ", indirect descriptors" : "")
+			<< (_maxDiscardSectors ? ", discard" : "")
+			<< (_maxWriteZeroesSectors ? ", write zeroes" : "") << std::endl;
 	_size = size;
 
 	_transport->runDevice();
 
-	// perform device specific setup
-	virtRequestBuffer = new VirtRequest[_requestQueue->numDescriptors()];
-	statusBuffer = new uint8_t[_requestQueue->numDescriptors()];
+	for(auto &queue : _queues)
+		queue->processRequests();
 
-	// natural alignment makes sure that request headers do not cross page boundaries
-	assert((uintptr_t)virtRequestBuffer % sizeof(VirtRequest) == 0);
+	blockfs::runDevice(this);
+}
 
-	// setup an interrupt for the device
-	_processRequests();
+RequestQueue *Device::_currentQueue() {
+	if(_queues.size() == 1)
+		return _queues.front().get();
 
-	blockfs::runDevice(this);
+	int cpu;
+	HEL_CHECK(helGetCurrentCpu(&cpu));
+	return _queues[cpu % _queues.size()].get();
+}
+
+async::result<void> Device::_transfer(uint32_t type, uint64_t sector,
+		void *buffer, size_t num_sectors, size_t max_sectors) {
+	assert(max_sectors >= 1);
+	auto queue = _currentQueue();
+
+	// Queue all chunks at once; the virtq's capacity bounds the number of requests in flight.
+	std::vector<std::unique_ptr<UserRequest>> requests;
+	for(size_t progress = 0; progress < num_sectors; progress += max_sectors) {
+		auto request = std::make_unique<UserRequest>(type, sector + progress,
+				buffer ? (char *)buffer + 512 * progress : nullptr,
+				std::min(num_sectors - progress, max_sectors));
+		queue->pendingQueue.push(request.get());
+		requests.push_back(std::move(request));
+	}
+	queue->pendingDoorbell.raise();
+
+	for(auto &request : requests)
+		co_await request->event.wait();
 }
 
 async::result<void> Device::readSectors(uint64_t sector,
@@ -55,19 +315,9 @@ async::result<void> Device::readSectors(uint64_t sector,
 	assert(!((uintptr_t)buffer % 512));
 //	printf("readSectors(%lu, %lu)\n", sector, num_sectors);
 
-	// Limit to ensure that we don't monopolize the device.
-	auto max_sectors = _requestQueue->numDescriptors() / 4;
-	assert(max_sectors >= 1);
-
-	for(size_t progress = 0; progress < num_sectors; progress += max_sectors) {
-		auto request = new UserRequest(false, sector + progress,
-				(char *)buffer + 512 * progress,
-				std::min(num_sectors - progress, max_sectors));
-		_pendingQueue.push(request);
-		_pendingDoorbell.raise();
-		co_await request->event.wait();
-		delete request;
-	}
+	auto queue = _currentQueue();
+	co_await _transfer(VIRTIO_BLK_T_IN, sector, buffer, num_sectors,
+			queue->maxSectors(_segMax));
 }
 
 async::result<void> Device::writeSectors(uint64_t sector,
@@ -76,84 +326,34 @@ async::result<void> Device::writeSectors(uint64_t sector,
 	assert(!((uintptr_t)buffer % 512));
 //	printf("writeSectors(%lu, %lu)\n", sector, num_sectors);
 
-	// Limit to ensure that we don't monopolize the device.
-	auto max_sectors = _requestQueue->numDescriptors() / 4;
-	assert(max_sectors >= 1);
+	auto queue = _currentQueue();
+	co_await _transfer(VIRTIO_BLK_T_OUT, sector, const_cast<void *>(buffer), num_sectors,
+			queue->maxSectors(_segMax));
+}
 
-	for(size_t progress = 0; progress < num_sectors; progress += max_sectors) {
-		auto request = new UserRequest(true, sector + progress,
-				(char *)buffer + 512 * progress,
-				std::min(num_sectors - progress, max_sectors));
-		_pendingQueue.push(request);
-		_pendingDoorbell.raise();
-		co_await request->event.wait();
-		delete request;
+async::result<void> Device::discardSectors(uint64_t sector, size_t num_sectors) {
+	// Discarding is only a hint.
+	if(!_maxDiscardSectors)
+		co_return;
+	if(num_sectors == SIZE_MAX)
+		num_sectors = _size - sector;
+	co_await _transfer(VIRTIO_BLK_T_DISCARD, sector, nullptr, num_sectors,
+			_maxDiscardSectors);
+}
+
+async::result<void> Device::writeZeroes(uint64_t sector, size_t num_sectors) {
+	if(!_maxWriteZeroesSectors) {
+		co_await BlockDevice::writeZeroes(sector, num_sectors);
+		co_return;
 	}
+	if(num_sectors == SIZE_MAX)
+		num_sectors = _size - sector;
+	co_await _transfer(VIRTIO_BLK_T_WRITE_ZEROES, sector, nullptr, num_sectors,
+			_maxWriteZeroesSectors);
 }
 
 async::result<size_t> Device::getSize() {
 	co_return _size * 512;
 }
 
-async::detached Device::_processRequests() {
-	while(true) {
-		if(_pendingQueue.empty()) {
-			co_await _pendingDoorbell.async_wait();
-			continue;
-		}
-
-		auto request = _pendingQueue.front();
-		_pendingQueue.pop();
-		assert(request->numSectors);
-
-		// Setup the descriptor for the request header.
-		virtio_core::Chain chain;
-		chain.append(co_await _requestQueue->obtainDescriptor());
-
-		VirtRequest *header = &virtRequestBuffer[chain.front().tableIndex()];
-		if(request->write) {
-			header->type = VIRTIO_BLK_T_OUT;
-		}else{
-			header->type = VIRTIO_BLK_T_IN;
-		}
-		header->reserved = 0;
-		header->sector = request->sector;
-
-		chain.setupBuffer(virtio_core::hostToDevice, arch::dma_buffer_view{nullptr,
-				header, sizeof(VirtRequest)});
-
-		// Setup descriptors for the transfered data.
-		for(size_t i = 0; i < request->numSectors; i++) {
-			chain.append(co_await _requestQueue->obtainDescriptor());
-			if(request->write) {
-				chain.setupBuffer(virtio_core::hostToDevice, arch::dma_buffer_view{nullptr,
-						(char *)request->buffer + 512 * i, 512});
-			}else{
-				chain.setupBuffer(virtio_core::deviceToHost, arch::dma_buffer_view{nullptr,
-						(char *)request->buffer + 512 * i, 512});
-			}
-		}
-
-		if(logInitiateRetire)
-			std::cout << "Submitting " << request->numSectors
-					<< " data descriptors" << std::endl;
-
-		// Setup a descriptor for the status byte.
-		chain.append(co_await _requestQueue->obtainDescriptor());
-		chain.setupBuffer(virtio_core::deviceToHost, arch::dma_buffer_view{nullptr,
-				&statusBuffer[chain.front().tableIndex()], 1});
-
-		// Submit the request to the device
-		_requestQueue->postDescriptor(chain.front(), request,
-				[] (virtio_core::Request *base_request) {
-			auto request = static_cast<UserRequest *>(base_request);
-			if(logInitiateRetire)
-				std::cout << "Retiring " << request->numSectors
-						<< " data descriptors" << std::endl;
-			request->event.raise();
-		});
-		_requestQueue->notify();
-	}
-}
-
 } } // namespace block::virtio
@@ -1,6 +1,7 @@
 
 #include <memory>
 #include <queue>
+#include <vector>
 
 #include <blockfs.hpp>
 #include <core/virtio/core.hpp>
@@ -20,34 +21,109 @@ struct VirtRequest {
 };
 static_assert(sizeof(VirtRequest) == 16, "Bad sizeof(VirtRequest)");
 
+// Payload of VIRTIO_BLK_T_DISCARD and VIRTIO_BLK_T_WRITE_ZEROES requests.
+struct DiscardWriteZeroesSegment {
+	uint64_t sector;
+	uint32_t numSectors;
+	uint32_t flags;
+};
+static_assert(sizeof(DiscardWriteZeroesSegment) == 16, "Bad sizeof(DiscardWriteZeroesSegment)");
+
 enum {
 	VIRTIO_BLK_T_IN = 0,
-	VIRTIO_BLK_T_OUT = 1
+	VIRTIO_BLK_T_OUT = 1,
+	VIRTIO_BLK_T_DISCARD = 11,
+	VIRTIO_BLK_T_WRITE_ZEROES = 13
+};
+
+enum {
+	VIRTIO_BLK_F_SEG_MAX = 2,
+	VIRTIO_BLK_F_MQ = 12,
+	VIRTIO_BLK_F_DISCARD = 13,
+	VIRTIO_BLK_F_WRITE_ZEROES = 14
 };
 
 namespace spec::regs {
 	inline constexpr arch::scalar_register<uint32_t> capacity[] = {
 			arch::scalar_register<uint32_t>{0},
 			arch::scalar_register<uint32_t>{4}};
+	inline constexpr arch::scalar_register<uint32_t> segMax{12};
+	inline constexpr arch::scalar_register<uint16_t> numQueues{34};
+	inline constexpr arch::scalar_register<uint32_t> maxDiscardSectors{36};
+	inline constexpr arch::scalar_register<uint32_t> maxWriteZeroesSectors{48};
 }
 
 struct Device;
+struct RequestQueue;
 
 // --------------------------------------------------------
 // UserRequest
 // --------------------------------------------------------
 
 struct UserRequest : virtio_core::Request {
-	UserRequest(bool write, uint64_t sector, void *buffer, size_t num_sectors);
+	UserRequest(uint32_t type, uint64_t sector, void *buffer, size_t num_sectors);
 
-	bool write;
+	uint32_t type;
 	uint64_t sector;
 	void *buffer;
 	size_t numSectors;
 
+	// Payload for discard and write zeroes requests.
+	// Aligned such that it does not cross a page boundary.
+	alignas(16) DiscardWriteZeroesSegment segment;
+
+	// Slot of the indirect descriptor table (if indirect descriptors are used).
+	size_t indirectSlot = 0;
+	RequestQueue *queue = nullptr;
+
 	async::oneshot_primitive event;
 };
 
+// --------------------------------------------------------
+// RequestQueue
+// --------------------------------------------------------
+
+// Each virtq of the device has its own RequestQueue.
+struct RequestQueue {
+	// Number of descriptors in each indirect table (i.e., one page of descriptors).
+	static constexpr size_t indirectTableSize = 0x1000 / sizeof(virtio_core::spec::Descriptor);
+	// Number of indirect tables per virtq; bounds the number of requests in flight.
+	static constexpr size_t numIndirectSlots = 32;
+
+	RequestQueue(virtio_core::Queue *queue, bool useIndirect);
+
+	// Returns the maximal number of sectors of a single read or write request.
+	size_t maxSectors(size_t segMax);
+
+	// Submits requests from pendingQueue to the device.
+	async::detached processRequests();
+
+	virtio_core::Queue *queue;
+	bool useIndirect;
+
+	// Stores UserRequest objects that have not been submitted yet.
+	std::queue<UserRequest *> pendingQueue;
+	async::recurring_event pendingDoorbell;
+
+	// These two buffers store virtio-block request header and status bytes.
+	// Without indirect descriptors, they are indexed by the index of the request's
+	// first descriptor; otherwise, they are indexed by the indirect slot.
+	VirtRequest *virtRequestBuffer;
+	uint8_t *statusBuffer;
+
+private:
+	async::result<size_t> _obtainIndirectSlot();
+	void _releaseIndirectSlot(size_t slot);
+
+	async::result<void> _submitDirect(UserRequest *request);
+	async::result<void> _submitIndirect(UserRequest *request);
+
+	// Indirect descriptor tables, one page per slot.
+	virtio_core::spec::Descriptor *_indirectTables = nullptr;
+	std::vector<size_t> _freeIndirectSlots;
+	async::recurring_event _indirectSlotDoorbell;
+};
+
 // --------------------------------------------------------
 // Device
 // --------------------------------------------------------
@@ -63,25 +139,31 @@ struct Device : blockfs::BlockDevice {
 	async::result<void> writeSectors(uint64_t sector,
 			const void *buffer, size_t num_sectors) override;
 
+	async::result<void> discardSectors(uint64_t sector, size_t num_sectors) override;
+
+	async::result<void> writeZeroes(uint64_t sector, size_t num_sectors) override;
+
 	async::result<size_t> getSize() override;
 
 private:
-	// Submits requests from _pendingQueue to the device.
-	async::detached _processRequests();
+	// Returns the queue that requests of the current CPU are submitted to.
+	RequestQueue *_currentQueue();
 
-	std::unique_ptr<virtio_core::Transport> _transport;
+	// Splits a request into chunks of at most max_sectors, submits all of them at once
+	// and waits until all of them are completed.
+	async::result<void> _transfer(uint32_t type, uint64_t sector,
+			void *buffer, size_t num_sectors, size_t max_sectors);
 
-	// The single virtq of this device.
-	virtio_core::Queue *_requestQueue;
+	std::unique_ptr<virtio_core::Transport> _transport;
 
-	// Stores UserRequest objects that have not been submitted yet.
-	std::queue<UserRequest *> _pendingQueue;
-	async::recurring_event _pendingDoorbell;
+	// One RequestQueue per virtq (more than one with VIRTIO_BLK_F_MQ).
+	std::vector<std::unique_ptr<RequestQueue>> _queues;
 
-	// these two buffer store virtio-block request header and status bytes
-	// they are indexed by the index of the request's first descriptor
-	VirtRequest *virtRequestBuffer;
-	uint8_t *statusBuffer;
+	// Maximal number of data segments per request (VIRTIO_BLK_F_SEG_MAX).
+	size_t _segMax = 0;
+	// Maximal number of sectors per discard / write zeroes request (0 if unsupported).
+	size_t _maxDiscardSectors = 0;
+	size_t _maxWriteZeroesSectors = 0;
 
 	// The size of the disk
 	size_t _size;
@@ -20,6 +20,17 @@ struct BlockDevice {
 		throw std::runtime_error("BlockDevice does not support writeSectors()");
 	}
 
+	// For discardSectors() and writeZeroes(), a num_sectors of SIZE_MAX
+	// refers to all sectors up to the end of the device.
+
+	// Informs the device that the given sectors do not contain useful data anymore.
+	// This is only a hint; the default implementation does nothing.
+	virtual async::result<void> discardSectors(uint64_t sector, size_t num_sectors);
+
+	// Fills the given sectors with zeros. Devices that can do this without transferring
+	// a buffer override this; the default implementation writes a zeroed buffer.
+	virtual async::result<void> writeZeroes(uint64_t sector, size_t num_sectors);
+
 	virtual async::result<size_t> getSize() = 0;
 
 	virtual async::result<void> handleIoctl(managarm::fs::GenericIoctlRequest &req, helix::UniqueDescriptor conversation) {
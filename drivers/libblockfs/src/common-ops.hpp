@@ -66,20 +66,11 @@ async::result<protocols::fs::Error> doFlock(void *object, int flags) {
 
 namespace detail {
 
+// Determines the part of the page cache that a read of length bytes at offset returns
+// and advances offset accordingly.
 template <Inode T>
-async::result<protocols::fs::ReadResult> doReadImpl(T *inode, void *buffer, size_t length, auto &offset) {
-	protocols::ostrace::Timer timer;
-	frg::scope_exit evtOnExit{[&] {
-		ostContext.emit(
-			ostEvtRead,
-			ostAttrNumBytes(length),
-			ostAttrTime(timer.elapsed())
-		);
-	}};
-
-	if (!length)
-		co_return size_t{0};
-
+async::result<protocols::fs::ReadMemoryResult>
+doReadRangeImpl(T *inode, size_t length, auto &offset) {
 	// TODO(geert): Pass cancellation token
 	co_await inode->readyEvent.wait();
 
@@ -96,14 +87,51 @@ async::result<protocols::fs::ReadResult> doReadImpl(T *inode, void *buffer, size
 	auto chunkOffset = offset;
 	offset += chunkSize;
 
-	// TODO: Add a sendFromMemory action to exchangeMsgs to avoid
-	// having to copy this data twice.
+	co_return protocols::fs::ReadMemoryRange{inode->accessMemory(), chunkOffset, chunkSize};
+}
+
+template <Inode T>
+async::result<protocols::fs::ReadResult> doReadImpl(T *inode, void *buffer, size_t length, auto &offset) {
+	protocols::ostrace::Timer timer;
+	frg::scope_exit evtOnExit{[&] {
+		ostContext.emit(
+			ostEvtRead,
+			ostAttrNumBytes(length),
+			ostAttrTime(timer.elapsed())
+		);
+	}};
+
+	if (!length)
+		co_return size_t{0};
+
+	auto range = co_await doReadRangeImpl(inode, length, offset);
+	if (!range)
+		co_return std::unexpected{range.error()};
+
 	auto readMemory = co_await helix_ng::readMemory(
-		inode->accessMemory(),
-		chunkOffset, chunkSize, buffer);
+		range->memory,
+		range->offset, range->length, buffer);
 	HEL_CHECK(readMemory.error());
 
-	co_return chunkSize;
+	co_return range->length;
+}
+
+template <Inode T>
+async::result<protocols::fs::ReadMemoryResult>
+doReadMemoryImpl(T *inode, size_t length, auto &offset) {
+	protocols::ostrace::Timer timer;
+	frg::scope_exit evtOnExit{[&] {
+		ostContext.emit(
+			ostEvtRead,
+			ostAttrNumBytes(length),
+			ostAttrTime(timer.elapsed())
+		);
+	}};
+
+	if (!length)
+		co_return protocols::fs::ReadMemoryRange{inode->accessMemory(), 0, 0};
+
+	co_return co_await doReadRangeImpl(inode, length, offset);
 }
 
 template <Inode T>
@@ -183,6 +211,42 @@ async::result<protocols::fs::ReadResult> doPread(void *object, int64_t offset, h
 }
 
 
+template <FileSystem T>
+async::result<protocols::fs::ReadMemoryResult> doReadMemory(void *object, helix_ng::CredentialsView,
+		size_t length, async::cancellation_token) {
+	using File = typename T::File;
+	using Inode = typename T::Inode;
+
+	auto self = static_cast<File *>(object);
+	auto inode = std::static_pointer_cast<Inode>(self->inode);
+
+	co_await self->mutex.async_lock();
+	frg::unique_lock lock{frg::adopt_lock, self->mutex};
+
+	co_return co_await detail::doReadMemoryImpl(inode.get(), length, self->offset);
+}
+
+
+template <FileSystem T>
+async::result<protocols::fs::ReadMemoryResult> doPreadMemory(void *object, int64_t offset,
+		helix_ng::CredentialsView, size_t length) {
+	using File = typename T::File;
+	using Inode = typename T::Inode;
+
+	if (offset < 0)
+		co_return std::unexpected{protocols::fs::Error::illegalArguments};
+	size_t unsignedOffset = offset;
+
+	auto self = static_cast<File *>(object);
+	auto inode = std::static_pointer_cast<Inode>(self->inode);
+
+	co_await self->mutex.async_lock_shared();
+	frg::shared_lock lock{frg::adopt_lock, self->mutex};
+
+	co_return co_await detail::doReadMemoryImpl(inode.get(), length, unsignedOffset);
+}
+
+
 template <FileSystem T>
 async::result<frg::expected<protocols::fs::Error, size_t>> doWrite(void *object, helix_ng::CredentialsView,
 		const void *buffer, size_t length) {
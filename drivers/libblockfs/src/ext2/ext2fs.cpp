@@ -13,6 +13,7 @@
 #include <core/align.hpp>
 #include <core/clock.hpp>
 #include <core/logging.hpp>
+#include <frg/scope_exit.hpp>
 #include <helix/ipc.hpp>
 #include <helix/memory.hpp>
 
@@ -284,6 +285,11 @@ async::result<frg::expected<protocols::fs::Error>> Inode::removeEntry(std::strin
 					target->diskInode(), fs.inodeSize);
 			HEL_CHECK(syncInode.error());
 
+			fs.dentryInvalidations.post(number, std::move(name));
+			// The inode number of a removed directory can be reused.
+			if(target->fileType == kTypeDirectory)
+				fs.dentryInvalidations.post(target->number, {});
+
 			co_return {};
 		}
 
@@ -356,6 +362,7 @@ Inode::link(std::string name, int64_t ino, blockfs::FileType type) {
 	auto result = co_await insertEntry(name, ino, type);
 	if(!result)
 		co_return std::unexpected{result.error()};
+	fs.dentryInvalidations.post(number, std::move(name));
 	co_return result.value();
 }
 
@@ -439,6 +446,7 @@ async::result<std::expected<DirEntry, protocols::fs::Error>> Inode::mkdir(std::s
 	auto result = co_await insertEntry(name, dirNode->number, kTypeDirectory);
 	if(!result)
 		co_return std::unexpected{result.error()};
+	fs.dentryInvalidations.post(number, std::move(name));
 	co_return result.value();
 }
 
@@ -469,6 +477,7 @@ async::result<std::expected<DirEntry, protocols::fs::Error>> Inode::symlink(std:
 	auto result = co_await insertEntry(name, newNode->number, kTypeSymlink);
 	if(!result)
 		co_return std::unexpected{result.error()};
+	fs.dentryInvalidations.post(number, std::move(name));
 	co_return result.value();
 }
 
@@ -1042,41 +1051,76 @@ async::detached FileSystem::manageFileData(std::shared_ptr<Inode> inode) {
 		co_await submit.async_wait();
 		HEL_CHECK(manage.error());
 		assert(manage.offset() + manage.length() <= ((inode->fileSize() + 0xFFF) & ~size_t(0xFFF)));
+		assert(!(manage.offset() % inode->fs.blockSize));
+
+		inode->pendingManage.push_back({manage.type(), manage.offset(), manage.length()});
+
+		// If all handlers are busy, the request is picked up (and possibly coalesced
+		// with adjacent requests) once one of them becomes free.
+		if(inode->numManageHandlers < maxManageHandlers) {
+			inode->numManageHandlers++;
+			handleManageRequests(inode);
+		}
+	}
+}
+
+async::detached FileSystem::handleManageRequests(std::shared_ptr<Inode> inode) {
+	while(!inode->pendingManage.empty()) {
+		auto request = inode->pendingManage.front();
+		inode->pendingManage.pop_front();
 
 		protocols::ostrace::Timer timer;
 
-		if(manage.type() == kHelManageInitialize) {
-			helix::Mapping file_map{helix::BorrowedDescriptor{inode->backingMemory},
-					static_cast<ptrdiff_t>(manage.offset()), manage.length(), kHelMapProtWrite};
+		if(request.type == kHelManageInitialize) {
+			// Coalesce queued requests that directly follow this one.
+			std::vector<ManageRequest> batch{request};
+			auto end = request.offset + request.length;
+			while(true) {
+				auto it = std::ranges::find_if(inode->pendingManage, [&] (const ManageRequest &other) {
+					return other.type == kHelManageInitialize && other.offset == end
+							&& end + other.length - request.offset <= maxManageCoalesce;
+				});
+				if(it == inode->pendingManage.end())
+					break;
+				batch.push_back(*it);
+				end += it->length;
+				inode->pendingManage.erase(it);
+			}
+
+			auto mapping = mapBackingMemory(inode.get(), end);
 
-			assert(!(manage.offset() % inode->fs.blockSize));
-			size_t backed_size = std::min(manage.length(), inode->fileSize() - manage.offset());
-			size_t num_blocks = (backed_size + (inode->fs.blockSize - 1)) / inode->fs.blockSize;
+			size_t backed_size = std::min(end - request.offset, inode->fileSize() - request.offset);
+			size_t num_blocks = (backed_size + (blockSize - 1)) / blockSize;
 
-			assert(num_blocks * inode->fs.blockSize <= manage.length());
-			co_await inode->fs.readDataBlocks(inode, manage.offset() / inode->fs.blockSize,
-					num_blocks, file_map.get());
+			assert(num_blocks * blockSize <= end - request.offset);
+			co_await readDataBlocks(inode, request.offset / blockSize, num_blocks,
+					reinterpret_cast<char *>(mapping->get()) + request.offset);
 
-			HEL_CHECK(helUpdateMemory(inode->backingMemory, kHelManageInitialize,
-					manage.offset(), manage.length()));
+			for(auto &part : batch)
+				HEL_CHECK(helUpdateMemory(inode->backingMemory, kHelManageInitialize,
+						part.offset, part.length));
 		}else{
-			assert(manage.type() == kHelManageWriteback);
+			assert(request.type == kHelManageWriteback);
+
+			co_await inode->writebackMutex.async_lock();
+			frg::scope_exit unlock{[&] {
+				inode->writebackMutex.unlock();
+			}};
 
-			helix::Mapping fileMap{helix::BorrowedDescriptor{inode->backingMemory},
-					static_cast<ptrdiff_t>(manage.offset()), manage.length(), kHelMapProtRead};
+			auto mapping = mapBackingMemory(inode.get(), request.offset + request.length);
 
-			assert(!(manage.offset() % inode->fs.blockSize));
-			size_t backedSize = std::min(manage.length(), inode->fileSize() - manage.offset());
-			auto blockOffset = manage.offset() / inode->fs.blockSize;
-			size_t numBlocks = (backedSize + (inode->fs.blockSize - 1)) / inode->fs.blockSize;
+			size_t backedSize = std::min(request.length, inode->fileSize() - request.offset);
+			auto blockOffset = request.offset / blockSize;
+			size_t numBlocks = (backedSize + (blockSize - 1)) / blockSize;
 
-			assert(numBlocks * inode->fs.blockSize <= manage.length());
+			assert(numBlocks * blockSize <= request.length);
 
-			co_await inode->fs.assignDataBlocks(inode.get(), blockOffset, numBlocks);
-			co_await inode->fs.writeDataBlocks(inode, blockOffset, numBlocks, fileMap.get());
+			co_await assignDataBlocks(inode.get(), blockOffset, numBlocks);
+			co_await writeDataBlocks(inode, blockOffset, numBlocks,
+					reinterpret_cast<char *>(mapping->get()) + request.offset);
 
 			HEL_CHECK(helUpdateMemory(inode->backingMemory, kHelManageWriteback,
-					manage.offset(), manage.length()));
+					request.offset, request.length));
 		}
 
 		ostContext.emit(
@@ -1084,6 +1128,21 @@ async::detached FileSystem::manageFileData(std::shared_ptr<Inode> inode) {
 			ostAttrTime(timer.elapsed())
 		);
 	}
+
+	inode->numManageHandlers--;
+}
+
+std::shared_ptr<helix::Mapping> FileSystem::mapBackingMemory(Inode *inode, size_t end) {
+	if(!inode->backingMapping || inode->backingMapping->size() < end) {
+		// Map the entire memory object such that we only remap when the file grows.
+		size_t size;
+		HEL_CHECK(helMemoryInfo(inode->backingMemory, &size));
+		assert(size >= end);
+		inode->backingMapping = std::make_shared<helix::Mapping>(
+				helix::BorrowedDescriptor{inode->backingMemory},
+				0, size, kHelMapProtRead | kHelMapProtWrite);
+	}
+	return inode->backingMapping;
 }
 
 async::detached FileSystem::manageIndirect(std::shared_ptr<Inode> inode,
@@ -1,5 +1,6 @@
 
 #include <expected>
+#include <deque>
 #include <functional>
 #include <string.h>
 #include <time.h>
@@ -174,6 +175,12 @@ struct DirEntry {
 
 struct FileSystem;
 
+struct ManageRequest {
+	int type;
+	uintptr_t offset;
+	size_t length;
+};
+
 struct Inode final : BaseInode, std::enable_shared_from_this<Inode> {
 	Inode(FileSystem &fs, uint32_t number);
 
@@ -213,6 +220,17 @@ struct Inode final : BaseInode, std::enable_shared_from_this<Inode> {
 	HelHandle frontalMemory;
 	helix::Mapping fileMapping;
 
+	// Mapping of backingMemory that is used to handle manage requests.
+	// It is replaced when the file grows; handlers keep the old mapping alive while they use it.
+	std::shared_ptr<helix::Mapping> backingMapping;
+
+	// Manage requests that were received but are not handled yet.
+	std::deque<ManageRequest> pendingManage;
+	// Number of handleManageRequests() coroutines running for this inode.
+	size_t numManageHandlers = 0;
+	// Writeback allocates data blocks, hence it is not done concurrently.
+	async::mutex writebackMutex;
+
 	helix::BorrowedDescriptor accessMemory() {
 		return helix::BorrowedDescriptor{frontalMemory};
 	}
@@ -269,8 +287,15 @@ struct FileSystem final : BaseFileSystem {
 	async::result<std::shared_ptr<Inode>> createDirectory();
 	async::result<std::shared_ptr<Inode>> createSymlink();
 
+	// Maximal number of manage requests of a single inode that are handled concurrently.
+	static constexpr size_t maxManageHandlers = 4;
+	// Maximal size of coalesced kHelManageInitialize requests.
+	static constexpr size_t maxManageCoalesce = size_t{1} << 20;
+
 	async::detached initiateInode(std::shared_ptr<Inode> inode);
 	async::detached manageFileData(std::shared_ptr<Inode> inode);
+	async::detached handleManageRequests(std::shared_ptr<Inode> inode);
+	std::shared_ptr<helix::Mapping> mapBackingMemory(Inode *inode, size_t end);
 	async::detached manageIndirect(std::shared_ptr<Inode> inode, int order,
 			helix::UniqueDescriptor memory);
 
@@ -309,6 +334,8 @@ struct FileSystem final : BaseFileSystem {
 	helix::Mapping inodeTableMapping;
 
 	std::unordered_map<uint32_t, std::weak_ptr<Inode>> activeInodes;
+
+	InvalidationLog dentryInvalidations;
 };
 
 // --------------------------------------------------------
@@ -346,6 +346,8 @@ constinit protocols::fs::FileOperations fileOperations {
 	.seekEof      = &doSeekEof<FileSystem>,
 	.read         = &doRead<FileSystem>,
 	.pread        = &doPread<FileSystem>,
+	.readMemory   = &doReadMemory<FileSystem>,
+	.preadMemory  = &doPreadMemory<FileSystem>,
 	.write        = &doWrite<FileSystem>,
 	.pwrite       = &doPwrite<FileSystem>,
 	.readEntries  = &readEntries,
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "common.hpp"
+#include <deque>
 #include <memory>
 #include <unordered_set>
 
 #include <async/mutex.hpp>
+#include <async/recurring-event.hpp>
 
 #include <protocols/fs/server.hpp>
 #include <protocols/fs/file-locks.hpp>
@@ -57,6 +59,33 @@ struct BaseFile {
 	bool append;
 };
 
+// Log of directory entries that were changed by the file system.
+// Clients that cache name lookups (i.e., posix) poll it through AwaitInvalidationRequest.
+struct InvalidationLog {
+	// Clients that fall further behind have to drop their whole cache.
+	static constexpr size_t maxEntries = 256;
+
+	struct Entry {
+		uint64_t directory;
+		// Empty if all entries of the directory are invalidated.
+		std::string name;
+	};
+
+	void post(uint64_t directory, std::string name) {
+		if(entries.size() == maxEntries)
+			entries.pop_front();
+		entries.push_back({directory, std::move(name)});
+		sequence++;
+		changed.raise();
+	}
+
+	// Sequence number of the newest entry. entries covers the sequence numbers
+	// (sequence - entries.size(), sequence].
+	uint64_t sequence = 0;
+	std::deque<Entry> entries;
+	async::recurring_event changed;
+};
+
 struct BaseFileSystem {
 	// TODO(qookie): Ideally, these methods would be a part of the concept
 	// instead of being pure virtual methods, but the code that uses these
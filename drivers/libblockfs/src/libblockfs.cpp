@@ -1,14 +1,17 @@
+#include <algorithm>
 #include <async/cancellation.hpp>
 #include <stdio.h>
 #include <string.h>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <sys/epoll.h>
 #include <linux/cdrom.h>
 #include <linux/fs.h>
 
 #include <core/clock.hpp>
 #include <frg/scope_exit.hpp>
+#include <frg/std_compat.hpp>
 #include <helix/ipc.hpp>
 #include <protocols/fs/server.hpp>
 #include <protocols/mbus/client.hpp>
@@ -29,6 +32,54 @@ bool clkInitialized = false;
 BlockDevice::BlockDevice(size_t sector_size, int64_t parent_id)
 : size(0), sectorSize(sector_size), parentId(parent_id) { }
 
+async::result<void> BlockDevice::discardSectors(uint64_t, size_t) {
+	co_return;
+}
+
+async::result<void> BlockDevice::writeZeroes(uint64_t sector, size_t num_sectors) {
+	if(num_sectors == SIZE_MAX)
+		num_sectors = co_await getSize() / sectorSize - sector;
+
+	std::vector<char> zeros(std::max(size_t{64 * 1024}, sectorSize));
+	size_t chunkSectors = zeros.size() / sectorSize;
+	while(num_sectors) {
+		auto n = std::min(num_sectors, chunkSectors);
+		co_await writeSectors(sector, zeros.data(), n);
+		sector += n;
+		num_sectors -= n;
+	}
+}
+
+// Answers an AwaitInvalidationRequest once the log contains entries newer than sequence.
+async::detached serveInvalidations(helix::UniqueDescriptor conversation,
+		ext2fs::FileSystem *fs, uint64_t sequence) {
+	auto &log = fs->dentryInvalidations;
+	while(log.sequence <= sequence)
+		co_await log.changed.async_wait();
+
+	managarm::fs::AwaitInvalidationResponse resp;
+	resp.set_error(managarm::fs::Errors::SUCCESS);
+	resp.set_sequence(log.sequence);
+
+	size_t first = 0;
+	if(sequence < log.sequence - log.entries.size()) {
+		resp.set_overflow(true);
+	}else{
+		first = log.entries.size() - (log.sequence - sequence);
+	}
+	for(size_t i = first; i < log.entries.size(); i++) {
+		resp.add_directories(log.entries[i].directory);
+		resp.add_names(log.entries[i].name);
+	}
+
+	auto [send_head, send_tail] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadTail(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(send_head.error());
+	HEL_CHECK(send_tail.error());
+}
+
 async::detached servePartition(helix::UniqueLane lane, gpt::Partition *partition, std::unique_ptr<raw::RawFs> rawFs) {
 	std::cout << "unix device: Connection" << std::endl;
 
@@ -264,6 +315,30 @@ async::detached servePartition(helix::UniqueLane lane, gpt::Partition *partition
 				helix_ng::sendBuffer(ser.data(), ser.size())
 			);
 			HEL_CHECK(send_resp.error());
+		}else if(preamble.id() == managarm::fs::AwaitInvalidationRequest::message_id) {
+			auto req = bragi::parse_head_only<managarm::fs::AwaitInvalidationRequest>(recv_head);
+			if(!req) {
+				std::cout << "libblockfs: Rejecting request due to decoding failure" << std::endl;
+				break;
+			}
+
+			if(!fs) {
+				managarm::fs::AwaitInvalidationResponse resp;
+				resp.set_error(managarm::fs::Errors::ILLEGAL_OPERATION_TARGET);
+
+				auto [send_head, send_tail] = co_await helix_ng::exchangeMsgs(
+					conversation,
+					helix_ng::sendBragiHeadTail(resp, frg::stl_allocator{})
+				);
+				HEL_CHECK(send_head.error());
+				HEL_CHECK(send_tail.error());
+				continue;
+			}
+
+			// This request blocks until the file system changes, so it is answered
+			// asynchronously and does not hold up other superblock requests.
+			serveInvalidations(std::move(conversation),
+					static_cast<ext2fs::FileSystem *>(fs.get()), req->sequence());
 		} else if(preamble.id() == managarm::fs::GenericIoctlRequest::message_id) {
 			auto req = bragi::parse_head_only<managarm::fs::GenericIoctlRequest>(recv_head);
 
@@ -244,6 +244,11 @@ extern inline __attribute__ (( always_inline )) HelError helSetPriority(HelHandl
 	return helSyscall2(kHelCallSetPriority, (HelWord)handle, (HelWord)priority);
 };
 
+extern inline __attribute__ (( always_inline )) HelError helSetTimerSlack(HelHandle handle,
+		uint64_t slack) {
+	return helSyscall2(kHelCallSetTimerSlack, (HelWord)handle, (HelWord)slack);
+};
+
 extern inline __attribute__ (( always_inline )) HelError helKillThread(HelHandle handle) {
 	return helSyscall1(kHelCallKillThread, (HelWord)handle);
 };
@@ -296,6 +301,13 @@ extern inline __attribute__ (( always_inline )) HelError helGetClock(uint64_t *c
 	return error;
 };
 
+extern inline __attribute__ (( always_inline )) HelError helAccessClockPage(HelHandle *handle) {
+	HelWord handle_word;
+	HelError error = helSyscall0_1(kHelCallAccessClockPage, &handle_word);
+	*handle = (HelHandle)handle_word;
+	return error;
+};
+
 extern inline __attribute__ (( always_inline )) HelError helCreateStream(HelHandle *lane1,
 		HelHandle *lane2, uint32_t attach_credentials) {
 	HelWord out_lane1;
@@ -320,6 +332,25 @@ extern inline __attribute__ (( always_inline )) HelError helFutexWake(int *point
 	return helSyscall2(kHelCallFutexWake, (HelWord)pointer, count);
 };
 
+extern inline __attribute__ (( always_inline )) HelError helFutexWaitv(
+		const struct HelFutexWaitItem *items, size_t count, int64_t deadline, size_t *index) {
+	HelWord out;
+	HelError error = helSyscall3_1(kHelCallFutexWaitv, (HelWord)items, (HelWord)count,
+			(HelWord)deadline, &out);
+	*index = (size_t)out;
+	return error;
+};
+
+extern inline __attribute__ (( always_inline )) HelError helFutexRequeue(int *pointer,
+		int *target, unsigned int wakeCount, unsigned int requeueCount, int expected,
+		uint32_t flags, unsigned int *count) {
+	HelWord out;
+	HelError error = helSyscall6_1(kHelCallFutexRequeue, (HelWord)pointer, (HelWord)target,
+			(HelWord)wakeCount, (HelWord)requeueCount, (HelWord)expected, (HelWord)flags, &out);
+	*count = (unsigned int)out;
+	return error;
+};
+
 extern inline __attribute__ (( always_inline )) HelError helCreateOneshotEvent(HelHandle *handle) {
 	HelWord handle_word;
 	HelError error = helSyscall0_1(kHelCallCreateOneshotEvent, &handle_word);
@@ -358,6 +389,18 @@ extern inline __attribute__ (( always_inline )) HelError helAutomateIrq(HelHandl
 			(HelWord)kernlet);
 };
 
+extern inline __attribute__ (( always_inline )) HelError helSetIrqAffinity(HelHandle handle,
+		uint8_t *mask, size_t size) {
+	return helSyscall3(kHelCallSetIrqAffinity, (HelWord)handle, (HelWord)mask,
+			(HelWord)size);
+};
+
+extern inline __attribute__ (( always_inline )) HelError helQueryIrqStats(HelHandle handle,
+		struct HelIrqStats *stats, uint64_t *cpuRaises, size_t numCpus) {
+	return helSyscall4(kHelCallQueryIrqStats, (HelWord)handle, (HelWord)stats,
+			(HelWord)cpuRaises, (HelWord)numCpus);
+};
+
 extern inline __attribute__ (( always_inline )) HelError helAccessIo(uintptr_t *port_array,
 		size_t num_ports, HelHandle *handle) {
 	HelWord out_handle;
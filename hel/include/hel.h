@@ -18,7 +18,7 @@
 
 enum {
 	// largest system call number plus 1
-	kHelNumCalls = 107,
+	kHelNumCalls = 113,
 
 	kHelCallLog = 1,
 	kHelCallPanic = 10,
@@ -63,6 +63,7 @@ enum {
 	kHelCallCreateThread = 67,
 	kHelCallQueryThreadStats = 95,
 	kHelCallSetPriority = 85,
+	kHelCallSetTimerSlack = 112,
 	kHelCallYield = 34,
 	kHelCallSubmitObserve = 74,
 	kHelCallKillThread = 87,
@@ -73,6 +74,7 @@ enum {
 	kHelCallQueryRegisterInfo = 102,
 	kHelCallWriteFsBase = 41,
 	kHelCallGetClock = 42,
+	kHelCallAccessClockPage = 111,
 	kHelCallSubmitAwaitClock = 80,
 	kHelCallCreateVirtualizedCpu = 37,
 	kHelCallRunVirtualizedCpu = 38,
@@ -88,6 +90,8 @@ enum {
 
 	kHelCallFutexWait = 73,
 	kHelCallFutexWake = 71,
+	kHelCallFutexWaitv = 107,
+	kHelCallFutexRequeue = 108,
 
 	kHelCallCreateOneshotEvent = 96,
 	kHelCallCreateBitsetEvent = 97,
@@ -96,6 +100,8 @@ enum {
 	kHelCallAcknowledgeIrq = 81,
 	kHelCallSubmitAwaitEvent = 82,
 	kHelCallAutomateIrq = 94,
+	kHelCallSetIrqAffinity = 109,
+	kHelCallQueryIrqStats = 110,
 
 	kHelCallAccessIo = 11,
 	kHelCallEnableIo = 12,
@@ -208,7 +214,14 @@ enum {
 	kHelActionRecvInline = 7,
 	kHelActionRecvToBuffer = 3,
 	kHelActionPushDescriptor = 2,
-	kHelActionPullDescriptor = 4
+	kHelActionPullDescriptor = 4,
+	// Moves page-aligned memory to the receiver; the range is unmapped from the sender.
+	kHelActionSendPages = 12,
+	kHelActionRecvPages = 13,
+	// Sends from the memory object given by handle; buffer holds the offset into it.
+	// If the memory object is shorter than the range when the data is transferred,
+	// the transfer is truncated. The result (HelLengthResult) holds the transferred length.
+	kHelActionSendFromMemory = 14
 };
 
 enum {
@@ -243,6 +256,8 @@ struct HelDescriptorInfo {
 enum HelAllocFlags {
 	kHelAllocContinuous = 4,
 	kHelAllocOnDemand = 1,
+	// Back naturally aligned ranges of the memory object by large pages where possible.
+	kHelAllocLargePages = 8,
 };
 
 struct HelAllocRestrictions {
@@ -265,7 +280,9 @@ enum HelMapFlags {
 	kHelMapProtExecute = 1024,
 	kHelMapDontRequireBacking = 128,
 	kHelMapFixed = 2048,
-	kHelMapFixedNoReplace = 4096
+	kHelMapFixedNoReplace = 4096,
+	// Fault in (and map) the whole range before returning.
+	kHelMapPopulate = 8192
 };
 
 enum HelSliceFlags {
@@ -586,12 +603,21 @@ struct HelSqExchangeMsgs {
 	uint32_t flags;
 };
 
+//! Flag for HelSqAwaitClock: use the given slack instead of the thread's timer slack.
+static const uint32_t kHelAwaitClockSlack = (1 << 0);
+
 //! SQ data for kHelSubmitAwaitClock.
 struct HelSqAwaitClock {
 	//! Deadline in nanoseconds since boot.
 	uint64_t counter;
 	//! Tag to cancel this operation.
 	uint64_t cancellationTag;
+	//! Flags (kHelAwaitClock*).
+	uint32_t flags;
+	uint32_t reserved;
+	//! Nanoseconds by which the completion may be delayed (if kHelAwaitClockSlack is set).
+	//! This allows the kernel to complete multiple timers in a single interrupt.
+	uint64_t slack;
 };
 
 //! SQ data for kHelSubmitAwaitEvent.
@@ -731,6 +757,17 @@ struct HelLengthResult {
 	size_t length;
 };
 
+//! Result of kHelActionRecvPages.
+//! The receiver owns the mapping and has to unmap it (the mapping is rounded up to full pages).
+struct HelPagesResult {
+	HelError error;
+	int reserved;
+	//! Number of bytes that were received.
+	size_t length;
+	//! Start of the mapping that contains the received bytes.
+	void *pointer;
+};
+
 struct HelHandleResult {
 	HelError error;
 	int reserved;
@@ -756,6 +793,54 @@ union HelKernletData {
 
 struct HelThreadStats {
 	uint64_t userTime;
+	//! Number of page faults that the thread took on user addresses.
+	uint64_t numPageFaults;
+};
+
+struct HelFutexWaitItem {
+	int *pointer;
+	int expected;
+};
+
+enum HelFutexRequeueFlags {
+	kHelFutexRequeueCompare = 1
+};
+
+//! Number of buckets of the IRQ latency histogram.
+enum {
+	kHelIrqLatencyBuckets = 16
+};
+
+struct HelIrqStats {
+	//! CPU that the IRQ is currently routed to.
+	uint32_t targetCpu;
+	//! Number of CPUs in the system.
+	uint32_t numCpus;
+	//! Histogram of the time between raising and acknowledging the IRQ.
+	//! Bucket i counts IRQs that were acknowledged within 2^i microseconds
+	//! (but not within 2^(i - 1) microseconds); the last bucket counts all slower IRQs.
+	uint64_t latencyHistogram[kHelIrqLatencyBuckets];
+};
+
+enum {
+	//! The counter parameters of the ::HelClockPage are valid.
+	//! If this flag is not set, userspace needs to call ::helGetClock.
+	kHelClockPageCounterValid = 1
+};
+
+//! Layout of the page returned by ::helAccessClockPage.
+//!
+//! The page is protected by a seqlock: readers load @p seqlock before and after reading
+//! the other fields and retry if the values differ or if the seqlock is odd.
+//! If ::kHelClockPageCounterValid is set, the monotone clock (see ::helGetClock) equals
+//! ((counter * @p scale) >> @p shift) + @p offset (computed using 128-bit arithmetic),
+//! where counter is the architecture's user-readable timestamp counter (i.e., the TSC on x86).
+struct HelClockPage {
+	uint64_t seqlock;
+	uint32_t flags;
+	uint32_t shift;
+	uint64_t scale;
+	int64_t offset;
 };
 
 enum {
@@ -892,6 +977,10 @@ HEL_C_LINKAGE HelError helAlertQueue(HelHandle queueHandle);
 //! @param[in] size
 //!    	Size of the memory object in bytes.
 //!    	Must be aligned to the system's page size.
+//! @param[in] flags
+//!    	Flags controlling the allocation (see ::HelAllocFlags).
+//!    	If kHelAllocLargePages is set, naturally aligned ranges of the memory object
+//!    	are backed (and mapped) by large pages unless physical memory is too fragmented.
 //! @param[in] restrictions
 //!    	Specifies restrictions for the kernel's memory allocator.
 //!    	May be @p NULL if there are no restrictions.
@@ -995,6 +1084,11 @@ HEL_C_LINKAGE HelError helCreateSpace(HelHandle *handle);
 //! @param[in] size
 //!    	Size of the mappping in bytes.
 //!    	Must be aligned to the system's page size.
+//! @param[in] flags
+//!     Protection and placement flags (see ::HelMapFlags).
+//!     If ::kHelMapPopulate is set, the kernel touches the memory and maps all pages
+//!     of the range before returning. This is best effort: pages that cannot be
+//!     obtained are faulted in on access.
 //! @param[out] actualPointer
 //!    	Pointer to which the memory is mapped.
 //!     Differs from @p pointer only if @p pointer was specified as @p NULL.
@@ -1072,6 +1166,17 @@ HEL_C_LINKAGE HelError helQueryThreadStats(HelHandle handle, struct HelThreadSta
 //!     New priority value of the thread.
 HEL_C_LINKAGE HelError helSetPriority(HelHandle handle, int priority);
 
+//! Set the timer slack of a thread.
+//!
+//! Timers that the thread sets up (e.g., via kHelSubmitAwaitClock) may complete
+//! up to @p slack nanoseconds after their deadline. This allows the kernel to
+//! coalesce the interrupts of timers that expire at similar times.
+//! @param[in] handle
+//!     Handle to the thread.
+//! @param[in] slack
+//!     New timer slack of the thread in nanoseconds.
+HEL_C_LINKAGE HelError helSetTimerSlack(HelHandle handle, uint64_t slack);
+
 //! Yields the current thread.
 HEL_C_LINKAGE HelError helYield();
 
@@ -1138,6 +1243,14 @@ HEL_C_LINKAGE HelError helGetCurrentCpu(int *cpu);
 //!     Current value of the system-wide clock in nanoseconds since boot.
 HEL_C_LINKAGE HelError helGetClock(uint64_t *counter);
 
+//! Obtains a memory object that contains the ::HelClockPage.
+//!
+//! The memory object is one page long and can only be mapped read-only.
+//! It allows userspace to read the system-wide monotone clock without entering the kernel.
+//! @param[out] handle
+//!     Handle to the memory object.
+HEL_C_LINKAGE HelError helAccessClockPage(HelHandle *handle);
+
 HEL_C_LINKAGE HelError helCreateVirtualizedCpu(HelHandle handle, HelHandle *out_handle);
 
 HEL_C_LINKAGE HelError helRunVirtualizedCpu(HelHandle handle, struct HelVmexitReason *reason);
@@ -1209,6 +1322,46 @@ HEL_C_LINKAGE HelError helFutexWait(int *pointer, int expected, int64_t deadline
 //!     Maximum number of waiters to wake.
 HEL_C_LINKAGE HelError helFutexWake(int *pointer, unsigned int count);
 
+//! Waits on multiple futexes at once.
+//!
+//! Returns as soon as any of the futexes is woken up.
+//! Like ::helFutexWait, this function does nothing unless
+//! all futexes match their expected values.
+//! @param[in] items
+//!     Array of futexes and their expected values.
+//! @param[in] count
+//!     Number of elements in @p items.
+//! @param[in] deadline
+//!     Timeout (in absolute monotone time, see ::helGetClock).
+//! @param[out] index
+//!     Index of the futex that was woken up.
+//!     Set to @p count if the call returned without a wake-up.
+HEL_C_LINKAGE HelError helFutexWaitv(const struct HelFutexWaitItem *items, size_t count,
+		int64_t deadline, size_t *index);
+
+//! Wakes up waiters of a futex and moves remaining waiters to another futex.
+//!
+//! This avoids waking up all waiters of a condition variable on broadcast,
+//! only for them to contend on the associated mutex.
+//! @param[in] pointer
+//!     Pointer that identifies the futex.
+//! @param[in] target
+//!     Pointer that identifies the futex that waiters are moved to.
+//! @param[in] wakeCount
+//!     Maximum number of waiters to wake.
+//! @param[in] requeueCount
+//!     Maximum number of waiters to move to @p target.
+//! @param[in] expected
+//!     Expected value of the futex (only used with ::kHelFutexRequeueCompare).
+//! @param[in] flags
+//!     If ::kHelFutexRequeueCompare is set, this function fails with
+//!     ::kHelErrIllegalState unless the futex pointed to by @p pointer
+//!     matches @p expected.
+//! @param[out] count
+//!     Total number of woken and moved waiters.
+HEL_C_LINKAGE HelError helFutexRequeue(int *pointer, int *target, unsigned int wakeCount,
+		unsigned int requeueCount, int expected, uint32_t flags, unsigned int *count);
+
 //! @}
 //! @name Event Handling
 //! @{
@@ -1234,6 +1387,33 @@ HEL_C_LINKAGE HelError helAcknowledgeIrq(HelHandle handle, uint32_t flags, uint6
 
 HEL_C_LINKAGE HelError helAutomateIrq(HelHandle handle, uint32_t flags, HelHandle kernlet);
 
+//! Set the CPUs that an IRQ may be routed to.
+//!
+//! The IRQ is routed to one of the CPUs in the mask. IRQs with an explicit affinity
+//! are not moved by the kernel's IRQ balancer.
+//! @param[in] handle
+//!     Handle to the IRQ.
+//! @param[in] mask
+//!     Pointer to a bit mask of CPUs.
+//! @param[in] size
+//!     Size of bit mask.
+//! @return
+//!     ::kHelErrNoHardwareSupport if the IRQ controller cannot route
+//!     the IRQ to any of the CPUs in the mask.
+HEL_C_LINKAGE HelError helSetIrqAffinity(HelHandle handle, uint8_t *mask, size_t size);
+
+//! Query statistics of an IRQ.
+//! @param[in] handle
+//!     Handle to the IRQ.
+//! @param[out] stats
+//!     Statistics of the IRQ.
+//! @param[out] cpuRaises
+//!     Array that receives the number of times that the IRQ was raised on each CPU.
+//! @param[in] numCpus
+//!     Size of the @p cpuRaises array. At most @p numCpus entries are written.
+HEL_C_LINKAGE HelError helQueryIrqStats(HelHandle handle, struct HelIrqStats *stats,
+		uint64_t *cpuRaises, size_t numCpus);
+
 //! @}
 //! @name Input/Output
 //! @{
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace helix {
+
+// Returns the current value of the system-wide monotone clock (see helGetClock()).
+// Reads the kernel's clock page instead of entering the kernel if possible.
+uint64_t getClockNanos();
+
+} // namespace helix
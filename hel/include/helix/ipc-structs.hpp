@@ -335,6 +335,93 @@ private:
 	size_t _length;
 };
 
+struct SendFromMemoryResult {
+	SendFromMemoryResult() :_valid{false} {}
+
+	HelError error() {
+		FRG_ASSERT(_valid);
+		return _error;
+	}
+
+	// Less than the requested length if the memory object was truncated.
+	size_t actualLength() {
+		FRG_ASSERT(_valid);
+		HEL_CHECK(error());
+		return _length;
+	}
+
+	void parse(void *&ptr, ElementHandle) {
+		auto result = reinterpret_cast<HelLengthResult *>(ptr);
+		_error = result->error;
+		_length = result->length;
+		ptr = (char *)ptr + sizeof(HelLengthResult);
+		_valid = true;
+	}
+
+private:
+	bool _valid;
+	HelError _error;
+	size_t _length;
+};
+
+struct SendPagesResult {
+	SendPagesResult() :_valid{false} {}
+
+	HelError error() {
+		FRG_ASSERT(_valid);
+		return _error;
+	}
+
+	void parse(void *&ptr, ElementHandle) {
+		auto result = reinterpret_cast<HelSimpleResult *>(ptr);
+		_error = result->error;
+		ptr = (char *)ptr + sizeof(HelSimpleResult);
+		_valid = true;
+	}
+
+private:
+	bool _valid;
+	HelError _error;
+};
+
+// The received data is mapped into the address space by the kernel.
+// The caller is responsible for unmapping it (the mapping is rounded up to full pages).
+struct RecvPagesResult {
+	RecvPagesResult() :_valid{false} {}
+
+	HelError error() {
+		FRG_ASSERT(_valid);
+		return _error;
+	}
+
+	size_t actualLength() {
+		FRG_ASSERT(_valid);
+		HEL_CHECK(error());
+		return _length;
+	}
+
+	void *data() {
+		FRG_ASSERT(_valid);
+		HEL_CHECK(error());
+		return _pointer;
+	}
+
+	void parse(void *&ptr, ElementHandle) {
+		auto result = reinterpret_cast<HelPagesResult *>(ptr);
+		_error = result->error;
+		_length = result->length;
+		_pointer = result->pointer;
+		ptr = (char *)ptr + sizeof(HelPagesResult);
+		_valid = true;
+	}
+
+private:
+	bool _valid;
+	HelError _error;
+	size_t _length;
+	void *_pointer;
+};
+
 struct RecvInlineResult {
 	RecvInlineResult() :_valid{false} {}
 
@@ -479,6 +566,26 @@ struct RecvBuffer {
 
 struct RecvInline { };
 
+// Sends data directly from a memory object (without mapping it into the sender).
+struct SendFromMemory {
+	HelHandle handle;
+	uintptr_t offset;
+	size_t size;
+};
+
+// Buffer and size must be page-aligned and the buffer must be covered by a single mapping.
+// The pages are moved to the receiver: they are unmapped from the sender on submission.
+// For large transfers, the receiver maps the sender's memory object directly (without copying);
+// hence, other mappings of the same memory object still observe the data.
+struct SendPages {
+	const void *buf;
+	size_t size;
+};
+
+struct RecvPages {
+	size_t maxSize;
+};
+
 struct PushDescriptor {
 	HelHandle handle;
 };
@@ -572,6 +679,18 @@ inline auto recvInline() {
 	return RecvInline{};
 }
 
+inline auto sendFromMemory(BorrowedDescriptor memory, uintptr_t offset, size_t length) {
+	return SendFromMemory{memory.getHandle(), offset, length};
+}
+
+inline auto sendPages(const void *data, size_t length) {
+	return SendPages{data, length};
+}
+
+inline auto recvPages(size_t maxLength) {
+	return RecvPages{maxLength};
+}
+
 inline auto pushDescriptor(BorrowedDescriptor desc) {
 	return PushDescriptor{desc.getHandle()};
 }
@@ -707,6 +826,36 @@ inline auto createActionsArrayFor(bool chain, const RecvBuffer &item) {
 	return frg::array<HelAction, 1>{action};
 }
 
+inline auto createActionsArrayFor(bool chain, const SendFromMemory &item) {
+	HelAction action{};
+	action.type = kHelActionSendFromMemory;
+	action.flags = chain ? kHelItemChain : 0;
+	action.buffer = reinterpret_cast<void *>(item.offset);
+	action.length = item.size;
+	action.handle = item.handle;
+
+	return frg::array<HelAction, 1>{action};
+}
+
+inline auto createActionsArrayFor(bool chain, const SendPages &item) {
+	HelAction action{};
+	action.type = kHelActionSendPages;
+	action.flags = chain ? kHelItemChain : 0;
+	action.buffer = const_cast<void *>(item.buf);
+	action.length = item.size;
+
+	return frg::array<HelAction, 1>{action};
+}
+
+inline auto createActionsArrayFor(bool chain, const RecvPages &item) {
+	HelAction action{};
+	action.type = kHelActionRecvPages;
+	action.flags = chain ? kHelItemChain : 0;
+	action.length = item.maxSize;
+
+	return frg::array<HelAction, 1>{action};
+}
+
 inline auto createActionsArrayFor(bool chain, const RecvInline &) {
 	HelAction action{};
 	action.type = kHelActionRecvInline;
@@ -802,6 +951,18 @@ inline auto resultTypeTuple(const RecvBuffer &) {
 	return frg::tuple<RecvBufferResult>{};
 }
 
+inline auto resultTypeTuple(const SendFromMemory &) {
+	return frg::tuple<SendFromMemoryResult>{};
+}
+
+inline auto resultTypeTuple(const SendPages &) {
+	return frg::tuple<SendPagesResult>{};
+}
+
+inline auto resultTypeTuple(const RecvPages &) {
+	return frg::tuple<RecvPagesResult>{};
+}
+
 inline auto resultTypeTuple(const RecvInline &) {
 	return frg::tuple<RecvInlineResult>{};
 }
@@ -537,12 +537,20 @@ private:
 struct Submission : private Context {
 	Submission(AwaitClock *operation,
 			uint64_t counter, Dispatcher &dispatcher)
+	: Submission{operation, counter, 0, 0, dispatcher} { }
+
+	// Unless flags contains kHelAwaitClockSlack, the thread's timer slack applies.
+	Submission(AwaitClock *operation,
+			uint64_t counter, uint64_t slack, uint32_t flags, Dispatcher &dispatcher)
 	: _result(operation) {
 		auto asyncId = dispatcher.makeAsyncId();
 
 		HelSqAwaitClock sqData;
 		sqData.counter = counter;
 		sqData.cancellationTag = asyncId;
+		sqData.flags = flags;
+		sqData.reserved = 0;
+		sqData.slack = slack;
 		std::array segments{std::as_bytes(std::span{&sqData, 1})};
 		dispatcher.pushSq(kHelSubmitAwaitClock,
 				reinterpret_cast<uintptr_t>(context()), segments);
@@ -641,6 +649,12 @@ inline Submission submitAwaitClock(AwaitClock *operation, uint64_t counter,
 	return {operation, counter, dispatcher};
 }
 
+// Like submitAwaitClock() but uses the given slack instead of the thread's timer slack.
+inline Submission submitAwaitClockWithSlack(AwaitClock *operation, uint64_t counter,
+		uint64_t slack, Dispatcher &dispatcher) {
+	return {operation, counter, slack, kHelAwaitClockSlack, dispatcher};
+}
+
 inline Submission submitProtectMemory(BorrowedDescriptor memory, ProtectMemory *operation,
 		void *pointer, size_t length, uint32_t flags,
 		Dispatcher &dispatcher) {
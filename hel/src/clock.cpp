@@ -0,0 +1,78 @@
+#include <hel.h>
+#include <hel-syscalls.h>
+#include <helix/clock.hpp>
+
+namespace helix {
+
+namespace {
+
+HelClockPage *mapClockPage() {
+	HelHandle handle;
+	HEL_CHECK(helAccessClockPage(&handle));
+
+	void *window;
+	HEL_CHECK(helMapMemory(handle, kHelNullHandle, nullptr,
+			0, 0x1000, kHelMapProtRead, &window));
+	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+	return reinterpret_cast<HelClockPage *>(window);
+}
+
+uint64_t readCounter() {
+#if defined(__x86_64__)
+	// Prevent the TSC read from being executed before earlier loads.
+	__builtin_ia32_lfence();
+	return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+	// Prevent the counter read from being executed before earlier instructions.
+	uint64_t cnt;
+	asm volatile ("isb; mrs %0, cntvct_el0" : "=r"(cnt) :: "memory");
+	return cnt;
+#elif defined(__riscv)
+	uint64_t v;
+	asm volatile ("rdtime %0" : "=r"(v));
+	return v;
+#else
+#	error "Unsupported architecture"
+#endif
+}
+
+} // anonymous namespace
+
+uint64_t getClockNanos() {
+	static HelClockPage *page = mapClockPage();
+
+	while(true) {
+		// Start the seqlock read.
+		auto seqlock = __atomic_load_n(&page->seqlock, __ATOMIC_ACQUIRE);
+		if(seqlock & 1)
+			continue;
+
+		// Perform the actual loads.
+		auto flags = __atomic_load_n(&page->flags, __ATOMIC_RELAXED);
+		auto shift = __atomic_load_n(&page->shift, __ATOMIC_RELAXED);
+		auto scale = __atomic_load_n(&page->scale, __ATOMIC_RELAXED);
+		auto offset = __atomic_load_n(&page->offset, __ATOMIC_RELAXED);
+
+		// The counter is not usable (e.g., because the TSC is not invariant).
+		if(!(flags & kHelClockPageCounterValid)) {
+			uint64_t now;
+			HEL_CHECK(helGetClock(&now));
+			return now;
+		}
+
+		auto counter = readCounter();
+
+		// Finish the seqlock read.
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if(__atomic_load_n(&page->seqlock, __ATOMIC_RELAXED) != seqlock)
+			continue;
+
+		// Saturate in the same way as the kernel does.
+		auto product = (static_cast<unsigned __int128>(counter) * scale) >> shift;
+		if(product >> 64)
+			return UINT64_MAX;
+		return static_cast<uint64_t>(product) + offset;
+	}
+}
+
+} // namespace helix
@@ -11,6 +11,7 @@ enum class Csr : uint16_t {
 	sstatus = 0x100, // Status register.
 	sie = 0x104,     // Interrupt enable.
 	stvec = 0x105,   // Trap vector address.
+	scounteren = 0x106, // Counter enable.
 	senvcfg = 0x10A, // Environment configuration.
 	// Supervisor trap handling.
 	sscratch = 0x140,
@@ -68,6 +69,13 @@ constexpr uint64_t cbcfe = UINT64_C(1) << 6;
 
 } // namespace senvcfg
 
+namespace scounteren {
+
+// Enables the execution of `rdtime` in U-mode.
+constexpr uint64_t tm = UINT64_C(1) << 1;
+
+} // namespace scounteren
+
 namespace interrupts {
 
 constexpr uint64_t ssi = 1; // Supervisor software interrupt.
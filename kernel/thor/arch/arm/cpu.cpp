@@ -276,6 +276,13 @@ void initializeThisProcessor() {
 
 	asm volatile ("msr sctlr_el1, %0" :: "r"(sctlr));
 
+	// Allow EL0 to read cntvct_el0 (for the clock page) but not the physical counter.
+	uint64_t cntkctl;
+	asm volatile ("mrs %0, cntkctl_el1" : "=r"(cntkctl));
+	cntkctl &= ~uint64_t(0b11);
+	cntkctl |= (uint64_t(1) << 1);
+	asm volatile ("msr cntkctl_el1, %0" :: "r"(cntkctl));
+
 	uint64_t mpidr;
 	asm volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
 	cpu_data->affinity = (mpidr & 0xFFFFFF) | (mpidr >> 32 & 0xFF) << 24;
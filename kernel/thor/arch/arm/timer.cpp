@@ -39,6 +39,11 @@ uint64_t getClockNanos() {
 	return timerInverseFreq * getRawTimestampCounter();
 }
 
+frg::optional<FreqFraction> getUserClockConversion() {
+	// EL0 can read cntvct_el0 since initializeThisProcessor() sets CNTKCTL_EL1.EL0VCTEN.
+	return timerInverseFreq;
+}
+
 void setTimerDeadline(frg::optional<uint64_t> deadline) {
 	if (deadline) {
 		uint64_t rawDeadline = timerFreq * *deadline;
@@ -193,6 +193,9 @@ void initializeThisProcessor() {
 	senvcfg |= riscv::senvcfg::cbie | riscv::senvcfg::cbcfe;
 	riscv::writeCsr<riscv::Csr::senvcfg>(senvcfg);
 
+	// Allow U-mode to read the time CSR (for the clock page).
+	riscv::writeCsr<riscv::Csr::scounteren>(riscv::scounteren::tm);
+
 	// Read back sstatus.
 	sstatus = riscv::readCsr<riscv::Csr::sstatus>();
 	if (sstatus & riscv::sstatus::ubeBit)
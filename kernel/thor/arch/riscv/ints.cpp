@@ -38,6 +38,11 @@ void sendShootdownIpi() {
 	}
 }
 
+void sendShootdownIpi(CpuData *dstData) {
+	if (raiseIpiBit(dstData, PlatformCpuData::ipiShootdown))
+		doSendIpi(dstData);
+}
+
 void sendSelfCallIpi() {
 	auto *selfData = getCpuData();
 	if (raiseIpiBit(selfData, PlatformCpuData::ipiSelfCall))
@@ -102,6 +102,11 @@ uint64_t getRawTimestampCounter() {
 
 uint64_t getClockNanos() { return inverseFreq * getRawTimestampCounter(); }
 
+frg::optional<FreqFraction> getUserClockConversion() {
+	// U-mode can use rdtime since initializeThisProcessor() sets scounteren.TM.
+	return inverseFreq;
+}
+
 void setTimerDeadline(frg::optional<uint64_t> deadline) {
 	assert(!intsAreEnabled());
 
@@ -115,12 +115,8 @@ void handleRiscvIpi(Frame *frame) {
 	if (mask & PlatformCpuData::ipiPing)
 		localScheduler.get(cpuData).forcePreemptionCall();
 
-	if (mask & PlatformCpuData::ipiShootdown) {
-		for (auto &binding : asidData.get()->bindings)
-			binding.shootdown();
-
-		asidData.get()->globalBinding.shootdown();
-	}
+	if (mask & PlatformCpuData::ipiShootdown)
+		handleShootdownIpi();
 
 	if (mask & PlatformCpuData::ipiSelfCall)
 		SelfIntCallBase::runScheduledCalls();
@@ -108,12 +108,28 @@ Executor::Executor(FiberContext *context, AbiParameters abi)
 	general()->rdi = abi.argument;
 	general()->cs = kSelSystemFiberCode;
 	general()->ss = kSelExecutorKernelData;
+
+	_hasSimdState = false;
 }
 
 Executor::~Executor() {
 	kernelAlloc->free(_pointer);
 }
 
+void saveCurrentSimdState(Executor *executor) {
+	if(!executor->_hasSimdState)
+		return;
+
+	auto features = getGlobalCpuFeatures();
+	if(features->haveXsaveopt) {
+		common::x86::xsaveopt((uint8_t*)executor->_fxState(), features->xsaveMask);
+	}else if(features->haveXsave) {
+		common::x86::xsave((uint8_t*)executor->_fxState(), features->xsaveMask);
+	}else{
+		asm volatile ("fxsaveq %0" : : "m" (*executor->_fxState()));
+	}
+}
+
 void saveExecutor(Executor *executor, FaultImageAccessor accessor) {
 	executor->general()->rax = accessor._frame()->rax;
 	executor->general()->rbx = accessor._frame()->rbx;
@@ -141,11 +157,7 @@ void saveExecutor(Executor *executor, FaultImageAccessor accessor) {
 	executor->general()->clientGs = common::x86::rdmsr(common::x86::kMsrIndexKernelGsBase);
 	executor->general()->iplState = accessor._frame()->iplState;
 
-	if(getGlobalCpuFeatures()->haveXsave){
-		common::x86::xsave((uint8_t*)executor->_fxState(), ~0);
-	} else {
-		asm volatile ("fxsaveq %0" : : "m" (*executor->_fxState()));
-	}
+	saveCurrentSimdState(executor);
 }
 
 void saveExecutor(Executor *executor, IrqImageAccessor accessor) {
@@ -175,11 +187,7 @@ void saveExecutor(Executor *executor, IrqImageAccessor accessor) {
 	executor->general()->clientGs = common::x86::rdmsr(common::x86::kMsrIndexKernelGsBase);
 	executor->general()->iplState = accessor._frame()->iplState;
 
-	if(getGlobalCpuFeatures()->haveXsave){
-		common::x86::xsave((uint8_t*)executor->_fxState(), ~0);
-	}else{
-		asm volatile ("fxsaveq %0" : : "m" (*executor->_fxState()));
-	}
+	saveCurrentSimdState(executor);
 }
 
 void saveExecutor(Executor *executor, SyscallImageAccessor accessor) {
@@ -209,11 +217,7 @@ void saveExecutor(Executor *executor, SyscallImageAccessor accessor) {
 	executor->general()->clientGs = common::x86::rdmsr(common::x86::kMsrIndexKernelGsBase);
 	executor->general()->iplState = accessor._frame()->iplState;
 
-	if(getGlobalCpuFeatures()->haveXsave){
-		common::x86::xsave((uint8_t*)executor->_fxState(), ~0);
-	}else{
-		asm volatile ("fxsaveq %0" : : "m" (*executor->_fxState()));
-	}
+	saveCurrentSimdState(executor);
 }
 
 extern "C" void forkExecutorRegisters(Executor *executor, void (*functor)(void *), void *context);
@@ -265,10 +269,19 @@ extern "C" [[ noreturn ]] void _restoreExecutorRegisters(void *pointer);
 	common::x86::wrmsr(common::x86::kMsrIndexFsBase, executor->general()->clientFs);
 	common::x86::wrmsr(common::x86::kMsrIndexKernelGsBase, executor->general()->clientGs);
 
-	if(getGlobalCpuFeatures()->haveXsave){
-		common::x86::xrstor((uint8_t*)executor->_fxState(), ~0);
-	}else{
-		asm volatile ("fxrstorq %0" : : "m" (*executor->_fxState()));
+	// Skip restoring the SIMD state if the registers still hold the state of this executor,
+	// e.g., if we only switched to a kernel fiber and back.
+	auto cpuData = getCpuData();
+	if(executor->_hasSimdState
+			&& (cpuData->simdOwner != executor || executor->_simdCpu != cpuData->cpuIndex)) {
+		auto features = getGlobalCpuFeatures();
+		if(features->haveXsave){
+			common::x86::xrstor((uint8_t*)executor->_fxState(), features->xsaveMask);
+		}else{
+			asm volatile ("fxrstorq %0" : : "m" (*executor->_fxState()));
+		}
+		cpuData->simdOwner = executor;
+		executor->_simdCpu = cpuData->cpuIndex;
 	}
 
 	iplLeaveContext(executor->general()->iplState);
@@ -395,6 +408,11 @@ static initgraph::Task enumerateCpuFeaturesTask{&globalInitEngine, "x86.enumerat
 
 			auto xsaveCpuid = common::x86::cpuid(0xD);
 			globalCpuFeatures.xsaveRegionSize = xsaveCpuid[2];
+
+			if(common::x86::cpuid(0xD, 1)[0] & (uint32_t(1) << 0)) {
+				debugLogger() << "thor: CPUs support XSAVEOPT" << frg::endlog;
+				globalCpuFeatures.haveXsaveopt = true;
+			}
 		}else{
 			debugLogger() << "thor: CPUs do not support XSAVE!" << frg::endlog;
 		}
@@ -413,6 +431,20 @@ static initgraph::Task enumerateCpuFeaturesTask{&globalInitEngine, "x86.enumerat
 			}else{
 				debugLogger() << "thor: CPUs do not support AVX-512!" << frg::endlog;
 			}
+
+			uint64_t xsaveMask = 0;
+			xsaveMask |= (uint64_t(1) << 0); // x87 feature set
+			xsaveMask |= (uint64_t(1) << 1); // SSE feature set
+
+			if(globalCpuFeatures.haveAvx)
+				xsaveMask |= (uint64_t(1) << 2); // AVX feature set
+
+			if(globalCpuFeatures.haveZmm) {
+				xsaveMask |= (uint64_t(1) << 5); // AVX-512
+				xsaveMask |= (uint64_t(1) << 6); // ZMM{0 -> 15}
+				xsaveMask |= (uint64_t(1) << 7); // ZMM{16 -> 31}
+			}
+			globalCpuFeatures.xsaveMask = xsaveMask;
 		}
 
 		if(common::x86::cpuid(0x80000007)[3] & (1 << 8)) {
@@ -571,6 +603,64 @@ static initgraph::Task initBootProcessorTask{&globalInitEngine, "x86.init-boot-p
 	}
 };
 
+namespace {
+	// Determines the CPU topology from the x2APIC ID layout (CPUID leaf 0xB) and
+	// from the deterministic cache parameters (CPUID leaf 4 or 0x8000001D on AMD).
+	void detectCpuTopology(CpuTopology &topology) {
+		if(common::x86::cpuid(0)[0] < 0xB)
+			return;
+
+		auto x2apicId = common::x86::cpuid(0xB)[3];
+		uint32_t smtShift = 0;
+		uint32_t packageShift = 0;
+		bool haveLevels = false;
+		for(uint32_t subleaf = 0; subleaf < 8; ++subleaf) {
+			auto leaf = common::x86::cpuid(0xB, subleaf);
+			auto type = (leaf[2] >> 8) & 0xFF;
+			if(!type)
+				break;
+			// Each level reports the shift that is required to obtain the ID of the next level.
+			auto shift = leaf[0] & 0x1F;
+			if(type == 1)
+				smtShift = shift;
+			packageShift = shift;
+			haveLevels = true;
+		}
+		if(!haveLevels)
+			return;
+
+		auto cacheShift = [] (uint32_t cacheLeaf) -> frg::optional<uint32_t> {
+			frg::optional<uint32_t> shift;
+			uint32_t maxLevel = 0;
+			for(uint32_t subleaf = 0; subleaf < 16; ++subleaf) {
+				auto leaf = common::x86::cpuid(cacheLeaf, subleaf);
+				if(!(leaf[0] & 0x1F))
+					break;
+				auto level = (leaf[0] >> 5) & 7;
+				if(level < maxLevel)
+					continue;
+				maxLevel = level;
+				// Maximal number of logical processors that share this cache.
+				auto sharing = ((leaf[0] >> 14) & 0xFFF) + 1;
+				uint32_t s = 0;
+				while((uint32_t{1} << s) < sharing)
+					++s;
+				shift = s;
+			}
+			return shift;
+		};
+
+		auto llcShift = cacheShift(4);
+		if(!llcShift && common::x86::cpuid(0x8000'0000)[0] >= 0x8000'001D)
+			llcShift = cacheShift(0x8000'001D);
+
+		topology.coreId = x2apicId >> smtShift;
+		topology.packageId = x2apicId >> packageShift;
+		topology.llcId = llcShift ? (x2apicId >> *llcShift) : topology.packageId;
+		topology.known = true;
+	}
+}
+
 void initializeThisProcessor() {
 	auto cpuData = getCpuData();
 
@@ -645,20 +735,8 @@ void initializeThisProcessor() {
 		cr4 |= uint32_t(1) << 18; // Enable XSAVE and x{get, set}bv
 		asm volatile ("mov %0, %%cr4" : : "r" (cr4));
 
-		uint64_t xcr0 = 0;
-		xcr0 |= (uint64_t(1) << 0); // Enable saving of x87 feature set
-		xcr0 |= (uint64_t(1) << 1); // Enable saving of SSE feature set
-
-		if(getGlobalCpuFeatures()->haveAvx)
-			xcr0 |= (uint64_t(1) << 2); // Enable saving of AVX feature set and enable it
-
-		if(getGlobalCpuFeatures()->haveZmm) {
-			xcr0 |= (uint64_t(1) << 5); // Enable AVX-512
-			xcr0 |= (uint64_t(1) << 6); // Enable management of ZMM{0 -> 15}
-			xcr0 |= (uint64_t(1) << 7); // Enable management of ZMM{16 -> 31}
-		}
-
-		common::x86::wrxcr(0, xcr0);
+		// Enable saving (and usage) of all feature sets that we support.
+		common::x86::wrxcr(0, getGlobalCpuFeatures()->xsaveMask);
 	}
 
 	// Enable the SMAP extension.
@@ -751,6 +829,8 @@ void initializeThisProcessor() {
 	cpuData->generalWorkQueue = cpuData->wqFiber->associatedWorkQueue().lock();
 	assert(cpuData->generalWorkQueue);
 
+	detectCpuTopology(cpuData->topology);
+
 	initLocalApicPerCpu();
 }
 
@@ -142,6 +142,12 @@ frg::expected<Error> EptOperations::faultPage(VirtualAddr va, MemoryView *view,
 			va, view, offset, flags, mode);
 }
 
+frg::expected<Error> EptOperations::faultAroundPages(VirtualAddr va, MemoryView *view,
+		uintptr_t offset, size_t size, PageFlags flags, CachingMode mode) {
+	return faultAroundPagesByCursor<EptCursor>(pageSpace_,
+			va, view, offset, size, flags, mode);
+}
+
 frg::expected<Error> EptOperations::cleanPages(VirtualAddr va, MemoryView *view,
 		uintptr_t offset, size_t size) {
 	return cleanPagesByCursor<EptCursor>(pageSpace_,
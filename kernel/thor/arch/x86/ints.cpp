@@ -3,7 +3,9 @@
 #include <thor-internal/ipl.hpp>
 #include <thor-internal/profile.hpp>
 #include <thor-internal/thread.hpp>
+#include <thor-internal/timer.hpp>
 #include <thor-internal/arch-generic/cpu.hpp>
+#include <thor-internal/arch/paging.hpp>
 #include <thor-internal/arch/pmc-amd.hpp>
 #include <thor-internal/arch/pmc-intel.hpp>
 #include <thor-internal/arch/stack.hpp>
@@ -296,6 +298,75 @@ bool inStub(uintptr_t ip) {
 	return ip >= (uintptr_t)stubsPtr && ip < (uintptr_t)stubsLimit;
 }
 
+// Emits a profiling sample (see profile.hpp for the format) to the CPU-local profiling ring.
+// Called from the PMC NMI and from the timer IRQ; hence, this must not fault or take locks.
+template<typename Image>
+void emitProfileSample(CpuData *cpuData, Image image) {
+	uintptr_t buffer[maxProfileSampleSize / sizeof(uintptr_t)];
+	auto ips = buffer + profileSampleHeader;
+	size_t n = 0;
+
+	uint16_t cs = *image.cs();
+	bool inUser = cs == kSelClientUserCode || cs == kSelClientUserCompat;
+	bool inThread = inUser
+			|| cs == kSelExecutorSyscallCode
+			|| cs == kSelExecutorFaultCode;
+
+	// Note that activeThread is only meaningful if we interrupted a thread.
+	uintptr_t pid = 0;
+	uintptr_t tid = 0;
+	if(inThread) {
+		auto thread = cpuData->activeThread.get();
+		tid = reinterpret_cast<uintptr_t>(thread);
+		pid = reinterpret_cast<uintptr_t>(thread->getAddressSpace().get());
+	}
+
+	if(!inUser) {
+		ips[n++] = *image.ip();
+#ifdef THOR_HAS_FRAME_POINTERS
+		// We can (obviously) only backtrace in the higher half.
+		// Also, we cannot backtrace if we did not make it out of the entry stubs yet
+		// since the entry stubs may still run with userspace RBP.
+		if (inHigherHalf(*image.ip()) && !inStub(*image.ip())) {
+			walkStack(reinterpret_cast<void *>(*image.bp()), [&] (uintptr_t ip) {
+				if(n < maxProfileKernelDepth)
+					ips[n++] = ip;
+			});
+		}
+#endif
+	}
+	size_t numKernel = n;
+
+	// User stacks are only available if we interrupted user mode. Otherwise, RBP
+	// points to kernel frames and the user RBP is not easily accessible.
+	if(inUser) {
+		ips[n++] = *image.ip();
+		if(wantProfileUserStacks && cs == kSelClientUserCode) {
+			// We cannot fault here; hence, walk the page tables instead of accessing
+			// user memory directly. We require frames to be strictly increasing
+			// to guarantee termination on corrupted stacks.
+			uintptr_t bp = *image.bp();
+			while(n < maxProfileKernelDepth + maxProfileUserDepth && bp) {
+				uintptr_t nextBp, ip;
+				if(!peekUserWord(bp, nextBp) || !peekUserWord(bp + sizeof(uintptr_t), ip))
+					break;
+				if(!ip)
+					break;
+				ips[n++] = ip;
+				if(nextBp <= bp)
+					break;
+				bp = nextBp;
+			}
+		}
+	}
+
+	buffer[0] = n;
+	buffer[1] = numKernel;
+	buffer[2] = pid;
+	buffer[3] = tid;
+	cpuData->localProfileRing->enqueue(buffer, (profileSampleHeader + n) * sizeof(uintptr_t));
+}
+
 void handlePageFault(FaultImageAccessor image, uintptr_t address, Word errorCode);
 void handleOtherFault(FaultImageAccessor image, Interrupt fault);
 void handleIrq(IrqImageAccessor image, IrqPin *irq);
@@ -462,7 +533,13 @@ extern "C" void onPlatformPreemption(IrqImageAccessor image) {
 	assert(!irqMutex().nesting());
 	disableUserAccess();
 
-	handleTimerInterrupt();
+	if(handleTimerInterrupt()) {
+		// The profiling deadline is only armed when timer-based profiling is active.
+		assert(getCpuData()->profileMechanism.load(std::memory_order_relaxed)
+				== ProfileMechanism::timer);
+		emitProfileSample(getCpuData(), image);
+		setProfileDeadline(getClockNanos() + getProfilePeriod());
+	}
 
 	getCpuData()->heartbeat.fetch_add(1, std::memory_order_relaxed);
 
@@ -508,10 +585,7 @@ extern "C" void onPlatformShootdown(IrqImageAccessor image) {
 	assert(!irqMutex().nesting());
 	disableUserAccess();
 
-	for(auto &binding : asidData.get()->bindings)
-		binding.shootdown();
-
-	asidData.get()->globalBinding.shootdown();
+	handleShootdownIpi();
 
 	acknowledgeIpi();
 
@@ -623,39 +697,16 @@ extern "C" void onPlatformNmi(NmiImageAccessor image) {
 	IseqContext ownIseq;
 	cpuData->iseqPtr = &ownIseq;
 
-	// Each sample is an array of uintptr_t.
-	// Element 0 stores the number of entries.
-	// Elements >0 store the stack trace IPs.
-	auto emitProfileSample = [&] {
-		constexpr size_t maxDepth = 15;
-		uintptr_t buffer[maxDepth + 1];
-		size_t n = 0;
-		buffer[1 + n++] = *image.ip();
-#ifdef THOR_HAS_FRAME_POINTERS
-		// We can (obviously) only backtrace in the higher half.
-		// Also, we cannot backtrace if we did not make it out of the entry stubs yet
-		// since the entry stubs may still run with userspace RBP.
-		if (inHigherHalf(*image.ip()) && !inStub(*image.ip())) {
-			walkStack(reinterpret_cast<void *>(*image.bp()), [&] (uintptr_t ip) {
-				if(n < maxDepth)
-					buffer[1 + n++] = ip;
-			});
-		}
-#endif
-		buffer[0] = n;
-		cpuData->localProfileRing->enqueue(buffer, (1 + n) * sizeof(uintptr_t));
-	};
-
 	bool explained = false;
 	auto pmcMechanism = cpuData->profileMechanism.load(std::memory_order_acquire);
 	if(pmcMechanism == ProfileMechanism::intelPmc && checkIntelPmcOverflow()) {
-		emitProfileSample();
+		emitProfileSample(cpuData, image);
 		// Note: on Intel, the PMI is automatically masked on raises.
 		LocalApicContext::clearPmi();
 		setIntelPmc();
 		explained = true;
 	}else if(pmcMechanism == ProfileMechanism::amdPmc && checkAmdPmcOverflow()) {
-		emitProfileSample();
+		emitProfileSample(cpuData, image);
 		setAmdPmc();
 		explained = true;
 	}
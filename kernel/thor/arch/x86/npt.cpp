@@ -130,6 +130,12 @@ frg::expected<Error> NptOperations::faultPage(VirtualAddr va, MemoryView *view,
 			va, view, offset, flags, mode);
 }
 
+frg::expected<Error> NptOperations::faultAroundPages(VirtualAddr va, MemoryView *view,
+		uintptr_t offset, size_t size, PageFlags flags, CachingMode mode) {
+	return faultAroundPagesByCursor<NptCursor>(pageSpace_,
+			va, view, offset, size, flags, mode);
+}
+
 frg::expected<Error> NptOperations::cleanPages(VirtualAddr va, MemoryView *view,
 		uintptr_t offset, size_t size) {
 	return cleanPagesByCursor<NptCursor>(pageSpace_,
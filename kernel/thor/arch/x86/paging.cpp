@@ -166,7 +166,8 @@ ClientPageSpace::~ClientPageSpace() {
 		PageAccessor accessor{ps};
 		auto tbl = reinterpret_cast<uint64_t *>(accessor.get());
 		for(int i = 0; i < 512; i++) {
-			if(tbl[i] & ptePresent)
+			// Large pages are owned by their memory views, we only free page tables.
+			if((tbl[i] & ptePresent) && !(tbl[i] & ptePageSize))
 				physicalAllocator->free(tbl[i] & pteAddress, kPageSize);
 		}
 	};
@@ -199,4 +200,39 @@ bool ClientPageSpace::updatePageAccess(VirtualAddr, PageFlags) {
 	return false;
 }
 
+bool peekUserWord(VirtualAddr address, uintptr_t &value) {
+	if(address & (sizeof(uintptr_t) - 1))
+		return false;
+	if(address >= 0x8000'0000'0000)
+		return false;
+
+	PhysicalAddr cr3;
+	asm volatile ("mov %%cr3, %0" : "=r"(cr3));
+
+	// Note that we cannot use a PageCursor here since it splits large pages.
+	auto table = cr3 & pteAddress;
+	for(int level = 3; level >= 0; level--) {
+		auto shift = 12 + 9 * level;
+		PageAccessor accessor{table};
+		auto pte = __atomic_load_n(reinterpret_cast<uint64_t *>(accessor.get())
+				+ ((address >> shift) & 0x1FF), __ATOMIC_RELAXED);
+		if(!(pte & ptePresent) || !(pte & pteUser))
+			return false;
+
+		if(!level || ((level == 1 || level == 2) && (pte & ptePageSize))) {
+			// For large pages, bit 12 is the PAT bit and not part of the address.
+			auto pageMask = (uint64_t{1} << shift) - 1;
+			auto physical = (pte & pteAddress & ~pageMask) + (address & pageMask);
+			PageAccessor pageAccessor{physical & ~uint64_t{kPageSize - 1}};
+			value = *reinterpret_cast<uintptr_t *>(
+					reinterpret_cast<uintptr_t>(pageAccessor.get())
+					+ (physical & (kPageSize - 1)));
+			return true;
+		}
+
+		table = pte & pteAddress;
+	}
+	__builtin_unreachable();
+}
+
 } // namespace thor
@@ -304,6 +304,17 @@ void calibrateApicTimer() {
 	localApicContext()->timersAreCalibrated = true;
 }
 
+uint64_t tscTicksFromNanos(uint64_t nanos) {
+	assert(localApicContext()->timersAreCalibrated);
+	// tscInverseFreq converts ticks to nanoseconds; invert it by
+	// converting a large number of ticks to avoid losing precision.
+	constexpr uint64_t refTicks = 1'000'000'000;
+	auto refNanos = localApicContext()->tscInverseFreq * refTicks;
+	if(!refNanos)
+		return 0;
+	return static_cast<uint64_t>(static_cast<__uint128_t>(nanos) * refTicks / refNanos);
+}
+
 static initgraph::Task assessTimersTask{&globalInitEngine, "x86.assess-timers",
 	initgraph::Requires{getHpetInitializedStage()},
 	initgraph::Entails{getTaskingAvailableStage()},
@@ -325,6 +336,16 @@ uint64_t getClockNanos() {
 	}
 }
 
+frg::optional<FreqFraction> getUserClockConversion() {
+	// Without an invariant TSC, getClockNanos() is based on the HPET.
+	if(!getGlobalCpuFeatures()->haveInvariantTsc)
+		return frg::null_opt;
+	// All CPUs share the calibration of CPU 0 (see calibrateApicTimer() above).
+	auto &context = apicContext.getFor(0);
+	assert(context.timersAreCalibrated);
+	return context.tscInverseFreq;
+}
+
 void acknowledgeIpi() {
 	picBase.store(lApicEoi, 0);
 }
@@ -390,6 +411,21 @@ void sendShootdownIpi() {
 	}
 }
 
+void sendShootdownIpi(CpuData *dstData) {
+	auto apic = dstData->localApicId;
+	if(picBase.isUsingX2apic()) {
+		picBase.store(lX2ApicIcr, x2apicIcrLowVector(0xF0) | x2apicIcrLowDelivMode(0)
+				| x2apicIcrLowLevel(true) | x2apicIcrLowShorthand(0) | x2apicIcrHighDestField(apic));
+	} else {
+		picBase.store(lApicIcrHigh, apicIcrHighDestField(apic));
+		picBase.store(lApicIcrLow, apicIcrLowVector(0xF0) | apicIcrLowDelivMode(0)
+				| apicIcrLowLevel(true) | apicIcrLowShorthand(0));
+		while(picBase.load(lApicIcrLow) & apicIcrLowDelivStatus) {
+			// Wait for IPI delivery.
+		}
+	}
+}
+
 void sendPingIpi(CpuData *dstData) {
 	auto apic = dstData->localApicId;
 //	infoLogger() << "thor [CPU" << getLocalApicId() << "]: Sending ping" << frg::endlog;
@@ -467,8 +503,21 @@ namespace {
 			acknowledgeIrq(0);
 		}
 
+		bool retarget(size_t cpu) override {
+			// Without a device that can be reprogrammed, we cannot change the message.
+			if(!canChangeMessage())
+				return false;
+			// Without interrupt remapping, MSIs can only target 8-bit APIC IDs.
+			auto apicId = getCpuData(cpu)->localApicId;
+			if(apicId > 0xFF)
+				return false;
+			apicId_ = apicId;
+			messageChanged();
+			return true;
+		}
+
 		uint64_t getMessageAddress() override {
-			return 0xFEE00000;
+			return 0xFEE00000 | (apicId_ << 12);
 		}
 
 		uint32_t getMessageData() override {
@@ -477,6 +526,8 @@ namespace {
 
 	private:
 		unsigned int vector_;
+		// Destination APIC ID. Initially, MSIs are delivered to the boot CPU.
+		uint64_t apicId_ = 0;
 	};
 }
 
@@ -547,11 +598,14 @@ namespace {
 			void mask() override;
 			void unmask() override;
 			void endOfInterrupt() override;
+			bool retarget(size_t cpu) override;
 
 		private:
 			IoApic *_chip;
 			unsigned int _index;
 			int _vector = -1;
+			// Destination APIC ID. Initially, IRQs are delivered to the boot CPU.
+			unsigned int _destination = 0;
 
 			// The following variables store the current pin configuration.
 			bool _levelTriggered;
@@ -655,7 +709,7 @@ namespace {
 					<< name() << frg::endlog;
 
 		_chip->_storeRegister(kIoApicInts + _index * 2 + 1,
-				static_cast<uint32_t>(pin_word2::destination(0)));
+				static_cast<uint32_t>(pin_word2::destination(_destination)));
 		_chip->_storeRegister(kIoApicInts + _index * 2,
 				static_cast<uint32_t>(pin_word1::vector(_vector)
 				| pin_word1::deliveryMode(0) | pin_word1::levelTriggered(_levelTriggered)
@@ -690,6 +744,17 @@ namespace {
 		acknowledgeIrq(0);
 	}
 
+	bool IoApic::Pin::retarget(size_t cpu) {
+		// The I/O APIC can only target 8-bit APIC IDs.
+		auto apicId = getCpuData(cpu)->localApicId;
+		if(apicId > 0xFF)
+			return false;
+		_destination = apicId;
+		_chip->_storeRegister(kIoApicInts + _index * 2 + 1,
+				static_cast<uint32_t>(pin_word2::destination(_destination)));
+		return true;
+	}
+
 	IoApic::IoApic(int apic_id, arch::mem_space space)
 	: _apicId(apic_id), _space{std::move(space)} {
 		_numPins = ((_loadRegister(kIoApicVersion) >> 16) & 0xFF) + 1;
@@ -1,5 +1,7 @@
 #include <x86/machine.hpp>
+#include <thor-internal/arch/pic.hpp>
 #include <thor-internal/arch/pmc-amd.hpp>
+#include <thor-internal/profile.hpp>
 
 namespace thor {
 
@@ -8,6 +10,15 @@ namespace counters {
 	inline constexpr unsigned int instructionsRetired = 0xC0;
 }
 
+// Number of events between two samples.
+// We count clock cycles; the TSC frequency approximates the nominal clock frequency.
+static uint64_t initialCount = 1'000'000'000/5000;
+
+void initializeAmdPmc() {
+	if(auto ticks = tscTicksFromNanos(getProfilePeriod()); ticks)
+		initialCount = ticks;
+}
+
 void setAmdPmc() {
 	// TODO: Support counters with IDs > 0xFF.
 	unsigned int whichCounter = counters::clockCycles;
@@ -22,8 +33,7 @@ void setAmdPmc() {
 	);
 
 	// Program the initial value.
-	// This is hardcoded to yield a fixed number of events per second on a 1 GHz machine for now.
-	common::x86::wrmsr(0xC001'0201, -static_cast<uint64_t>(1'000'000'000/5000));
+	common::x86::wrmsr(0xC001'0201, -initialCount);
 
 	// Re-enable the performance counter.
 	common::x86::wrmsr(0xC001'0200,
@@ -1,6 +1,8 @@
 #include <x86/machine.hpp>
 #include <thor-internal/debug.hpp>
+#include <thor-internal/arch/pic.hpp>
 #include <thor-internal/arch/pmc-intel.hpp>
+#include <thor-internal/profile.hpp>
 
 namespace thor {
 
@@ -24,11 +26,14 @@ static uint32_t supportedFixedCounters{0};
 // Bit width of PMCs.
 static int counterBitWidth{0};
 
-// This is hardcoded to yield a fixed number of events per second on a 1 GHz machine for now.
-// TODO: We want to adaptively pick this to achieve a constant sampling rate.
+// Number of events between two samples.
+// Since we count TSC cycles, this is derived from the TSC frequency.
 static uint64_t initialCount = 4'000'000'000/1000;
 
 void initializeIntelPmc() {
+	if(auto ticks = tscTicksFromNanos(getProfilePeriod()); ticks)
+		initialCount = ticks;
+
 	auto c = common::x86::cpuid(0xA);
 	auto version = c[0] & 0xFF;
 	counterBitWidth = (c[0] >> 16) & 0xFF;
@@ -39,6 +39,9 @@ struct PlatformCpuData : public AssemblyCpuData {
 
 	common::x86::Tss64 tss;
 
+	// Executor whose SIMD state was most recently loaded into the registers of this CPU.
+	Executor *simdOwner{nullptr};
+
 	bool havePcids = false;
 	bool haveSmap = false;
 	bool haveVirtualization = false;
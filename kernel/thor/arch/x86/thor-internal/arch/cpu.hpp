@@ -154,6 +154,8 @@ struct IrqImageAccessor {
 	Word *cs() { return &_frame()->cs; }
 	Word *rflags() { return &_frame()->rflags; }
 	Word *ss() { return &_frame()->ss; }
+	// Exposed for profiling.
+	Word *bp() { return &_frame()->rbp; }
 
 	IplState *iplState() { return &_frame()->iplState; }
 
@@ -391,6 +393,7 @@ struct Executor {
 	friend void workOnExecutor(Executor *executor);
 	friend void restoreExecutor(Executor *executor);
 	friend void doForkExecutor(Executor *executor, void (*functor)(void *), void *context);
+	friend void saveCurrentSimdState(Executor *executor);
 
 	static size_t determineSize();
 	static size_t determineSimdSize();
@@ -517,6 +520,11 @@ public:
 		return _uar;
 	}
 
+	// Must be called after the saved SIMD state is modified by software.
+	void invalidateLoadedSimdState() {
+		_simdCpu = -1;
+	}
+
 private:
 	// Private function only used for the static_assert check.
 	//
@@ -531,6 +539,13 @@ private:
 	void *_syscallStack;
 	common::x86::Tss64 *_tss;
 	UserAccessRegion *_uar;
+
+	// Kernel fibers do not use SIMD registers; we never save or restore them.
+	bool _hasSimdState{true};
+	// CPU whose SIMD registers hold the latest state of this executor (or -1).
+	// Together with PlatformCpuData::simdOwner, this allows us to skip restoring
+	// the SIMD state if no other executor has loaded its state in the meantime.
+	int _simdCpu{-1};
 };
 
 struct CpuFeatures {
@@ -538,6 +553,7 @@ struct CpuFeatures {
 	static constexpr uint32_t profileAmdSupported = 2;
 
 	bool haveXsave;
+	bool haveXsaveopt;
 	bool haveAvx;
 	bool haveZmm;
 	bool haveInvariantTsc;
@@ -546,6 +562,8 @@ struct CpuFeatures {
 	bool haveSvm;
 	uint32_t profileFlags;
 	size_t xsaveRegionSize;
+	// State components that are enabled in XCR0.
+	uint64_t xsaveMask;
 };
 
 extern bool cpuFeaturesKnown;
@@ -569,13 +587,7 @@ void initializeThisProcessor();
 void bootSecondary(unsigned int apic_id, size_t cpuIndex);
 
 // Save the current SIMD register state into the given executor.
-inline void saveCurrentSimdState(Executor *executor) {
-	if(getGlobalCpuFeatures()->haveXsave) {
-		common::x86::xsave((uint8_t*)executor->_fxState(), ~0);
-	} else {
-		asm volatile ("fxsaveq %0" : : "m" (*executor->_fxState()));
-	}
-}
+void saveCurrentSimdState(Executor *executor);
 
 // --------------------------------------------------------
 // TSC functionality.
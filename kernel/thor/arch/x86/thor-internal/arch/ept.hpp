@@ -45,6 +45,9 @@ struct EptOperations final : VirtualOperations {
 	frg::expected<Error> faultPage(VirtualAddr va, MemoryView *view,
 			uintptr_t offset, PageFlags flags, CachingMode mode) override;
 
+	frg::expected<Error> faultAroundPages(VirtualAddr va, MemoryView *view,
+			uintptr_t offset, size_t size, PageFlags flags, CachingMode mode) override;
+
 	frg::expected<Error> cleanPages(VirtualAddr va, MemoryView *view,
 			uintptr_t offset, size_t size) override;
 
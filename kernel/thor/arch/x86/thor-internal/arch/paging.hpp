@@ -20,6 +20,10 @@ constexpr uint64_t ptePwt = 0x8;
 constexpr uint64_t ptePcd = 0x10;
 constexpr uint64_t pteDirty = 0x40;
 constexpr uint64_t ptePat = 0x80;
+// Only valid in non-last level PTEs. Note that this is the same bit as ptePat.
+constexpr uint64_t ptePageSize = 0x80;
+// PAT bit of large page PTEs.
+constexpr uint64_t pteLargePat = 0x1000;
 constexpr uint64_t pteGlobal = 0x100;
 constexpr uint64_t pteXd = 0x8000000000000000;
 constexpr uint64_t pteAddress = 0x000F'FFFF'FFFF'F000;
@@ -105,7 +109,7 @@ struct X86CursorPolicy {
 
 
 	static constexpr bool pteTablePresent(uint64_t pte) {
-		return pte & ptePresent;
+		return (pte & ptePresent) && !(pte & ptePageSize);
 	}
 
 	static constexpr PhysicalAddr pteTableAddress(uint64_t pte) {
@@ -121,6 +125,28 @@ struct X86CursorPolicy {
 
 		return newPtAddr | ptePresent | pteWrite | pteUser;
 	}
+
+
+	static constexpr bool ptePageLarge(uint64_t pte) {
+		return (pte & ptePresent) && (pte & ptePageSize);
+	}
+
+	static constexpr uint64_t pteBuildLarge(PhysicalAddr physical, PageFlags flags,
+			CachingMode cachingMode) {
+		assert(!(physical & (kLargePageSize - 1)));
+		auto pte = pteBuild(physical, flags, cachingMode);
+		// The PAT bit is at a different position for large pages.
+		if(pte & ptePat)
+			pte = (pte & ~ptePat) | pteLargePat;
+		return pte | ptePageSize;
+	}
+
+	static constexpr uint64_t pteLargeToSmall(uint64_t pte) {
+		auto smallPte = pte & ~(ptePageSize | pteLargePat);
+		if(pte & pteLargePat)
+			smallPte |= ptePat;
+		return smallPte;
+	}
 };
 
 using KernelCursorPolicy = X86CursorPolicy<true>;
@@ -128,6 +154,7 @@ static_assert(CursorPolicy<KernelCursorPolicy>);
 
 using ClientCursorPolicy = X86CursorPolicy<false>;
 static_assert(CursorPolicy<ClientCursorPolicy>);
+static_assert(LargePageCursorPolicy<ClientCursorPolicy>);
 
 
 struct KernelPageSpace : PageSpace {
@@ -162,4 +189,9 @@ struct ClientPageSpace : PageSpace {
 	bool updatePageAccess(VirtualAddr pointer, PageFlags);
 };
 
+// Reads an aligned word of user memory by walking the currently active page tables.
+// Unlike regular user accesses, this never faults (and hence never blocks);
+// it can be used in NMI context. Returns false if the word is not mapped.
+bool peekUserWord(VirtualAddr address, uintptr_t &value);
+
 } // namespace thor
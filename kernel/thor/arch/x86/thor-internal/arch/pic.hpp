@@ -79,6 +79,9 @@ uint32_t getLocalApicId();
 
 void calibrateApicTimer();
 
+// Converts a duration to the number of TSC ticks on the current CPU.
+uint64_t tscTicksFromNanos(uint64_t nanos);
+
 void acknowledgeIpi();
 
 void raiseInitAssertIpi(uint32_t dest_apic_id);
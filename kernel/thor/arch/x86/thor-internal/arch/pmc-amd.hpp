@@ -2,6 +2,7 @@
 
 namespace thor {
 
+void initializeAmdPmc();
 void setAmdPmc();
 bool checkAmdPmcOverflow();
 
@@ -15,6 +15,21 @@ namespace {
 	constexpr bool logCleanup = false;
 	constexpr bool logUsage = false;
 
+	// On read faults, we also map the already present pages in the surrounding
+	// (aligned) window of this size. This avoids one fault per page when
+	// the backing memory is filled in larger chunks (e.g., by readahead).
+	constexpr size_t faultAroundSize = 16 * kPageSize;
+
+	// Returns the length of the prefix of the mapping that is still backed by the view.
+	// Views can shrink below the mapping (e.g., via BackingMemory::resize());
+	// peekRange() must not be called past their end.
+	size_t mappedViewLength(Mapping *mapping) {
+		auto viewLength = mapping->view->getLength();
+		if(viewLength <= mapping->viewOffset)
+			return 0;
+		return frg::min(mapping->length, viewLength - mapping->viewOffset);
+	}
+
 	[[maybe_unused]]
 	void logRss(VirtualSpace *space) {
 		if(!logUsage)
@@ -107,6 +122,33 @@ frg::expected<Error> VirtualOperations::faultPage(VirtualAddr va, MemoryView *vi
 	return {};
 }
 
+frg::expected<Error> VirtualOperations::faultLargePage(VirtualAddr, MemoryView *,
+		uintptr_t, PageFlags, CachingMode) {
+	// The generic implementation only supports 4k pages.
+	return Error::fault;
+}
+
+frg::expected<Error> VirtualOperations::faultAroundPages(VirtualAddr va, MemoryView *view,
+		uintptr_t offset, size_t size, PageFlags flags, CachingMode mode) {
+	assert(!(va & (kPageSize - 1)));
+	assert(!(offset & (kPageSize - 1)));
+	assert(!(size & (kPageSize - 1)));
+
+	for(size_t progress = 0; progress < size; progress += kPageSize) {
+		if(isMapped(va + progress))
+			continue;
+
+		auto physicalRange = view->peekRange(offset + progress);
+		if(physicalRange.get<0>() == PhysicalAddr(-1))
+			continue;
+		assert(!(physicalRange.get<0>() & (kPageSize - 1)));
+
+		mapSingle4k(va + progress, physicalRange.get<0>(),
+				flags, determineCachingMode(physicalRange.get<1>(), mode));
+	}
+	return {};
+}
+
 frg::expected<Error> VirtualOperations::cleanPages(VirtualAddr va, MemoryView *view,
 		uintptr_t offset, size_t size) {
 	assert(!(va & (kPageSize - 1)));
@@ -381,6 +423,8 @@ VirtualSpace::map(smarter::borrowed_ptr<MemorySlice> slice,
 
 	if(offset + length > slice->length())
 		co_return Error::bufferTooSmall;
+	if(slice->getView()->isReadOnly() && (flags & (kMapProtWrite | kMapProtExecute)))
+		co_return Error::badPermissions;
 
 	co_await _consistencyMutex.async_lock();
 	frg::unique_lock consistencyLock{frg::adopt_lock, _consistencyMutex};
@@ -408,14 +452,24 @@ VirtualSpace::map(smarter::borrowed_ptr<MemorySlice> slice,
 			}
 			actualAddress = FRG_CO_TRY(_allocateAt(address, length));
 		}else{
+			// Prefer addresses that allow the use of large pages.
+			auto allocate = [&] () -> frg::expected<Error, VirtualAddr> {
+				if(length >= kLargePageSize
+						&& !((slice->offset() + offset) & (kLargePageSize - 1))) {
+					if(auto res = _allocate(length, flags, kLargePageSize))
+						return res;
+				}
+				return _allocate(length, flags);
+			};
+
 			if(address && !_areMappingsInRange(address, length)) {
 				if(auto res = _allocateAt(address, length)) {
 					actualAddress = res.unwrap();
 				}else {
-					actualAddress = FRG_CO_TRY(_allocate(length, flags));
+					actualAddress = FRG_CO_TRY(allocate());
 				}
 			}else {
-				actualAddress = FRG_CO_TRY(_allocate(length, flags));
+				actualAddress = FRG_CO_TRY(allocate());
 			}
 		}
 
@@ -455,8 +509,6 @@ VirtualSpace::map(smarter::borrowed_ptr<MemorySlice> slice,
 				slice.lock(), slice->offset() + offset);
 		mapping->selfPtr = mapping;
 
-		assert(!(flags & kMapPopulate));
-
 		auto caching = CachingMode::null;
 		if(slice->getCachingFlags() == cacheWriteCombine)
 			caching = CachingMode::writeCombine;
@@ -494,6 +546,13 @@ VirtualSpace::map(smarter::borrowed_ptr<MemorySlice> slice,
 	if(mapping->view->canEvictMemory())
 		spawnOnWorkQueue(*kernelAlloc, WorkQueue::generalQueue().lock(), mapping->runEvictionLoop());
 
+	if(flags & kMapPopulate) {
+		// Populating requires touchRange(), i.e., it can block; hence we do not want
+		// to hold _consistencyMutex exclusively while we do it.
+		consistencyLock.unlock();
+		co_await _populateMapping(mapping, wq);
+	}
+
 	co_return actualAddress;
 }
 
@@ -528,6 +587,12 @@ VirtualSpace::protect(VirtualAddr address, size_t length, uint32_t flags, WorkQu
 
 	auto [start, end] = co_await _splitMappings(address, length);
 	assert(start || (!start && !end));
+	if(flags & (kMapProtWrite | kMapProtExecute)) {
+		for (auto it = start; it != end; it = MappingTree::successor(it)) {
+			if(it->view->isReadOnly())
+				co_return Error::badPermissions;
+		}
+	}
 	for (auto it = start; it != end;) {
 		auto mapping = it->selfPtr.lock();
 		it = MappingTree::successor(it);
@@ -638,6 +703,14 @@ VirtualSpace::handleFault(VirtualAddr address, uint32_t faultFlags,
 	// TODO: Aligning should not be necessary here.
 	auto offset = (address - mapping->address) & ~(kPageSize - 1);
 
+	// Large pages can only be used if the mapping covers the whole (aligned) large page
+	// and if the view offset has the same alignment as the virtual address.
+	auto largeAddress = address & ~(kLargePageSize - 1);
+	bool tryLarge = largeAddress >= mapping->address
+			&& largeAddress + kLargePageSize <= mapping->address + mapping->length
+			&& !((mapping->viewOffset + (largeAddress - mapping->address))
+				& (kLargePageSize - 1));
+
 	while(true) {
 		FetchFlags fetchFlags = 0;
 		if(mapping->flags & MappingFlags::dontRequireBacking)
@@ -653,6 +726,15 @@ VirtualSpace::handleFault(VirtualAddr address, uint32_t faultFlags,
 		co_await mapping->evictionMutex.async_lock();
 		frg::unique_lock evictionLock{frg::adopt_lock, mapping->evictionMutex};
 
+		if(tryLarge) {
+			auto largeOutcome = _ops->faultLargePage(largeAddress,
+					mapping->view.get(), mapping->viewOffset + (largeAddress - mapping->address),
+					mapping->compilePageFlags(), caching);
+			if(largeOutcome)
+				co_return {};
+			// Otherwise, fall back to 4k pages.
+		}
+
 		auto remapOutcome = _ops->faultPage(address & ~(kPageSize - 1),
 				mapping->view.get(), mapping->viewOffset + offset,
 				mapping->compilePageFlags(), caching);
@@ -669,10 +751,71 @@ VirtualSpace::handleFault(VirtualAddr address, uint32_t faultFlags,
 			}
 		}
 
+		// Map present neighbours in the same walk while we still hold the evictionMutex.
+		// Write faults are excluded since they usually trigger copy-on-write or dirty
+		// tracking for the faulting page only.
+		if(!(faultFlags & VirtualSpace::kFaultWrite)) {
+			auto aroundAddress = address & ~(faultAroundSize - 1);
+			auto aroundStart = frg::max(aroundAddress, mapping->address);
+			auto aroundEnd = frg::min(aroundAddress + faultAroundSize,
+					mapping->address + mappedViewLength(mapping.get()));
+			if(aroundStart < aroundEnd) {
+				auto aroundOutcome = _ops->faultAroundPages(aroundStart, mapping->view.get(),
+						mapping->viewOffset + (aroundStart - mapping->address),
+						aroundEnd - aroundStart, mapping->compilePageFlags(), caching);
+				assert(aroundOutcome);
+			}
+		}
+
 		co_return {};
 	}
 }
 
+coroutine<void> VirtualSpace::_populateMapping(smarter::shared_ptr<Mapping> mapping,
+		WorkQueue *wq) {
+	co_await _consistencyMutex.async_lock_shared();
+	frg::shared_lock consistencyLock{frg::adopt_lock, _consistencyMutex};
+
+	// The mapping might have been unmapped concurrently.
+	if(mapping->state != MappingState::active)
+		co_return;
+
+	FetchFlags fetchFlags = 0;
+	if(mapping->flags & MappingFlags::dontRequireBacking)
+		fetchFlags |= fetchDisallowBacking;
+
+	// Like MAP_POPULATE on Linux, populating is best effort. If touchRange() fails,
+	// the remaining pages are faulted in on access.
+	// touchRange() may return after a single chunk, hence we loop on its progress.
+	auto length = mappedViewLength(mapping.get());
+	size_t progress = 0;
+	while(progress < length) {
+		auto touchOutcome = co_await mapping->view->touchRange(mapping->viewOffset + progress,
+				length - progress, fetchFlags, wq);
+		if(!touchOutcome)
+			break;
+		assert(touchOutcome.value());
+		progress += touchOutcome.value();
+	}
+	progress = frg::min(progress, length) & ~(kPageSize - 1);
+
+	auto caching = CachingMode::null;
+	if(mapping->slice->getCachingFlags() == cacheWriteCombine)
+		caching = CachingMode::writeCombine;
+
+	co_await mapping->evictionMutex.async_lock();
+	frg::unique_lock evictionLock{frg::adopt_lock, mapping->evictionMutex};
+
+	// The view might have shrunk while we were touching it.
+	progress = frg::min(progress, mappedViewLength(mapping.get()));
+	if(!progress)
+		co_return;
+
+	auto populateOutcome = _ops->faultAroundPages(mapping->address, mapping->view.get(),
+			mapping->viewOffset, progress, mapping->compilePageFlags(), caching);
+	assert(populateOutcome);
+}
+
 coroutine<frg::expected<Error, PhysicalAddr>>
 VirtualSpace::retrievePhysical(VirtualAddr address, WorkQueue *wq) {
 	// We do not take _consistencyMutex here since we are only interested in a snapshot.
@@ -708,6 +851,27 @@ VirtualSpace::retrievePhysical(VirtualAddr address, WorkQueue *wq) {
 	}
 }
 
+frg::expected<Error, frg::tuple<smarter::shared_ptr<MemoryView>, uintptr_t, bool>>
+VirtualSpace::resolveView(VirtualAddr address, size_t length) {
+	smarter::shared_ptr<Mapping> mapping;
+	{
+		auto irq_lock = frg::guard(&irqMutex());
+		auto space_guard = frg::guard(&_snapshotMutex);
+
+		mapping = _findMapping(address);
+	}
+	if(!mapping)
+		return Error::fault;
+	if(!(mapping->flags & MappingFlags::protRead))
+		return Error::fault;
+	if(length > mapping->address + mapping->length - address)
+		return Error::fault;
+
+	return frg::tuple<smarter::shared_ptr<MemoryView>, uintptr_t, bool>{mapping->view,
+			mapping->viewOffset + (address - mapping->address),
+			static_cast<bool>(mapping->flags & MappingFlags::protWrite)};
+}
+
 smarter::shared_ptr<Mapping> VirtualSpace::_findMapping(VirtualAddr address) {
 	auto current = _mappings.get_root();
 	while(current) {
@@ -746,13 +910,18 @@ bool VirtualSpace::_areMappingsInRange(VirtualAddr address, size_t length) {
 	return false;
 }
 
-frg::expected<Error, VirtualAddr> VirtualSpace::_allocate(size_t length, MapFlags flags) {
+frg::expected<Error, VirtualAddr> VirtualSpace::_allocate(size_t length, MapFlags flags,
+		size_t align) {
 	assert(length > 0);
 	assert((length % kPageSize) == 0);
+	assert(align >= kPageSize && !(align & (align - 1)));
 //	infoLogger() << "Allocate virtual memory area"
 //			<< ", size: 0x" << frg::hex_fmt(length) << frg::endlog;
 
-	if(_holes.get_root()->largestHole < length)
+	// Any hole of this size can satisfy the alignment constraint.
+	auto requiredLength = length + (align - kPageSize);
+
+	if(_holes.get_root()->largestHole < requiredLength)
 		return Error::noMemory;
 
 	auto current = _holes.get_root();
@@ -760,41 +929,41 @@ frg::expected<Error, VirtualAddr> VirtualSpace::_allocate(size_t length, MapFlag
 		if(flags & kMapPreferBottom) {
 			// Try to allocate memory at the bottom of the range.
 			if(HoleTree::get_left(current)
-					&& HoleTree::get_left(current)->largestHole >= length) {
+					&& HoleTree::get_left(current)->largestHole >= requiredLength) {
 				current = HoleTree::get_left(current);
 				continue;
 			}
 
-			if(current->length() >= length) {
+			if(current->length() >= requiredLength) {
 				// Note that _splitHole can deallocate the hole!
-				auto address = current->address();
-				_splitHole(current, 0, length);
+				auto address = (current->address() + (align - 1)) & ~(align - 1);
+				_splitHole(current, address - current->address(), length);
 				return address;
 			}
 
 			assert(HoleTree::get_right(current));
-			assert(HoleTree::get_right(current)->largestHole >= length);
+			assert(HoleTree::get_right(current)->largestHole >= requiredLength);
 			current = HoleTree::get_right(current);
 		}else{
 			// Try to allocate memory at the top of the range.
 			assert(flags & kMapPreferTop);
 
 			if(HoleTree::get_right(current)
-					&& HoleTree::get_right(current)->largestHole >= length) {
+					&& HoleTree::get_right(current)->largestHole >= requiredLength) {
 				current = HoleTree::get_right(current);
 				continue;
 			}
 
-			if(current->length() >= length) {
+			if(current->length() >= requiredLength) {
 				// Note that _splitHole can deallocate the hole!
-				auto offset = current->length() - length;
-				auto address = current->address() + offset;
-				_splitHole(current, offset, length);
+				auto address = (current->address() + current->length() - length)
+						& ~(align - 1);
+				_splitHole(current, address - current->address(), length);
 				return address;
 			}
 
 			assert(HoleTree::get_left(current));
-			assert(HoleTree::get_left(current)->largestHole >= length);
+			assert(HoleTree::get_left(current)->largestHole >= requiredLength);
 			current = HoleTree::get_left(current);
 		}
 	}
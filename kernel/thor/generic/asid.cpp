@@ -8,19 +8,25 @@
 namespace thor {
 
 THOR_DEFINE_PERCPU(asidData);
+THOR_DEFINE_PERCPU(tlbData);
 
 namespace {
 
+// If we're invalidating at least this many pages, just invalidate
+// the whole ASID instead.
+constexpr size_t asidFlushThreshold = 64;
+
 void invalidateNode(int asid, ShootNode *node) {
-	// If we're invalidating a lot of pages, just invalidate the
-	// whole ASID instead.
 	// invalidateAsid(globalBindingId) is not allowed, so avoid
 	// the optimization in that case.
-	if(asid != globalBindingId && (node->size >> kPageShift) >= 64) {
+	auto &stats = tlbData.get();
+	if(asid != globalBindingId && (node->size >> kPageShift) >= asidFlushThreshold) {
 		invalidateAsid(asid);
+		stats.numAsidFlushes.fetch_add(1, std::memory_order_relaxed);
 	} else {
 		for(size_t off = 0; off < node->size; off += kPageSize)
 			invalidatePage(asid, reinterpret_cast<void *>(node->address + off));
+		stats.numPageFlushes.fetch_add(node->size >> kPageShift, std::memory_order_relaxed);
 	}
 }
 
@@ -28,20 +34,43 @@ void invalidateNode(int asid, ShootNode *node) {
 
 
 ShootNodeList
-PageBinding::completeShootdown_(PageSpace *space, uint64_t afterSequence, bool doShootdown) {
+PageBinding::completeShootdown_(PageSpace *space, uint64_t afterSequence,
+		CompleteMode mode, CpuData *cpu) {
 	assert(!intsAreEnabled());
 	assert(space->mutex_.is_locked());
 
 	ShootNodeList complete;
 
+	// Requests that queue up while the IPI is in flight are handled as a batch:
+	// if they cover enough pages in total, flush the entire ASID once.
+	bool flushAsid = false;
+	if(mode == CompleteMode::shootdown && id_ != globalBindingId
+			&& !space->shootQueue_.empty()) {
+		size_t numPages = 0;
+		auto current = space->shootQueue_.back();
+		while(current->sequence_ > afterSequence) {
+			if(current->initiatorCpu_ != cpu)
+				numPages += current->size >> kPageShift;
+			current = current->queueNode.previous;
+			if(!current)
+				break;
+		}
+
+		if(numPages >= asidFlushThreshold) {
+			invalidateAsid(id_);
+			tlbData.get().numAsidFlushes.fetch_add(1, std::memory_order_relaxed);
+			flushAsid = true;
+		}
+	}
+
 	if(!space->shootQueue_.empty()) {
 		auto current = space->shootQueue_.back();
 		while(current->sequence_ > afterSequence) {
 			auto predecessor = current->queueNode.previous;
 
 			// Signal completion of the shootdown.
-			if(current->initiatorCpu_ != getCpuData()) {
-				if(doShootdown) {
+			if(current->initiatorCpu_ != cpu) {
+				if(mode == CompleteMode::shootdown && !flushAsid) {
 					invalidateNode(id_, current);
 				}
 
@@ -58,9 +87,15 @@ PageBinding::completeShootdown_(PageSpace *space, uint64_t afterSequence, bool d
 		}
 	}
 
+	if(mode == CompleteMode::lazy) {
+		// The CPU flushes the ASID once it leaves lazy TLB mode.
+		stale_ = true;
+		alreadyShotSequence_ = space->shootSequence_;
+	}
+
 	// If not just doing a TLB shootdown, we're unbinding this
 	// page space.
-	if(!doShootdown) {
+	if(mode == CompleteMode::unbind) {
 		space->numBindings_--;
 		if(!space->numBindings_ && space->retireNode_) {
 			auto node = space->retireNode_;
@@ -115,6 +150,9 @@ void PageBinding::rebind(smarter::shared_ptr<PageSpace> space) {
 
 	boundSpace_ = space;
 	alreadyShotSequence_ = targetSeq;
+	rawBoundSpace_.store(space.get(), std::memory_order_relaxed);
+	// Switching invalidates the ASID.
+	stale_ = false;
 
 	switchToPageTable(boundSpace_->rootTable(), id_, true);
 
@@ -129,7 +167,8 @@ void PageBinding::rebind(smarter::shared_ptr<PageSpace> space) {
 		complete = completeShootdown_(
 			unboundSpace.get(),
 			unboundSequence,
-			false);
+			CompleteMode::unbind,
+			getCpuData());
 	}
 
 	while(!complete.empty()) {
@@ -155,6 +194,7 @@ void PageBinding::initialBind(smarter::shared_ptr<PageSpace> space) {
 
 	boundSpace_ = space;
 	alreadyShotSequence_ = targetSeq;
+	rawBoundSpace_.store(space.get(), std::memory_order_relaxed);
 }
 
 void PageBinding::unbind() {
@@ -174,19 +214,26 @@ void PageBinding::unbind() {
 		invalidateAsid(id_);
 	}
 
+	// Keep the space alive until we drop its lock.
+	auto space = boundSpace_;
+
 	ShootNodeList complete;
 	{
-		auto lock = frg::guard(&boundSpace_->mutex_);
+		auto lock = frg::guard(&space->mutex_);
 
 		complete = completeShootdown_(
-			boundSpace_.get(),
+			space.get(),
 			alreadyShotSequence_,
-			false);
+			CompleteMode::unbind,
+			getCpuData());
+
+		// Remote CPUs may inspect this binding while we are lazy.
+		boundSpace_ = nullptr;
+		alreadyShotSequence_ = 0;
+		rawBoundSpace_.store(nullptr, std::memory_order_relaxed);
+		stale_ = false;
 	}
 
-	boundSpace_ = nullptr;
-	alreadyShotSequence_ = 0;
-
 	while(!complete.empty()) {
 		auto current = complete.pop_front();
 		current->complete();
@@ -206,20 +253,18 @@ void PageBinding::shootdown() {
 	}
 
 	ShootNodeList complete;
-	uint64_t targetSeq;
 	{
 		auto lock = frg::guard(&boundSpace_->mutex_);
 
 		complete = completeShootdown_(
 			boundSpace_.get(),
 			alreadyShotSequence_,
-			true);
+			CompleteMode::shootdown,
+			getCpuData());
 
-		targetSeq = boundSpace_->shootSequence_;
+		alreadyShotSequence_ = boundSpace_->shootSequence_;
 	}
 
-	alreadyShotSequence_ = targetSeq;
-
 	while(!complete.empty()) {
 		auto current = complete.pop_front();
 		current->complete();
@@ -227,7 +272,93 @@ void PageBinding::shootdown() {
 }
 
 
+void PageBinding::flushIfStale() {
+	assert(!intsAreEnabled());
+
+	// Remote CPUs do not touch stale_ since this CPU is not lazy anymore.
+	if(!stale_)
+		return;
+
+	invalidateAsid(id_);
+	stale_ = false;
+	tlbData.get().numLazyFlushes.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void enterLazyTlb() {
+	assert(!intsAreEnabled());
+	auto &tlb = tlbData.get();
+
+	// Only this CPU changes the state, hence we can read it without locking.
+	if(tlb.state == TlbState::lazy)
+		return;
+
+	auto lock = frg::guard(&tlb.mutex);
+	tlb.state = TlbState::lazy;
+}
+
+namespace {
+
+void leaveLazyTlb() {
+	assert(!intsAreEnabled());
+	auto &tlb = tlbData.get();
+
+	if(tlb.state == TlbState::active)
+		return;
+
+	bool wasLazy;
+	{
+		auto lock = frg::guard(&tlb.mutex);
+		wasLazy = tlb.state == TlbState::lazy;
+		tlb.state = TlbState::active;
+	}
+
+	// From now on, remote CPUs send IPIs again. Flush all ASIDs
+	// for which shootdowns were completed on our behalf.
+	if(wasLazy) {
+		for(auto &binding : asidData.get()->bindings)
+			binding.flushIfStale();
+	}
+}
+
+} // namespace anonymous
+
+void handleShootdownIpi() {
+	assert(!intsAreEnabled());
+	auto &tlb = tlbData.get();
+
+	// Clear the flag before looking at the shoot queues. Requests that are submitted
+	// after this point either are seen below or send another IPI.
+	tlb.ipiPending.exchange(false, std::memory_order_acq_rel);
+	tlb.numIpisReceived.fetch_add(1, std::memory_order_relaxed);
+
+	for(auto &binding : asidData.get()->bindings)
+		binding.shootdown();
+
+	asidData.get()->globalBinding.shootdown();
+}
+
+ShootdownStatistics getShootdownStatistics() {
+	ShootdownStatistics stats{};
+	for(size_t i = 0; i < getCpuCount(); i++) {
+		auto &tlb = tlbData.get(getCpuData(i));
+		stats.requests += tlb.numRequests.load(std::memory_order_relaxed);
+		stats.ipisSent += tlb.numIpisSent.load(std::memory_order_relaxed);
+		stats.ipisCoalesced += tlb.numIpisCoalesced.load(std::memory_order_relaxed);
+		stats.ipisSkipped += tlb.numIpisSkipped.load(std::memory_order_relaxed);
+		stats.ipisReceived += tlb.numIpisReceived.load(std::memory_order_relaxed);
+		stats.broadcasts += tlb.numBroadcasts.load(std::memory_order_relaxed);
+		stats.pageFlushes += tlb.numPageFlushes.load(std::memory_order_relaxed);
+		stats.asidFlushes += tlb.numAsidFlushes.load(std::memory_order_relaxed);
+		stats.lazyFlushes += tlb.numLazyFlushes.load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+
 void PageSpace::activate(smarter::shared_ptr<PageSpace> space) {
+	leaveLazyTlb();
+
 	auto &bindings = asidData.get()->bindings;
 
 	size_t lruIdx = 0;
@@ -273,6 +404,8 @@ void PageSpace::retire(RetireNode *node) {
 	if(!anyBindings)
 		node->complete();
 
+	// Lazy CPUs have to switch away from the page tables, so they are not skipped here.
+	tlbData.get().numBroadcasts.fetch_add(1, std::memory_order_relaxed);
 	sendShootdownIpi();
 }
 
@@ -281,10 +414,15 @@ bool PageSpace::submitShootdown(ShootNode *node) {
 	assert(!(node->address & (kPageSize - 1)));
 	assert(!(node->size & (kPageSize - 1)));
 
+	ShootNodeList complete;
+	bool broadcast = false;
 	{
 		auto irqLock = frg::guard(&irqMutex());
 		auto lock = frg::guard(&mutex_);
 
+		auto self = getCpuData();
+		auto &stats = tlbData.get();
+
 		auto unshotBindings = numBindings_;
 
 		auto &bindings = asidData.get()->bindings;
@@ -308,14 +446,73 @@ bool PageSpace::submitShootdown(ShootNode *node) {
 		if(!unshotBindings)
 			return true;
 
-		node->initiatorCpu_ = getCpuData();
+		node->initiatorCpu_ = self;
 		node->sequence_ = ++shootSequence_;
 		node->bindingsToShoot_ = unshotBindings;
 		shootQueue_.push_back(node);
+		stats.numRequests.fetch_add(1, std::memory_order_relaxed);
+
+		if(this == &KernelPageSpace::global()) {
+			// All CPUs use the kernel page space, even lazy ones.
+			stats.numBroadcasts.fetch_add(1, std::memory_order_relaxed);
+			broadcast = true;
+		} else {
+			for(size_t i = 0; i < getCpuCount(); i++) {
+				auto cpu = getCpuData(i);
+				if(cpu == self)
+					continue;
+
+				auto &tlb = tlbData.get(cpu);
+				auto tlbLock = frg::guard(&tlb.mutex);
+
+				// Offline CPUs have no bindings to user page spaces.
+				if(tlb.state == TlbState::offline)
+					continue;
+
+				// Lazy CPUs do not access user memory. Complete the requests of their
+				// bindings right away; they flush the ASIDs before becoming active.
+				// Bindings can only switch to a different space while the CPU is active,
+				// so the bindings that point to this space are stable.
+				if(tlb.state == TlbState::lazy) {
+					for(auto &binding : asidData.get(cpu)->bindings) {
+						if(binding.rawBoundSpace_.load(std::memory_order_relaxed) != this)
+							continue;
+
+						auto done = binding.completeShootdown_(this, binding.alreadyShotSequence_,
+								PageBinding::CompleteMode::lazy, cpu);
+						while(!done.empty())
+							complete.push_back(done.pop_front());
+					}
+					stats.numIpisSkipped.fetch_add(1, std::memory_order_relaxed);
+					continue;
+				}
+				tlbLock.unlock();
+
+				// If an IPI is still pending, the CPU will see our request when handling it.
+				if(tlb.ipiPending.exchange(true, std::memory_order_acq_rel)) {
+					stats.numIpisCoalesced.fetch_add(1, std::memory_order_relaxed);
+					continue;
+				}
+				sendShootdownIpi(cpu);
+				stats.numIpisSent.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
 	}
 
-	sendShootdownIpi();
-	return false;
+	if(broadcast)
+		sendShootdownIpi();
+
+	// If only lazy CPUs were affected, our own request may already be complete.
+	bool done = false;
+	while(!complete.empty()) {
+		auto current = complete.pop_front();
+		if(current == node) {
+			done = true;
+			continue;
+		}
+		current->complete();
+	}
+	return done;
 }
 
 
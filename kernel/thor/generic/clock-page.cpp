@@ -0,0 +1,126 @@
+#include <string.h>
+
+#include <hel.h>
+#include <initgraph.hpp>
+#include <thor-internal/arch-generic/timer.hpp>
+#include <thor-internal/clock-page.hpp>
+#include <thor-internal/debug.hpp>
+#include <thor-internal/main.hpp>
+#include <thor-internal/physical.hpp>
+
+namespace thor {
+
+namespace {
+
+// A single page of kernel memory. Userspace can map it but it cannot write to it.
+struct ClockPageMemory final : MemoryView {
+	ClockPageMemory() {
+		_physical = physicalAllocator->allocate(kPageSize);
+		assert(_physical != PhysicalAddr(-1) && "OOM when allocating the clock page");
+
+		PageAccessor accessor{_physical};
+		memset(accessor.get(), 0, kPageSize);
+	}
+
+	ClockPageMemory(const ClockPageMemory &) = delete;
+
+	~ClockPageMemory() {
+		physicalAllocator->free(_physical, kPageSize);
+	}
+
+	ClockPageMemory &operator= (const ClockPageMemory &) = delete;
+
+	bool isReadOnly() override {
+		return true;
+	}
+
+	size_t getLength() override {
+		return kPageSize;
+	}
+
+	coroutine<frg::expected<Error>> copyTo(uintptr_t, const void *, size_t,
+			FetchFlags, WorkQueue *) override {
+		co_return Error::badPermissions;
+	}
+
+	Error lockRange(uintptr_t, size_t) override {
+		// The page is never evicted.
+		return Error::success;
+	}
+
+	void unlockRange(uintptr_t, size_t) override {
+		// The page is never evicted.
+	}
+
+	frg::tuple<PhysicalAddr, CachingMode> peekRange(uintptr_t offset) override {
+		assert(offset == 0);
+		return frg::tuple<PhysicalAddr, CachingMode>{_physical, CachingMode::null};
+	}
+
+	coroutine<frg::expected<Error, size_t>>
+	touchRange(uintptr_t offset, size_t, FetchFlags, WorkQueue *) override {
+		if(offset >= kPageSize)
+			co_return Error::fault;
+		co_return kPageSize - offset;
+	}
+
+	void markDirty(uintptr_t, size_t) override {
+		// The page is never evicted, there is no need to track dirty pages.
+	}
+
+	// Updates the page. Readers synchronize using the seqlock.
+	template<typename F>
+	void update(F fn) {
+		PageAccessor accessor{_physical};
+		auto page = reinterpret_cast<HelClockPage *>(accessor.get());
+
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&_mutex);
+
+		auto seqlock = __atomic_load_n(&page->seqlock, __ATOMIC_RELAXED);
+		__atomic_store_n(&page->seqlock, seqlock + 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+
+		fn(page);
+
+		__atomic_store_n(&page->seqlock, seqlock + 2, __ATOMIC_RELEASE);
+	}
+
+private:
+	frg::ticket_spinlock _mutex;
+
+	PhysicalAddr _physical;
+};
+
+frg::manual_box<smarter::shared_ptr<ClockPageMemory>> clockPageMemory;
+
+initgraph::Task initClockPage{&globalInitEngine, "generic.init-clock-page",
+	initgraph::Requires{getTaskingAvailableStage()},
+	[] {
+		clockPageMemory.initialize(smarter::allocate_shared<ClockPageMemory>(*kernelAlloc));
+
+		auto conversion = getUserClockConversion();
+		(*clockPageMemory)->update([&] (HelClockPage *page) {
+			if(conversion) {
+				__atomic_store_n(&page->scale, conversion->f, __ATOMIC_RELAXED);
+				__atomic_store_n(&page->shift, conversion->s, __ATOMIC_RELAXED);
+				__atomic_store_n(&page->offset, 0, __ATOMIC_RELAXED);
+				__atomic_store_n(&page->flags, kHelClockPageCounterValid, __ATOMIC_RELAXED);
+			}else{
+				__atomic_store_n(&page->flags, 0, __ATOMIC_RELAXED);
+			}
+		});
+
+		if(!conversion)
+			infoLogger() << "thor: Clock page is unavailable,"
+					" userspace falls back to helGetClock()" << frg::endlog;
+	}
+};
+
+} // anonymous namespace
+
+smarter::shared_ptr<MemoryView> getClockPageMemory() {
+	return *clockPageMemory;
+}
+
+} // namespace thor
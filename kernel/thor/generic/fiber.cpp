@@ -1,6 +1,7 @@
 #include <thor-internal/debug.hpp>
 #include <thor-internal/fiber.hpp>
 #include <thor-internal/main.hpp>
+#include <thor-internal/arch-generic/asid.hpp>
 #include <thor-internal/arch-generic/cpu.hpp>
 
 namespace thor {
@@ -97,6 +98,9 @@ KernelFiber::KernelFiber(UniqueKernelStack stack, AbiParameters abi)
 void KernelFiber::invoke() {
 	assert(!intsAreEnabled());
 
+	// Fibers do not access user memory.
+	enterLazyTlb();
+
 	getCpuData()->executorContext = &_executorContext;
 	getCpuData()->activeFiber = this;
 	restoreExecutor(&_executor);
@@ -8,6 +8,7 @@
 #include <frg/dyn_array.hpp>
 #include <frg/small_vector.hpp>
 #include <thor-internal/cancel.hpp>
+#include <thor-internal/clock-page.hpp>
 #include <thor-internal/event.hpp>
 #include <thor-internal/coroutine.hpp>
 #include <thor-internal/io.hpp>
@@ -245,7 +246,7 @@ HelError helSubmitAsyncNop(HelHandle queueHandle, uintptr_t context) {
 	smarter::shared_ptr<IpcQueue> queue;
 	{
 		auto irqLock = frg::guard(&irqMutex());
-		Universe::Guard universeGuard(thisUniverse->lock);
+		Universe::ReadGuard universeGuard;
 
 		auto queueWrapper = thisUniverse->getDescriptor(universeGuard, queueHandle);
 		if(!queueWrapper)
@@ -291,7 +292,7 @@ helTransferDescriptor(HelHandle handle, HelHandle universeHandle, HelTransferDes
 
 	{
 		auto irqLock = frg::guard(&irqMutex());
-		Universe::Guard lock(thisUniverse->lock);
+		Universe::ReadGuard lock;
 
 		smarter::shared_ptr<Universe> universe;
 		if(universeHandle == kHelThisUniverse) {
@@ -317,7 +318,7 @@ helTransferDescriptor(HelHandle handle, HelHandle universeHandle, HelTransferDes
 
 	{
 		auto irqLock = frg::guard(&irqMutex());
-		Universe::Guard lock{srcUniverse->lock};
+		Universe::ReadGuard lock;
 
 		auto descriptorIt = srcUniverse->getDescriptor(lock, handle);
 		if (!descriptorIt)
@@ -341,7 +342,7 @@ HelError helDescriptorInfo(HelHandle handle, HelDescriptorInfo *) {
 	auto this_universe = this_thread->getUniverse();
 
 	auto irq_lock = frg::guard(&irqMutex());
-	Universe::Guard universe_guard(this_universe->lock);
+	Universe::ReadGuard universe_guard;
 
 	auto wrapper = this_universe->getDescriptor(universe_guard, handle);
 	if(!wrapper)
@@ -362,7 +363,7 @@ HelError helGetCredentials(HelHandle handle, uint32_t flags, char *credentials)
 	std::array<char, 16> creds;
 	{
 		auto irqLock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(thisUniverse->lock);
+		Universe::ReadGuard universe_guard;
 
 		if(handle == kHelThisThread) {
 			creds = thisThread->credentials();
@@ -394,7 +395,7 @@ HelError helCloseDescriptor(HelHandle universeHandle, HelHandle handle) {
 		universe = thisUniverse.lock();
 	}else{
 		auto irqLock = frg::guard(&irqMutex());
-		Universe::Guard universeLock(thisUniverse->lock);
+		Universe::ReadGuard universeLock;
 
 		auto universeIt = thisUniverse->getDescriptor(universeLock, universeHandle);
 		if(!universeIt)
@@ -404,17 +405,17 @@ HelError helCloseDescriptor(HelHandle universeHandle, HelHandle handle) {
 		universe = universeIt->get<UniverseDescriptor>().universe;
 	}
 
-	frg::optional<AnyDescriptor> descriptor;
+	bool detached;
 	{
 		auto irqLock = frg::guard(&irqMutex());
 		Universe::Guard otherUniverseLock(universe->lock);
 
-		descriptor = universe->detachDescriptor(otherUniverseLock, handle);
+		detached = universe->detachDescriptor(otherUniverseLock, handle);
 	}
-	if(!descriptor)
+	if(!detached)
 		return kHelErrNoDescriptor;
 
-	// Note that the descriptor is released outside of the locks.
+	// Note that the descriptor is released outside of the locks (after an RCU grace period).
 
 	return kHelErrNone;
 }
@@ -454,7 +455,7 @@ HelError helDriveQueue(HelHandle handle, uint32_t flags) {
 	smarter::shared_ptr<IpcQueue> queue;
 	{
 		auto irqLock = frg::guard(&irqMutex());
-		Universe::Guard universeGuard(thisUniverse->lock);
+		Universe::ReadGuard universeGuard;
 
 		auto queueWrapper = thisUniverse->getDescriptor(universeGuard, handle);
 		if(!queueWrapper)
@@ -494,7 +495,7 @@ HelError helAlertQueue(HelHandle handle) {
 	smarter::shared_ptr<IpcQueue> queue;
 	{
 		auto irqLock = frg::guard(&irqMutex());
-		Universe::Guard universeGuard(thisUniverse->lock);
+		Universe::ReadGuard universeGuard;
 
 		auto queueWrapper = thisUniverse->getDescriptor(universeGuard, handle);
 		if(!queueWrapper)
@@ -534,6 +535,9 @@ HelError helAllocateMemory(size_t size, uint32_t flags,
 	if(flags & kHelAllocContinuous) {
 		memory = smarter::allocate_shared<AllocatedMemory>(*kernelAlloc, size, effective.addressBits,
 				size, kPageSize);
+	}else if(flags & kHelAllocLargePages) {
+		memory = smarter::allocate_shared<AllocatedMemory>(*kernelAlloc, size, effective.addressBits,
+				kPageSize, kPageSize, true);
 	}else if(flags & kHelAllocOnDemand) {
 		memory = smarter::allocate_shared<AllocatedMemory>(*kernelAlloc, size, effective.addressBits);
 	}else{
@@ -561,7 +565,7 @@ HelError doSubmitResizeMemory(HelHandle handle, smarter::shared_ptr<IpcQueue> qu
 	smarter::shared_ptr<MemoryView> memory;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!wrapper)
@@ -635,7 +639,7 @@ HelError helCopyOnWrite(HelHandle memoryHandle,
 
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		if(memoryHandle >= 0) {
 			auto wrapper = this_universe->getDescriptor(universe_guard, memoryHandle);
@@ -709,7 +713,7 @@ HelError helAlterMemoryIndirection(HelHandle indirectHandle, size_t slot,
 	CachingFlags cacheFlags = 0;
 	{
 		auto irqLock = frg::guard(&irqMutex());
-		Universe::Guard universeLock(thisUniverse->lock);
+		Universe::ReadGuard universeLock;
 
 		auto indirectWrapper = thisUniverse->getDescriptor(universeLock, indirectHandle);
 		if(!indirectWrapper)
@@ -733,6 +737,10 @@ HelError helAlterMemoryIndirection(HelHandle indirectHandle, size_t slot,
 		}
 	}
 
+	// Indirect memory is mapped writable; it must not expose read-only views.
+	if(memoryView->isReadOnly())
+		return kHelErrBadPermissions;
+
 	if(auto e = indirectView->setIndirection(slot, std::move(memoryView), offset, size, cacheFlags);
 			e != Error::success) {
 		if(e == Error::illegalObject) {
@@ -760,7 +768,7 @@ HelError helCreateSliceView(HelHandle memoryHandle,
 	smarter::shared_ptr<MemoryView> view;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto wrapper = this_universe->getDescriptor(universe_guard, memoryHandle);
 		if(!wrapper)
@@ -795,7 +803,7 @@ HelError doSubmitForkMemory(HelHandle handle, smarter::shared_ptr<IpcQueue> queu
 	smarter::shared_ptr<MemoryView> view;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto viewWrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!viewWrapper)
@@ -911,7 +919,7 @@ HelError helCreateVirtualizedCpu(HelHandle handle, HelHandle *out) {
 	smarter::shared_ptr<VirtualizedPageSpace> vspace;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!wrapper)
@@ -954,7 +962,7 @@ HelError helRunVirtualizedCpu(HelHandle handle, HelVmexitReason *exitInfo) {
 	smarter::shared_ptr<VirtualizedCpu> vcpu;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!wrapper)
@@ -1016,6 +1024,8 @@ HelError helMapMemory(HelHandle memory_handle, HelHandle space_handle,
 
 	if(flags & kHelMapDontRequireBacking)
 		map_flags |= AddressSpace::kMapDontRequireBacking;
+	if(flags & kHelMapPopulate)
+		map_flags |= AddressSpace::kMapPopulate;
 
 	smarter::shared_ptr<MemorySlice> slice;
 	smarter::shared_ptr<AddressSpace, BindableHandle> space;
@@ -1023,7 +1033,7 @@ HelError helMapMemory(HelHandle memory_handle, HelHandle space_handle,
 	bool isVspace = false;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto memory_wrapper = this_universe->getDescriptor(universe_guard, memory_handle);
 		if(!memory_wrapper)
@@ -1078,7 +1088,8 @@ HelError helMapMemory(HelHandle memory_handle, HelHandle space_handle,
 	}
 
 	if(!mapResult) {
-		assert(mapResult.error() == Error::bufferTooSmall || mapResult.error() == Error::alreadyExists || mapResult.error() == Error::noMemory);
+		assert(mapResult.error() == Error::bufferTooSmall || mapResult.error() == Error::alreadyExists
+				|| mapResult.error() == Error::noMemory || mapResult.error() == Error::badPermissions);
 
 		if(mapResult.error() == Error::bufferTooSmall)
 			return kHelErrBufferTooSmall;
@@ -1086,6 +1097,8 @@ HelError helMapMemory(HelHandle memory_handle, HelHandle space_handle,
 			return kHelErrNoMemory;
 		else if(mapResult.error() == Error::alreadyExists)
 			return kHelErrAlreadyExists;
+		else if(mapResult.error() == Error::badPermissions)
+			return kHelErrBadPermissions;
 	}
 
 	*actualPointer = (void *)mapResult.value();
@@ -1108,7 +1121,7 @@ HelError doSubmitProtectMemory(HelHandle space_handle, smarter::shared_ptr<IpcQu
 	smarter::shared_ptr<AddressSpace, BindableHandle> space;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		if(space_handle == kHelNullHandle) {
 			space = this_thread->getAddressSpace().lock();
@@ -1133,10 +1146,11 @@ HelError doSubmitProtectMemory(HelHandle space_handle, smarter::shared_ptr<IpcQu
 			enable_detached_coroutine) -> void {
 		auto outcome = co_await space->protect(pointer, length, protectFlags,
 				thisThread->mainWorkQueue().get());
-		// TODO: handle errors after propagating them through VirtualSpace::protect.
-		assert(outcome);
+		assert(outcome || outcome.error() == Error::badPermissions);
 
 		HelSimpleResult helResult{.error = kHelErrNone, .reserved = {}};
+		if(!outcome)
+			helResult.error = translateError(outcome.error());
 		QueueSource ipcSource{&helResult, sizeof(HelSimpleResult), nullptr};
 		co_await queue->submit(&ipcSource, context);
 	}(this_thread.lock(), std::move(space), std::move(queue), reinterpret_cast<VirtualAddr>(pointer),
@@ -1153,7 +1167,7 @@ HelError helUnmapMemory(HelHandle space_handle, void *pointer, size_t length) {
 	smarter::shared_ptr<AddressSpace, BindableHandle> space;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		if(space_handle == kHelNullHandle) {
 			space = this_thread->getAddressSpace().lock();
@@ -1185,7 +1199,7 @@ HelError doSubmitSynchronizeSpace(HelHandle spaceHandle, smarter::shared_ptr<Ipc
 	smarter::shared_ptr<AddressSpace, BindableHandle> space;
 	{
 		auto irqLock = frg::guard(&irqMutex());
-		Universe::Guard universeGuard(thisUniverse->lock);
+		Universe::ReadGuard universeGuard;
 
 		if(spaceHandle == kHelNullHandle) {
 			space = thisThread->getAddressSpace().lock();
@@ -1245,7 +1259,7 @@ HelError doSubmitReadMemory(HelHandle handle, smarter::shared_ptr<IpcQueue> queu
 	AnyDescriptor descriptor;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universeGuard(thisUniverse->lock);
+		Universe::ReadGuard universeGuard;
 
 		auto wrapper = thisUniverse->getDescriptor(universeGuard, handle);
 		if(!wrapper)
@@ -1373,7 +1387,7 @@ HelError doSubmitWriteMemory(HelHandle handle, smarter::shared_ptr<IpcQueue> que
 	AnyDescriptor descriptor;
 	{
 		auto irqLock = frg::guard(&irqMutex());
-		Universe::Guard universeGuard(thisUniverse->lock);
+		Universe::ReadGuard universeGuard;
 
 		auto wrapper = thisUniverse->getDescriptor(universeGuard, handle);
 		if(!wrapper)
@@ -1502,7 +1516,7 @@ HelError helMemoryInfo(HelHandle handle, size_t *size) {
 	smarter::shared_ptr<MemoryView> memory;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!wrapper)
@@ -1523,7 +1537,7 @@ HelError doSubmitManageMemory(HelHandle handle, smarter::shared_ptr<IpcQueue> qu
 	smarter::shared_ptr<MemoryView> memory;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto memory_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!memory_wrapper)
@@ -1574,7 +1588,7 @@ HelError helUpdateMemory(HelHandle handle, int type,
 	smarter::shared_ptr<MemoryView> memory;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto memory_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!memory_wrapper)
@@ -1613,7 +1627,7 @@ HelError doSubmitLockMemoryView(HelHandle handle, smarter::shared_ptr<IpcQueue>
 	smarter::shared_ptr<MemoryView> memory;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto memory_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!memory_wrapper)
@@ -1694,7 +1708,7 @@ HelError helLoadahead(HelHandle handle, uintptr_t offset, size_t length) {
 	smarter::shared_ptr<MemoryView> memory;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto memory_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!memory_wrapper)
@@ -1729,7 +1743,7 @@ HelError helCreateThread(HelHandle universe_handle, HelHandle space_handle,
 	smarter::shared_ptr<AddressSpace, BindableHandle> space;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		if(universe_handle == kHelNullHandle) {
 			universe = this_thread->getUniverse().lock();
@@ -1790,7 +1804,7 @@ HelError helQueryThreadStats(HelHandle handle, HelThreadStats *user_stats) {
 		thread = this_thread.lock();
 	}else{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto thread_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!thread_wrapper)
@@ -1803,6 +1817,7 @@ HelError helQueryThreadStats(HelHandle handle, HelThreadStats *user_stats) {
 	HelThreadStats stats;
 	memset(&stats, 0, sizeof(HelThreadStats));
 	stats.userTime = thread->runTime();
+	stats.numPageFaults = thread->numPageFaults();
 
 	if(!writeUserObject(user_stats, stats))
 		return kHelErrFault;
@@ -1819,7 +1834,7 @@ HelError helSetPriority(HelHandle handle, int priority) {
 		thread = this_thread.lock();
 	}else{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto thread_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!thread_wrapper)
@@ -1834,6 +1849,30 @@ HelError helSetPriority(HelHandle handle, int priority) {
 	return kHelErrNone;
 }
 
+HelError helSetTimerSlack(HelHandle handle, uint64_t slack) {
+	auto thisThread = getCurrentThread();
+	auto thisUniverse = thisThread->getUniverse();
+
+	smarter::shared_ptr<Thread> thread;
+	if(handle == kHelThisThread) {
+		thread = thisThread.lock();
+	}else{
+		auto irqLock = frg::guard(&irqMutex());
+		Universe::ReadGuard universeLock;
+
+		auto threadWrapper = thisUniverse->getDescriptor(universeLock, handle);
+		if(!threadWrapper)
+			return kHelErrNoDescriptor;
+		if(!threadWrapper->is<ThreadDescriptor>())
+			return kHelErrBadDescriptor;
+		thread = remove_tag_cast(threadWrapper->get<ThreadDescriptor>().thread);
+	}
+
+	thread->setTimerSlack(slack);
+
+	return kHelErrNone;
+}
+
 HelError helYield() {
 	Thread::deferCurrent();
 
@@ -1848,7 +1887,7 @@ HelError doSubmitObserve(HelHandle handle, smarter::shared_ptr<IpcQueue> queue,
 	smarter::shared_ptr<Thread> thread;
 	{
 		auto irqLock = frg::guard(&irqMutex());
-		Universe::Guard universeGuard(thisUniverse->lock);
+		Universe::ReadGuard universeGuard;
 
 		auto threadWrapper = thisUniverse->getDescriptor(universeGuard, handle);
 		if(!threadWrapper)
@@ -1904,7 +1943,7 @@ HelError helKillThread(HelHandle handle) {
 	smarter::shared_ptr<Thread> thread;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto thread_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!thread_wrapper)
@@ -1926,7 +1965,7 @@ HelError helInterruptThread(HelHandle handle) {
 	smarter::shared_ptr<Thread> thread;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto thread_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!thread_wrapper)
@@ -1948,7 +1987,7 @@ HelError helResume(HelHandle handle) {
 	smarter::shared_ptr<Thread> thread;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto thread_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!thread_wrapper)
@@ -1976,7 +2015,7 @@ HelError helLoadRegisters(HelHandle handle, int set, void *image) {
 	VirtualizedCpuDescriptor vcpu;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto thread_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!thread_wrapper)
@@ -2175,7 +2214,7 @@ HelError helStoreRegisters(HelHandle handle, int set, const void *image) {
 		thread = this_thread.lock();
 	}else{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto thread_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!thread_wrapper)
@@ -2287,6 +2326,7 @@ HelError helStoreRegisters(HelHandle handle, int set, const void *image) {
 #if defined(__x86_64__)
 		if(!readUserMemory(thread->_executor._fxState(), image, Executor::determineSimdSize()))
 			return kHelErrFault;
+		thread->_executor.invalidateLoadedSimdState();
 #elif defined(__aarch64__)
 		if(!readUserMemory(&thread->_executor.general()->fp, image, sizeof(FpRegisters)))
 			return kHelErrFault;
@@ -2403,15 +2443,30 @@ HelError helGetClock(uint64_t *counter) {
 	return kHelErrNone;
 }
 
+HelError helAccessClockPage(HelHandle *handle) {
+	auto thisThread = getCurrentThread();
+	auto thisUniverse = thisThread->getUniverse();
+
+	{
+		auto irqLock = frg::guard(&irqMutex());
+		Universe::Guard universeLock(thisUniverse->lock);
+
+		*handle = thisUniverse->attachDescriptor(universeLock,
+				MemoryViewDescriptor(getClockPageMemory()));
+	}
+
+	return kHelErrNone;
+}
+
 HelError doSubmitAwaitClock(smarter::shared_ptr<IpcQueue> queue, uint64_t counter,
-		uintptr_t context, CancelGuard cg) {
+		uint64_t slack, uintptr_t context, CancelGuard cg) {
 	if(!queue->validSize(ipcSourceSize(sizeof(HelSimpleResult))))
 		return kHelErrQueueTooSmall;
 
-	[](smarter::shared_ptr<IpcQueue> queue, uint64_t counter, uintptr_t context,
-			CancelGuard cg,
+	[](smarter::shared_ptr<IpcQueue> queue, uint64_t counter, uint64_t slack,
+			uintptr_t context, CancelGuard cg,
 			enable_detached_coroutine) -> void {
-		bool succeeded = co_await generalTimerEngine()->sleep(counter, cg.token());
+		bool succeeded = co_await generalTimerEngine()->sleep(counter, cg.token(), slack);
 
 		queue->unregisterTag(std::move(cg));
 
@@ -2419,7 +2474,7 @@ HelError doSubmitAwaitClock(smarter::shared_ptr<IpcQueue> queue, uint64_t counte
 		HelSimpleResult helResult{.error = error, .reserved = {}};
 		QueueSource ipcSource{&helResult, sizeof(HelSimpleResult), nullptr};
 		co_await queue->submit(&ipcSource, context);
-	}(std::move(queue), counter, context, std::move(cg),
+	}(std::move(queue), counter, slack, context, std::move(cg),
 		enable_detached_coroutine{getCurrentThread()->mainWorkQueue().lock()});
 
 	return kHelErrNone;
@@ -2443,6 +2498,82 @@ HelError helCreateStream(HelHandle *lane1_handle, HelHandle *lane2_handle, uint3
 	return kHelErrNone;
 }
 
+namespace {
+
+// kHelActionSendPages moves the pages from the sender to the receiver.
+// Below this size, the data is sent inline through a kernel buffer and the receiver
+// gets fresh pages. Larger transfers hand the sender's memory to the receiver as-is;
+// this only pays off once the cost of setting up the shared mapping is amortized
+// over enough pages.
+constexpr size_t pageTransferThreshold = 64 * 1024;
+
+// Maps the data received by a kTagRecvPages node into the receiver's address space.
+// peer is the kTagSendPages node (or nullptr if the data was sent inline). In the former
+// case, the receiver maps the sender's memory directly; no data is copied.
+coroutine<frg::expected<Error, VirtualAddr>>
+receivePages(smarter::shared_ptr<Thread> thread, StreamNode *node, StreamNode *peer) {
+	auto length = node->actualLength();
+	if(!length)
+		co_return VirtualAddr{0};
+	auto mapLength = (length + (kPageSize - 1)) & ~(kPageSize - 1);
+	auto wq = thread->mainWorkQueue().get();
+
+	smarter::shared_ptr<MemorySlice> slice;
+	uint32_t flags = AddressSpace::kMapPreferTop | AddressSpace::kMapProtRead;
+	if(peer) {
+		// The sender's buffer is page-aligned, hence length == mapLength.
+		slice = smarter::allocate_shared<MemorySlice>(*kernelAlloc,
+				peer->_inView, peer->_inViewOffset, mapLength);
+		if(peer->_inViewWritable)
+			flags |= AddressSpace::kMapProtWrite;
+	}else{
+		auto memory = smarter::allocate_shared<AllocatedMemory>(*kernelAlloc, mapLength);
+		memory->selfPtr = memory;
+		FRG_CO_TRY(co_await memory->copyTo(0, node->_transmitBuffer.data(), length, wq));
+
+		slice = smarter::allocate_shared<MemorySlice>(*kernelAlloc,
+				std::move(memory), 0, mapLength);
+		flags |= AddressSpace::kMapProtWrite;
+	}
+
+	auto space = thread->getAddressSpace().lock();
+	co_return co_await space->map(slice, 0, 0, mapLength, flags, wq);
+}
+
+// Returns how many bytes of a kHelActionSendFromMemory node are still available
+// from the given progress on. The memory object may have shrunk since the action
+// was submitted; in this case, the transfer is truncated at the end of the memory object.
+size_t availableSentMemory(StreamNode *node, size_t length, uintptr_t progress) {
+	auto offset = node->_inViewOffset + progress;
+	auto viewLength = node->_inView->getLength();
+	if(offset >= viewLength)
+		return 0;
+	return frg::min(length - progress, viewLength - offset);
+}
+
+// Locks the page of a kHelActionSendFromMemory node that contains the given range
+// and returns its physical address. The range must not cross a page boundary.
+coroutine<frg::expected<Error, PhysicalAddr>> lockSentPage(StreamNode *node,
+		uintptr_t offset, size_t size, WorkQueue *wq) {
+	auto view = node->_inView.get();
+	auto pageOffset = offset & ~(kPageSize - 1);
+	assert(offset + size <= pageOffset + kPageSize);
+
+	auto error = view->lockRange(offset, size);
+	if(error != Error::success)
+		co_return error;
+	auto outcome = co_await view->touchRange(pageOffset, kPageSize, 0, wq);
+	if(!outcome) {
+		view->unlockRange(offset, size);
+		co_return outcome.error();
+	}
+	auto physical = view->peekRange(pageOffset).get<0>();
+	assert(physical != PhysicalAddr(-1));
+	co_return physical;
+}
+
+} // anonymous namespace
+
 HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue> queue,
 		ImmediateMemory *sqMemory, size_t sqActionsOffset,
 		size_t count, uintptr_t context, uint32_t flags) {
@@ -2457,7 +2588,7 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 	LaneHandle lane;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(thisUniverse->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto wrapper = thisUniverse->getDescriptor(universe_guard, laneHandle);
 		if(!wrapper)
@@ -2481,6 +2612,7 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 			HelCredentialsResult helCredentialsResult;
 			HelInlineResultNoFlex helInlineResult;
 			HelLengthResult helLengthResult;
+			HelPagesResult helPagesResult;
 		};
 	};
 
@@ -2523,7 +2655,7 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 					creds = thisThread->credentials();
 				} else {
 					auto irq_lock = frg::guard(&irqMutex());
-					Universe::Guard universe_guard(thisUniverse->lock);
+					Universe::ReadGuard universe_guard;
 
 					auto wrapper = thisUniverse->getDescriptor(universe_guard, recipe->handle);
 					if(!wrapper) {
@@ -2564,6 +2696,38 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 				}
 				ipcSize += ipcSourceSize(sizeof(HelSimpleResult));
 				break;
+			case kHelActionSendFromMemory: {
+				smarter::shared_ptr<MemoryView> view;
+				{
+					auto irq_lock = frg::guard(&irqMutex());
+					Universe::ReadGuard universe_guard;
+
+					auto wrapper = thisUniverse->getDescriptor(universe_guard, recipe->handle);
+					if(!wrapper)
+						return kHelErrNoDescriptor;
+					if(!wrapper->is<MemoryViewDescriptor>())
+						return kHelErrBadDescriptor;
+					view = wrapper->get<MemoryViewDescriptor>().memory;
+				}
+
+				// The buffer field holds the offset into the memory object.
+				// The range is checked against the length of the memory object once
+				// the data is transferred, since the memory object can be resized in the meantime.
+				auto offset = reinterpret_cast<uintptr_t>(recipe->buffer);
+				uintptr_t end;
+				if(__builtin_add_overflow(offset, recipe->length, &end))
+					return kHelErrIllegalArgs;
+
+				// Always use the flow protocol; once the receiver is known,
+				// it copies directly from the pages of the view.
+				node->_tag = kTagSendFlow;
+				node->_maxLength = recipe->length;
+				node->_inView = std::move(view);
+				node->_inViewOffset = offset;
+				++numFlows;
+				ipcSize += ipcSourceSize(sizeof(HelLengthResult));
+				break;
+			}
 			case kHelActionSendFromBufferSg: {
 				size_t length = 0;
 				auto sglist = reinterpret_cast<HelSgItem *>(recipe->buffer);
@@ -2602,11 +2766,56 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 				++numFlows;
 				ipcSize += ipcSourceSize(sizeof(HelLengthResult));
 				break;
+			case kHelActionSendPages: {
+				if((reinterpret_cast<uintptr_t>(recipe->buffer) & (kPageSize - 1))
+						|| (recipe->length & (kPageSize - 1)))
+					return kHelErrIllegalArgs;
+
+				// The pages are unmapped from the sender below, once all items are validated.
+				// This requires the buffer to be covered by a single mapping.
+				smarter::shared_ptr<MemoryView> view;
+				uintptr_t viewOffset = 0;
+				bool writable = false;
+				if(recipe->length) {
+					auto space = thisThread->getAddressSpace().lock();
+					auto resolved = space->resolveView(
+							reinterpret_cast<VirtualAddr>(recipe->buffer), recipe->length);
+					if(!resolved)
+						return translateError(resolved.error());
+					view = std::move(resolved.value().get<0>());
+					viewOffset = resolved.value().get<1>();
+					writable = resolved.value().get<2>();
+				}
+
+				if(recipe->length < pageTransferThreshold) {
+					frg::unique_memory<KernelAlloc> buffer(*kernelAlloc, recipe->length);
+					if(!readUserMemory(reinterpret_cast<char *>(buffer.data()),
+							reinterpret_cast<char *>(recipe->buffer), recipe->length))
+						return kHelErrFault;
+
+					node->_tag = kTagSendKernelBuffer;
+					node->_inBuffer = std::move(buffer);
+				}else{
+					node->_tag = kTagSendPages;
+					node->_maxLength = recipe->length;
+					node->_inView = std::move(view);
+					node->_inViewOffset = viewOffset;
+					node->_inViewWritable = writable;
+				}
+				ipcSize += ipcSourceSize(sizeof(HelSimpleResult));
+				break;
+			}
+			case kHelActionRecvPages:
+				node->_tag = kTagRecvPages;
+				node->_maxLength = recipe->length;
+				++numFlows;
+				ipcSize += ipcSourceSize(sizeof(HelPagesResult));
+				break;
 			case kHelActionPushDescriptor: {
 				AnyDescriptor operand;
 				{
 					auto irq_lock = frg::guard(&irqMutex());
-					Universe::Guard universe_guard(thisUniverse->lock);
+					Universe::ReadGuard universe_guard;
 
 					auto wrapper = thisUniverse->getDescriptor(universe_guard, recipe->handle);
 					if(!wrapper)
@@ -2646,6 +2855,20 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 	if(!queue->validSize(ipcSize))
 		return kHelErrQueueTooSmall;
 
+	// kHelActionSendPages moves the pages to the receiver, so remove them from the sender.
+	// The ranges were validated above, hence this cannot fail.
+	for(size_t i = 0; i < count; i++) {
+		auto recipe = &items[i].recipe;
+		if(recipe->type != kHelActionSendPages || !recipe->length)
+			continue;
+
+		auto space = thisThread->getAddressSpace().lock();
+		auto outcome = Thread::asyncBlockCurrent(space->unmap(
+				reinterpret_cast<VirtualAddr>(recipe->buffer), recipe->length,
+				thisThread->mainWorkQueue().get()));
+		assert(outcome);
+	}
+
 	// From this point on, the function must not fail, since we now link our items
 	// into intrusive linked lists.
 
@@ -2686,6 +2909,12 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 
 			// The size of this array must be a power of two.
 			frg::array<frg::unique_memory<KernelAlloc>, 2> xferBuffers;
+			// Pages of kHelActionSendFromMemory that are locked while their packet is in-flight.
+			struct LockedRange {
+				uintptr_t offset = 0;
+				size_t size = 0;
+			};
+			frg::array<LockedRange, 2> lockedRanges{};
 
 			size_t i = 0;
 			size_t seenFlows = 0; // Iterates through flows.
@@ -2702,18 +2931,51 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 				co_await node->issueFlow.wait();
 				auto peer = node->peerNode;
 
+				if(node->tag() == kTagRecvPages) {
+					auto error = node->error();
+					void *pointer = nullptr;
+					if(error == Error::success) {
+						auto outcome = co_await receivePages(thread, node, peer);
+						if(outcome) {
+							pointer = reinterpret_cast<void *>(outcome.value());
+						}else{
+							error = outcome.error();
+						}
+					}
+					item->helPagesResult = {translateError(error), 0,
+							error == Error::success ? node->actualLength() : 0, pointer};
+
+					// The sender only completes after its data was copied.
+					// Hence, it may reuse its buffer as soon as it sees the completion.
+					node->complete();
+					if(peer)
+						peer->complete();
+					continue;
+				}
+
 				// Check for transmission errors (transmission errors or zero-size transfers).
 				if(!peer) {
 					node->complete();
 					continue;
 				}
 
-				if(recipe->type == kHelActionSendFromBuffer
-						&& node->tag() == kTagSendFlow
+				if(node->tag() == kTagSendFlow
 						&& peer->tag() == kTagRecvKernelBuffer) {
-					frg::unique_memory<KernelAlloc> buffer(*kernelAlloc, recipe->length);
-
-					auto outcome = readUserMemory(buffer.data(), recipe->buffer, recipe->length);
+					bool outcome;
+					frg::unique_memory<KernelAlloc> buffer;
+					if(recipe->type == kHelActionSendFromMemory) {
+						auto length = availableSentMemory(node, recipe->length, 0);
+						buffer = frg::unique_memory<KernelAlloc>(*kernelAlloc, length);
+						outcome = true;
+						if(length)
+							outcome = static_cast<bool>(co_await node->_inView->copyFrom(
+									node->_inViewOffset, buffer.data(), length,
+									thread->mainWorkQueue().get()));
+						node->_actualLength = length;
+					}else{
+						buffer = frg::unique_memory<KernelAlloc>(*kernelAlloc, recipe->length);
+						outcome = readUserMemory(buffer.data(), recipe->buffer, recipe->length);
+					}
 					if(!outcome) {
 						// We complete with fault; the remote with success.
 						// TODO: it probably makes sense to introduce a "remote fault" error.
@@ -2728,8 +2990,7 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 					peer->_transmitBuffer = std::move(buffer);
 					peer->complete();
 					node->complete();
-				}else if(recipe->type == kHelActionSendFromBuffer
-						&& node->tag() == kTagSendFlow
+				}else if(node->tag() == kTagSendFlow
 						&& peer->tag() == kTagRecvFlow) {
 					// Empty packets are handled by the generic stream code.
 					assert(recipe->length);
@@ -2738,6 +2999,17 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 					size_t numSent = 0;
 					size_t numAcked = 0;
 					bool lastTransferSent = false;
+
+					// Unlocks the page (if any) of the packet that is acked.
+					auto retireAck = [&] {
+						auto &locked = lockedRanges[numAcked & (lockedRanges.size() - 1)];
+						if(locked.size) {
+							node->_inView->unlockRange(locked.offset, locked.size);
+							locked.size = 0;
+						}
+						++numAcked;
+					};
+
 					// Each iteration of this loop sends one transfer packet (or terminates).
 					while(true) {
 						bool anyRemoteFault = false;
@@ -2750,7 +3022,7 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 							assert(ackPacket);
 							if(ackPacket->fault)
 								anyRemoteFault = true;
-							++numAcked;
+							retireAck();
 						}
 
 						if(lastTransferSent) {
@@ -2758,6 +3030,7 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 								node->_error = Error::remoteFault;
 							}else{
 								node->_error = Error::success;
+								node->_actualLength = progress;
 							}
 							break;
 						}
@@ -2773,24 +3046,61 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 							while(numSent != numAcked) {
 								auto ackPacket = co_await node->flowQueue.async_get();
 								assert(ackPacket);
-								++numAcked;
+								retireAck();
 							}
 
 							node->_error = Error::remoteFault;
 							break;
 						}
 
-						// Prepare a buffer an send it.
+						// Prepare a packet an send it.
 						assert(numSent - numAcked < xferBuffers.size());
-						auto &xb = xferBuffers[numSent & (xferBuffers.size() - 1)];
-						if(!xb.size())
-							xb = frg::unique_memory<KernelAlloc>{*kernelAlloc, 4096};
+						auto slot = numSent & (xferBuffers.size() - 1);
+
+						FlowPacket packet;
+						bool outcome;
+						if(recipe->type == kHelActionSendFromMemory) {
+							// Instead of copying into a transfer buffer, we pass the locked page
+							// to the receiver, which copies directly into its buffer.
+							auto offset = node->_inViewOffset + progress;
+							auto misalign = offset & (kPageSize - 1);
+							auto chunkSize = frg::min(
+									availableSentMemory(node, recipe->length, progress),
+									kPageSize - misalign);
+
+							if(!chunkSize) {
+								// The memory object was truncated; end the transfer here.
+								outcome = true;
+								lastTransferSent = true;
+							}else{
+								auto physical = co_await lockSentPage(node, offset, chunkSize,
+										thread->mainWorkQueue().get());
+								outcome = static_cast<bool>(physical);
+								if(outcome) {
+									lockedRanges[slot] = {offset, chunkSize};
+									packet.physical = physical.value();
+									packet.pageOffset = misalign;
+									packet.size = chunkSize;
+									lastTransferSent = (progress + chunkSize == recipe->length);
+								}
+							}
+						}else{
+							auto &xb = xferBuffers[slot];
+							if(!xb.size())
+								xb = frg::unique_memory<KernelAlloc>{*kernelAlloc, 4096};
 
-						auto chunkSize = frg::min(recipe->length - progress, xb.size());
-						assert(chunkSize);
+							auto chunkSize = frg::min(recipe->length - progress, xb.size());
+							assert(chunkSize);
 
-						auto outcome = readUserMemory(xb.data(),
-								reinterpret_cast<std::byte *>(recipe->buffer) + progress, chunkSize);
+							outcome = readUserMemory(xb.data(),
+									reinterpret_cast<std::byte *>(recipe->buffer) + progress,
+									chunkSize);
+							if(outcome) {
+								packet.data = xb.data();
+								packet.size = chunkSize;
+								lastTransferSent = (progress + chunkSize == recipe->length);
+							}
+						}
 						if(!outcome) {
 							// Send the packet (may deallocate the peer!).
 							peer->flowQueue.put({ .terminate = true, .fault = true });
@@ -2801,22 +3111,18 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 							while(numSent != numAcked) {
 								auto ackPacket = co_await node->flowQueue.async_get();
 								assert(ackPacket);
-								++numAcked;
+								retireAck();
 							}
 
 							node->_error = Error::fault;
 							break;
 						}
 
-						lastTransferSent = (progress + chunkSize == recipe->length);
+						packet.terminate = lastTransferSent;
 						// Send the packet (may deallocate the peer!).
-						peer->flowQueue.put({
-							.data = xb.data(),
-							.size = chunkSize,
-							.terminate = lastTransferSent
-						});
+						peer->flowQueue.put(packet);
 						++numSent;
-						progress += chunkSize;
+						progress += packet.size;
 					}
 
 					node->complete();
@@ -2849,13 +3155,24 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 						auto xferPacket = co_await node->flowQueue.async_get();
 						assert(xferPacket);
 
-						if(xferPacket->data && !didFault) {
+						if(xferPacket->size && !didFault) {
 							// Otherwise, there would have been a transmission error.
 							assert(progress + xferPacket->size <= recipe->length);
 
-							auto outcome = writeUserMemory(
-									reinterpret_cast<std::byte *>(recipe->buffer) + progress,
-									xferPacket->data, xferPacket->size);
+							bool outcome;
+							if(xferPacket->physical != PhysicalAddr(-1)) {
+								// The sender keeps the page locked until we ack the packet.
+								PageAccessor accessor{xferPacket->physical};
+								outcome = writeUserMemory(
+										reinterpret_cast<std::byte *>(recipe->buffer) + progress,
+										reinterpret_cast<std::byte *>(accessor.get())
+											+ xferPacket->pageOffset,
+										xferPacket->size);
+							}else{
+								outcome = writeUserMemory(
+										reinterpret_cast<std::byte *>(recipe->buffer) + progress,
+										xferPacket->data, xferPacket->size);
+							}
 							if(outcome) {
 								progress += xferPacket->size;
 							}else{
@@ -2974,6 +3291,11 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 				item->helSimpleResult = {translateError(node->error()), 0};
 				item->mainSource.setup(&item->helSimpleResult, sizeof(HelSimpleResult));
 				link(&item->mainSource);
+			}else if(recipe->type == kHelActionSendFromMemory) {
+				item->helLengthResult = {translateError(node->error()),
+						0, node->actualLength()};
+				item->mainSource.setup(&item->helLengthResult, sizeof(HelLengthResult));
+				link(&item->mainSource);
 			}else if(recipe->type == kHelActionRecvInline) {
 				item->helInlineResult = {translateError(node->error()),
 						0, node->_transmitBuffer.size()};
@@ -2987,6 +3309,14 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 						0, node->actualLength()};
 				item->mainSource.setup(&item->helLengthResult, sizeof(HelLengthResult));
 				link(&item->mainSource);
+			}else if(recipe->type == kHelActionSendPages) {
+				item->helSimpleResult = {translateError(node->error()), 0};
+				item->mainSource.setup(&item->helSimpleResult, sizeof(HelSimpleResult));
+				link(&item->mainSource);
+			}else if(recipe->type == kHelActionRecvPages) {
+				// helPagesResult was already filled in by the flow loop above.
+				item->mainSource.setup(&item->helPagesResult, sizeof(HelPagesResult));
+				link(&item->mainSource);
 			}else if(recipe->type == kHelActionPushDescriptor) {
 				item->helSimpleResult = {translateError(node->error()), 0};
 				item->mainSource.setup(&item->helSimpleResult, sizeof(HelSimpleResult));
@@ -3028,7 +3358,7 @@ HelError helShutdownLane(HelHandle handle) {
 	LaneHandle lane;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!wrapper)
@@ -3043,32 +3373,32 @@ HelError helShutdownLane(HelHandle handle) {
 	return kHelErrNone;
 }
 
-HelError helFutexWait(int *pointer, int expected, int64_t deadline) {
-	auto thisThread = getCurrentThread();
-	auto space = thisThread->getAddressSpace();
-	auto address = reinterpret_cast<uintptr_t>(pointer);
+namespace {
+	// Same limit as FUTEX_WAITV_MAX on Linux.
+	constexpr size_t maxFutexWaitItems = 128;
+
+	// Blocks on a futex wait (that is invoked with a cancellation token),
+	// optionally bounded by a deadline.
+	template<typename F>
+	HelError blockOnFutexWait(int64_t deadline, F wait) {
+		if(deadline < 0) {
+			if(deadline != -1)
+				return kHelErrIllegalArgs;
 
-	if(deadline < 0) {
-		if(deadline != -1)
-			return kHelErrIllegalArgs;
+			return translateError(Thread::asyncBlockCurrentInterruptible(
+				async::lambda([&](async::cancellation_token ct) {
+					return wait(ct);
+				})
+			));
+		}
 
-		return translateError(Thread::asyncBlockCurrentInterruptible(
-			async::lambda([&](async::cancellation_token ct) {
-				return getGlobalFutexRealm()->wait(
-					space->globalFutexSpace(), address, expected, thisThread->mainWorkQueue().get(), ct
-				);
-			})
-		));
-	}else{
 		Error waitErr;
 		bool timeout = false;
 
 		Thread::asyncBlockCurrentInterruptible(async::lambda([&](async::cancellation_token ct) {
 			return async::race_and_cancel(
 			    async::lambda([&](async::cancellation_token cancellation) -> coroutine<void> {
-				    waitErr = co_await getGlobalFutexRealm()->wait(
-				        space->globalFutexSpace(), address, expected, thisThread->mainWorkQueue().get(), cancellation
-				    );
+				    waitErr = co_await wait(cancellation);
 			    }),
 			    async::lambda([&](async::cancellation_token cancellation) -> coroutine<void> {
 				    timeout = co_await generalTimerEngine()->sleep(deadline, cancellation);
@@ -3084,8 +3414,50 @@ HelError helFutexWait(int *pointer, int expected, int64_t deadline) {
 
 		return translateError(waitErr);
 	}
+}
 
-	return kHelErrNone;
+HelError helFutexWait(int *pointer, int expected, int64_t deadline) {
+	auto thisThread = getCurrentThread();
+	auto space = thisThread->getAddressSpace();
+	auto address = reinterpret_cast<uintptr_t>(pointer);
+
+	return blockOnFutexWait(deadline, [&](async::cancellation_token ct) {
+		return getGlobalFutexRealm()->wait(
+			space->globalFutexSpace(), address, expected, thisThread->mainWorkQueue().get(), ct
+		);
+	});
+}
+
+HelError helFutexWaitv(const HelFutexWaitItem *items, size_t count,
+		int64_t deadline, size_t *index) {
+	auto thisThread = getCurrentThread();
+	auto space = thisThread->getAddressSpace();
+
+	*index = count;
+	if(!count || count > maxFutexWaitItems)
+		return kHelErrIllegalArgs;
+
+	frg::vector<HelFutexWaitItem, KernelAlloc> userItems{*kernelAlloc};
+	userItems.resize(count);
+	if(!readUserArray(items, userItems.data(), count))
+		return kHelErrFault;
+
+	frg::vector<FutexWaitItem, KernelAlloc> waitItems{*kernelAlloc};
+	waitItems.resize(count);
+	for(size_t i = 0; i < count; i++) {
+		waitItems[i].address = reinterpret_cast<uintptr_t>(userItems[i].pointer);
+		waitItems[i].expected = userItems[i].expected;
+	}
+
+	size_t wokenIndex = count;
+	auto error = blockOnFutexWait(deadline, [&](async::cancellation_token ct) {
+		return getGlobalFutexRealm()->waitv(
+			space->globalFutexSpace(), waitItems.data(), count, wokenIndex,
+			thisThread->mainWorkQueue().get(), ct
+		);
+	});
+	*index = wokenIndex;
+	return error;
 }
 
 HelError helFutexWake(int *pointer, unsigned int count) {
@@ -3104,6 +3476,36 @@ HelError helFutexWake(int *pointer, unsigned int count) {
 	return kHelErrNone;
 }
 
+HelError helFutexRequeue(int *pointer, int *target, unsigned int wakeCount,
+		unsigned int requeueCount, int expected, uint32_t flags, unsigned int *count) {
+	auto thisThread = getCurrentThread();
+	auto space = thisThread->getAddressSpace();
+
+	*count = 0;
+	if(flags & ~uint32_t{kHelFutexRequeueCompare})
+		return kHelErrIllegalArgs;
+
+	frg::optional<unsigned int> expectedValue;
+	if(flags & kHelFutexRequeueCompare)
+		expectedValue = static_cast<unsigned int>(expected);
+
+	auto result = Thread::asyncBlockCurrent(
+			getGlobalFutexRealm()->requeue(
+				space->globalFutexSpace(), reinterpret_cast<uintptr_t>(pointer),
+				reinterpret_cast<uintptr_t>(target), wakeCount, requeueCount,
+				expectedValue, thisThread->mainWorkQueue().get()
+			)
+	);
+	if(!result) {
+		if(result.error() == Error::futexRace)
+			return kHelErrIllegalState;
+		return kHelErrFault;
+	}
+
+	*count = result.value();
+	return kHelErrNone;
+}
+
 HelError helCreateOneshotEvent(HelHandle *handle) {
 	auto this_thread = getCurrentThread();
 	auto this_universe = this_thread->getUniverse();
@@ -3145,7 +3547,7 @@ HelError helRaiseEvent(HelHandle handle) {
 	AnyDescriptor descriptor;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!wrapper)
@@ -3202,7 +3604,7 @@ HelError helAcknowledgeIrq(HelHandle handle, uint32_t flags, uint64_t sequence)
 	smarter::shared_ptr<IrqObject> irq;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto irq_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!irq_wrapper)
@@ -3239,7 +3641,7 @@ HelError doSubmitAwaitEvent(HelHandle handle, smarter::shared_ptr<IpcQueue> queu
 	AnyDescriptor descriptor;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 		auto wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!wrapper)
 			return kHelErrNoDescriptor;
@@ -3332,7 +3734,7 @@ HelError helAutomateIrq(HelHandle handle, uint32_t flags, HelHandle kernlet_hand
 	smarter::shared_ptr<BoundKernlet> kernlet;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto irq_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!irq_wrapper)
@@ -3354,6 +3756,81 @@ HelError helAutomateIrq(HelHandle handle, uint32_t flags, HelHandle kernlet_hand
 	return kHelErrNone;
 }
 
+HelError helSetIrqAffinity(HelHandle handle, uint8_t *mask, size_t size) {
+	auto maskSize = IrqPin::affinityMaskSize();
+	if (size > maskSize)
+		return kHelErrOutOfBounds;
+
+	frg::vector<uint8_t, KernelAlloc> buf{*kernelAlloc};
+	buf.resize(maskSize);
+	if (!readUserArray(mask, buf.data(), size))
+		return kHelErrFault;
+
+	auto this_thread = getCurrentThread();
+	auto this_universe = this_thread->getUniverse();
+
+	smarter::shared_ptr<IrqObject> irq;
+	{
+		auto irq_lock = frg::guard(&irqMutex());
+		Universe::ReadGuard universe_guard;
+
+		auto irq_wrapper = this_universe->getDescriptor(universe_guard, handle);
+		if(!irq_wrapper)
+			return kHelErrNoDescriptor;
+		if(!irq_wrapper->is<IrqDescriptor>())
+			return kHelErrBadDescriptor;
+		irq = irq_wrapper->get<IrqDescriptor>().irq;
+	}
+
+	auto pin = irq->getPin();
+	if(!pin)
+		return kHelErrIllegalState;
+
+	if(auto error = pin->setAffinity({buf.data(), maskSize}); error != Error::success)
+		return translateError(error);
+	return kHelErrNone;
+}
+
+HelError helQueryIrqStats(HelHandle handle, HelIrqStats *stats,
+		uint64_t *cpuRaises, size_t numCpus) {
+	auto this_thread = getCurrentThread();
+	auto this_universe = this_thread->getUniverse();
+
+	smarter::shared_ptr<IrqObject> irq;
+	{
+		auto irq_lock = frg::guard(&irqMutex());
+		Universe::ReadGuard universe_guard;
+
+		auto irq_wrapper = this_universe->getDescriptor(universe_guard, handle);
+		if(!irq_wrapper)
+			return kHelErrNoDescriptor;
+		if(!irq_wrapper->is<IrqDescriptor>())
+			return kHelErrBadDescriptor;
+		irq = irq_wrapper->get<IrqDescriptor>().irq;
+	}
+
+	auto pin = irq->getPin();
+	if(!pin)
+		return kHelErrIllegalState;
+
+	auto n = frg::min(numCpus, getCpuCount());
+	frg::dyn_array<uint64_t, KernelAlloc> buf{n, *kernelAlloc};
+	auto pinStats = pin->getStats({buf.data(), n});
+
+	HelIrqStats result{};
+	result.targetCpu = pinStats.targetCpu;
+	result.numCpus = getCpuCount();
+	static_assert(kHelIrqLatencyBuckets == numIrqLatencyBuckets);
+	for(size_t i = 0; i < numIrqLatencyBuckets; ++i)
+		result.latencyHistogram[i] = pinStats.latencyHistogram[i];
+
+	if(!writeUserObject(stats, result))
+		return kHelErrFault;
+	if(n && !writeUserArray(cpuRaises, buf.data(), n))
+		return kHelErrFault;
+	return kHelErrNone;
+}
+
 HelError helAccessIo(uintptr_t *port_array, size_t num_ports,
 		HelHandle *handle) {
 	auto this_thread = getCurrentThread();
@@ -3386,7 +3863,7 @@ HelError helEnableIo(HelHandle handle) {
 	smarter::shared_ptr<IoSpace> io_space;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!wrapper)
@@ -3426,7 +3903,7 @@ HelError helBindKernlet(HelHandle handle, const HelKernletData *data, size_t num
 	smarter::shared_ptr<KernletObject> kernlet;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto kernlet_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!kernlet_wrapper)
@@ -3455,7 +3932,7 @@ HelError helBindKernlet(HelHandle handle, const HelKernletData *data, size_t num
 			smarter::shared_ptr<MemoryView> memory;
 			{
 				auto irq_lock = frg::guard(&irqMutex());
-				Universe::Guard universe_guard(this_universe->lock);
+				Universe::ReadGuard universe_guard;
 
 				auto wrapper = this_universe->getDescriptor(universe_guard, d.handle);
 				if(!wrapper)
@@ -3482,7 +3959,7 @@ HelError helBindKernlet(HelHandle handle, const HelKernletData *data, size_t num
 			smarter::shared_ptr<BitsetEvent> event;
 			{
 				auto irq_lock = frg::guard(&irqMutex());
-				Universe::Guard universe_guard(this_universe->lock);
+				Universe::ReadGuard universe_guard;
 
 				auto wrapper = this_universe->getDescriptor(universe_guard, d.handle);
 				if(!wrapper)
@@ -3518,7 +3995,7 @@ HelError helGetAffinity(HelHandle handle, uint8_t *mask, size_t size, size_t *ac
 	smarter::borrowed_ptr<Thread> thread;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
-		Universe::Guard universe_guard(this_universe->lock);
+		Universe::ReadGuard universe_guard;
 
 		auto thread_wrapper = this_universe->getDescriptor(universe_guard, handle);
 		if(!thread_wrapper)
@@ -3573,7 +4050,7 @@ HelError helSetAffinity(HelHandle handle, uint8_t *mask, size_t size) {
 		smarter::borrowed_ptr<Thread> thread;
 		{
 			auto irq_lock = frg::guard(&irqMutex());
-			Universe::Guard universe_guard(this_universe->lock);
+			Universe::ReadGuard universe_guard;
 
 			auto thread_wrapper = this_universe->getDescriptor(universe_guard, handle);
 			if(!thread_wrapper)
@@ -3689,7 +4166,7 @@ HelError helCreateToken(HelHandle *handle) {
 }
 
 // Called from IpcQueue::processSq() to handle SQ elements.
-void thor::submitFromSq(smarter::shared_ptr<IpcQueue> queue, uint32_t opcode,
+void thor::submitFromSq(const smarter::shared_ptr<IpcQueue> &queue, uint32_t opcode,
 		ImmediateMemory *memory, size_t dataOffset, size_t length,
 		uintptr_t context) {
 	HelError error;
@@ -3730,8 +4207,15 @@ void thor::submitFromSq(smarter::shared_ptr<IpcQueue> queue, uint32_t opcode,
 		}
 		HelSqAwaitClock sqData;
 		memory->readImmediate(dataOffset, &sqData, sizeof(sqData));
+		if(sqData.flags & ~kHelAwaitClockSlack) {
+			error = kHelErrIllegalArgs;
+			break;
+		}
+		auto slack = getCurrentThread()->timerSlack();
+		if(sqData.flags & kHelAwaitClockSlack)
+			slack = sqData.slack;
 		auto cg = queue->registerTag(sqData.cancellationTag);
-		error = doSubmitAwaitClock(queue, sqData.counter, context, std::move(cg));
+		error = doSubmitAwaitClock(queue, sqData.counter, slack, context, std::move(cg));
 		break;
 	}
 	case kHelSubmitAwaitEvent: {
@@ -3864,7 +4348,7 @@ void thor::submitFromSq(smarter::shared_ptr<IpcQueue> queue, uint32_t opcode,
 			HelSimpleResult helResult{.error = error, .reserved = {}};
 			QueueSource ipcSource{&helResult, sizeof(HelSimpleResult), nullptr};
 			co_await queue->submit(&ipcSource, ~uintptr_t{0});
-		}(std::move(queue), error,
+		}(queue, error,
 			enable_detached_coroutine{getCurrentThread()->mainWorkQueue().lock()});
 	}
 }
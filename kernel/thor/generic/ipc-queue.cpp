@@ -158,6 +158,11 @@ void IpcQueue::processSq() {
 		Thread::asyncBlockCurrent(_sqMutex.async_lock());
 	frg::unique_lock lock{frg::adopt_lock, _sqMutex};
 
+	// Userspace may submit many elements per helDriveQueue(); only take one reference
+	// to ourselves for the whole batch.
+	auto self = selfPtr.lock();
+	assert(self);
+
 	// Process SQ elements.
 	while(true) {
 		auto chunkOffset = _chunkOffsets[_sqCurrentChunk];
@@ -174,7 +179,7 @@ void IpcQueue::processSq() {
 
 			// Dispatch the SQ element.
 			auto dataOffset = chunkOffset + elementOffset + sizeof(ElementStruct);
-			submitFromSq(selfPtr.lock(), element.opcode, _memory.get(), dataOffset,
+			submitFromSq(self, element.opcode, _memory.get(), dataOffset,
 					element.length, reinterpret_cast<uintptr_t>(element.context));
 
 			_sqCurrentProgress += sizeof(ElementStruct) + element.length;
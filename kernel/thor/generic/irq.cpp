@@ -1,15 +1,35 @@
+#include <frg/cmdline.hpp>
 #include <thor-internal/coroutine.hpp>
 #include <thor-internal/cpu-data.hpp>
 #include <thor-internal/debug.hpp>
 #include <thor-internal/irq.hpp>
+#include <thor-internal/main.hpp>
 #include <thor-internal/timer.hpp>
 
 namespace thor {
 
 namespace {
 	constexpr bool logService = false;
+	constexpr bool logBalancing = false;
+
+	bool irqBalancingEnabled = false;
+
+	// IRQs that are raised less often than this (per balancing round) are never moved.
+	constexpr uint64_t minBalancedRaises = 1000;
 }
 
+static initgraph::Task parseIrqOptions{&globalInitEngine, "generic.parse-irq-options",
+	[] {
+		frg::array args = {
+			frg::option{"thor.irq_balance", frg::store_true(irqBalancingEnabled)},
+		};
+		frg::parse_arguments(getKernelCmdline(), args);
+
+		if(irqBalancingEnabled)
+			infoLogger() << "thor: IRQ balancing is enabled" << frg::endlog;
+	}
+};
+
 // --------------------------------------------------------
 // IrqSlot
 // --------------------------------------------------------
@@ -119,12 +139,31 @@ Error IrqPin::kickSink(IrqSink *sink, bool wantClear) {
 // IrqPin
 // --------------------------------------------------------
 
+frg::ticket_spinlock IrqPin::_globalMutex;
+frg::eternal<IrqPin::GlobalList> IrqPin::_globalList;
+
+size_t IrqPin::affinityMaskSize() {
+	return (getCpuCount() + 7) / 8;
+}
+
 IrqPin::IrqPin(frg::string<KernelAlloc> name)
 : _name{std::move(name)}, _strategy{0},
 		_inService{false}, _dueSinks{0},
-		_maskState{0} {
+		_maskState{0}, _cpuRaises{getCpuCount(), *kernelAlloc},
+		_affinityMask{*kernelAlloc} {
 	_hash = frg::hash<frg::string<KernelAlloc>>{}(_name);
 
+	// By default, IRQs may be routed to all CPUs.
+	_affinityMask.resize(affinityMaskSize());
+	for(size_t i = 0; i < getCpuCount(); ++i)
+		_affinityMask[i / 8] |= 1 << (i % 8);
+
+	{
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&_globalMutex);
+		_globalList->push_back(this);
+	}
+
 	[] (IrqPin *self, enable_detached_coroutine) -> void {
 		while(true) {
 			co_await self->_unstallEvent.async_wait_if([&] () -> bool {
@@ -187,6 +226,8 @@ void IrqPin::raise() {
 	assert(!intsAreEnabled());
 	auto lock = frg::guard(&_mutex);
 
+	++_cpuRaises[getCpuData()->cpuIndex];
+
 	if(!_strategy) {
 		debugLogger() << "thor: Unconfigured IRQ was raised" << frg::endlog;
 		dumpHardwareState();
@@ -303,6 +344,7 @@ void IrqPin::_dispatch() {
 
 		_inService = false;
 		_maskState &= ~maskedForService;
+		_recordServiceLatency();
 
 		if (_strategy & irq_strategy::endOfService)
 			endOfService();
@@ -358,10 +400,62 @@ void IrqPin::warnIfPending() {
 	}
 }
 
+IrqStats IrqPin::getStats(frg::span<uint64_t> cpuRaises) {
+	auto irq_lock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&_mutex);
+
+	IrqStats stats;
+	stats.targetCpu = _targetCpu;
+	for(size_t i = 0; i < numIrqLatencyBuckets; ++i)
+		stats.latencyHistogram[i] = _latencyHistogram[i];
+	for(size_t i = 0; i < cpuRaises.size() && i < _cpuRaises.size(); ++i)
+		cpuRaises[i] = _cpuRaises[i];
+	return stats;
+}
+
+Error IrqPin::setAffinity(frg::span<const uint8_t> mask) {
+	assert(mask.size() == affinityMaskSize());
+
+	auto irq_lock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&_mutex);
+
+	auto inMask = [&] (size_t cpu) -> bool {
+		return mask[cpu / 8] & (1 << (cpu % 8));
+	};
+
+	// Avoid moving the IRQ if the current CPU is still allowed.
+	auto cpu = _targetCpu;
+	if(!inMask(cpu)) {
+		cpu = getCpuCount();
+		for(size_t i = 0; i < getCpuCount(); ++i) {
+			if(inMask(i)) {
+				cpu = i;
+				break;
+			}
+		}
+		if(cpu == getCpuCount())
+			return Error::illegalArgs;
+
+		if(!retarget(cpu))
+			return Error::noHardwareSupport;
+		_targetCpu = cpu;
+	}
+
+	for(size_t i = 0; i < mask.size(); ++i)
+		_affinityMask[i] = mask[i];
+	_explicitAffinity = true;
+	return Error::success;
+}
+
 void IrqPin::dumpHardwareState() {
 	infoLogger() << "thor: No dump available for IRQ pin " << name() << frg::endlog;
 }
 
+bool IrqPin::retarget(size_t) {
+	// Default implementation: the IRQ controller does not support routing to other CPUs.
+	return false;
+}
+
 void IrqPin::endOfInterrupt() {
 	// Default implementation is a no-op: not all IRQ controllers need endOfInterrupt().
 }
@@ -421,6 +515,7 @@ void IrqPin::_doService() {
 
 			_inService = false;
 			_maskState &= ~maskedForService;
+			_recordServiceLatency();
 
 			if (_strategy & irq_strategy::endOfService)
 				endOfService();
@@ -449,6 +544,14 @@ void IrqPin::_doService() {
 	_dueSinks = numAsynchronous;
 }
 
+void IrqPin::_recordServiceLatency() {
+	auto us = (getClockNanos() - _raiseClock) / 1000;
+	size_t bucket = 0;
+	while(bucket + 1 < numIrqLatencyBuckets && (uint64_t{1} << bucket) < us)
+		++bucket;
+	++_latencyHistogram[bucket];
+}
+
 void IrqPin::_updateMask() {
 	// TODO: Avoid the virtual calls if the state does not change?
 	if(!_maskState) {
@@ -460,6 +563,103 @@ void IrqPin::_updateMask() {
 	}
 }
 
+// --------------------------------------------------------
+// MsiPin
+// --------------------------------------------------------
+
+void MsiPin::setProgrammer(MsiProgrammer *programmer, size_t index) {
+	auto irq_lock = frg::guard(&irqMutex());
+	auto lock = frg::guard(pinMutex());
+
+	_programmer = programmer;
+	_programmerIndex = index;
+}
+
+void MsiPin::messageChanged() {
+	if(_programmer)
+		_programmer->reprogramMsi(this, _programmerIndex);
+}
+
+// --------------------------------------------------------
+// IRQ balancing
+// --------------------------------------------------------
+
+void balanceIrqs(frg::span<const uint64_t> threadLoad) {
+	if(!irqBalancingEnabled)
+		return;
+
+	auto numCpus = getCpuCount();
+	assert(threadLoad.size() == numCpus);
+
+	auto irq_lock = frg::guard(&irqMutex());
+	auto globalLock = frg::guard(&IrqPin::_globalMutex);
+
+	// Number of IRQs that each CPU handled since the last round.
+	frg::dyn_array<uint64_t, KernelAlloc> irqLoad{numCpus, *kernelAlloc};
+	// Number of raises of each pin since the last round.
+	frg::vector<uint64_t, KernelAlloc> pinRaises{*kernelAlloc};
+	for(auto pin : *IrqPin::_globalList) {
+		auto lock = frg::guard(&pin->_mutex);
+
+		uint64_t total = 0;
+		for(size_t i = 0; i < pin->_cpuRaises.size(); ++i)
+			total += pin->_cpuRaises[i];
+		auto delta = total - pin->_balancedRaises;
+		pin->_balancedRaises = total;
+
+		irqLoad[pin->_targetCpu] += delta;
+		pinRaises.push_back(delta);
+	}
+
+	size_t busiest = 0;
+	for(size_t i = 1; i < numCpus; ++i)
+		if(irqLoad[i] > irqLoad[busiest])
+			busiest = i;
+
+	// Find the hottest IRQ on the busiest CPU that we are allowed to move.
+	IrqPin *candidate = nullptr;
+	uint64_t candidateRaises = 0;
+	size_t n = 0;
+	for(auto pin : *IrqPin::_globalList) {
+		auto delta = pinRaises[n++];
+		auto lock = frg::guard(&pin->_mutex);
+		if(pin->_targetCpu != busiest || pin->_explicitAffinity)
+			continue;
+		if(delta < minBalancedRaises || delta <= candidateRaises)
+			continue;
+		candidate = pin;
+		candidateRaises = delta;
+	}
+	if(!candidate)
+		return;
+
+	auto lock = frg::guard(&candidate->_mutex);
+
+	// Pick the CPU with the least IRQ load; among those, prefer CPUs that run few threads.
+	size_t target = busiest;
+	for(size_t i = 0; i < numCpus; ++i) {
+		if(i == busiest || !candidate->_inAffinityMask(i))
+			continue;
+		if(target == busiest || irqLoad[i] < irqLoad[target]
+				|| (irqLoad[i] == irqLoad[target] && threadLoad[i] < threadLoad[target]))
+			target = i;
+	}
+	if(target == busiest)
+		return;
+
+	// Only move the IRQ if that reduces the imbalance. This prevents IRQs from
+	// ping-ponging between CPUs.
+	if(irqLoad[target] + candidateRaises >= irqLoad[busiest])
+		return;
+
+	if(!candidate->retarget(target))
+		return;
+	if(logBalancing)
+		infoLogger() << "thor: Moving IRQ " << candidate->name()
+				<< " from CPU " << busiest << " to CPU " << target << frg::endlog;
+	candidate->_targetCpu = target;
+}
+
 // --------------------------------------------------------
 // IrqObject
 // --------------------------------------------------------
@@ -1,15 +1,18 @@
 #include <frg/string.hpp>
 
 #include <thor-internal/universe.hpp>
+#include <thor-internal/arch-generic/asid.hpp>
 #include <thor-internal/coroutine.hpp>
 #include <thor-internal/fiber.hpp>
 #include <thor-internal/kerncfg.hpp>
 #include <thor-internal/ostrace.hpp>
 #include <thor-internal/kernel-log.hpp>
+#include <thor-internal/load-balancing.hpp>
 #include <thor-internal/profile.hpp>
 #include <thor-internal/stream.hpp>
 #include <thor-internal/timer.hpp>
 #include <thor-internal/mbus.hpp>
+#include <thor-internal/memory-view.hpp>
 #include <thor-internal/physical.hpp>
 
 #include <bragi/helpers-frigg.hpp>
@@ -107,6 +110,130 @@ private:
 			if(respError != Error::success) {
 				co_return respError;
 			}
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::GetPageCacheStatisticsRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::GetPageCacheStatisticsRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			auto &stats = getPageCacheStatistics();
+			managarm::kerncfg::GetPageCacheStatisticsResponse<KernelAlloc> resp(*kernelAlloc);
+			resp.set_error(managarm::kerncfg::Error::SUCCESS);
+			resp.set_hits(stats.hits.load(std::memory_order_relaxed));
+			resp.set_misses(stats.misses.load(std::memory_order_relaxed));
+			resp.set_pending_hits(stats.pendingHits.load(std::memory_order_relaxed));
+			resp.set_readahead_pages(stats.readaheadPages.load(std::memory_order_relaxed));
+			resp.set_async_readaheads(stats.asyncReadaheads.load(std::memory_order_relaxed));
+
+			frg::unique_memory<KernelAlloc> respBuffer{*kernelAlloc, resp.size_of_head()};
+			bragi::write_head_only(resp, respBuffer);
+			auto respError = co_await sendBuffer(lane, std::move(respBuffer));
+			if(respError != Error::success)
+				co_return respError;
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::GetReclaimStatisticsRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::GetReclaimStatisticsRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			auto stats = getReclaimStatistics();
+			managarm::kerncfg::GetReclaimStatisticsResponse<KernelAlloc> resp(*kernelAlloc);
+			resp.set_error(managarm::kerncfg::Error::SUCCESS);
+			resp.set_active_pages(stats.activePages);
+			resp.set_inactive_pages(stats.inactivePages);
+			resp.set_posted_pages(stats.postedPages);
+			resp.set_low_watermark(stats.lowWatermark);
+			resp.set_high_watermark(stats.highWatermark);
+			resp.set_scanned(stats.scanned);
+			resp.set_activated(stats.activated);
+			resp.set_deactivated(stats.deactivated);
+			resp.set_posted(stats.posted);
+			resp.set_rescued(stats.rescued);
+			resp.set_evicted(stats.evicted);
+			resp.set_wakeups(stats.wakeups);
+
+			frg::unique_memory<KernelAlloc> respBuffer{*kernelAlloc, resp.size_of_head()};
+			bragi::write_head_only(resp, respBuffer);
+			auto respError = co_await sendBuffer(lane, std::move(respBuffer));
+			if(respError != Error::success)
+				co_return respError;
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::GetLoadBalancingDomainsRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::GetLoadBalancingDomainsRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			managarm::kerncfg::GetLoadBalancingDomainsResponse<KernelAlloc> resp(*kernelAlloc);
+			resp.set_error(managarm::kerncfg::Error::SUCCESS);
+			auto &lb = LoadBalancer::singleton();
+			if(lb.domainsReady()) {
+				for(auto domain : lb.domains()) {
+					resp.add_levels(static_cast<uint32_t>(domain->level));
+					resp.add_parents(domain->parent ? static_cast<int64_t>(domain->parent->id) : -1);
+					resp.add_intervals(domain->interval);
+					resp.add_balances(domain->numBalances.load(std::memory_order_relaxed));
+					resp.add_migrations(domain->numMigrations.load(std::memory_order_relaxed));
+					resp.add_idle_migrations(domain->numIdleMigrations.load(std::memory_order_relaxed));
+					resp.add_num_cpus(domain->cpus.size());
+					resp.add_num_groups(domain->numGroups());
+					for(auto cpu : domain->cpus)
+						resp.add_cpus(cpu);
+					for(auto end : domain->groupEnds)
+						resp.add_group_ends(end);
+				}
+			}
+
+			frg::unique_memory<KernelAlloc> respHeadBuffer{*kernelAlloc, resp.size_of_head()};
+			frg::unique_memory<KernelAlloc> respTailBuffer{*kernelAlloc, resp.size_of_tail()};
+			bragi::write_head_tail(resp, respHeadBuffer, respTailBuffer);
+			auto respHeadError = co_await sendBuffer(lane, std::move(respHeadBuffer));
+			if(respHeadError != Error::success)
+				co_return respHeadError;
+			auto respTailError = co_await sendBuffer(lane, std::move(respTailBuffer));
+			if(respTailError != Error::success)
+				co_return respTailError;
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::GetShootdownStatisticsRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::GetShootdownStatisticsRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			auto stats = getShootdownStatistics();
+			managarm::kerncfg::GetShootdownStatisticsResponse<KernelAlloc> resp(*kernelAlloc);
+			resp.set_error(managarm::kerncfg::Error::SUCCESS);
+			resp.set_requests(stats.requests);
+			resp.set_ipis_sent(stats.ipisSent);
+			resp.set_ipis_coalesced(stats.ipisCoalesced);
+			resp.set_ipis_skipped(stats.ipisSkipped);
+			resp.set_ipis_received(stats.ipisReceived);
+			resp.set_broadcasts(stats.broadcasts);
+			resp.set_page_flushes(stats.pageFlushes);
+			resp.set_asid_flushes(stats.asidFlushes);
+			resp.set_lazy_flushes(stats.lazyFlushes);
+
+			frg::unique_memory<KernelAlloc> respBuffer{*kernelAlloc, resp.size_of_head()};
+			bragi::write_head_only(resp, respBuffer);
+			auto respError = co_await sendBuffer(lane, std::move(respBuffer));
+			if(respError != Error::success)
+				co_return respError;
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::GetTimerStatisticsRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::GetTimerStatisticsRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			auto stats = getTimerStatistics();
+			managarm::kerncfg::GetTimerStatisticsResponse<KernelAlloc> resp(*kernelAlloc);
+			resp.set_error(managarm::kerncfg::Error::SUCCESS);
+			resp.set_alarms(stats.alarms);
+			resp.set_expirations(stats.expirations);
+			resp.set_coalesced(stats.coalesced);
+
+			frg::unique_memory<KernelAlloc> respBuffer{*kernelAlloc, resp.size_of_head()};
+			bragi::write_head_only(resp, respBuffer);
+			auto respError = co_await sendBuffer(lane, std::move(respBuffer));
+			if(respError != Error::success)
+				co_return respError;
 		}else{
 			managarm::kerncfg::SvrResponse<KernelAlloc> resp(*kernelAlloc);
 			resp.set_error(managarm::kerncfg::Error::ILLEGAL_REQUEST);
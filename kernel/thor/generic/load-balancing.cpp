@@ -1,4 +1,6 @@
+#include <frg/optional.hpp>
 #include <frg/unique.hpp>
+#include <thor-internal/irq.hpp>
 #include <thor-internal/load-balancing.hpp>
 #include <thor-internal/timer.hpp>
 
@@ -10,14 +12,66 @@ constexpr bool debugLb = false;
 
 // Basic settings.
 constexpr bool enableLb = true;
-constexpr uint64_t lbInterval = 100'000'000;
+// Interval for load estimation.
+constexpr uint64_t lbEstimateInterval = 100'000'000;
+// The periodic balancing interval of a domain is lbIntervalPerCpu times the number of
+// CPUs in the domain, clamped to [lbMinInterval, lbMaxInterval].
+// Thus, balancing in small (cheap) domains happens more frequently.
+constexpr uint64_t lbIntervalPerCpu = 10'000'000;
+constexpr uint64_t lbMinInterval = 20'000'000;
+constexpr uint64_t lbMaxInterval = 1'000'000'000;
+// Minimal interval between two attempts to pull load to an idle CPU.
+constexpr uint64_t lbIdleInterval = 1'000'000;
+// Load is only moved between groups if the busiest group has a load that is at least
+// lbImbalancePct percent of the local group (per CPU).
+constexpr uint64_t lbImbalancePct = 125;
 
 // Load decay factor (scale is hardcoded to 8 below) and decay interval.
 constexpr uint64_t lbDecay = 184;
 constexpr uint64_t lbDecayInterval = 1'000'000'000;
 
+// Interval for IRQ balancing (which only happens if it is enabled on the command line).
+constexpr uint64_t irqBalanceInterval = 1'000'000'000;
+
 frg::eternal<LoadBalancer> loadBalancer;
 
+// Returns the ID of the CPU at the given level of the topology.
+uint64_t topologyKey(size_t cpu, size_t level) {
+	auto &topology = getCpuData(cpu)->topology;
+	switch(static_cast<LbLevel>(level)) {
+	case LbLevel::smt:
+		return topology.known ? topology.coreId : cpu;
+	case LbLevel::llc:
+		return topology.known ? topology.llcId : 0;
+	case LbLevel::package:
+		return topology.known ? topology.packageId : 0;
+	case LbLevel::system:
+		return 0;
+	}
+	__builtin_unreachable();
+}
+
+// Returns true if both CPUs are part of the same domain at the given level.
+// This considers all higher levels such that domains are properly nested, even if
+// the topology information is inconsistent.
+bool sameDomain(size_t a, size_t b, size_t level) {
+	for(size_t k = level; k < numLbLevels; ++k) {
+		if(topologyKey(a, k) != topologyKey(b, k))
+			return false;
+	}
+	return true;
+}
+
+const char *levelName(LbLevel level) {
+	switch(level) {
+	case LbLevel::smt: return "smt";
+	case LbLevel::llc: return "llc";
+	case LbLevel::package: return "package";
+	case LbLevel::system: return "system";
+	}
+	__builtin_unreachable();
+}
+
 } // namespace
 
 THOR_DEFINE_PERCPU(lbNode);
@@ -26,13 +80,16 @@ LoadBalancer &LoadBalancer::singleton() {
 	return loadBalancer.get();
 }
 
-LoadBalancer::LoadBalancer()
-: barrier_{0} {}
+LoadBalancer::LoadBalancer() = default;
 
 void LoadBalancer::setOnline(CpuData *cpu) {
 	auto *node = &lbNode.get(cpu);
 	node->cpu = cpu;
 	spawnOnWorkQueue(*kernelAlloc, cpu->generalWorkQueue, loadBalancer->run_(cpu));
+
+	// The domains are built from the topology of all CPUs.
+	if(numOnline_.fetch_add(1, std::memory_order_acq_rel) + 1 == getCpuCount())
+		buildDomains_();
 }
 
 void LoadBalancer::connect(Thread *thread, CpuData *cpu) {
@@ -52,104 +109,285 @@ void LoadBalancer::connect(Thread *thread, CpuData *cpu) {
 	}
 }
 
+void LoadBalancer::balanceOnIdle() {
+	if(!enableLb || !domainsReady())
+		return;
+
+	auto *node = &lbNode.get();
+	auto now = getClockNanos();
+	if(now < node->nextIdleBalance)
+		return;
+	node->nextIdleBalance = now + lbIdleInterval;
+
+	// Try the cheapest domain first.
+	for(size_t i = 0; i < node->numDomains; ++i)
+		balanceDomain_(node, node->domains[i], true);
+}
+
 coroutine<void> LoadBalancer::run_(CpuData *cpu) {
 	auto *thisNode = &lbNode.get(cpu);
 
-	bool joined = false;
 	uint64_t lastDecay = getClockNanos();
+	uint64_t lastIrqBalance = lastDecay;
+	uint64_t nextEstimate = lastDecay;
 
 	while(true) {
-		// Global barrier to wait for initiation of load balancing.
-		async::barrier::arrival_token token;
-		if (!joined) {
-			token = barrier_.arrive_and_join();
-			joined = true;
-		} else {
-			token = barrier_.arrive();
+		auto now = getClockNanos();
+
+		if (now >= nextEstimate) {
+			bool applyDecay = false;
+			if (now - lastDecay >= lbDecayInterval) {
+				applyDecay = true;
+				lastDecay = now;
+			}
+
+			estimateLoad_(thisNode, applyDecay);
+			nextEstimate = now + lbEstimateInterval;
 		}
-		co_await barrier_.async_wait(token);
 
-		if (debugLb)
-			infoLogger() << "CPU #" << cpu->cpuIndex << " enters load balancing" << frg::endlog;
+		uint64_t deadline = nextEstimate;
+		if (enableLb && domainsReady()) {
+			// Balance the lowest domains first such that load is spread within cheap
+			// domains before it is moved across more expensive domains.
+			for (size_t i = 0; i < thisNode->numDomains; ++i) {
+				auto *domain = thisNode->domains[i];
+
+				// Above the lowest domain, each group is the span of the next lower domain.
+				// Only the first CPU of each group balances such that the CPUs of a group
+				// do not all contend on the same nodes. The lower domains then spread
+				// the load within the group.
+				if (i && thisNode->domains[i - 1]->cpus[0] != static_cast<size_t>(cpu->cpuIndex))
+					continue;
 
-		bool applyDecay = false;
-		auto now = getClockNanos();
-		if (now - lastDecay >= lbDecayInterval) {
-			applyDecay = true;
-			lastDecay = now;
+				if (now >= thisNode->nextBalance[i]) {
+					balanceDomain_(thisNode, domain, false);
+					thisNode->nextBalance[i] = now + domain->interval;
+				}
+				deadline = frg::min(deadline, thisNode->nextBalance[i]);
+			}
+		}
+
+		// Move IRQs away from CPUs that handle many IRQs. This is done on CPU zero only.
+		// IRQ balancing takes the thread load into account but not vice versa.
+		if (!cpu->cpuIndex && now - lastIrqBalance >= irqBalanceInterval) {
+			frg::dyn_array<uint64_t, KernelAlloc> threadLoad{getCpuCount(), *kernelAlloc};
+			for (size_t i = 0; i < getCpuCount(); ++i)
+				threadLoad[i] = lbNode.getFor(i).load.load(std::memory_order_relaxed);
+			balanceIrqs({threadLoad.data(), threadLoad.size()});
+			lastIrqBalance = now;
 		}
 
-		// On this CPU, estimate the load.
-		uint64_t load = 0;
-		{
-			auto irqLock = frg::guard(&irqMutex());
-			auto lock = frg::guard(&thisNode->mutex);
-
-			auto it = thisNode->tasks.begin();
-			while (it != thisNode->tasks.end()) {
-				auto currentIt = it;
-				auto *cb = *currentIt;
-				++it;
-
-				// cb is owned by thisNode.
-				// We deallocate the control block once the thread has been destroyed.
-				auto thread = cb->thread_.lock();
-				if (!thread) {
-					thisNode->tasks.erase(currentIt);
-					frg::destruct(*kernelAlloc, cb);
+		co_await generalTimerEngine()->sleep(deadline);
+	}
+
+	co_return;
+}
+
+void LoadBalancer::estimateLoad_(LbNode *node, bool applyDecay) {
+	auto irqLock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&node->mutex);
+
+	uint64_t load = 0;
+	auto it = node->tasks.begin();
+	while (it != node->tasks.end()) {
+		auto currentIt = it;
+		auto *cb = *currentIt;
+		++it;
+
+		// cb is owned by node.
+		// We deallocate the control block once the thread has been destroyed.
+		auto thread = cb->thread_.lock();
+		if (!thread) {
+			node->tasks.erase(currentIt);
+			frg::destruct(*kernelAlloc, cb);
+			continue;
+		}
+
+		thread->updateLoad();
+		if (applyDecay)
+			thread->decayLoad(lbDecay, 8);
+		cb->load_ = thread->loadLevel();
+		load += cb->load_;
+	}
+
+	node->load.store(load, std::memory_order_relaxed);
+
+	if (debugLb)
+		infoLogger() << "CPU #" << node->cpu->cpuIndex << " has load " << load << frg::endlog;
+}
+
+void LoadBalancer::buildDomains_() {
+	auto numCpus = getCpuCount();
+	domains_.initialize(*kernelAlloc);
+
+	// Level of the highest domain that was created for each CPU so far (or -1).
+	frg::dyn_array<int, KernelAlloc> childLevel{numCpus, *kernelAlloc};
+	for (size_t c = 0; c < numCpus; ++c)
+		childLevel[c] = -1;
+
+	for (size_t level = 0; level < numLbLevels; ++level) {
+		for (size_t c = 0; c < numCpus; ++c) {
+			auto *node = &lbNode.getFor(c);
+
+			// Two CPUs are in the same group if they share the child domain.
+			auto sameGroup = [&] (size_t a, size_t b) -> bool {
+				if (childLevel[a] < 0)
+					return a == b;
+				return sameDomain(a, b, childLevel[a]);
+			};
+
+			size_t spanSize = 0;
+			size_t groupSize = 0;
+			for (size_t d = 0; d < numCpus; ++d) {
+				if (!sameDomain(c, d, level))
 					continue;
+				++spanSize;
+				if (sameGroup(c, d))
+					++groupSize;
+			}
+
+			// Skip degenerate domains that consist of a single group.
+			if (spanSize == groupSize)
+				continue;
+
+			// Reuse the domain of a CPU that we already handled.
+			LbDomain *domain = nullptr;
+			for (size_t d = 0; d < c && !domain; ++d) {
+				if (!sameDomain(c, d, level))
+					continue;
+				auto *otherNode = &lbNode.getFor(d);
+				for (size_t i = 0; i < otherNode->numDomains; ++i) {
+					if (otherNode->domains[i]->level == static_cast<LbLevel>(level))
+						domain = otherNode->domains[i];
+				}
+			}
+
+			if (!domain) {
+				domain = frg::construct<LbDomain>(*kernelAlloc);
+				domain->id = domains_->size();
+				domain->level = static_cast<LbLevel>(level);
+
+				// Add CPUs group by group.
+				for (size_t d = 0; d < numCpus; ++d) {
+					if (!sameDomain(c, d, level))
+						continue;
+
+					bool isFirstOfGroup = true;
+					for (size_t e = 0; e < d; ++e) {
+						if (sameDomain(c, e, level) && sameGroup(e, d))
+							isFirstOfGroup = false;
+					}
+					if (!isFirstOfGroup)
+						continue;
+
+					for (size_t e = d; e < numCpus; ++e) {
+						if (sameDomain(c, e, level) && sameGroup(d, e))
+							domain->cpus.push_back(e);
+					}
+					domain->groupEnds.push_back(domain->cpus.size());
 				}
 
-				thread->updateLoad();
-				if (applyDecay)
-					thread->decayLoad(lbDecay, 8);
-				cb->load_ = thread->loadLevel();
-				load += cb->load_;
+				domain->interval = frg::min(frg::max(lbIntervalPerCpu * spanSize, lbMinInterval),
+						lbMaxInterval);
+				domains_->push_back(domain);
+
+				auto log = infoLogger();
+				log << "thor: Load balancing domain " << domain->id
+						<< " (" << levelName(domain->level) << "):";
+				for (size_t g = 0; g < domain->numGroups(); ++g) {
+					log << " {";
+					auto group = domain->group(g);
+					for (size_t i = 0; i < group.size(); ++i)
+						log << (i ? " " : "") << group[i];
+					log << "}";
+				}
+				log << frg::endlog;
 			}
+
+			if (node->numDomains)
+				node->domains[node->numDomains - 1]->parent = domain;
+			node->domains[node->numDomains++] = domain;
 		}
 
-		thisNode->totalLoad = load;
-		thisNode->currentLoad = load;
-
-		if (debugLb)
-			infoLogger() << "CPU #" << cpu->cpuIndex << " has load " << load << frg::endlog;
-
-		// Global barrier to wait until all CPUs know their load level.
-		co_await barrier_.async_wait(barrier_.arrive());
-
-		// Sum load of all CPUs.
-		// TODO: Doing this on all CPUs is unnecessary. However, it is also reasonably fast
-		//       and might be preferable over synchronization overhead.
-		uint64_t systemLoad = 0;
-		for (size_t i = 0; i < getCpuCount(); ++i)
-			systemLoad += lbNode.getFor(i).totalLoad;
-		uint64_t idealLoad = systemLoad / getCpuCount();
-		if (debugLb && cpu == getCpuData(0))
-			infoLogger() << "Total system load is " << systemLoad
-					<< " (ideal load: " << idealLoad << ")" << frg::endlog;
-
-		if (enableLb) {
-			// Distribute load from other CPUs to this CPU.
-			// TODO: This loop probably does not scale very well since all CPUs try to pull from
-			//       all other CPUs in the same order (and this can cause lock contention).
-			uint64_t newLoad = thisNode->totalLoad;
-			for (size_t i = 0; i < getCpuCount(); ++i) {
-				auto *toCpu = getCpuData(i);
-				if (cpu != toCpu)
-					balanceBetween_(&lbNode.get(toCpu), thisNode, newLoad, idealLoad);
-			}
+		for (size_t c = 0; c < numCpus; ++c) {
+			auto *node = &lbNode.getFor(c);
+			if (node->numDomains
+					&& node->domains[node->numDomains - 1]->level == static_cast<LbLevel>(level))
+				childLevel[c] = level;
 		}
+	}
+
+	domainsReady_.store(true, std::memory_order_release);
+}
+
+void LoadBalancer::balanceDomain_(LbNode *dstNode, LbDomain *domain, bool idle) {
+	size_t thisCpu = dstNode->cpu->cpuIndex;
+	domain->numBalances.fetch_add(1, std::memory_order_relaxed);
 
-		// Balance load again after some time has passed.
-		// Note that we only wait on CPU zero. All other CPUs wait on the barrier instead.
-		if (!cpu->cpuIndex)
-			co_await generalTimerEngine()->sleep(getClockNanos() + lbInterval);
+	auto loadOf = [] (size_t cpu) -> uint64_t {
+		return lbNode.getFor(cpu).load.load(std::memory_order_relaxed);
+	};
+
+	// Find the local group and the busiest remote group (by load per CPU).
+	uint64_t domainLoad = 0;
+	uint64_t localAvg = 0;
+	frg::optional<size_t> busiestGroup;
+	uint64_t busiestAvg = 0;
+	for (size_t g = 0; g < domain->numGroups(); ++g) {
+		auto group = domain->group(g);
+		uint64_t groupLoad = 0;
+		bool isLocal = false;
+		for (auto cpu : group) {
+			groupLoad += loadOf(cpu);
+			if (cpu == thisCpu)
+				isLocal = true;
+		}
+		domainLoad += groupLoad;
+
+		auto avg = groupLoad / group.size();
+		if (isLocal) {
+			localAvg = avg;
+		} else if (!busiestGroup || avg > busiestAvg) {
+			busiestGroup = g;
+			busiestAvg = avg;
+		}
 	}
 
-	co_return;
+	if (!busiestGroup)
+		return;
+	// Idle CPUs pull as long as there is any imbalance.
+	if (idle) {
+		if (busiestAvg <= localAvg)
+			return;
+	} else {
+		if (busiestAvg * 100 < localAvg * lbImbalancePct || busiestAvg == localAvg)
+			return;
+	}
+
+	// Pull from the busiest CPU of the busiest group.
+	frg::optional<size_t> busiestCpu;
+	for (auto cpu : domain->group(*busiestGroup)) {
+		if (!busiestCpu || loadOf(cpu) > loadOf(*busiestCpu))
+			busiestCpu = cpu;
+	}
+
+	uint64_t idealLoad = domainLoad / domain->cpus.size();
+	if (debugLb)
+		infoLogger() << "CPU #" << thisCpu << " balances " << levelName(domain->level)
+				<< " domain " << domain->id << " (ideal load: " << idealLoad << ")"
+				<< frg::endlog;
+
+	auto moved = balanceBetween_(&lbNode.getFor(*busiestCpu), dstNode, idealLoad);
+	if (moved) {
+		if (idle) {
+			domain->numIdleMigrations.fetch_add(moved, std::memory_order_relaxed);
+		} else {
+			domain->numMigrations.fetch_add(moved, std::memory_order_relaxed);
+		}
+	}
 }
 
-void LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &newLoad, uint64_t idealLoad) {
+size_t LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t idealLoad) {
 	auto improvesBalance = [] (uint64_t srcLoad, uint64_t dstLoad, uint64_t stolenLoad) -> bool {
 		uint64_t srcLoadPostMove = srcLoad - stolenLoad;
 		uint64_t dstLoadPostMove = dstLoad + stolenLoad;
@@ -168,10 +406,15 @@ void LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &n
 			&LbControlBlock::hook_
 		>
 	> stolenTasks;
+	size_t numStolen = 0;
+	uint64_t stolenLoad = 0;
 	{
 		auto irqLock = frg::guard(&irqMutex());
 		auto lock = frg::guard(&srcNode->mutex);
 
+		auto srcLoad = srcNode->load.load(std::memory_order_relaxed);
+		auto newLoad = dstNode->load.load(std::memory_order_relaxed);
+
 		auto it = srcNode->tasks.begin();
 		while (it != srcNode->tasks.end()) {
 			auto currentIt = it;
@@ -181,7 +424,7 @@ void LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &n
 			// Do not attempt to do load balancing if source and destination are both
 			// undersubscribed. While it may still be possible to improve the balance,
 			// it is probably not worth it in terms of effort and cache degradation.
-			if (srcNode->currentLoad < idealLoad && newLoad < idealLoad)
+			if (srcLoad < idealLoad && newLoad < idealLoad)
 				break;
 
 			// Do not move threads with tiny contributions to the total load.
@@ -191,7 +434,7 @@ void LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &n
 			if (!cb->inAffinityMask(dstNode->cpu->cpuIndex))
 				continue;
 
-			if (!improvesBalance(srcNode->currentLoad, newLoad, cb->load_))
+			if (!improvesBalance(srcLoad, newLoad, cb->load_))
 				continue;
 
 			if (debugLb)
@@ -206,18 +449,25 @@ void LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &n
 			cb->_assignedCpu.store(dstNode->cpu, std::memory_order_relaxed);
 			stolenTasks.push_back(cb);
 
-			srcNode->currentLoad -= cb->load_;
+			srcLoad -= cb->load_;
 			newLoad += cb->load_;
+			stolenLoad += cb->load_;
+			++numStolen;
 		}
+
+		srcNode->load.store(srcLoad, std::memory_order_relaxed);
 	}
 
 	// Add tasks from temporary list to dstNode.
-	{
+	if (numStolen) {
 		auto irqLock = frg::guard(&irqMutex());
 		auto lock = frg::guard(&dstNode->mutex);
 
 		dstNode->tasks.splice(dstNode->tasks.end(), stolenTasks);
+		dstNode->load.fetch_add(stolenLoad, std::memory_order_relaxed);
 	}
+
+	return numStolen;
 }
 
 } // namespace thor
@@ -107,6 +107,8 @@ extern "C" void thorInitialize() {
 
 	runCpuDataInitializers();
 	initializeAsidContext(getCpuData());
+
+	physicalAllocator->enablePerCpuCaches();
 }
 
 extern "C" void thorRunConstructors() {
@@ -433,6 +435,7 @@ void handlePageFault(FaultImageAccessor image, uintptr_t address, Word errorCode
 
 	smarter::borrowed_ptr<Thread> this_thread = getCurrentThread();
 	assert(this_thread.get());
+	this_thread->countPageFault();
 
 	auto address_space = this_thread->getAddressSpace();
 	assert(!(errorCode & kPfBadTable));
@@ -740,6 +743,9 @@ void handleSyscall(SyscallImageAccessor image) {
 	case kHelCallSetPriority: {
 		*image.error() = helSetPriority((HelHandle)arg0, (int)arg1);
 	} break;
+	case kHelCallSetTimerSlack: {
+		*image.error() = helSetTimerSlack((HelHandle)arg0, (uint64_t)arg1);
+	} break;
 	case kHelCallYield: {
 		*image.error() = helYield();
 	} break;
@@ -779,6 +785,11 @@ void handleSyscall(SyscallImageAccessor image) {
 		*image.error() = helGetClock(&counter);
 		*image.out0() = counter;
 	} break;
+	case kHelCallAccessClockPage: {
+		HelHandle handle;
+		*image.error() = helAccessClockPage(&handle);
+		*image.out0() = handle;
+	} break;
 	case kHelCallCreateStream: {
 		HelHandle lane1;
 		HelHandle lane2;
@@ -796,6 +807,18 @@ void handleSyscall(SyscallImageAccessor image) {
 	case kHelCallFutexWake: {
 		*image.error() = helFutexWake((int *)arg0, (unsigned int)arg1);
 	} break;
+	case kHelCallFutexWaitv: {
+		size_t index;
+		*image.error() = helFutexWaitv((const HelFutexWaitItem *)arg0, (size_t)arg1,
+				(int64_t)arg2, &index);
+		*image.out0() = index;
+	} break;
+	case kHelCallFutexRequeue: {
+		unsigned int count;
+		*image.error() = helFutexRequeue((int *)arg0, (int *)arg1, (unsigned int)arg2,
+				(unsigned int)arg3, (int)arg4, (uint32_t)arg5, &count);
+		*image.out0() = count;
+	} break;
 
 	case kHelCallCreateOneshotEvent: {
 		HelHandle handle;
@@ -821,6 +844,13 @@ void handleSyscall(SyscallImageAccessor image) {
 	case kHelCallAutomateIrq: {
 		*image.error() = helAutomateIrq((HelHandle)arg0, (uint32_t)arg1, (HelHandle)arg2);
 	} break;
+	case kHelCallSetIrqAffinity: {
+		*image.error() = helSetIrqAffinity((HelHandle)arg0, (uint8_t *)arg1, (size_t)arg2);
+	} break;
+	case kHelCallQueryIrqStats: {
+		*image.error() = helQueryIrqStats((HelHandle)arg0, (HelIrqStats *)arg1,
+				(uint64_t *)arg2, (size_t)arg3);
+	} break;
 
 	case kHelCallAccessIo: {
 		HelHandle handle;
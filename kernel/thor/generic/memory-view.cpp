@@ -1,3 +1,4 @@
+#include <frg/cmdline.hpp>
 #include <thor-internal/address-space.hpp>
 #include <thor-internal/coroutine.hpp>
 #include <thor-internal/fiber.hpp>
@@ -21,16 +22,38 @@ namespace {
 // Reclaim implementation.
 // --------------------------------------------------------
 
+// Pages are kept on two lists, similar to Linux' active/inactive LRU.
+// New pages start out on the inactive list. Accesses only set CachePage::referenced
+// (which does not require any lock); the reclaim fiber then ages the lists:
+// referenced pages on the inactive list are activated, unreferenced pages at the head
+// of the active list are deactivated. Only pages at the head of the inactive list
+// are posted to their bundles for eviction. Hence, a single scan over a large file
+// cannot push out the working set (which lives on the active list).
+//
+// Reclaim is driven by watermarks on the number of free physical pages:
+// it is started once fewer than _lowWatermark pages are free (the physical allocator
+// wakes up the reclaim fiber in this case) and continues until _highWatermark pages
+// are free (counting pages that are already being evicted).
 struct MemoryReclaimer {
+	// Maximal number of pages that are posted for eviction at once.
+	static constexpr size_t reclaimBatch = 32;
+
+	MemoryReclaimer() {
+		auto totalPages = physicalAllocator->numTotalPages();
+		_lowWatermark = totalPages / 4;
+		_highWatermark = totalPages / 4 + totalPages / 8;
+	}
+
 	void addPage(CachePage *page) {
 		auto irqLock = frg::guard(&irqMutex());
 		auto lock = frg::guard(&_mutex);
 
 		assert(!(page->flags & CachePage::reclaimRegistered));
 
-		_lruList.push_back(page);
+		page->referenced.store(false, std::memory_order_relaxed);
+		_inactiveList.push_back(page);
 		page->flags |= CachePage::reclaimRegistered;
-		_cachedSize += kPageSize;
+		_numInactive++;
 	}
 
 	void removePage(CachePage *page) {
@@ -46,121 +69,247 @@ struct MemoryReclaimer {
 			}
 
 			page->flags &= ~(CachePage::reclaimPosted | CachePage::reclaimInflight);
+			_numPosted--;
+		}else if(page->flags & CachePage::reclaimActive) {
+			auto it = _activeList.iterator_to(page);
+			_activeList.erase(it);
+			page->flags &= ~CachePage::reclaimActive;
+			_numActive--;
 		}else{
-			auto it = _lruList.iterator_to(page);
-			_lruList.erase(it);
-			_cachedSize -= kPageSize;
+			auto it = _inactiveList.iterator_to(page);
+			_inactiveList.erase(it);
+			_numInactive--;
 		}
 		page->flags &= ~CachePage::reclaimRegistered;
 	}
 
+	// Marks the page as recently used. This is called on every access to a cached page,
+	// hence it does not take any locks; the referenced bit is only evaluated during reclaim.
 	void bumpPage(CachePage *page) {
+		if(!page->referenced.load(std::memory_order_relaxed))
+			page->referenced.store(true, std::memory_order_relaxed);
+	}
+
+	auto awaitReclaim(CacheBundle *bundle, async::cancellation_token ct = {}) {
+		return async::transform(
+			bundle->_reclaimEvent.async_wait_if([this, bundle] () -> bool {
+				auto irqLock = frg::guard(&irqMutex());
+				auto lock = frg::guard(&_mutex);
+
+				return bundle->_reclaimList.empty();
+			}, ct),
+			[] (auto) { }
+		);
+	}
+
+	CachePage *reclaimPage(CacheBundle *bundle) {
 		auto irqLock = frg::guard(&irqMutex());
 		auto lock = frg::guard(&_mutex);
 
-		assert(page->flags & CachePage::reclaimRegistered);
+		while(!bundle->_reclaimList.empty()) {
+			auto page = bundle->_reclaimList.pop_front();
 
-		if(page->flags & CachePage::reclaimPosted) {
-			if(!(page->flags & CachePage::reclaimInflight)) {
-				auto it = page->bundle->_reclaimList.iterator_to(page);
-				page->bundle->_reclaimList.erase(it);
+			assert(page->flags & CachePage::reclaimRegistered);
+			assert(page->flags & CachePage::reclaimPosted);
+			assert(!(page->flags & CachePage::reclaimInflight));
+
+			// The page was accessed after it was posted; keep it.
+			if(page->referenced.exchange(false, std::memory_order_relaxed)) {
+				page->flags &= ~CachePage::reclaimPosted;
+				_numPosted--;
+				_activate(page);
+				_stats.rescued++;
+				continue;
 			}
 
-			page->flags &= ~(CachePage::reclaimPosted | CachePage::reclaimInflight);
-			_cachedSize += kPageSize;
-		}else{
-			auto it = _lruList.iterator_to(page);
-			_lruList.erase(it);
+			page->flags |= CachePage::reclaimInflight;
+			_stats.evicted++;
+			return page;
 		}
 
-		_lruList.push_back(page);
+		return nullptr;
 	}
 
-	auto awaitReclaim(CacheBundle *bundle, async::cancellation_token ct = {}) {
-		return async::transform(
-			bundle->_reclaimEvent.async_wait(ct),
-			[] (auto) { }
-		);
+	// Called by the physical allocator when free memory drops below the low watermark.
+	// This may be called from any context (with arbitrary locks held).
+	void wakeUp() {
+		if(_wakeRequested.exchange(true, std::memory_order_relaxed))
+			return;
+		_wakeWork.invoke();
 	}
 
-	CachePage *reclaimPage(CacheBundle *bundle) {
+	ReclaimStatistics getStatistics() {
 		auto irqLock = frg::guard(&irqMutex());
 		auto lock = frg::guard(&_mutex);
 
-		if(bundle->_reclaimList.empty())
-			return nullptr;
+		auto stats = _stats;
+		stats.activePages = _numActive;
+		stats.inactivePages = _numInactive;
+		stats.postedPages = _numPosted;
+		stats.lowWatermark = _lowWatermark;
+		stats.highWatermark = _highWatermark;
+		return stats;
+	}
 
-		auto page = bundle->_reclaimList.pop_front();
+	size_t lowWatermark() {
+		return _lowWatermark;
+	}
 
-		assert(page->flags & CachePage::reclaimRegistered);
-		assert(page->flags & CachePage::reclaimPosted);
-		assert(!(page->flags & CachePage::reclaimInflight));
+	void runReclaimFiber() {
+		KernelFiber::run([=, this] {
+			while(true) {
+				if(logUncaching) {
+					auto irqLock = frg::guard(&irqMutex());
+					auto lock = frg::guard(&_mutex);
+					infoLogger() << "thor: " << ((_numActive + _numInactive) * kPageSize / 1024)
+							<< " KiB of cached pages (" << _numActive << " active, "
+							<< _numInactive << " inactive pages)" << frg::endlog;
+				}
 
-		page->flags |= CachePage::reclaimInflight;
+				bool stalled = false;
+				while(_reclaimRound(stalled))
+					;
 
-		return page;
+				uint64_t period = tortureUncaching ? 10'000'000 : 1'000'000'000;
+				if(stalled) {
+					// We need memory but there is nothing to reclaim;
+					// do not let the allocator wake us up again before the next period.
+					KernelFiber::asyncBlockCurrent(generalTimerEngine()->sleepFor(period));
+					_wakeRequested.store(false, std::memory_order_relaxed);
+				}else{
+					_wakeRequested.store(false, std::memory_order_relaxed);
+					KernelFiber::asyncBlockCurrent(async::race_and_cancel(
+						async::lambda([this] (async::cancellation_token ct) -> coroutine<void> {
+							co_await _wakeEvent.async_wait_if([this] () -> bool {
+								return !_wakeRequested.load(std::memory_order_relaxed);
+							}, ct);
+						}),
+						async::lambda([period] (async::cancellation_token ct) -> coroutine<void> {
+							co_await generalTimerEngine()->sleepFor(period, ct);
+						})
+					));
+				}
+			}
+		});
 	}
 
-	void runReclaimFiber() {
-		auto checkReclaim = [this] () -> bool {
-			if(disableUncaching)
-				return false;
+private:
+	struct WakeWork {
+		void setUp() { }
+
+		void execute() {
+			{
+				auto irqLock = frg::guard(&irqMutex());
+				auto lock = frg::guard(&self->_mutex);
+
+				self->_stats.wakeups++;
+			}
+			self->_wakeEvent.raise();
+		}
+
+		MemoryReclaimer *self;
+	};
+
+	// Moves a page to the tail of the active list. Caller must hold _mutex.
+	void _activate(CachePage *page) {
+		assert(!(page->flags & CachePage::reclaimActive));
+		_activeList.push_back(page);
+		page->flags |= CachePage::reclaimActive;
+		_numActive++;
+		_stats.activated++;
+	}
 
+	// Posts up to reclaimBatch pages for eviction.
+	// Returns true if reclaim should continue immediately.
+	bool _reclaimRound(bool &stalled) {
+		if(disableUncaching)
+			return false;
+
+		// Bundles are raised without holding _mutex, see awaitReclaim().
+		CacheBundle *toRaise[reclaimBatch];
+		size_t numToRaise = 0;
+		{
 			auto irqLock = frg::guard(&irqMutex());
 			auto lock = frg::guard(&_mutex);
 
-			if(_lruList.empty())
-				return false;
-
-			if(!tortureUncaching) {
-				auto pagesWatermark = physicalAllocator->numTotalPages() * 3 / 4;
-				auto usedPages = physicalAllocator->numUsedPages();
-				if(usedPages < pagesWatermark) {
+			size_t target;
+			if(tortureUncaching) {
+				target = reclaimBatch;
+			}else{
+				// Pages that are already posted will be freed soon.
+				auto freePages = physicalAllocator->numFreePages() + _numPosted;
+				if(!_reclaiming && freePages >= _lowWatermark)
+					return false;
+				if(freePages >= _highWatermark) {
+					_reclaiming = false;
 					return false;
-				}else{
-					if(logUncaching)
-						infoLogger() << "thor: Uncaching page. " << usedPages
-								<< " pages are in use (watermark: " << pagesWatermark << ")"
-								<< frg::endlog;
 				}
+				_reclaiming = true;
+				target = frg::min(_highWatermark - freePages, reclaimBatch);
+
+				if(logUncaching)
+					infoLogger() << "thor: Reclaiming " << target << " pages, "
+							<< freePages << " pages are free (watermarks: "
+							<< _lowWatermark << ", " << _highWatermark << ")"
+							<< frg::endlog;
 			}
 
-			auto page = _lruList.pop_front();
-
-			assert(page->flags & CachePage::reclaimRegistered);
-			assert(!(page->flags & CachePage::reclaimPosted));
-			assert(!(page->flags & CachePage::reclaimInflight));
+			if(!_numActive && !_numInactive) {
+				stalled = !tortureUncaching;
+				return false;
+			}
 
-			page->flags |= CachePage::reclaimPosted;
-			_cachedSize -= kPageSize;
+			// Keep the inactive list at least as large as the active list.
+			// Referenced pages at the head of the active list get another round.
+			size_t budget = 2 * reclaimBatch;
+			while(_numActive > _numInactive && budget) {
+				auto page = _activeList.pop_front();
+				budget--;
+				_stats.scanned++;
+				if(page->referenced.exchange(false, std::memory_order_relaxed)) {
+					_activeList.push_back(page);
+					continue;
+				}
+				page->flags &= ~CachePage::reclaimActive;
+				_numActive--;
+				_inactiveList.push_back(page);
+				_numInactive++;
+				_stats.deactivated++;
+			}
 
-			page->bundle->_reclaimList.push_back(page);
-			page->bundle->_reclaimEvent.raise();
+			size_t numPosted = 0;
+			budget = 2 * reclaimBatch;
+			while(numPosted < target && !_inactiveList.empty() && budget) {
+				auto page = _inactiveList.pop_front();
+				budget--;
+				_numInactive--;
+				_stats.scanned++;
 
-			return true;
-		};
+				assert(page->flags & CachePage::reclaimRegistered);
+				assert(!(page->flags & CachePage::reclaimPosted));
+				assert(!(page->flags & CachePage::reclaimInflight));
 
-		KernelFiber::run([=, this] {
-			while(true) {
-				if(logUncaching) {
-					auto irqLock = frg::guard(&irqMutex());
-					auto lock = frg::guard(&_mutex);
-					infoLogger() << "thor: " << (_cachedSize / 1024)
-							<< " KiB of cached pages" << frg::endlog;
+				if(page->referenced.exchange(false, std::memory_order_relaxed)) {
+					_activate(page);
+					continue;
 				}
 
-				while(checkReclaim())
-					;
-				if(tortureUncaching) {
-					KernelFiber::asyncBlockCurrent(generalTimerEngine()->sleepFor(10'000'000));
-				}else{
-					KernelFiber::asyncBlockCurrent(generalTimerEngine()->sleepFor(1'000'000'000));
-				}
+				// Only raise the bundle on the first post; bundles drain their list.
+				if(page->bundle->_reclaimList.empty())
+					toRaise[numToRaise++] = page->bundle;
+				page->flags |= CachePage::reclaimPosted;
+				page->bundle->_reclaimList.push_back(page);
+				_numPosted++;
+				_stats.posted++;
+				numPosted++;
 			}
-		});
+		}
+
+		for(size_t i = 0; i < numToRaise; i++)
+			toRaise[i]->_reclaimEvent.raise();
+		return true;
 	}
 
-private:
 	frg::ticket_spinlock _mutex;
 
 	frg::intrusive_list<
@@ -170,9 +319,31 @@ private:
 			frg::default_list_hook<CachePage>,
 			&CachePage::listHook
 		>
-	> _lruList;
+	> _activeList;
 
-	size_t _cachedSize = 0;
+	frg::intrusive_list<
+		CachePage,
+		frg::locate_member<
+			CachePage,
+			frg::default_list_hook<CachePage>,
+			&CachePage::listHook
+		>
+	> _inactiveList;
+
+	size_t _numActive = 0;
+	size_t _numInactive = 0;
+	// Pages that are posted to (or being evicted by) their bundles.
+	size_t _numPosted = 0;
+
+	size_t _lowWatermark = 0;
+	size_t _highWatermark = 0;
+	bool _reclaiming = false;
+
+	ReclaimStatistics _stats;
+
+	std::atomic<bool> _wakeRequested{false};
+	async::recurring_event _wakeEvent;
+	DeferredWork<WakeWork> _wakeWork{{this}};
 };
 
 static frg::manual_box<MemoryReclaimer> globalReclaimer;
@@ -181,10 +352,51 @@ static initgraph::Task initReclaim{&globalInitEngine, "generic.init-reclaim",
 	initgraph::Requires{getFibersAvailableStage()},
 	[] {
 		globalReclaimer.initialize();
+		if(!disableUncaching)
+			physicalAllocator->setLowWatermark(globalReclaimer->lowWatermark(), [] {
+				globalReclaimer->wakeUp();
+			});
 		globalReclaimer->runReclaimFiber();
 	}
 };
 
+ReclaimStatistics getReclaimStatistics() {
+	return globalReclaimer->getStatistics();
+}
+
+// --------------------------------------------------------
+// Readahead configuration and page cache statistics.
+// --------------------------------------------------------
+
+namespace {
+	// Size of the first readahead window of a sequential stream (in pages).
+	constexpr size_t initialReadahead = 4;
+
+	// Upper bound on the readahead window (in pages).
+	// Can be changed via the thor.max_readahead command line option.
+	constexpr size_t defaultMaxReadahead = 32;
+	size_t maxReadahead = defaultMaxReadahead;
+}
+
+static initgraph::Task parseReadaheadOptions{&globalInitEngine, "generic.parse-readahead-options",
+	[] {
+		frg::array args = {
+			frg::option{"thor.max_readahead", frg::as_number(maxReadahead)},
+		};
+		frg::parse_arguments(getKernelCmdline(), args);
+
+		if(maxReadahead != defaultMaxReadahead)
+			infoLogger() << "thor: Maximal readahead window is "
+					<< maxReadahead << " pages" << frg::endlog;
+	}
+};
+
+constinit PageCacheStatistics pageCacheStatistics;
+
+PageCacheStatistics &getPageCacheStatistics() {
+	return pageCacheStatistics;
+}
+
 // --------------------------------------------------------
 // MemoryView.
 // --------------------------------------------------------
@@ -198,6 +410,10 @@ coroutine<frg::expected<Error, smarter::shared_ptr<MemoryView>>> MemoryView::for
 	co_return Error::illegalObject;
 }
 
+frg::tuple<PhysicalAddr, CachingMode> MemoryView::peekLargeRange(uintptr_t) {
+	return frg::tuple<PhysicalAddr, CachingMode>{PhysicalAddr(-1), CachingMode::null};
+}
+
 // In addition to what copyFrom() does, we also have to mark the memory as dirty.
 coroutine<frg::expected<Error>> MemoryView::copyTo(uintptr_t offset,
 		const void *pointer, size_t size,
@@ -546,9 +762,9 @@ size_t HardwareMemory::getLength() {
 // --------------------------------------------------------
 
 AllocatedMemory::AllocatedMemory(size_t desiredLngth,
-		int addressBits, size_t desiredChunkSize, size_t chunkAlign)
-: _physicalChunks{*kernelAlloc},
-		_addressBits{addressBits}, _chunkAlign{chunkAlign} {
+		int addressBits, size_t desiredChunkSize, size_t chunkAlign, bool largePages)
+: _physicalChunks{*kernelAlloc}, _largeSlots{*kernelAlloc},
+		_addressBits{addressBits}, _chunkAlign{chunkAlign}, _largePages{largePages} {
 	static_assert(sizeof(unsigned long) == sizeof(uint64_t), "Fix use of __builtin_clzl");
 	_chunkSize = size_t(1) << (64 - __builtin_clzl(desiredChunkSize - 1));
 	if(_chunkSize != desiredChunkSize)
@@ -565,6 +781,11 @@ AllocatedMemory::AllocatedMemory(size_t desiredLngth,
 	assert(_chunkAlign % kPageSize == 0);
 	assert(_chunkSize % _chunkAlign == 0);
 	_physicalChunks.resize(length / _chunkSize, PhysicalAddr(-1));
+	if(_largePages) {
+		assert(_chunkSize == kPageSize);
+		_largeSlots.resize((length + kLargePageSize - 1) >> kLargePageShift,
+				LargeState::untouched);
+	}
 }
 
 AllocatedMemory::~AllocatedMemory() {
@@ -574,6 +795,16 @@ AllocatedMemory::~AllocatedMemory() {
 		infoLogger() << "thor: Releasing AllocatedMemory ("
 				<< (physicalAllocator->numUsedPages() * 4) << " KiB in use)" << frg::endlog;
 	for(size_t i = 0; i < _physicalChunks.size(); ++i) {
+		if(_largePages) {
+			auto slot = (i * _chunkSize) >> kLargePageShift;
+			if(_largeSlots[slot] == LargeState::large) {
+				// Free the whole large page at once and skip the remaining chunks.
+				assert(!((i * _chunkSize) & (kLargePageSize - 1)));
+				physicalAllocator->free(_physicalChunks[i], kLargePageSize);
+				i += (kLargePageSize / _chunkSize) - 1;
+				continue;
+			}
+		}
 		if(_physicalChunks[i] != PhysicalAddr(-1))
 			physicalAllocator->free(_physicalChunks[i], _chunkSize);
 	}
@@ -591,6 +822,12 @@ coroutine<frg::expected<Error>> AllocatedMemory::resize(size_t newSize) {
 		size_t num_chunks = newSize / _chunkSize;
 		assert(num_chunks >= _physicalChunks.size());
 		_physicalChunks.resize(num_chunks, PhysicalAddr(-1));
+		if(_largePages) {
+			// Note that a partial slot at the end can stay untouched (and become
+			// eligible for a large page) if none of its pages were accessed.
+			_largeSlots.resize((newSize + kLargePageSize - 1) >> kLargePageShift,
+					LargeState::untouched);
+		}
 	}
 	co_return {};
 }
@@ -620,6 +857,53 @@ frg::tuple<PhysicalAddr, CachingMode> AllocatedMemory::peekRange(uintptr_t offse
 			CachingMode::null};
 }
 
+frg::tuple<PhysicalAddr, CachingMode> AllocatedMemory::peekLargeRange(uintptr_t offset) {
+	assert(!(offset & (kLargePageSize - 1)));
+
+	if(!_largePages)
+		return frg::tuple<PhysicalAddr, CachingMode>{PhysicalAddr(-1), CachingMode::null};
+
+	auto irq_lock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&_mutex);
+
+	auto slot = offset >> kLargePageShift;
+	assert(slot < _largeSlots.size());
+
+	if(_largeSlots[slot] != LargeState::large)
+		return frg::tuple<PhysicalAddr, CachingMode>{PhysicalAddr(-1), CachingMode::null};
+	return frg::tuple<PhysicalAddr, CachingMode>{_physicalChunks[offset / _chunkSize],
+			CachingMode::null};
+}
+
+bool AllocatedMemory::_allocateLargeSlot(uintptr_t offset) {
+	auto slot = offset >> kLargePageShift;
+	auto slotOffset = slot << kLargePageShift;
+	assert(_largeSlots[slot] == LargeState::untouched);
+
+	// Partial slots at the end of the memory are always backed by small pages.
+	if(slotOffset + kLargePageSize > _physicalChunks.size() * _chunkSize) {
+		_largeSlots[slot] = LargeState::small;
+		return false;
+	}
+
+	// Fall back to small pages if physical memory is too fragmented.
+	auto physical = physicalAllocator->allocate(kLargePageSize, _addressBits);
+	if(physical == PhysicalAddr(-1)) {
+		_largeSlots[slot] = LargeState::small;
+		return false;
+	}
+	assert(!(physical & (kLargePageSize - 1)));
+
+	for(size_t pg_progress = 0; pg_progress < kLargePageSize; pg_progress += kPageSize) {
+		PageAccessor accessor{physical + pg_progress};
+		memset(accessor.get(), 0, kPageSize);
+		assert(_physicalChunks[(slotOffset + pg_progress) / _chunkSize] == PhysicalAddr(-1));
+		_physicalChunks[(slotOffset + pg_progress) / _chunkSize] = physical + pg_progress;
+	}
+	_largeSlots[slot] = LargeState::large;
+	return true;
+}
+
 coroutine<frg::expected<Error, size_t>>
 AllocatedMemory::touchRange(uintptr_t offset, size_t, FetchFlags, WorkQueue *) {
 	auto irq_lock = frg::guard(&irqMutex());
@@ -629,6 +913,14 @@ AllocatedMemory::touchRange(uintptr_t offset, size_t, FetchFlags, WorkQueue *) {
 	auto disp = offset & (_chunkSize - 1);
 	assert(index < _physicalChunks.size());
 
+	if(_largePages) {
+		auto slot = offset >> kLargePageShift;
+		if(_largeSlots[slot] == LargeState::untouched && _allocateLargeSlot(offset))
+			co_return kLargePageSize - (offset & (kLargePageSize - 1));
+		if(_largeSlots[slot] == LargeState::large)
+			co_return kLargePageSize - (offset & (kLargePageSize - 1));
+	}
+
 	if(_physicalChunks[index] == PhysicalAddr(-1)) {
 		auto physical = physicalAllocator->allocate(_chunkSize, _addressBits);
 		assert(physical != PhysicalAddr(-1) && "OOM");
@@ -665,49 +957,67 @@ ManagedSpace::ManagedSpace(size_t length, bool readahead)
 	assert(!(length & (kPageSize - 1)));
 
 	[] (ManagedSpace *self, enable_detached_coroutine) -> void {
+		// Maximal number of pages that are evicted at once.
+		constexpr size_t evictBatch = 16;
+
 		while(true) {
 			// TODO: Cancel awaitReclaim() when the ManagedSpace is destructed.
 			co_await globalReclaimer->awaitReclaim(self);
 
-			CachePage *page;
-			ManagedPage *pit;
+			ManagedPage *batch[evictBatch];
+			size_t n = 0;
 			{
 				auto irqLock = frg::guard(&irqMutex());
 				auto lock = frg::guard(&self->mutex);
 
-				page = globalReclaimer->reclaimPage(self);
-				if(!page)
-					continue;
+				while(n < evictBatch) {
+					auto page = globalReclaimer->reclaimPage(self);
+					if(!page)
+						break;
+
+					size_t index = page->identity;
+					auto pit = self->pages.find(index);
+					assert(pit);
+					assert(pit->loadState == kStatePresent);
+					assert(!pit->lockCount);
+					pit->loadState = kStateEvicting;
+					globalReclaimer->removePage(&pit->cachePage);
+					batch[n++] = pit;
+				}
+			}
 
-				size_t index = page->identity;
-				pit = self->pages.find(index);
-				assert(pit);
-				assert(pit->loadState == kStatePresent);
-				assert(!pit->lockCount);
-				pit->loadState = kStateEvicting;
-				globalReclaimer->removePage(&pit->cachePage);
+			// Evict runs of adjacent pages with a single evictRange() call.
+			for(size_t i = 0; i < n; ) {
+				size_t count = 1;
+				while(i + count < n && batch[i + count]->cachePage.identity
+						== batch[i]->cachePage.identity + count)
+					count++;
+				co_await self->_evictQueue.evictRange(batch[i]->cachePage.identity << kPageShift,
+						count << kPageShift);
+				i += count;
 			}
 
-			co_await self->_evictQueue.evictRange(page->identity << kPageShift, kPageSize);
+			for(size_t i = 0; i < n; i++) {
+				auto pit = batch[i];
+				PhysicalAddr physical;
+				{
+					auto irqLock = frg::guard(&irqMutex());
+					auto lock = frg::guard(&self->mutex);
 
-			PhysicalAddr physical;
-			{
-				auto irqLock = frg::guard(&irqMutex());
-				auto lock = frg::guard(&self->mutex);
+					if(pit->loadState != kStateEvicting)
+						continue;
+					assert(!pit->lockCount);
+					assert(pit->physical != PhysicalAddr(-1));
+					physical = pit->physical;
 
-				if(pit->loadState != kStateEvicting)
-					continue;
-				assert(!pit->lockCount);
-				assert(pit->physical != PhysicalAddr(-1));
-				physical = pit->physical;
+					pit->loadState = kStateMissing;
+					pit->physical = PhysicalAddr(-1);
+				}
 
-				pit->loadState = kStateMissing;
-				pit->physical = PhysicalAddr(-1);
+				if(logUncaching)
+					warningLogger() << "Evicting physical page" << frg::endlog;
+				physicalAllocator->free(physical, kPageSize);
 			}
-
-			if(logUncaching)
-				warningLogger() << "Evicting physical page" << frg::endlog;
-			physicalAllocator->free(physical, kPageSize);
 		}
 	}(this, enable_detached_coroutine{WorkQueue::generalQueue().lock()});
 }
@@ -859,6 +1169,55 @@ void ManagedSpace::_progressManagement(ManageList &pending) {
 	}
 }
 
+void ManagedSpace::_doReadahead(size_t index, bool missing) {
+	size_t first;
+	if(!missing) {
+		// The reader reached the async marker of the previous window;
+		// it is still reading sequentially, hence we can grow the window.
+		assert(index == raAsyncIndex);
+		raWindow = frg::min(frg::max(raWindow * 2, initialReadahead), maxReadahead);
+		first = frg::max(raEnd, index + 1);
+		pageCacheStatistics.asyncReadaheads.fetch_add(1, std::memory_order_relaxed);
+	}else if(index >= raStart && index <= raEnd) {
+		// Sequential miss: the reader caught up with the readahead window.
+		raWindow = frg::min(frg::max(raWindow * 2, initialReadahead), maxReadahead);
+		first = index + 1;
+	}else{
+		// Random access: shrink the window; stop reading ahead entirely once
+		// the window drops below its initial size.
+		raWindow /= 2;
+		if(raWindow < initialReadahead)
+			raWindow = 0;
+		first = index + 1;
+	}
+
+	auto end = frg::min(first + raWindow, numPages);
+	if(first >= end) {
+		raStart = index + 1;
+		raEnd = index + 1;
+		raAsyncIndex = static_cast<size_t>(-1);
+		return;
+	}
+
+	// Pages are queued in order, such that _progressManagement() can fuse them
+	// (and the page that triggered the readahead) into a single request.
+	size_t numQueued = 0;
+	for(size_t i = first; i < end; ++i) {
+		auto [pit, wasInserted] = pages.find_or_insert(i, this, i);
+		assert(pit);
+		if(pit->loadState == kStateMissing) {
+			pit->loadState = kStateWantInitialization;
+			_initializationList.push_back(&pit->cachePage);
+			numQueued++;
+		}
+	}
+	pageCacheStatistics.readaheadPages.fetch_add(numQueued, std::memory_order_relaxed);
+
+	raStart = first;
+	raEnd = end;
+	raAsyncIndex = first;
+}
+
 void ManagedSpace::_progressMonitors(MonitorList &pending) {
 	// TODO: Accelerate this by storing the monitors in a RB tree ordered by their progress.
 	auto progressNode = [&] (MonitorNode *node) -> bool {
@@ -1102,9 +1461,12 @@ FrontalMemory::touchRange(uintptr_t offset, size_t, FetchFlags flags, WorkQueue
 	auto misalign = offset & (kPageSize - 1);
 	auto alignedOffset = offset & ~(kPageSize - 1);
 
+	auto &stats = getPageCacheStatistics();
+
 	ManageList pendingManagement;
 	MonitorList pendingMonitors;
 	MonitorNode fetchMonitor;
+	bool mustWait = true;
 	{
 		auto irq_lock = frg::guard(&irqMutex());
 		auto lock = frg::guard(&_managed->mutex);
@@ -1130,44 +1492,48 @@ FrontalMemory::touchRange(uintptr_t offset, size_t, FetchFlags flags, WorkQueue
 				globalReclaimer->addPage(&pit->cachePage);
 			}
 
-			co_return kPageSize - misalign;
+			stats.hits.fetch_add(1, std::memory_order_relaxed);
+			if(!_managed->readahead || index != _managed->raAsyncIndex)
+				co_return kPageSize - misalign;
+
+			// Issue the next readahead window but do not wait for it.
+			_managed->_doReadahead(index, false);
+			_managed->_progressManagement(pendingManagement);
+			mustWait = false;
 		}else{
 			assert(pit->loadState == ManagedSpace::kStateMissing
 					|| pit->loadState == ManagedSpace::kStateWantInitialization
 					|| pit->loadState == ManagedSpace::kStateInitialization);
 		}
 
-		if(flags & fetchDisallowBacking) {
-			urgentLogger() << "thor: Backing of page is disallowed" << frg::endlog;
-			co_return Error::fault;
-		}
-
-		// We have to take the slow-path, i.e., perform the fetch asynchronously.
-		if(pit->loadState == ManagedSpace::kStateMissing) {
-			pit->loadState = ManagedSpace::kStateWantInitialization;
-			_managed->_initializationList.push_back(&pit->cachePage);
-		}
+		if(mustWait) {
+			if(flags & fetchDisallowBacking) {
+				urgentLogger() << "thor: Backing of page is disallowed" << frg::endlog;
+				co_return Error::fault;
+			}
 
-		// Perform readahead.
-		if(_managed->readahead)
-			for(size_t i = 1; i < 4; ++i) {
-				if(!(index + i < _managed->numPages))
-					break;
-				auto [pit, wasInserted] = _managed->pages.find_or_insert(
-						index + i, _managed.get(), index + i);
-				assert(pit);
-				if(pit->loadState == ManagedSpace::kStateMissing) {
-					pit->loadState = ManagedSpace::kStateWantInitialization;
-					_managed->_initializationList.push_back(&pit->cachePage);
-				}
+			// We have to take the slow-path, i.e., perform the fetch asynchronously.
+			bool missing = pit->loadState == ManagedSpace::kStateMissing;
+			if(missing) {
+				pit->loadState = ManagedSpace::kStateWantInitialization;
+				_managed->_initializationList.push_back(&pit->cachePage);
+				stats.misses.fetch_add(1, std::memory_order_relaxed);
+			}else{
+				stats.pendingHits.fetch_add(1, std::memory_order_relaxed);
 			}
 
-		_managed->_progressManagement(pendingManagement);
+			// Perform readahead. Pages that are already in flight only
+			// trigger readahead if they carry the async marker.
+			if(_managed->readahead && (missing || index == _managed->raAsyncIndex))
+				_managed->_doReadahead(index, missing);
+
+			_managed->_progressManagement(pendingManagement);
 
-		fetchMonitor.setup(ManageRequest::initialize, alignedOffset, kPageSize);
-		fetchMonitor.progress = 0;
-		_managed->_monitorQueue.push_back(&fetchMonitor);
-		_managed->_progressMonitors(pendingMonitors);
+			fetchMonitor.setup(ManageRequest::initialize, alignedOffset, kPageSize);
+			fetchMonitor.progress = 0;
+			_managed->_monitorQueue.push_back(&fetchMonitor);
+			_managed->_progressMonitors(pendingMonitors);
+		}
 	}
 
 	while(!pendingManagement.empty()) {
@@ -1179,6 +1545,9 @@ FrontalMemory::touchRange(uintptr_t offset, size_t, FetchFlags flags, WorkQueue
 		node->event.raise();
 	}
 
+	if(!mustWait)
+		co_return kPageSize - misalign;
+
 	co_await fetchMonitor.event.wait();
 	assert(fetchMonitor.error() == Error::success);
 
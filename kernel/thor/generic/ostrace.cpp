@@ -1,8 +1,8 @@
 #include <bragi/helpers-all.hpp>
 #include <bragi/helpers-frigg.hpp>
 #include <frg/cmdline.hpp>
-#include <frg/small_vector.hpp>
 #include <frg/span.hpp>
+#include <frg/vector.hpp>
 #include <thor-internal/fiber.hpp>
 #include <thor-internal/kernel-io.hpp>
 #include <thor-internal/main.hpp>
@@ -26,11 +26,27 @@ initgraph::Stage *getOsTraceAvailableStage() {
 	return &s;
 }
 
+extern PerCpu<frg::manual_box<SingleProducerRecordRing>> osTraceCpuRings;
+THOR_DEFINE_PERCPU(osTraceCpuRings);
+
 namespace {
 
+// Size of the per-CPU rings. Each CPU writes its records into its own ring; a drain
+// fiber merges the records of all CPUs (ordered by timestamp) into the global ring
+// that is exposed to userspace.
+constexpr size_t cpuRingSize = 1 << 18;
+constexpr uint64_t drainInterval = 10'000'000;
+
 std::atomic<uint64_t> nextId{1};
 frg::manual_box<LogRingBuffer> globalOsTraceRing;
 
+// Prefix of each record in the per-CPU rings. The global ring only receives the
+// part after the timestamp (i.e., the header and the payload).
+struct CpuRecordPrefix {
+	uint64_t ts;
+	uint32_t size;
+} __attribute__((packed));
+
 initgraph::Task initOsTraceCore{&globalInitEngine, "generic.init-ostrace-core",
 	initgraph::Entails{getOsTraceAvailableStage()},
 	[] {
@@ -46,31 +62,50 @@ initgraph::Task initOsTraceCore{&globalInitEngine, "generic.init-ostrace-core",
 		void *osTraceMemory = kernelAlloc->allocate(1 << 20);
 		globalOsTraceRing.initialize(reinterpret_cast<uintptr_t>(osTraceMemory), 1 << 20);
 
+		for(size_t i = 0; i < getCpuCount(); i++) {
+			void *cpuMemory = kernelAlloc->allocate(cpuRingSize);
+			osTraceCpuRings.get(getCpuData(i)).initialize(reinterpret_cast<uintptr_t>(cpuMemory),
+					cpuRingSize);
+		}
+
 		osTraceInUse.store(true);
 
 		ostrace::setup();
 	}
 };
 
-void doEmit(frg::span<char> payload) {
-	if(!osTraceInUse.load(std::memory_order_relaxed))
-		return;
+// Returns true if a record with a payload of the given size fits into the per-CPU rings.
+bool recordFits(size_t size) {
+	return size <= SingleProducerRecordRing::maxRecordSize(cpuRingSize) - sizeof(CpuRecordPrefix);
+}
 
-	struct Header {
-		uint32_t size;
-	};
+char *doBeginRecord(size_t size, uint64_t ts) {
+	assert(!intsAreEnabled());
 
-	frg::small_vector<char, 64, KernelAlloc> buffer{*kernelAlloc};
-	buffer.resize(sizeof(Header) + payload.size());
+	// Drop records that can never fit into the ring.
+	if(!recordFits(size))
+		return nullptr;
 
-	auto hdr = new (buffer.data()) Header;
-	hdr->size = payload.size();
+	auto buffer = osTraceCpuRings.get()->reserve(sizeof(CpuRecordPrefix) + size);
+	if(!buffer)
+		return nullptr;
 
-	memcpy(buffer.data() + sizeof(Header), payload.data(), payload.size());
+	CpuRecordPrefix prefix{.ts = ts, .size = static_cast<uint32_t>(size)};
+	memcpy(buffer, &prefix, sizeof(CpuRecordPrefix));
+	return buffer + sizeof(CpuRecordPrefix);
+}
+
+void doEmit(frg::span<char> payload) {
+	if(!osTraceInUse.load(std::memory_order_relaxed))
+		return;
 
-	// We want to be able to call this function from any context, but we cannot wake the waiters
-	// in all contexts. For now, only wake waiters if IRQs are enabled.
-	globalOsTraceRing->enqueue(buffer.data(), buffer.size(), !intsAreEnabled());
+	auto irqLock = frg::guard(&irqMutex());
+
+	auto buffer = doBeginRecord(payload.size(), getClockNanos());
+	if(!buffer)
+		return;
+	memcpy(buffer, payload.data(), payload.size());
+	osTraceCpuRings.get()->commit();
 }
 
 template<typename R>
@@ -78,15 +113,61 @@ void commitOsTrace(R record) {
 	if(!osTraceInUse.load(std::memory_order_relaxed))
 		return;
 
+	auto irqLock = frg::guard(&irqMutex());
+
 	auto ts = record.size_of_tail();
-	frg::small_vector<char, 64, KernelAlloc> ser(*kernelAlloc);
-	ser.resize(8 + ts);
+	auto buffer = doBeginRecord(8 + ts, getClockNanos());
+	if(!buffer)
+		return;
 	bool encodeSuccess = bragi::write_head_tail(record,
-			frg::span<char>(ser.data(), 8),
-			frg::span<char>(ser.data() + 8, ts));
+			frg::span<char>(buffer, 8),
+			frg::span<char>(buffer + 8, ts));
 	assert(encodeSuccess);
+	osTraceCpuRings.get()->commit();
+}
 
-	doEmit({ser.data(), ser.size()});
+// Moves records from the per-CPU rings to the global ring, oldest first.
+void drainRings() {
+	auto numCpus = getCpuCount();
+
+	while(true) {
+		SingleProducerRecordRing *oldest = nullptr;
+		frg::span<const char> oldestRecord;
+		uint64_t oldestTs = 0;
+		for(size_t i = 0; i < numCpus; i++) {
+			auto ring = osTraceCpuRings.get(getCpuData(i)).get();
+			auto record = ring->front();
+			if(!record.size())
+				continue;
+
+			uint64_t ts;
+			memcpy(&ts, record.data(), sizeof(uint64_t));
+			if(!oldest || ts < oldestTs) {
+				oldest = ring;
+				oldestRecord = record;
+				oldestTs = ts;
+			}
+		}
+		if(!oldest)
+			break;
+
+		globalOsTraceRing->enqueue(oldestRecord.data() + sizeof(uint64_t),
+				oldestRecord.size() - sizeof(uint64_t));
+		oldest->pop();
+	}
+}
+
+// Reports records that were dropped since the last call.
+void reportDroppedRecords(frg::vector<uint64_t, KernelAlloc> &reported) {
+	for(size_t i = 0; i < reported.size(); i++) {
+		auto numDropped = osTraceCpuRings.get(getCpuData(i))->numDropped();
+		if(numDropped == reported[i])
+			continue;
+
+		ostrace::emit(ostEvtRecordsDropped, ostAttrCpu(i),
+				ostAttrNumDropped(numDropped - reported[i]));
+		reported[i] = numDropped;
+	}
 }
 
 } // anonymous namespace
@@ -171,8 +252,13 @@ private:
 
 			managarm::ostrace::Response<KernelAlloc> resp(*kernelAlloc);
 			if (wantOsTrace) {
-				doEmit({reinterpret_cast<char *>(dataBuffer.data()), dataBuffer.size()});
-				resp.set_error(managarm::ostrace::Error::SUCCESS);
+				// The buffer size is controlled by userspace; reject records that do not fit.
+				if(recordFits(dataBuffer.size())) {
+					doEmit({reinterpret_cast<char *>(dataBuffer.data()), dataBuffer.size()});
+					resp.set_error(managarm::ostrace::Error::SUCCESS);
+				}else{
+					resp.set_error(managarm::ostrace::Error::ILLEGAL_REQUEST);
+				}
 			}else{
 				resp.set_error(managarm::ostrace::Error::OSTRACE_GLOBALLY_DISABLED);
 			}
@@ -245,9 +331,19 @@ initgraph::Task initOsTraceMbus{&globalInitEngine, "generic.init-ostrace-sinks",
 			auto ostrace = frg::construct<OstraceBusObject>(*kernelAlloc);
 			spawnOnWorkQueue(*kernelAlloc, WorkQueue::generalQueue().lock(), ostrace->run());
 
-			// Only dump to an I/O channel if ostrace is supported (otherwise, the ring buffer
-			// does not even exist).
+			// Only drain the per-CPU rings and dump to an I/O channel if ostrace is supported
+			// (otherwise, the ring buffers do not even exist).
 			if(wantOsTrace) {
+				KernelFiber::run([] {
+					frg::vector<uint64_t, KernelAlloc> reported{*kernelAlloc};
+					reported.resize(getCpuCount(), 0);
+					while(true) {
+						reportDroppedRecords(reported);
+						drainRings();
+						KernelFiber::asyncBlockCurrent(generalTimerEngine()->sleepFor(drainInterval));
+					}
+				});
+
 				auto channel = solicitIoChannel("ostrace");
 				if(channel) {
 					infoLogger() << "thor: Connecting ostrace to I/O channel" << frg::endlog;
@@ -269,8 +365,6 @@ namespace ostrace {
 
 std::atomic<bool> available{false};
 
-THOR_DEFINE_PERCPU(context);
-
 void setup() {
 	auto setupTerm = [] (ostrace::Term &term) {
 		assert(!term.id_);
@@ -284,9 +378,26 @@ void setup() {
 
 	setupTerm(ostEvtArmPreemption);
 	setupTerm(ostEvtArmCpuTimer);
+	setupTerm(ostEvtRecordsDropped);
+	setupTerm(ostAttrCpu);
+	setupTerm(ostAttrNumDropped);
 	available.store(true, std::memory_order_relaxed);
 }
 
+uint64_t timestamp() {
+	return getClockNanos();
+}
+
+char *beginRecord(size_t size, uint64_t ts) {
+	if(!osTraceInUse.load(std::memory_order_relaxed))
+		return nullptr;
+	return doBeginRecord(size, ts);
+}
+
+void commitRecord() {
+	osTraceCpuRings.get()->commit();
+}
+
 void emitBuffer(frg::span<char> payload) {
 	doEmit(payload);
 }
@@ -299,5 +410,8 @@ void emitBuffer(frg::span<char> payload) {
 
 ostrace::Event ostEvtArmPreemption{"thor.arm-preemption"};
 ostrace::Event ostEvtArmCpuTimer{"thor.arm-cpu-timer"};
+ostrace::Event ostEvtRecordsDropped{"thor.ostrace-records-dropped"};
+ostrace::UintAttribute ostAttrCpu{"cpu"};
+ostrace::UintAttribute ostAttrNumDropped{"num-dropped"};
 
 } // namespace thor
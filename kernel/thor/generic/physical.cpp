@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <string.h>
 #include <thor-internal/arch-generic/paging.hpp>
 #include <thor-internal/cpu-data.hpp>
 #include <thor-internal/debug.hpp>
@@ -10,6 +11,9 @@ static bool logPhysicalAllocs = false;
 
 THOR_DEFINE_ELF_NOTE(memoryLayoutNote){elf_note_type::memoryLayout, {}};
 
+extern PerCpu<PhysicalPageCache> physicalPageCache;
+THOR_DEFINE_PERCPU(physicalPageCache);
+
 void poisonPhysicalAccess(PhysicalAddr physical) {
 	auto address = directPhysicalOffset() + physical;
 	KernelPageSpace::global().unmapSingle4k(address);
@@ -50,15 +54,35 @@ void PhysicalChunkAllocator::bootstrapRegion(PhysicalAddr address,
 	_freePages.store(currentFree + (numRoots << order), std::memory_order_relaxed);
 }
 
+void PhysicalChunkAllocator::enablePerCpuCaches() {
+	_cachesEnabled.store(true, std::memory_order_relaxed);
+}
+
+void PhysicalChunkAllocator::setLowWatermark(size_t pages, void (*handler)()) {
+	_lowWatermark.store(pages, std::memory_order_relaxed);
+	_lowMemoryHandler.store(handler, std::memory_order_relaxed);
+}
+
 PhysicalAddr PhysicalChunkAllocator::allocate(size_t size, int addressBits) {
 	auto irq_lock = frg::guard(&irqMutex());
-	auto lock = frg::guard(&_mutex);
 
-	auto currentFree = _freePages.load(std::memory_order_relaxed);
-	auto currentUsed = _usedPages.load(std::memory_order_relaxed);
-	assert(currentFree > size / kPageSize);
-	_freePages.store(currentFree - size / kPageSize, std::memory_order_relaxed);
-	_usedPages.store(currentUsed + size / kPageSize, std::memory_order_relaxed);
+	// Fast path: order-0 allocations without address restrictions are served
+	// from the per-CPU cache. Cached pages can come from any region.
+	if(size == kPageSize && addressBits == 64
+			&& _cachesEnabled.load(std::memory_order_relaxed)) {
+		auto cache = &physicalPageCache.get();
+		if(!cache->numPages) {
+			_refillCache(cache);
+			// Only check the watermark when we touch the global pool.
+			_checkWatermark();
+		}
+		if(cache->numPages) {
+			auto physical = cache->pages[--cache->numPages];
+			_cachedPages.fetch_sub(1, std::memory_order_relaxed);
+			return physical;
+		}
+		// Fall through to the buddy allocator (which will most likely fail, too).
+	}
 
 	// TODO: This could be solved better.
 	int target = 0;
@@ -66,6 +90,37 @@ PhysicalAddr PhysicalChunkAllocator::allocate(size_t size, int addressBits) {
 		target++;
 	assert(size == (size_t(kPageSize) << target));
 
+	PhysicalAddr physical;
+	{
+		auto lock = frg::guard(&_mutex);
+		physical = _allocateLocked(target, addressBits);
+	}
+	_checkWatermark();
+	return physical;
+}
+
+void PhysicalChunkAllocator::free(PhysicalAddr address, size_t size) {
+	auto irq_lock = frg::guard(&irqMutex());
+
+	if(size == kPageSize && _cachesEnabled.load(std::memory_order_relaxed)) {
+		auto cache = &physicalPageCache.get();
+		if(cache->numPages == PhysicalPageCache::kCapacity)
+			_drainCache(cache, PhysicalPageCache::kBatchSize);
+		assert(cache->numPages < PhysicalPageCache::kCapacity);
+		cache->pages[cache->numPages++] = address;
+		_cachedPages.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	int target = 0;
+	while(size > (size_t(kPageSize) << target))
+		target++;
+
+	auto lock = frg::guard(&_mutex);
+	_freeLocked(address, target);
+}
+
+PhysicalAddr PhysicalChunkAllocator::_allocateLocked(int target, int addressBits) {
 	if(logPhysicalAllocs)
 		infoLogger() << "thor: Allocating physical memory of order "
 					<< (target + kPageShift) << frg::endlog;
@@ -78,20 +133,20 @@ PhysicalAddr PhysicalChunkAllocator::allocate(size_t size, int addressBits) {
 			continue;
 	//	infoLogger() << "Allocate " << (void *)physical << frg::endlog;
 		assert(!(physical % (size_t(kPageSize) << target)));
+
+		auto currentFree = _freePages.load(std::memory_order_relaxed);
+		auto currentUsed = _usedPages.load(std::memory_order_relaxed);
+		assert(currentFree >= (size_t(1) << target));
+		_freePages.store(currentFree - (size_t(1) << target), std::memory_order_relaxed);
+		_usedPages.store(currentUsed + (size_t(1) << target), std::memory_order_relaxed);
 		return physical;
 	}
 
 	return static_cast<PhysicalAddr>(-1);
 }
 
-void PhysicalChunkAllocator::free(PhysicalAddr address, size_t size) {
-	auto irq_lock = frg::guard(&irqMutex());
-	auto lock = frg::guard(&_mutex);
-	
-	int target = 0;
-	while(size > (size_t(kPageSize) << target))
-		target++;
-
+void PhysicalChunkAllocator::_freeLocked(PhysicalAddr address, int target) {
+	size_t size = size_t(kPageSize) << target;
 	for(int i = 0; i < _numRegions; i++) {
 		if(address < _allRegions[i].physicalBase)
 			continue;
@@ -101,15 +156,50 @@ void PhysicalChunkAllocator::free(PhysicalAddr address, size_t size) {
 		_allRegions[i].buddyAccessor.free(address, target);
 		auto currentFree = _freePages.load(std::memory_order_relaxed);
 		auto currentUsed = _usedPages.load(std::memory_order_relaxed);
-		assert(currentUsed > size / kPageSize);
-		_freePages.store(currentFree + size / kPageSize, std::memory_order_relaxed);
-		_usedPages.store(currentUsed - size / kPageSize, std::memory_order_relaxed);
+		assert(currentUsed >= (size_t(1) << target));
+		_freePages.store(currentFree + (size_t(1) << target), std::memory_order_relaxed);
+		_usedPages.store(currentUsed - (size_t(1) << target), std::memory_order_relaxed);
 		return;
 	}
 
 	assert(!"Physical page is not part of any region");
 }
 
+// Moves up to kBatchSize pages from the buddy allocator into the cache.
+void PhysicalChunkAllocator::_refillCache(PhysicalPageCache *cache) {
+	auto lock = frg::guard(&_mutex);
+
+	size_t n = 0;
+	while(n < PhysicalPageCache::kBatchSize
+			&& cache->numPages < PhysicalPageCache::kCapacity) {
+		auto physical = _allocateLocked(0, 64);
+		if(physical == static_cast<PhysicalAddr>(-1))
+			break;
+		cache->pages[cache->numPages++] = physical;
+		n++;
+	}
+
+	_cachedPages.fetch_add(n, std::memory_order_relaxed);
+	_cacheRefills.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Returns the n least recently freed pages of the cache to the buddy allocator.
+// The most recently freed pages stay in the cache since they are likely still cache-hot.
+void PhysicalChunkAllocator::_drainCache(PhysicalPageCache *cache, size_t n) {
+	assert(n <= cache->numPages);
+	{
+		auto lock = frg::guard(&_mutex);
+		for(size_t i = 0; i < n; i++)
+			_freeLocked(cache->pages[i], 0);
+	}
+
+	memmove(cache->pages, cache->pages + n, (cache->numPages - n) * sizeof(PhysicalAddr));
+	cache->numPages -= n;
+
+	_cachedPages.fetch_sub(n, std::memory_order_relaxed);
+	_cacheDrains.fetch_add(1, std::memory_order_relaxed);
+}
+
 PhysicalWindow::PhysicalWindow(PhysicalAddr physical, size_t size, CachingMode caching)
 : size_{size} {
 	uintptr_t lowAddr = physical & ~(kPageSize - 1);
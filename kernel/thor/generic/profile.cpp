@@ -2,6 +2,7 @@
 #include <thor-internal/arch/pmc-amd.hpp>
 #include <thor-internal/arch/pmc-intel.hpp>
 #endif
+#include <frg/cmdline.hpp>
 #include <thor-internal/fiber.hpp>
 #include <thor-internal/kernel-io.hpp>
 #include <thor-internal/main.hpp>
@@ -11,8 +12,14 @@
 namespace thor {
 
 bool wantKernelProfile = false;
+bool wantProfileUserStacks = false;
 
 namespace {
+	// Sampling frequency in Hz.
+	// Can be changed via the thor.profile_frequency command line option.
+	constexpr uint64_t defaultProfileFrequency = 1000;
+	uint64_t profileFrequency = defaultProfileFrequency;
+
 	frg::manual_box<LogRingBuffer> globalProfileRing;
 
 	initgraph::Task initProfilingSinks{&globalInitEngine, "generic.init-profiling-sinks",
@@ -32,50 +39,78 @@ namespace {
 	};
 }
 
+uint64_t getProfilePeriod() {
+	return 1'000'000'000 / profileFrequency;
+}
+
 void initializeProfile() {
 #ifdef __x86_64__
 	if(!wantKernelProfile)
 		return;
 
-	if(!(getGlobalCpuFeatures()->profileFlags & CpuFeatures::profileIntelSupported)
-			&& !(getGlobalCpuFeatures()->profileFlags & CpuFeatures::profileAmdSupported)) {
-		urgentLogger() << "thor: Kernel profiling was requested but"
-				" no hardware support is available" << frg::endlog;
-		return;
+	// Use the timer-based fallback even if PMCs are available.
+	bool forceTimerProfile = false;
+
+	frg::array args = {
+		frg::option{"thor.profile_frequency", frg::as_number(profileFrequency)},
+		frg::option{"thor.profile_user_stacks", frg::store_true(wantProfileUserStacks)},
+		frg::option{"thor.profile_timer", frg::store_true(forceTimerProfile)},
+	};
+	frg::parse_arguments(getKernelCmdline(), args);
+
+	if(!profileFrequency || profileFrequency > 1'000'000)
+		profileFrequency = defaultProfileFrequency;
+	infoLogger() << "thor: Profiling at " << profileFrequency << " Hz"
+			<< (wantProfileUserStacks ? " (with user stacks)" : "") << frg::endlog;
+
+	bool haveIntelPmc = getGlobalCpuFeatures()->profileFlags & CpuFeatures::profileIntelSupported;
+	bool haveAmdPmc = getGlobalCpuFeatures()->profileFlags & CpuFeatures::profileAmdSupported;
+	if(forceTimerProfile) {
+		haveIntelPmc = false;
+		haveAmdPmc = false;
 	}
+	if(!haveIntelPmc && !haveAmdPmc)
+		infoLogger() << "thor: No PMC support for profiling,"
+				" falling back to timer-based sampling" << frg::endlog;
 
 	void *profileMemory = kernelAlloc->allocate(1 << 20);
 	globalProfileRing.initialize(reinterpret_cast<uintptr_t>(profileMemory), 1 << 20);
 
 	// Dump the per-CPU profiling data to the global ring buffer.
-	auto fiberMain = [] {
+	auto fiberMain = [=] {
 		infoLogger() << "thor: Profiling on CPU " << getCpuData()->cpuIndex << frg::endlog;
 		getCpuData()->localProfileRing = frg::construct<SingleContextRecordRing>(*kernelAlloc);
 
-		if(getGlobalCpuFeatures()->profileFlags & CpuFeatures::profileIntelSupported) {
+		if(haveIntelPmc) {
 			initializeIntelPmc();
 			getCpuData()->profileMechanism.store(ProfileMechanism::intelPmc,
 					std::memory_order_release);
 			setIntelPmc();
-		}else{
-			assert(getGlobalCpuFeatures()->profileFlags & CpuFeatures::profileAmdSupported);
+		}else if(haveAmdPmc) {
+			initializeAmdPmc();
 			getCpuData()->profileMechanism.store(ProfileMechanism::amdPmc,
 					std::memory_order_release);
 			setAmdPmc();
+		}else{
+			// Timer-based samples cannot observe code that runs with IRQs disabled.
+			StatelessIrqLock irqLock;
+			getCpuData()->profileMechanism.store(ProfileMechanism::timer,
+					std::memory_order_release);
+			setProfileDeadline(getClockNanos() + getProfilePeriod());
 		}
 
 		uint64_t deqPtr = 0;
 		while(true) {
-			char buffer[128];
+			char buffer[maxProfileSampleSize];
 			auto [success, recordPtr, newPtr, size] = getCpuData()->localProfileRing->dequeueAt(
-					deqPtr, buffer, 128);
+					deqPtr, buffer, maxProfileSampleSize);
 			deqPtr = newPtr;
 			if(!success) {
 				KernelFiber::asyncBlockCurrent(generalTimerEngine()->sleepFor(1'000'000));
 				continue;
 			}
 			assert(size);
-			assert(size <= 128);
+			assert(size <= maxProfileSampleSize);
 
 			globalProfileRing->enqueue(buffer, size);
 		}
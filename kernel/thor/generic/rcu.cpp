@@ -0,0 +1,137 @@
+#include <async/recurring-event.hpp>
+#include <frg/manual_box.hpp>
+#include <frg/spinlock.hpp>
+#include <thor-internal/coroutine.hpp>
+#include <thor-internal/fiber.hpp>
+#include <thor-internal/main.hpp>
+#include <thor-internal/rcu.hpp>
+#include <thor-internal/work-queue.hpp>
+
+namespace thor {
+
+THOR_DEFINE_PERCPU(rcuCpuState);
+
+void rcuSynchronize() {
+	assert(!rcuCpuState.get().nesting);
+
+	// Order the unpublishing stores of the caller before the loads of the sequences.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	for(size_t i = 0; i < getCpuCount(); ++i) {
+		auto state = &rcuCpuState.getFor(i);
+		auto seq = state->sequence.load(std::memory_order_acquire);
+		if(!(seq & 1))
+			continue;
+		// The critical section ends once the sequence changes.
+		while(state->sequence.load(std::memory_order_acquire) == seq)
+			;
+	}
+}
+
+void RcuCallback::setup(void (*run)(RcuCallback *)) {
+	_run = run;
+}
+
+// Collects callbacks and runs them in batches (one grace period per batch) on a fiber.
+struct RcuReclaimer {
+	void post(RcuCallback *callback) {
+		bool wasEmpty;
+		{
+			auto irqLock = frg::guard(&irqMutex());
+			auto lock = frg::guard(&_mutex);
+
+			wasEmpty = _pending.empty();
+			_pending.push_back(callback);
+		}
+		if(wasEmpty)
+			_wakeWork.invoke();
+	}
+
+	void runReclaimFiber() {
+		KernelFiber::run([this] {
+			while(true) {
+				frg::intrusive_list<
+					RcuCallback,
+					frg::locate_member<
+						RcuCallback,
+						frg::default_list_hook<RcuCallback>,
+						&RcuCallback::_hook
+					>
+				> batch;
+				{
+					auto irqLock = frg::guard(&irqMutex());
+					auto lock = frg::guard(&_mutex);
+
+					while(!_pending.empty())
+						batch.push_back(_pending.pop_front());
+				}
+
+				if(batch.empty()) {
+					KernelFiber::asyncBlockCurrent(_waitForPending());
+					continue;
+				}
+
+				// We do not hold any locks here, so spinning cannot deadlock with readers.
+				rcuSynchronize();
+
+				while(!batch.empty()) {
+					auto callback = batch.pop_front();
+					callback->_run(callback);
+				}
+			}
+		});
+	}
+
+private:
+	struct WakeWork {
+		void setUp() { }
+
+		void execute() {
+			self->_wakeEvent.raise();
+		}
+
+		RcuReclaimer *self;
+	};
+
+	coroutine<void> _waitForPending() {
+		co_await _wakeEvent.async_wait_if([this] () -> bool {
+			auto irqLock = frg::guard(&irqMutex());
+			auto lock = frg::guard(&_mutex);
+
+			return _pending.empty();
+		});
+	}
+
+	frg::ticket_spinlock _mutex;
+
+	frg::intrusive_list<
+		RcuCallback,
+		frg::locate_member<
+			RcuCallback,
+			frg::default_list_hook<RcuCallback>,
+			&RcuCallback::_hook
+		>
+	> _pending;
+
+	async::recurring_event _wakeEvent;
+	DeferredWork<WakeWork> _wakeWork{{this}};
+};
+
+namespace {
+	frg::manual_box<RcuReclaimer> globalRcuReclaimer;
+
+	initgraph::Task initRcuReclaimer{&globalInitEngine, "generic.init-rcu-reclaimer",
+		initgraph::Requires{getFibersAvailableStage()},
+		initgraph::Entails{getTaskingAvailableStage()},
+		[] {
+			globalRcuReclaimer.initialize();
+			globalRcuReclaimer->runReclaimFiber();
+		}
+	};
+}
+
+void rcuCall(RcuCallback *callback) {
+	globalRcuReclaimer->post(callback);
+}
+
+} // namespace thor
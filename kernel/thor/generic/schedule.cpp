@@ -1,9 +1,11 @@
 #include <assert.h>
 
+#include <thor-internal/arch-generic/asid.hpp>
 #include <thor-internal/arch-generic/cpu.hpp>
 #include <thor-internal/arch-generic/ints.hpp>
 #include <thor-internal/cpu-data.hpp>
 #include <thor-internal/debug.hpp>
+#include <thor-internal/load-balancing.hpp>
 #include <thor-internal/ostrace.hpp>
 #include <thor-internal/schedule.hpp>
 #include <thor-internal/thread.hpp>
@@ -27,9 +29,13 @@ namespace {
 		: ScheduleEntity{ScheduleType::idle} { }
 
 		[[noreturn]] void invoke() override {
+			enterLazyTlb();
 			runOnStack([] (Continuation) {
 				if(logIdle)
 					infoLogger() << "System is idle" << frg::endlog;
+				// Try to pull threads from busy CPUs. Note that pulled threads
+				// only migrate the next time that they run on their current CPU.
+				LoadBalancer::singleton().balanceOnIdle();
 				suspendSelf();
 				__builtin_trap();
 			}, getCpuData()->idleStack.base());
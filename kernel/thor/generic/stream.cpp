@@ -22,6 +22,8 @@ struct ImbueExtract { };
 struct SendRecvInline { };
 struct SendRecvBuffer { };
 struct PushPull { };
+struct SendRecvPages { };
+struct SendInlineRecvPages { };
 
 static void transfer(OfferAccept, StreamNode *offer, StreamNode *accept) {
 	offer->_error = Error::success;
@@ -73,6 +75,45 @@ static void transfer(PushPull, StreamNode *push, StreamNode *pull) {
 	pull->complete();
 }
 
+// The receiver (which uses the flow protocol) copies the data from the sender's memory
+// and completes both nodes.
+static void transfer(SendRecvPages, StreamNode *from, StreamNode *to) {
+	if(from->_maxLength <= to->_maxLength) {
+		to->_actualLength = from->_maxLength;
+
+		from->_error = Error::success;
+		to->_error = Error::success;
+		to->peerNode = from;
+		to->issueFlow.raise();
+	}else{
+		from->_error = Error::bufferTooSmall;
+		from->complete();
+
+		to->_error = Error::bufferTooSmall;
+		to->issueFlow.raise();
+	}
+}
+
+// Small page transfers are sent inline; the receiver copies them to fresh memory.
+static void transfer(SendInlineRecvPages, StreamNode *from, StreamNode *to) {
+	if(from->_inBuffer.size() <= to->_maxLength) {
+		to->_actualLength = from->_inBuffer.size();
+		to->_transmitBuffer = std::move(from->_inBuffer);
+
+		from->_error = Error::success;
+		from->complete();
+
+		to->_error = Error::success;
+		to->issueFlow.raise();
+	}else{
+		from->_error = Error::bufferTooSmall;
+		from->complete();
+
+		to->_error = Error::bufferTooSmall;
+		to->issueFlow.raise();
+	}
+}
+
 void Stream::Submitter::enqueue(const LaneHandle &lane, StreamList &chain) {
 	while(!chain.empty()) {
 		auto node = chain.pop_front();
@@ -168,6 +209,10 @@ void Stream::Submitter::run() {
 			transfer(ImbueExtract{}, u, v);
 		}else if(u->tag() == kTagSendKernelBuffer && v->tag() == kTagRecvKernelBuffer) {
 			transfer(SendRecvInline{}, u, v);
+		}else if(u->tag() == kTagSendPages && v->tag() == kTagRecvPages) {
+			transfer(SendRecvPages{}, u, v);
+		}else if(u->tag() == kTagSendKernelBuffer && v->tag() == kTagRecvPages) {
+			transfer(SendInlineRecvPages{}, u, v);
 		}else if(u->tag() == kTagSendFlow && v->tag() == kTagRecvKernelBuffer) {
 			if(u->_inBuffer.size() > v->_maxLength) {
 				// Both nodes complete with bufferTooSmall.
@@ -60,6 +60,18 @@ frg::expected<Error> mapPresentPagesByCursor(PageSpace *ps, VirtualAddr va,
 	Cursor c{ps, va};
 	while(c.virtualAddress() < va + size) {
 		auto progress = c.virtualAddress() - va;
+		if(progress + kLargePageSize <= size && c.canMapLarge()) {
+			if constexpr (Cursor::supportsLargePages) {
+				auto largeRange = view->peekLargeRange(offset + progress);
+				if(largeRange.template get<0>() != PhysicalAddr(-1)) {
+					c.mapLarge(largeRange.template get<0>(), flags,
+						determineCachingMode(largeRange.template get<1>(), mode));
+					c.advanceLarge();
+					continue;
+				}
+			}
+		}
+
 		auto physicalRange = view->peekRange(offset + progress);
 		if(physicalRange.template get<0>() == PhysicalAddr(-1)) {
 			c.advance4k();
@@ -85,6 +97,30 @@ frg::expected<Error> remapPresentPagesByCursor(PageSpace *ps, VirtualAddr va,
 	while(c.virtualAddress() < va + size) {
 		auto progress = c.virtualAddress() - va;
 
+		// Keep (or create) large pages if the whole large page is affected.
+		// Otherwise, the 4k functions below split the large page.
+		if(!(c.virtualAddress() & (kLargePageSize - 1)) && progress + kLargePageSize <= size
+				&& (c.isLarge() || c.canMapLarge())) {
+			if constexpr (Cursor::supportsLargePages) {
+				auto largeRange = view->peekLargeRange(offset + progress);
+				if(largeRange.template get<0>() != PhysicalAddr(-1)) {
+					PageStatus status = 0;
+					if(c.isLarge()) {
+						status = c.remapLarge(largeRange.template get<0>(), flags,
+							determineCachingMode(largeRange.template get<1>(), mode));
+					}else{
+						c.mapLarge(largeRange.template get<0>(), flags,
+							determineCachingMode(largeRange.template get<1>(), mode));
+					}
+					c.advanceLarge();
+
+					if((status & page_status::present) && (status & page_status::dirty))
+						view->markDirty(offset + progress, kLargePageSize);
+					continue;
+				}
+			}
+		}
+
 		auto physicalRange = view->peekRange(offset + progress);
 		if(physicalRange.template get<0>() == PhysicalAddr(-1)) {
 			auto [status, _] = c.unmap4k();
@@ -130,6 +166,75 @@ frg::expected<Error> faultPageByCursor(PageSpace *ps, VirtualAddr va,
 	return {};
 }
 
+// Maps the large page at va (which needs to be aligned) if the view is backed by
+// a suitable large page. Returns Error::fault if that is not possible;
+// in that case, callers should fall back to faultPageByCursor().
+template<typename Cursor, typename PageSpace>
+frg::expected<Error> faultLargePageByCursor(PageSpace *ps, VirtualAddr va,
+		MemoryView *view, uintptr_t offset, PageFlags flags, CachingMode mode) {
+	assert(!(va & (kLargePageSize - 1)));
+	assert(!(offset & (kLargePageSize - 1)));
+
+	if constexpr (Cursor::supportsLargePages) {
+		Cursor c{ps, va};
+		if(!c.isLarge() && !c.canMapLarge())
+			return Error::fault;
+
+		auto physicalRange = view->peekLargeRange(offset);
+		if(physicalRange.template get<0>() == PhysicalAddr(-1))
+			return Error::fault;
+
+		if(c.isLarge()) {
+			auto status = c.remapLarge(physicalRange.template get<0>(), flags,
+				determineCachingMode(physicalRange.template get<1>(), mode));
+			if(status & page_status::present) {
+				if(status & page_status::dirty)
+					view->markDirty(offset, kLargePageSize);
+			}
+		}else{
+			c.mapLarge(physicalRange.template get<0>(), flags,
+				determineCachingMode(physicalRange.template get<1>(), mode));
+		}
+		return {};
+	}else{
+		return Error::fault;
+	}
+}
+
+template<typename Cursor, typename PageSpace>
+frg::expected<Error> faultAroundPagesByCursor(PageSpace *ps, VirtualAddr va,
+		MemoryView *view, uintptr_t offset, size_t size, PageFlags flags, CachingMode mode) {
+	assert(!(va & (kPageSize - 1)));
+	assert(!(offset & (kPageSize - 1)));
+	assert(!(size & (kPageSize - 1)));
+
+	Cursor c{ps, va};
+	while(c.virtualAddress() < va + size) {
+		auto current = c.virtualAddress();
+
+		// Skip pages that are already mapped. findPresent() advances the cursor
+		// past the page if nothing is mapped; move back in that case.
+		if(c.findPresent(current + kPageSize)) {
+			if(c.isLarge()) {
+				c.advanceLarge();
+			}else{
+				c.advance4k();
+			}
+			continue;
+		}
+		c.moveTo(current);
+
+		auto physicalRange = view->peekRange(offset + (current - va));
+		if(physicalRange.template get<0>() != PhysicalAddr(-1)) {
+			assert(!(physicalRange.template get<0>() & (kPageSize - 1)));
+			c.map4k(physicalRange.template get<0>(), flags,
+				determineCachingMode(physicalRange.template get<1>(), mode));
+		}
+		c.advance4k();
+	}
+	return {};
+}
+
 template<typename Cursor, typename PageSpace>
 frg::expected<Error> cleanPagesByCursor(PageSpace *ps, VirtualAddr va,
 		MemoryView *view, uintptr_t offset, size_t size) {
@@ -141,6 +246,19 @@ frg::expected<Error> cleanPagesByCursor(PageSpace *ps, VirtualAddr va,
 	while(c.findDirty(va + size)) {
 		auto progress = c.virtualAddress() - va;
 
+		if constexpr (Cursor::supportsLargePages) {
+			if(c.isLarge() && !(c.virtualAddress() & (kLargePageSize - 1))
+					&& progress + kLargePageSize <= size) {
+				auto status = c.cleanLarge();
+				assert(status & page_status::present);
+				assert(status & page_status::dirty);
+				view->markDirty(offset + progress, kLargePageSize);
+
+				c.advanceLarge();
+				continue;
+			}
+		}
+
 		auto status = c.clean4k();
 		assert(status & page_status::present);
 		assert(status & page_status::dirty);
@@ -162,6 +280,19 @@ frg::expected<Error> unmapPagesByCursor(PageSpace *ps, VirtualAddr va,
 	while(c.findPresent(va + size)) {
 		auto progress = c.virtualAddress() - va;
 
+		if constexpr (Cursor::supportsLargePages) {
+			if(c.isLarge() && !(c.virtualAddress() & (kLargePageSize - 1))
+					&& progress + kLargePageSize <= size) {
+				auto [status, _] = c.unmapLarge();
+				assert(status & page_status::present);
+				if(status & page_status::dirty)
+					view->markDirty(offset + progress, kLargePageSize);
+
+				c.advanceLarge();
+				continue;
+			}
+		}
+
 		auto [status, _] = c.unmap4k();
 		assert(status & page_status::present);
 		if(status & page_status::dirty)
@@ -216,6 +347,17 @@ struct VirtualOperations {
 	virtual frg::expected<Error> faultPage(VirtualAddr va, MemoryView *view,
 			uintptr_t offset, PageFlags flags, CachingMode mode);
 
+	// Like faultPage() but maps a whole large page. va and offset must be aligned
+	// to kLargePageSize. Returns Error::fault if no large page can be mapped.
+	virtual frg::expected<Error> faultLargePage(VirtualAddr va, MemoryView *view,
+			uintptr_t offset, PageFlags flags, CachingMode mode);
+
+	// Maps all pages of the view that are already present (i.e., that can be mapped without
+	// calling touchRange()) but only if there is no page mapped at the corresponding address.
+	// Used to map the neighbours of a faulting page without taking additional faults.
+	virtual frg::expected<Error> faultAroundPages(VirtualAddr va, MemoryView *view,
+			uintptr_t offset, size_t size, PageFlags flags, CachingMode mode);
+
 	virtual frg::expected<Error> cleanPages(VirtualAddr va, MemoryView *view,
 			uintptr_t offset, size_t size);
 
@@ -509,6 +651,12 @@ public:
 	coroutine<frg::expected<Error, PhysicalAddr>>
 	retrievePhysical(VirtualAddr address, WorkQueue *wq);
 
+	// Returns the MemoryView (and the offset into it) that backs [address, address + length),
+	// together with whether the mapping is writable.
+	// The range must be covered by a single readable mapping.
+	frg::expected<Error, frg::tuple<smarter::shared_ptr<MemoryView>, uintptr_t, bool>>
+	resolveView(VirtualAddr address, size_t length);
+
 	size_t rss() {
 		return _ops->getRss();
 	}
@@ -614,7 +762,8 @@ public:
 
 private:
 	// Allocates a new mapping of the given length somewhere in the address space.
-	frg::expected<Error, VirtualAddr> _allocate(size_t length, MapFlags flags);
+	frg::expected<Error, VirtualAddr> _allocate(size_t length, MapFlags flags,
+			size_t align = kPageSize);
 
 	frg::expected<Error, VirtualAddr> _allocateAt(VirtualAddr address, size_t length);
 
@@ -634,6 +783,10 @@ private:
 	// Returns whether shootdown needs to be performed (any of the mappings got unmapped).
 	coroutine<bool> _unmapMappings(VirtualAddr address, size_t length, Mapping *start, Mapping *end);
 
+	// Touches the memory behind a (new) mapping and maps all of its pages (for kMapPopulate).
+	// Takes _consistencyMutex in shared mode.
+	coroutine<void> _populateMapping(smarter::shared_ptr<Mapping> mapping, WorkQueue *wq);
+
 	VirtualOperations *_ops;
 
 	// Since changing memory mappings requires TLB shootdown, most mapping-related operations
@@ -687,6 +840,18 @@ struct AddressSpace final : VirtualSpace, smarter::crtp_counter<AddressSpace, Bi
 					va, view, offset, flags, mode);
 		}
 
+		frg::expected<Error> faultLargePage(VirtualAddr va, MemoryView *view,
+				uintptr_t offset, PageFlags flags, CachingMode mode) override {
+			return faultLargePageByCursor<ClientPageSpace::Cursor>(&space_->pageSpace_,
+					va, view, offset, flags, mode);
+		}
+
+		frg::expected<Error> faultAroundPages(VirtualAddr va, MemoryView *view,
+				uintptr_t offset, size_t size, PageFlags flags, CachingMode mode) override {
+			return faultAroundPagesByCursor<ClientPageSpace::Cursor>(&space_->pageSpace_,
+					va, view, offset, size, flags, mode);
+		}
+
 		frg::expected<Error> cleanPages(VirtualAddr va, MemoryView *view,
 				uintptr_t offset, size_t size) override {
 			return cleanPagesByCursor<ClientPageSpace::Cursor>(&space_->pageSpace_,
@@ -727,8 +892,6 @@ public:
 
 	void dispose(BindableHandle);
 
-	FutexRealm localFutexRealm;
-
 	bool updatePageAccess(VirtualAddr address, PageFlags flags) {
 		return pageSpace_.updatePageAccess(address, flags);
 	}
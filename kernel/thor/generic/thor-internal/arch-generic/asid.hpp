@@ -84,12 +84,20 @@ inline constexpr int globalBindingId = -1;
 struct PageSpace;
 
 struct PageBinding {
+	friend struct PageSpace;
+
 	friend void swap(PageBinding &a, PageBinding &b) {
 		using std::swap;
 		swap(a.id_, b.id_);
 		swap(a.boundSpace_, b.boundSpace_);
 		swap(a.primaryStamp_, b.primaryStamp_);
 		swap(a.alreadyShotSequence_, b.alreadyShotSequence_);
+		swap(a.stale_, b.stale_);
+
+		auto rawSpace = a.rawBoundSpace_.load(std::memory_order_relaxed);
+		a.rawBoundSpace_.store(b.rawBoundSpace_.load(std::memory_order_relaxed),
+				std::memory_order_relaxed);
+		b.rawBoundSpace_.store(rawSpace, std::memory_order_relaxed);
 	}
 
 	PageBinding() = default;
@@ -146,9 +154,23 @@ struct PageBinding {
 	// space.
 	void shootdown();
 
+	// Flush the ASID if shootdowns were skipped while this CPU was in lazy TLB mode.
+	void flushIfStale();
+
 private:
+	enum class CompleteMode {
+		// Invalidate the TLB entries of all pending requests.
+		shootdown,
+		// Do not invalidate anything since the ASID was already flushed;
+		// also drop this binding from the space.
+		unbind,
+		// Do not invalidate anything but mark the binding as stale. Used by remote CPUs
+		// to complete requests on behalf of a CPU that is in lazy TLB mode.
+		lazy
+	};
+
 	ShootNodeList completeShootdown_(PageSpace *space, uint64_t afterSequence,
-			bool doShootdown);
+			CompleteMode mode, CpuData *cpu);
 
 	int id_ = 0;
 
@@ -160,6 +182,14 @@ private:
 	uint64_t primaryStamp_ = 0;
 
 	uint64_t alreadyShotSequence_ = 0;
+
+	// Raw pointer to boundSpace_ that remote CPUs can inspect. Only changes while
+	// holding the mutex of the space that is bound (or about to be bound).
+	std::atomic<PageSpace *> rawBoundSpace_ = nullptr;
+
+	// Shootdowns were completed on behalf of this binding while its CPU was lazy.
+	// Protected by the mutex of the bound space.
+	bool stale_ = false;
 };
 
 
@@ -168,6 +198,7 @@ struct PageSpace {
 
 	// Switch to the given page space on this CPU. Picks the least
 	// recently used binding to use for the switch.
+	// This also makes the CPU leave lazy TLB mode.
 	static void activate(smarter::shared_ptr<PageSpace> space);
 
 	PageSpace(PhysicalAddr rootTable);
@@ -221,6 +252,58 @@ struct AsidCpuData {
 	frg::vector<PageBinding, KernelAlloc> bindings;
 };
 
+enum class TlbState {
+	// The CPU has not activated any user page space yet.
+	offline,
+	// The CPU runs threads and must be interrupted by shootdowns.
+	active,
+	// The CPU runs kernel fibers or idles and does not access user memory.
+	// Shootdowns of user page spaces are completed on its behalf (without an IPI)
+	// and the affected bindings are flushed once the CPU becomes active again.
+	lazy
+};
+
+// Unlike AsidCpuData, this is initialized for all CPUs (even before they boot).
+struct TlbCpuData {
+	frg::ticket_spinlock mutex;
+	TlbState state = TlbState::offline;
+
+	// Set when a shootdown IPI was sent to this CPU but not handled yet.
+	// Further shootdowns do not need to send another IPI.
+	std::atomic<bool> ipiPending = false;
+
+	// Statistics.
+	std::atomic<uint64_t> numRequests = 0;
+	std::atomic<uint64_t> numIpisSent = 0;
+	std::atomic<uint64_t> numIpisCoalesced = 0;
+	std::atomic<uint64_t> numIpisSkipped = 0;
+	std::atomic<uint64_t> numIpisReceived = 0;
+	std::atomic<uint64_t> numBroadcasts = 0;
+	std::atomic<uint64_t> numPageFlushes = 0;
+	std::atomic<uint64_t> numAsidFlushes = 0;
+	std::atomic<uint64_t> numLazyFlushes = 0;
+};
+
+struct ShootdownStatistics {
+	// Shootdown requests that had to wait for other CPUs.
+	uint64_t requests;
+	// Unicast IPIs that were sent, and IPIs that were avoided because
+	// an IPI was already pending or because the target CPU was lazy.
+	uint64_t ipisSent;
+	uint64_t ipisCoalesced;
+	uint64_t ipisSkipped;
+	uint64_t ipisReceived;
+	// IPIs that were sent to all CPUs (for the kernel page space and for retirement).
+	uint64_t broadcasts;
+	// Single page invalidations and whole ASID invalidations.
+	uint64_t pageFlushes;
+	uint64_t asidFlushes;
+	// ASID invalidations caused by stale bindings when leaving lazy TLB mode.
+	uint64_t lazyFlushes;
+};
+
+ShootdownStatistics getShootdownStatistics();
+
 
 template<typename R>
 struct ShootdownOperation;
@@ -297,6 +380,14 @@ void invalidatePage(int asid, const void *address);
 struct CpuData;
 
 extern PerCpu<frg::manual_box<AsidCpuData>> asidData;
+extern PerCpu<TlbCpuData> tlbData;
+
+// Enter lazy TLB mode on this CPU. Called before running kernel fibers or idling.
+void enterLazyTlb();
+
+// Process all shootdown requests that target this CPU.
+// Called by the architecture's shootdown IPI handler.
+void handleShootdownIpi();
 
 // Initialize the ASID context on the given CPU.
 void initializeAsidContext(CpuData *cpuData);
@@ -46,10 +46,25 @@ concept CursorPolicy = requires (uint64_t pte, uint64_t *ptePtr,
 	{ T::pteNewTable() } -> std::same_as<uint64_t>;
 };
 
+// Policies that additionally support large pages (i.e., leaf PTEs in the second-to-last level).
+template <typename T>
+concept LargePageCursorPolicy = CursorPolicy<T> && requires (uint64_t pte,
+		PhysicalAddr pa, PageFlags flags, CachingMode cachingMode) {
+	// Check whether the given (second-to-last level) PTE maps a present large page.
+	{ T::ptePageLarge(pte) } -> std::same_as<bool>;
+	// Construct a new large page PTE from the given parameters.
+	{ T::pteBuildLarge(pa, flags, cachingMode) } -> std::same_as<uint64_t>;
+	// Convert a large page PTE into the PTE of the first small page that it covers.
+	{ T::pteLargeToSmall(pte) } -> std::same_as<uint64_t>;
+};
+
 template <CursorPolicy Policy>
 struct PageCursor {
 	inline static constexpr uintptr_t levelMask = (uintptr_t{1} << Policy::bitsPerLevel) - 1;
 	inline static constexpr size_t lastLevel = Policy::maxLevels - 1;
+	inline static constexpr bool supportsLargePages = LargePageCursorPolicy<Policy>;
+	static_assert(!supportsLargePages
+			|| (size_t{1} << (Policy::bitsPerLevel + kPageShift)) == kLargePageSize);
 
 	PageCursor(PageSpace *space, uintptr_t va)
 	: space_{space}, va_{}, initialLevel_{Policy::maxLevels - Policy::numLevels()} {
@@ -75,6 +90,13 @@ private:
 		return __atomic_exchange_n(currentPtePtr_(), value, __ATOMIC_RELAXED);
 	}
 
+	// Pointer to the second-to-last level PTE that covers va_.
+	// Only valid if accessors_[lastLevel - 1] is loaded.
+	uint64_t *largePtePtr_() {
+		return reinterpret_cast<uint64_t *>(accessors_[lastLevel - 1].get())
+			+ ((va_ >> levelShift(lastLevel - 1)) & levelMask);
+	}
+
 public:
 	uintptr_t virtualAddress() {
 		return va_;
@@ -91,6 +113,15 @@ public:
 		}
 
 		va_ = va;
+		if constexpr (supportsLargePages) {
+			large_ = false;
+			if(!accessors_[lastLevel] && reloadLevel_(lastLevel - 1)) {
+				auto ptEnt = __atomic_load_n(largePtePtr_(), __ATOMIC_RELAXED);
+				large_ = Policy::ptePageLarge(ptEnt);
+				if(large_)
+					return;
+			}
+		}
 		reloadLevel_(lastLevel);
 	}
 
@@ -100,6 +131,9 @@ public:
 
 	bool findPresent(uintptr_t limit) {
 		while(va_ < limit) {
+			if(isLarge())
+				return true;
+
 			if(!accessors_[lastLevel]) {
 				advance4k();
 				continue;
@@ -117,6 +151,14 @@ public:
 
 	bool findDirty(uintptr_t limit) {
 		while(va_ < limit) {
+			if(isLarge()) {
+				auto ptEnt = __atomic_load_n(largePtePtr_(), __ATOMIC_RELAXED);
+				if(Policy::ptePageStatus(ptEnt) & page_status::dirty)
+					return true;
+				advanceLarge();
+				continue;
+			}
+
 			if(!accessors_[lastLevel]) {
 				advance4k();
 				continue;
@@ -133,6 +175,8 @@ public:
 	}
 
 	void map4k(PhysicalAddr pa, PageFlags flags, CachingMode cachingMode) {
+		if(isLarge())
+			splitLarge_();
 		if(!accessors_[lastLevel])
 			realizePts_();
 
@@ -149,6 +193,8 @@ public:
 	}
 
 	PageStatus remap4k(PhysicalAddr pa, PageFlags flags, CachingMode cachingMode) {
+		if(isLarge())
+			splitLarge_();
 		if(!accessors_[lastLevel])
 			realizePts_();
 
@@ -163,6 +209,8 @@ public:
 	}
 
 	PageStatus clean4k() {
+		if(isLarge())
+			splitLarge_();
 		if(!accessors_[lastLevel])
 			return 0;
 
@@ -170,6 +218,8 @@ public:
 	}
 
 	std::tuple<PageStatus, PhysicalAddr> unmap4k() {
+		if(isLarge())
+			splitLarge_();
 		if(!accessors_[lastLevel])
 			return {0, 0};
 
@@ -178,9 +228,99 @@ public:
 		return {Policy::ptePageStatus(ptEnt), Policy::ptePageAddress(ptEnt)};
 	}
 
+	// Large page API. The 4k functions above transparently split large pages.
+	// Large pages are only ever created by mapLarge(), i.e., never by the 4k functions.
+
+	// Whether va_ is covered by a present large page.
+	bool isLarge() {
+		if constexpr (supportsLargePages) {
+			return large_;
+		}else{
+			return false;
+		}
+	}
+
+	// Moves to the start of the next large page.
+	void advanceLarge() {
+		moveTo((va_ & ~uintptr_t(kLargePageSize - 1)) + kLargePageSize);
+	}
+
+	// Whether a large page can be mapped at va_, i.e., whether va_ is suitably aligned
+	// and the range is neither covered by a large page nor by a page table.
+	// Note that we never replace (empty) page tables by large pages since that would
+	// require a TLB shootdown before the page table can be freed.
+	bool canMapLarge() {
+		if constexpr (supportsLargePages) {
+			if(va_ & (kLargePageSize - 1))
+				return false;
+			if(large_ || accessors_[lastLevel])
+				return false;
+			if(!reloadLevel_(lastLevel - 1))
+				return true;
+			auto ptEnt = __atomic_load_n(largePtePtr_(), __ATOMIC_RELAXED);
+			return !Policy::ptePagePresent(ptEnt) && !Policy::pteTablePresent(ptEnt);
+		}else{
+			return false;
+		}
+	}
+
+	void mapLarge(PhysicalAddr pa, PageFlags flags, CachingMode cachingMode)
+	requires supportsLargePages {
+		assert(canMapLarge());
+		assert(!(pa & (kLargePageSize - 1)));
+		realizeLargePt_();
+
+		if (flags & page_access::execute) {
+			for(size_t progress = 0; progress < kLargePageSize; progress += kPageSize)
+				Policy::pteSyncICache(pa + progress);
+		}
+
+		auto ptEnt = Policy::pteBuildLarge(pa, flags, cachingMode);
+		__atomic_store_n(largePtePtr_(), ptEnt, __ATOMIC_RELAXED);
+		Policy::pteWriteBarrier();
+		large_ = true;
+	}
+
+	PageStatus remapLarge(PhysicalAddr pa, PageFlags flags, CachingMode cachingMode)
+	requires supportsLargePages {
+		assert(large_);
+		assert(!(va_ & (kLargePageSize - 1)));
+		assert(!(pa & (kLargePageSize - 1)));
+
+		if (flags & page_access::execute) {
+			for(size_t progress = 0; progress < kLargePageSize; progress += kPageSize)
+				Policy::pteSyncICache(pa + progress);
+		}
+
+		auto ptEnt = Policy::pteBuildLarge(pa, flags, cachingMode);
+		ptEnt = __atomic_exchange_n(largePtePtr_(), ptEnt, __ATOMIC_RELAXED);
+		Policy::pteWriteBarrier();
+		return Policy::ptePageStatus(ptEnt);
+	}
+
+	PageStatus cleanLarge()
+	requires supportsLargePages {
+		assert(large_);
+		return Policy::pteClean(largePtePtr_());
+	}
+
+	std::tuple<PageStatus, PhysicalAddr> unmapLarge()
+	requires supportsLargePages {
+		assert(large_);
+		assert(!(va_ & (kLargePageSize - 1)));
+
+		auto ptEnt = __atomic_exchange_n(largePtePtr_(), 0, __ATOMIC_RELAXED);
+		Policy::pteWriteBarrier();
+		large_ = false;
+		return {Policy::ptePageStatus(ptEnt),
+				Policy::ptePageAddress(Policy::pteLargeToSmall(ptEnt))};
+	}
+
 	// Low-level API for use by arch-specific code.
 public:
 	uint64_t *getPtePtr() {
+		if(isLarge())
+			splitLarge_();
 		if (!accessors_[lastLevel])
 			return nullptr;
 		return currentPtePtr_();
@@ -245,9 +385,54 @@ private:
 		}
 	}
 
+	// Realizes all page tables down to (and including) the one that contains large PTEs.
+	void realizeLargePt_() {
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&space_->tableMutex());
+		{
+			realizeLevel_(lastLevel - 1);
+		}
+	}
+
+	// Replaces the large page at va_ by a page table that maps the same memory
+	// with the same attributes. Since the translation does not change, no TLB
+	// shootdown is necessary; subsequent changes to individual 4k pages
+	// invalidate the large TLB entry as part of their own shootdown.
+	void splitLarge_() {
+		assert(large_);
+		auto tblEnt = Policy::pteNewTable();
+		PageAccessor tblAccessor{Policy::pteTableAddress(tblEnt)};
+		auto tblPtr = reinterpret_cast<uint64_t *>(tblAccessor.get());
+
+		{
+			auto irqLock = frg::guard(&irqMutex());
+			auto lock = frg::guard(&space_->tableMutex());
+
+			// Hardware may concurrently set the dirty bit of the large PTE.
+			auto largeEnt = __atomic_load_n(largePtePtr_(), __ATOMIC_RELAXED);
+			while(true) {
+				assert(Policy::ptePageLarge(largeEnt));
+				auto smallEnt = Policy::pteLargeToSmall(largeEnt);
+				for(size_t i = 0; i <= levelMask; i++)
+					__atomic_store_n(&tblPtr[i], smallEnt + (i << kPageShift), __ATOMIC_RELAXED);
+				Policy::pteWriteBarrier();
+
+				if(__atomic_compare_exchange_n(largePtePtr_(), &largeEnt, tblEnt,
+						false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+					break;
+			}
+			Policy::pteWriteBarrier();
+		}
+
+		accessors_[lastLevel] = std::move(tblAccessor);
+		large_ = false;
+	}
+
 private:
 	PageSpace *space_;
 	uintptr_t va_;
+	// Whether va_ is covered by a large page. Only used if supportsLargePages.
+	bool large_{false};
 
 	size_t initialLevel_;
 
@@ -9,6 +9,13 @@ enum {
 	kPageShift = 12
 };
 
+// Size of large pages (i.e., pages that are mapped by the second-to-last
+// page table level). This is the same on all supported architectures.
+enum {
+	kLargePageSize = 0x20'0000,
+	kLargePageShift = 21
+};
+
 constexpr Word kPfAccess = 1;
 constexpr Word kPfWrite = 2;
 constexpr Word kPfUser = 4;
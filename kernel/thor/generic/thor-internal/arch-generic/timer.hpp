@@ -2,6 +2,7 @@
 
 #include <frg/optional.hpp>
 #include <stdint.h>
+#include <thor-internal/util.hpp>
 
 namespace thor {
 
@@ -14,9 +15,14 @@ void setTimerDeadline(frg::optional<uint64_t> deadline);
 bool haveTimer();
 // Get the raw timestamp in preemption timer ticks.
 uint64_t getRawTimestampCounter();
+// If userspace can read the raw timestamp counter and getClockNanos() equals
+// conversion * getRawTimestampCounter() on all CPUs, returns that conversion.
+// Otherwise, returns frg::null_opt and userspace has to fall back to helGetClock().
+frg::optional<FreqFraction> getUserClockConversion();
 
 // Called by the architecture-specific code. Handles timer deadline
-// expiry.
-void handleTimerInterrupt();
+// expiry. Returns true if the profiling deadline expired; in this case,
+// the caller is expected to take a profiling sample.
+bool handleTimerInterrupt();
 
 } // namespace thor
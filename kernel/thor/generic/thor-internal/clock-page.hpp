@@ -0,0 +1,12 @@
+#pragma once
+
+#include <smarter.hpp>
+#include <thor-internal/memory-view.hpp>
+
+namespace thor {
+
+// Returns the memory object that contains the HelClockPage.
+// It allows userspace to read the monotone clock without a syscall.
+smarter::shared_ptr<MemoryView> getClockPageMemory();
+
+} // namespace thor
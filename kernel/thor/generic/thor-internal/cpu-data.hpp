@@ -24,7 +24,9 @@ struct WorkQueue;
 enum class ProfileMechanism {
 	none,
 	intelPmc,
-	amdPmc
+	amdPmc,
+	// Fallback for CPUs without PMC support: samples are taken from the timer IRQ.
+	timer
 };
 
 // "Interrupt priority level". This is our version of the IRQL that the NT kernel uses.
@@ -63,6 +65,18 @@ struct alignas(4) IplState {
 };
 static_assert(std::atomic<IplState>::is_always_lock_free);
 
+// Position of a CPU in the CPU topology.
+// CPUs that are SMT siblings, that share a last level cache or that are part of the
+// same package have equal coreId, llcId or packageId, respectively.
+struct CpuTopology {
+	// Whether the architecture code determined the topology.
+	// If false, each CPU is treated as a separate core.
+	bool known{false};
+	uint32_t coreId{0};
+	uint32_t llcId{0};
+	uint32_t packageId{0};
+};
+
 struct CpuData : public PlatformCpuData {
 	static constexpr unsigned int RS_EMITTING = 1;
 	static constexpr unsigned int RS_PENDING = 2;
@@ -81,6 +95,8 @@ struct CpuData : public PlatformCpuData {
 	bool haveVirtualization;
 
 	int cpuIndex;
+	// Filled in by the architecture code before the CPU is set online.
+	CpuTopology topology;
 
 	ExecutorContext *executorContext{nullptr};
 	smarter::borrowed_ptr<Thread> activeThread;
@@ -2,10 +2,12 @@
 
 #include <async/cancellation.hpp>
 #include <async/oneshot-event.hpp>
+#include <atomic>
 #include <frg/functional.hpp>
-#include <frg/hash_map.hpp>
 #include <frg/list.hpp>
+#include <frg/optional.hpp>
 #include <frg/spinlock.hpp>
+#include <frg/vector.hpp>
 
 #include <thor-internal/cancel.hpp>
 #include <thor-internal/coroutine.hpp>
@@ -55,184 +57,325 @@ concept FutexSpace = requires(S s, WorkQueue *wq) {
 	{ s.withFutex(uintptr_t{}, wq, [] (Futex auto) {}) } -> std::same_as<coroutine<frg::expected<Error>>>;
 };
 
+// Futex and expected value for FutexRealm::waitv().
+struct FutexWaitItem {
+	uintptr_t address;
+	unsigned int expected;
+};
+
 struct FutexRealm {
 private:
-	enum class State {
-		none,
-		done,
-		cancelled,
+	static constexpr size_t numBuckets = 256;
+
+	// Values of Waiter::woken that do not refer to a Node.
+	static constexpr size_t noIndex = static_cast<size_t>(-1);
+	static constexpr size_t cancelledIndex = static_cast<size_t>(-2);
+
+	// Represents a thread that waits on one or more futexes.
+	struct Waiter {
+		// Index of the Node that completed the wait (or cancelledIndex).
+		// Whoever changes this from noIndex has to raise completionEvent.
+		std::atomic<size_t> woken{noIndex};
+		async::oneshot_primitive completionEvent;
+		frg::default_list_hook<Waiter> pendingHook;
 	};
 
-	// Represents a single waiter.
+	struct Bucket;
+
+	// Represents a single futex that a Waiter waits on.
+	// All fields except for bucket are protected by the lock of the node's bucket.
 	struct Node {
-		State st{State::none};
+		FutexIdentity id;
+		Waiter *waiter{nullptr};
+		size_t index{0};
+		// Only changed by requeue() while holding the locks of the old and the new bucket.
+		Bucket *bucket{nullptr};
+		bool queued{false};
 		frg::default_list_hook<Node> queueHook;
-		async::oneshot_primitive completionEvent;
 	};
 
-	struct Slot {
-		frg::intrusive_list<
+	using NodeList = frg::intrusive_list<
+		Node,
+		frg::locate_member<
 			Node,
-			frg::locate_member<
-				Node,
-				frg::default_list_hook<Node>,
-				&Node::queueHook
-			>
-		> queue;
+			frg::default_list_hook<Node>,
+			&Node::queueHook
+		>
+	>;
+
+	using WaiterList = frg::intrusive_list<
+		Waiter,
+		frg::locate_member<
+			Waiter,
+			frg::default_list_hook<Waiter>,
+			&Waiter::pendingHook
+		>
+	>;
+
+	using Mutex = frg::ticket_spinlock;
+
+	// Each bucket holds the waiters of all futexes that hash to it.
+	// Buckets are padded to avoid false sharing between their locks.
+	struct alignas(64) Bucket {
+		Mutex mutex;
+		NodeList queue;
 	};
 
 public:
-	FutexRealm()
-	: _slots{FutexIdentity::Hash{}, *kernelAlloc} { }
-
-	bool empty() {
-		return _slots.empty();
-	}
+	FutexRealm() = default;
 
 	// ----------------------------------------------------------------------------------
-	// wait().
+	// wait() and waitv().
 	// ----------------------------------------------------------------------------------
 
 	template<FutexSpace S>
 	coroutine<Error> wait(S space, uintptr_t address, unsigned int expected,
 			WorkQueue *wq,
 			async::cancellation_token ct = {}) {
+		FutexWaitItem item{address, expected};
 		Node node{};
-		FutexIdentity id;
-
-		bool futexRace = false;
-		auto result = co_await space.withFutex(address, wq, [&](auto futex) {
-			id = futex.getIdentity();
+		size_t index;
+		co_return co_await _waitMany(space, &item, &node, 1, index, wq, ct);
+	}
 
-			auto irqLock = frg::guard(&irqMutex());
-			auto lock = frg::guard(&_mutex);
+	// Waits until any of the futexes is woken up. On success, index is set
+	// to the index of the futex that was woken up.
+	template<FutexSpace S>
+	coroutine<Error> waitv(S space, const FutexWaitItem *items, size_t count,
+			size_t &index, WorkQueue *wq,
+			async::cancellation_token ct = {}) {
+		frg::vector<Node, KernelAlloc> nodes{*kernelAlloc};
+		nodes.resize(count);
+		co_return co_await _waitMany(space, items, nodes.data(), count, index, wq, ct);
+	}
 
-			if(futex.read() != expected) {
-				futexRace = true;
-				return;
-			}
+	// ----------------------------------------------------------------------------------
+	// wake().
+	// ----------------------------------------------------------------------------------
 
-			auto sit = _slots.get(id);
-			if(!sit) {
-				_slots.insert(id, Slot());
-				sit = _slots.get(id);
-			}
+	template<FutexSpace S>
+	coroutine<frg::expected<Error>> wake(S space, uintptr_t address, uint32_t count,
+			WorkQueue *wq) {
+		FutexIdentity id;
 
-			sit->queue.push_back(&node);
+		auto result = co_await space.withFutex(address, wq, [&](auto futex) {
+			id = futex.getIdentity();
 		});
+
 		if(!result)
 			co_return result.error();
-		if (futexRace)
-			co_return Error::futexRace;
 
-		co_await async::with_cancel_cb(
-			node.completionEvent.wait(),
-			[&] {
-				// Remove the node from the futex's wait list.
-				{
-					auto irqLock = frg::guard(&irqMutex());
-					auto lock = frg::guard(&_mutex);
-
-					if (node.st == State::done)
-						return;
-					assert(node.st == State::none);
-
-					auto sit = _slots.get(id);
-					assert(sit);
-
-					// Invariant: If the slot exists then its queue is not empty.
-					assert(!sit->queue.empty());
-
-					auto nit = sit->queue.iterator_to(&node);
-					sit->queue.erase(nit);
-					node.st = State::cancelled;
-
-					if(sit->queue.empty())
-						_slots.remove(id);
-				}
+		WaiterList pending;
+		{
+			auto bucket = _bucketOf(id);
+			auto irqLock = frg::guard(&irqMutex());
+			auto lock = frg::guard(&bucket->mutex);
 
-				node.completionEvent.raise();
-			},
-			ct
-		);
-		if (node.st == State::done) {
-			co_return Error::success;
-		} else {
-			assert(node.st == State::cancelled);
-			co_return Error::cancelled;
+			_wakeLocked(bucket, id, count, pending);
 		}
+
+		_raise(pending);
+		co_return {};
 	}
 
 	// ----------------------------------------------------------------------------------
-	// wake().
+	// requeue().
 	// ----------------------------------------------------------------------------------
 
+	// Wakes up to wakeCount waiters of the futex at address and moves up to requeueCount
+	// of the remaining waiters to the futex at target. If expected is given, the operation
+	// fails with Error::futexRace unless the futex at address has that value.
+	// Returns the total number of woken and requeued waiters.
 	template<FutexSpace S>
-	coroutine<frg::expected<Error>> wake(S space, uintptr_t address, uint32_t count,
+	coroutine<frg::expected<Error, size_t>> requeue(S space, uintptr_t address, uintptr_t target,
+			uint32_t wakeCount, uint32_t requeueCount, frg::optional<unsigned int> expected,
 			WorkQueue *wq) {
-		FutexIdentity id;
+		FutexIdentity targetId;
+		auto targetResult = co_await space.withFutex(target, wq, [&](auto futex) {
+			targetId = futex.getIdentity();
+		});
+		if(!targetResult)
+			co_return targetResult.error();
 
+		bool futexRace = false;
+		size_t numWoken = 0;
+		size_t numRequeued = 0;
+		WaiterList pending;
 		auto result = co_await space.withFutex(address, wq, [&](auto futex) {
-			id = futex.getIdentity();
-		});
+			auto id = futex.getIdentity();
+			auto source = _bucketOf(id);
+			auto dest = _bucketOf(targetId);
+
+			// Lock both buckets in a consistent order to avoid deadlocks.
+			auto first = source < dest ? source : dest;
+			auto second = source < dest ? dest : source;
+
+			auto irqLock = frg::guard(&irqMutex());
+			first->mutex.lock();
+			if(second != first)
+				second->mutex.lock();
+
+			if(expected && futex.read() != *expected) {
+				futexRace = true;
+			}else{
+				numWoken = _wakeLocked(source, id, wakeCount, pending);
+
+				auto it = source->queue.begin();
+				while(it != source->queue.end() && numRequeued < requeueCount) {
+					auto node = *it;
+					++it;
+					if(!(node->id == id))
+						continue;
+
+					source->queue.erase(source->queue.iterator_to(node));
+					node->id = targetId;
+					__atomic_store_n(&node->bucket, dest, __ATOMIC_RELAXED);
+					dest->queue.push_back(node);
+					numRequeued++;
+				}
+			}
 
+			if(second != first)
+				second->mutex.unlock();
+			first->mutex.unlock();
+		});
 		if(!result)
 			co_return result.error();
+		if(futexRace)
+			co_return Error::futexRace;
 
-		frg::intrusive_list<
-			Node,
-			frg::locate_member<
-				Node,
-				frg::default_list_hook<Node>,
-				&Node::queueHook
-			>
-		> pending;
-		{
-			auto irqLock = frg::guard(&irqMutex());
-			auto lock = frg::guard(&_mutex);
+		_raise(pending);
+		co_return numWoken + numRequeued;
+	}
 
-			auto sit = _slots.get(id);
-			if(!sit)
-				co_return {};
-			// Invariant: If the slot exists then its queue is not empty.
-			assert(!sit->queue.empty());
+private:
+	Bucket *_bucketOf(FutexIdentity id) {
+		return &_buckets[FutexIdentity::Hash{}(id) % numBuckets];
+	}
 
-			while(!sit->queue.empty() && count) {
-				auto node = sit->queue.front();
-				assert(node->st == State::none);
-				sit->queue.pop_front();
+	// Completes the wait of a Waiter. Returns false if the wait was already completed.
+	static bool _claim(Waiter *waiter, size_t index) {
+		size_t expected = noIndex;
+		return waiter->woken.compare_exchange_strong(expected, index,
+				std::memory_order_acq_rel, std::memory_order_relaxed);
+	}
 
-				node->st = State::done;
-				pending.push_back(node);
+	static void _raise(WaiterList &pending) {
+		while(!pending.empty()) {
+			// The waiter can be destructed as soon as its event is raised.
+			auto waiter = pending.pop_front();
+			waiter->completionEvent.raise();
+		}
+	}
 
-				count--;
+	// Removes up to count waiters of the futex from the bucket and moves them to pending.
+	// Nodes of waiters that were already woken up (via another futex) are removed, too,
+	// but do not count towards count. Returns the number of waiters that were woken up.
+	size_t _wakeLocked(Bucket *bucket, FutexIdentity id, uint32_t count, WaiterList &pending) {
+		size_t numWoken = 0;
+		auto it = bucket->queue.begin();
+		while(it != bucket->queue.end() && numWoken < count) {
+			auto node = *it;
+			++it;
+			if(!(node->id == id))
+				continue;
+
+			bucket->queue.erase(bucket->queue.iterator_to(node));
+			node->queued = false;
+			if(_claim(node->waiter, node->index)) {
+				pending.push_back(node->waiter);
+				numWoken++;
 			}
+		}
+		return numWoken;
+	}
+
+	template<FutexSpace S>
+	coroutine<Error> _waitMany(S space, const FutexWaitItem *items, Node *nodes, size_t count,
+			size_t &index, WorkQueue *wq, async::cancellation_token ct) {
+		Waiter waiter;
+
+		// Enqueue one node per futex. Each node is enqueued under the bucket lock
+		// before the futex value is checked, such that we cannot miss wake-ups.
+		Error error = Error::success;
+		size_t numQueued = 0;
+		for(; numQueued < count; numQueued++) {
+			auto node = &nodes[numQueued];
+			node->waiter = &waiter;
+			node->index = numQueued;
+
+			bool futexRace = false;
+			auto result = co_await space.withFutex(items[numQueued].address, wq, [&](auto futex) {
+				node->id = futex.getIdentity();
+				auto bucket = _bucketOf(node->id);
+
+				auto irqLock = frg::guard(&irqMutex());
+				auto lock = frg::guard(&bucket->mutex);
+
+				if(futex.read() != items[numQueued].expected) {
+					futexRace = true;
+					return;
+				}
 
-			if(sit->queue.empty())
-				_slots.remove(id);
+				__atomic_store_n(&node->bucket, bucket, __ATOMIC_RELAXED);
+				node->queued = true;
+				bucket->queue.push_back(node);
+			});
+			if(!result) {
+				error = result.error();
+				break;
+			}
+			if(futexRace) {
+				error = Error::futexRace;
+				break;
+			}
 		}
 
-		while(!pending.empty()) {
-			auto node = pending.pop_front();
-			node->completionEvent.raise();
+		// Abort the wait unless one of the enqueued nodes was already woken up.
+		if(error != Error::success && _claim(&waiter, cancelledIndex)) {
+			_dequeue(nodes, numQueued);
+			co_return error;
 		}
 
-		co_return {};
-	}
+		co_await async::with_cancel_cb(
+			waiter.completionEvent.wait(),
+			[&] {
+				if(_claim(&waiter, cancelledIndex))
+					waiter.completionEvent.raise();
+			},
+			ct
+		);
+		_dequeue(nodes, numQueued);
 
-private:
-	using Mutex = frg::ticket_spinlock;
+		auto woken = waiter.woken.load(std::memory_order_acquire);
+		if(woken == cancelledIndex)
+			co_return Error::cancelled;
+		index = woken;
+		co_return Error::success;
+	}
 
-	// TODO: use a scalable hash table with fine-grained locks to
-	// improve the scalability of the futex algorithm.
-	Mutex _mutex;
+	// Removes nodes from their buckets (unless a wake-up already removed them).
+	void _dequeue(Node *nodes, size_t count) {
+		auto irqLock = frg::guard(&irqMutex());
+		for(size_t i = 0; i < count; i++) {
+			auto node = &nodes[i];
+			while(true) {
+				// Retry if requeue() moves the node while we acquire the lock.
+				auto bucket = __atomic_load_n(&node->bucket, __ATOMIC_RELAXED);
+				auto lock = frg::guard(&bucket->mutex);
+				if(__atomic_load_n(&node->bucket, __ATOMIC_RELAXED) != bucket)
+					continue;
+
+				if(node->queued) {
+					bucket->queue.erase(bucket->queue.iterator_to(node));
+					node->queued = false;
+				}
+				break;
+			}
+		}
+	}
 
-	frg::hash_map<
-		FutexIdentity,
-		Slot,
-		FutexIdentity::Hash,
-		KernelAlloc
-	> _slots;
+	Bucket _buckets[numBuckets];
 };
 
 } // namespace thor
@@ -45,7 +45,7 @@ struct ImmediateMemory;
 
 // Called from IpcQueue::processSq() to handle SQ elements.
 // Implemented in hel.cpp.
-void submitFromSq(smarter::shared_ptr<IpcQueue> queue, uint32_t opcode,
+void submitFromSq(const smarter::shared_ptr<IpcQueue> &queue, uint32_t opcode,
 		ImmediateMemory *memory, size_t dataOffset, size_t length, uintptr_t context);
 
 struct ElementStruct {
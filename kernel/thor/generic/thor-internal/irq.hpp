@@ -1,9 +1,13 @@
 #pragma once
 
 #include <async/recurring-event.hpp>
+#include <frg/dyn_array.hpp>
+#include <frg/eternal.hpp>
 #include <frg/expected.hpp>
 #include <frg/list.hpp>
+#include <frg/span.hpp>
 #include <frg/string.hpp>
+#include <frg/vector.hpp>
 #include <thor-internal/error.hpp>
 #include <thor-internal/kernel-heap.hpp>
 #include <thor-internal/kernlet.hpp>
@@ -169,6 +173,17 @@ constexpr IrqStrategy endOfService = IrqStrategy{1} << 9;
 
 } // namespace irq_strategy
 
+// Bucket i of the service latency histogram counts IRQs that were acked within
+// 2^i microseconds (and not within 2^(i - 1) microseconds). The last bucket counts
+// all IRQs that took longer.
+inline constexpr size_t numIrqLatencyBuckets = 16;
+
+struct IrqStats {
+	// CPU that the IRQ is currently routed to.
+	size_t targetCpu;
+	uint64_t latencyHistogram[numIrqLatencyBuckets];
+};
+
 // Represents a (not necessarily physical) "pin" of an interrupt controller.
 // This class handles the IRQ configuration and acknowledgement.
 struct IrqPin {
@@ -202,6 +217,17 @@ public:
 	// This function is called from IrqSlot::raise().
 	void raise();
 
+	static size_t affinityMaskSize();
+
+	// Returns the statistics of this IRQ. Also copies the number of raises on each CPU
+	// to cpuRaises (up to cpuRaises.size() CPUs).
+	IrqStats getStats(frg::span<uint64_t> cpuRaises);
+
+	// Restricts the IRQ to the CPUs in mask and routes it to one of them.
+	// IRQs with an explicit affinity are not moved by the IRQ balancer.
+	// Precondition: mask.size() == affinityMaskSize().
+	Error setAffinity(frg::span<const uint8_t> mask);
+
 private:
 	void _acknowledge();
 	void _nack();
@@ -219,6 +245,10 @@ protected:
 	virtual void mask() = 0;
 	virtual void unmask() = 0;
 
+	// Routes the IRQ to the given CPU. Called with pinMutex() held.
+	// Returns false if the IRQ controller cannot route the IRQ to that CPU.
+	virtual bool retarget(size_t cpu);
+
 	// Sends an end-of-interrupt signal to the interrupt controller.
 	virtual void endOfInterrupt();
 	// Called when an interrupt exits service (i.e., when it is acked).
@@ -226,9 +256,20 @@ protected:
 
 	~IrqPin() = default;
 
+	frg::ticket_spinlock *pinMutex() {
+		return &_mutex;
+	}
+
 private:
+	friend void balanceIrqs(frg::span<const uint64_t> threadLoad);
+
+	bool _inAffinityMask(size_t cpu) {
+		return _affinityMask[cpu / 8] & (1 << (cpu % 8));
+	}
+
 	void _doService();
 	void _updateMask();
+	void _recordServiceLatency();
 
 	frg::string<KernelAlloc> _name;
 	// Hash of the IRQ name. Mostly useful when extracting entropy from IRQs.
@@ -262,6 +303,32 @@ private:
 	int _unstallExponent = 0;
 	async::recurring_event _unstallEvent;
 
+	// The following fields are protected by _mutex.
+	// Number of raises per CPU.
+	frg::dyn_array<uint64_t, KernelAlloc> _cpuRaises;
+	uint64_t _latencyHistogram[numIrqLatencyBuckets]{};
+	frg::vector<uint8_t, KernelAlloc> _affinityMask;
+	bool _explicitAffinity = false;
+	// CPU that the IRQ is routed to. IRQs are initially routed to the boot CPU.
+	size_t _targetCpu = 0;
+	// Total number of raises at the last balancing round.
+	uint64_t _balancedRaises = 0;
+
+	// Hook for the global list of IRQ pins (used by the IRQ balancer).
+	frg::default_list_hook<IrqPin> _globalHook;
+
+	using GlobalList = frg::intrusive_list<
+		IrqPin,
+		frg::locate_member<
+			IrqPin,
+			frg::default_list_hook<IrqPin>,
+			&IrqPin::_globalHook
+		>
+	>;
+
+	static frg::ticket_spinlock _globalMutex;
+	static frg::eternal<GlobalList> _globalList;
+
 	// TODO: This list should change rarely. Use a RCU list.
 	frg::intrusive_list<
 		IrqSink,
@@ -273,6 +340,18 @@ private:
 	> _sinkList;
 };
 
+struct MsiPin;
+
+// Implemented by devices that need to rewrite their MSI registers if the message
+// of an MSI changes (e.g., because the MSI is routed to another CPU).
+struct MsiProgrammer {
+	// Called with IRQs disabled.
+	virtual void reprogramMsi(MsiPin *msi, size_t index) = 0;
+
+protected:
+	~MsiProgrammer() = default;
+};
+
 struct MsiPin : IrqPin {
 	MsiPin(frg::string<KernelAlloc> name)
 	: IrqPin{std::move(name)} { }
@@ -280,10 +359,32 @@ struct MsiPin : IrqPin {
 	virtual uint64_t getMessageAddress() = 0;
 	virtual uint32_t getMessageData() = 0;
 
+	// Sets the device that is notified when the message of this MSI changes.
+	void setProgrammer(MsiProgrammer *programmer, size_t index);
+
 protected:
+	// Returns true if a device is notified of message changes.
+	// Called with pinMutex() held.
+	bool canChangeMessage() {
+		return _programmer;
+	}
+
+	// Must be called (with pinMutex() held) after the message changes.
+	void messageChanged();
+
 	~MsiPin() = default;
+
+private:
+	// Protected by pinMutex().
+	MsiProgrammer *_programmer = nullptr;
+	size_t _programmerIndex = 0;
 };
 
+// Moves IRQs with high rates away from CPUs that handle a disproportionate share of IRQs.
+// threadLoad is the load of each CPU as estimated by the LoadBalancer.
+// Only has an effect if IRQ balancing is enabled (thor.irq_balance).
+void balanceIrqs(frg::span<const uint64_t> threadLoad);
+
 // ----------------------------------------------------------------------------
 
 // This class implements the user-visible part of IRQ handling.
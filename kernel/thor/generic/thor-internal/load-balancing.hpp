@@ -1,7 +1,8 @@
 #pragma once
 
-#include <async/barrier.hpp>
+#include <frg/manual_box.hpp>
 #include <frg/span.hpp>
+#include <frg/vector.hpp>
 #include <thor-internal/coroutine.hpp>
 #include <thor-internal/cpu-data.hpp>
 #include <thor-internal/thread.hpp>
@@ -83,6 +84,56 @@ private:
 	frg::vector<uint8_t, KernelAlloc> affinityMask_;
 };
 
+// Levels of the CPU topology that load balancing domains are built from.
+enum class LbLevel {
+	// SMT siblings.
+	smt,
+	// Cores that share a last level cache.
+	llc,
+	package,
+	system
+};
+
+inline constexpr size_t numLbLevels = 4;
+
+// A load balancing domain is a set of CPUs that share a level of the CPU topology.
+// Load is balanced between the groups of a domain. Each group is the set of CPUs
+// of a domain of the next lower level (or a single CPU for the lowest domain).
+struct LbDomain {
+	LbDomain() = default;
+
+	LbDomain(const LbDomain &) = delete;
+	LbDomain &operator= (const LbDomain &) = delete;
+
+	size_t numGroups() {
+		return groupEnds.size();
+	}
+
+	frg::span<const size_t> group(size_t i) {
+		size_t begin = i ? groupEnds[i - 1] : 0;
+		return {cpus.data() + begin, groupEnds[i] - begin};
+	}
+
+	// Index of this domain in LoadBalancer::domains().
+	size_t id{0};
+	LbLevel level{LbLevel::system};
+	// Domain of the next higher level (or nullptr).
+	LbDomain *parent{nullptr};
+
+	// CPUs of this domain, sorted by group.
+	frg::vector<size_t, KernelAlloc> cpus{*kernelAlloc};
+	// Group i consists of cpus[groupEnds[i - 1]] until (excluding) cpus[groupEnds[i]].
+	frg::vector<size_t, KernelAlloc> groupEnds{*kernelAlloc};
+
+	// Interval for periodic load balancing in this domain (in ns).
+	uint64_t interval{0};
+
+	// Statistics.
+	std::atomic<uint64_t> numBalances{0};
+	std::atomic<uint64_t> numMigrations{0};
+	std::atomic<uint64_t> numIdleMigrations{0};
+};
+
 // Per-CPU load balancing data structure.
 struct LbNode {
 	CpuData *cpu{nullptr};
@@ -99,12 +150,18 @@ struct LbNode {
 		>
 	> tasks;
 
-	// Constant during main phase of load balancing.
-	uint64_t totalLoad{0};
+	// Estimated load of all tasks of this node.
+	// Only written while holding mutex but may be read without holding it.
+	std::atomic<uint64_t> load{0};
+
+	// Domains of this CPU, from the lowest level to the highest level.
+	// Immutable once LoadBalancer::domainsReady() is true.
+	LbDomain *domains[numLbLevels]{};
+	size_t numDomains{0};
 
-	// Equal to totalLoad before load balancing but updated during load balancing.
-	// Protected by mutex during main phase of load balancing.
-	uint64_t currentLoad{0};
+	// The following fields are only accessed by the owning CPU.
+	uint64_t nextBalance[numLbLevels]{};
+	uint64_t nextIdleBalance{0};
 };
 
 extern PerCpu<LbNode> lbNode;
@@ -118,6 +175,7 @@ struct LoadBalancer {
 	LoadBalancer &operator= (const LoadBalancer &) = delete;
 
 	// Must be called on each CPU before threads can be moved to that CPU.
+	// Load balancing domains are built once all CPUs are online.
 	void setOnline(CpuData *cpu);
 
 	// Attaches a thread to the load balancer.
@@ -125,14 +183,37 @@ struct LoadBalancer {
 	// The thread is detached from the load balancer when the weak reference goes out of scope.
 	void connect(Thread *thread, CpuData *cpu);
 
+	// Called when the current CPU becomes idle. Tries to pull load from other CPUs.
+	void balanceOnIdle();
+
+	bool domainsReady() {
+		return domainsReady_.load(std::memory_order_acquire);
+	}
+
+	// Precondition: domainsReady().
+	frg::span<LbDomain *> domains() {
+		return {domains_->data(), domains_->size()};
+	}
+
 private:
 	coroutine<void> run_(CpuData *cpu);
 
+	// Estimates the load of the given node.
+	void estimateLoad_(LbNode *node, bool applyDecay);
+
+	void buildDomains_();
+
+	// Pulls load from the busiest group of the domain to dstNode.
+	void balanceDomain_(LbNode *dstNode, LbDomain *domain, bool idle);
+
 	// Move tasks from srcNode to dstNode to balance load.
-	// newLoad: newLoad at dstNode after balancing.
-	void balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &newLoad, uint64_t idealLoad);
+	// Returns the number of tasks that were moved.
+	size_t balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t idealLoad);
 
-	async::barrier barrier_;
+	std::atomic<size_t> numOnline_{0};
+	std::atomic<bool> domainsReady_{false};
+	// Initialized by buildDomains_().
+	frg::manual_box<frg::vector<LbDomain *, KernelAlloc>> domains_;
 };
 
 } // namespace thor
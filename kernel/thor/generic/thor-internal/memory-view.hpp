@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 
 #include <async/algorithm.hpp>
@@ -38,6 +39,8 @@ struct CachePage {
 	static constexpr uint32_t reclaimPosted = 0x02;
 	// Page has been evicted (neither in the LRU, nor in the bundle list).
 	static constexpr uint32_t reclaimInflight = 0x04;
+	// Page is on the active (instead of the inactive) LRU list.
+	static constexpr uint32_t reclaimActive = 0x08;
 
 	// CacheBundle that owns this page.
 	CacheBundle *bundle = nullptr;
@@ -50,8 +53,35 @@ struct CachePage {
 	frg::default_list_hook<CachePage> listHook;
 
 	uint32_t flags = 0;
+
+	// Set on access, cleared by the reclaimer. Can be updated without holding any lock.
+	std::atomic<bool> referenced{false};
+};
+
+// Snapshot of the reclaimer's state (exported to userspace via kerncfg).
+struct ReclaimStatistics {
+	// Current sizes of the LRU lists (in pages).
+	uint64_t activePages = 0;
+	uint64_t inactivePages = 0;
+	// Pages that are posted for eviction but not evicted yet.
+	uint64_t postedPages = 0;
+	// Reclaim starts below lowWatermark and stops above highWatermark free pages.
+	uint64_t lowWatermark = 0;
+	uint64_t highWatermark = 0;
+
+	// Cumulative event counters.
+	uint64_t scanned = 0;
+	uint64_t activated = 0;
+	uint64_t deactivated = 0;
+	uint64_t posted = 0;
+	uint64_t rescued = 0;
+	uint64_t evicted = 0;
+	// Number of times that the physical allocator woke up the reclaimer.
+	uint64_t wakeups = 0;
 };
 
+ReclaimStatistics getReclaimStatistics();
+
 // This is the "backend" part of a memory object.
 struct CacheBundle {
 	friend struct MemoryReclaimer;
@@ -253,6 +283,11 @@ public:
 
 	virtual size_t getLength() = 0;
 
+	// Read-only views can only be mapped without write and execute permissions.
+	virtual bool isReadOnly() {
+		return false;
+	}
+
 	virtual coroutine<frg::expected<Error>> resize(size_t newLength);
 
 	virtual coroutine<frg::expected<Error, smarter::shared_ptr<MemoryView>>> fork();
@@ -286,6 +321,11 @@ public:
 	// Result stays valid until the range is evicted.
 	virtual frg::tuple<PhysicalAddr, CachingMode> peekRange(uintptr_t offset) = 0;
 
+	// Like peekRange() but for a whole large page at offset (which needs to be aligned
+	// to kLargePageSize). Only succeeds if the range is backed by physically contiguous,
+	// suitably aligned memory; otherwise, this returns PhysicalAddr(-1).
+	virtual frg::tuple<PhysicalAddr, CachingMode> peekLargeRange(uintptr_t offset);
+
 	// Makes a range of memory available for peekRange().
 	// The sizeHint parameter is a hint; the implementation may affect fewer bytes.
 	// Returns the number of bytes that were actually affected.
@@ -603,8 +643,11 @@ private:
 };
 
 struct AllocatedMemory final : MemoryView {
+	// If largePages is set, the memory is backed by large pages where possible
+	// (i.e., unless physical memory is too fragmented). This requires chunkSize == kPageSize.
 	AllocatedMemory(size_t length, int addressBits = 64,
-			size_t chunkSize = kPageSize, size_t chunkAlign = kPageSize);
+			size_t chunkSize = kPageSize, size_t chunkAlign = kPageSize,
+			bool largePages = false);
 	AllocatedMemory(const AllocatedMemory &) = delete;
 	~AllocatedMemory();
 
@@ -615,6 +658,7 @@ struct AllocatedMemory final : MemoryView {
 	Error lockRange(uintptr_t offset, size_t size) override;
 	void unlockRange(uintptr_t offset, size_t size) override;
 	frg::tuple<PhysicalAddr, CachingMode> peekRange(uintptr_t offset) override;
+	frg::tuple<PhysicalAddr, CachingMode> peekLargeRange(uintptr_t offset) override;
 	coroutine<frg::expected<Error, size_t>>
 			touchRange(uintptr_t offset, size_t sizeHint, FetchFlags flags,
 			WorkQueue *wq) override;
@@ -624,13 +668,44 @@ public:
 	// Contract: set by the code that constructs this object.
 	smarter::borrowed_ptr<AllocatedMemory> selfPtr;
 private:
+	// State of each large page sized slot (only used if _largePages is set).
+	enum class LargeState : uint8_t {
+		// No page of the slot has been allocated yet.
+		untouched,
+		// Slot is backed by a single large page.
+		large,
+		// Slot is backed by individual small pages.
+		small
+	};
+
+	// Tries to back the large page slot that contains offset by a single large page.
+	bool _allocateLargeSlot(uintptr_t offset);
+
 	frg::ticket_spinlock _mutex;
 
 	frg::vector<PhysicalAddr, KernelAlloc> _physicalChunks;
+	frg::vector<LargeState, KernelAlloc> _largeSlots;
 	int _addressBits;
 	size_t _chunkSize, _chunkAlign;
+	bool _largePages;
+};
+
+// Global page cache counters (exported to userspace via kerncfg).
+struct PageCacheStatistics {
+	// Accesses that found the page already present.
+	std::atomic<uint64_t> hits{0};
+	// Accesses that found the page missing and had to fetch it synchronously.
+	std::atomic<uint64_t> misses{0};
+	// Accesses that had to wait for a page that was already being fetched.
+	std::atomic<uint64_t> pendingHits{0};
+	// Number of pages that were requested by readahead.
+	std::atomic<uint64_t> readaheadPages{0};
+	// Number of readahead windows that were issued ahead of the reader.
+	std::atomic<uint64_t> asyncReadaheads{0};
 };
 
+PageCacheStatistics &getPageCacheStatistics();
+
 struct ManagedSpace : CacheBundle {
 	enum LoadState {
 		kStateMissing,
@@ -696,6 +771,11 @@ struct ManagedSpace : CacheBundle {
 	void _progressManagement(ManageList &pending);
 	void _progressMonitors(MonitorList &pending);
 
+	// Updates the readahead window after an access to the given page and
+	// queues the pages of the new window for initialization.
+	// missing is true if the accessed page itself had to be fetched.
+	void _doReadahead(size_t index, bool missing);
+
 	smarter::borrowed_ptr<ManagedSpace> selfPtr;
 
 	frg::ticket_spinlock mutex;
@@ -705,6 +785,16 @@ struct ManagedSpace : CacheBundle {
 	size_t numPages;
 	bool readahead;
 
+	// Adaptive readahead state (similar to Linux' file_ra_state).
+	// [raStart, raEnd) is the most recently issued readahead window.
+	// Misses inside of (or directly after) that window are considered sequential
+	// and grow the window, other misses shrink it.
+	size_t raStart = 0;
+	size_t raEnd = 0;
+	size_t raWindow = 0;
+	// Accessing this page issues the next window before the reader has to wait.
+	size_t raAsyncIndex = static_cast<size_t>(-1);
+
 	EvictionQueue _evictQueue;
 
 	frg::intrusive_list<
@@ -22,18 +22,21 @@ namespace ostrace {
 // Set by the ostrace code one in-kernel ostrace is available.
 extern std::atomic<bool> available;
 
-struct Context {
-	frg::vector<char, KernelAlloc> buffer{*kernelAlloc};
-};
-
-extern PerCpu<Context> context;
-
 // Setup the in-kernel ostrace support.
 // This is called during ostrace initialization.
 // We only put it into the header for friends declarations.
 void setup();
 
-// Emit an in-kernel ostrace event.
+// Returns the current timestamp (in nanoseconds) for new records.
+uint64_t timestamp();
+
+// Reserve space for a record of the given size in the ring of the current CPU.
+// Must be called with IRQs disabled. Returns nullptr if the record is dropped
+// because the ring is full; otherwise, the record has to be committed.
+char *beginRecord(size_t size, uint64_t ts);
+void commitRecord();
+
+// Emit an already serialized record.
 void emitBuffer(frg::span<char> payload);
 
 using ItemId = uint64_t;
@@ -83,8 +86,13 @@ void emit(const Event &event, Args... args) {
 	if (!available.load(std::memory_order_relaxed))
 		return;
 
+	auto irqLock = frg::guard(&irqMutex());
+	auto ts = timestamp();
+
+	// Note that none of these records allocate memory.
 	managarm::ostrace::EventRecord<KernelAlloc> eventRecord{*kernelAlloc};
 	eventRecord.set_id(static_cast<uint64_t>(event.id()));
+	eventRecord.set_ts(ts);
 
 	managarm::ostrace::EndOfRecord<KernelAlloc> endOfRecord{*kernelAlloc};
 
@@ -98,33 +106,33 @@ void emit(const Event &event, Args... args) {
 	(determineSize(args), ...);
 	determineSize(endOfRecord);
 
-	{
-		auto irqLock = frg::guard(&irqMutex());
-		auto *ctx = &context.get();
-
-		ctx->buffer.resize(size);
-
-		// Emit all records to the buffer.
-		size_t offset = 0;
-		auto emitMsg = [&] (auto &msg) {
-			auto ts = msg.size_of_tail();
-			bool encodeSuccess = bragi::write_head_tail(msg,
-					frg::span<char>(ctx->buffer.data() + offset, 8),
-					frg::span<char>(ctx->buffer.data() + offset + 8, ts));
-			assert(encodeSuccess);
-			offset += 8 + ts;
-		};
-		emitMsg(eventRecord);
-		(emitMsg(args), ...);
-		emitMsg(endOfRecord);
-
-		emitBuffer({ctx->buffer.data(), size});
-	}
+	auto buffer = beginRecord(size, ts);
+	if(!buffer)
+		return;
+
+	// Serialize all records directly into the ring.
+	size_t offset = 0;
+	auto emitMsg = [&] (auto &msg) {
+		auto ts = msg.size_of_tail();
+		bool encodeSuccess = bragi::write_head_tail(msg,
+				frg::span<char>(buffer + offset, 8),
+				frg::span<char>(buffer + offset + 8, ts));
+		assert(encodeSuccess);
+		offset += 8 + ts;
+	};
+	emitMsg(eventRecord);
+	(emitMsg(args), ...);
+	emitMsg(endOfRecord);
+
+	commitRecord();
 }
 
 } // namespace ostrace
 
 extern ostrace::Event ostEvtArmPreemption;
 extern ostrace::Event ostEvtArmCpuTimer;
+extern ostrace::Event ostEvtRecordsDropped;
+extern ostrace::UintAttribute ostAttrCpu;
+extern ostrace::UintAttribute ostAttrNumDropped;
 
 } // namespace thor
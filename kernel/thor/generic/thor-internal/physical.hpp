@@ -114,6 +114,20 @@ void poisonPhysicalAccess(PhysicalAddr physical);
 void poisonPhysicalWriteAccess(PhysicalAddr physical);
 
 
+// Per-CPU magazine of free order-0 pages that sits in front of the buddy allocator.
+// Allocations and frees of single pages are served from this cache without
+// taking the global lock; the cache is refilled from (and drained to) the buddy
+// allocator in batches of kBatchSize pages.
+// Must only be accessed with IRQs disabled on the owning CPU.
+struct PhysicalPageCache {
+	static constexpr size_t kCapacity = 64;
+	// Number of pages that are moved between the cache and the buddy allocator at once.
+	static constexpr size_t kBatchSize = 16;
+
+	size_t numPages{0};
+	PhysicalAddr pages[kCapacity];
+};
+
 class PhysicalChunkAllocator {
 	typedef frg::ticket_spinlock Mutex;
 public:
@@ -122,21 +136,60 @@ public:
 	void bootstrapRegion(PhysicalAddr address,
 			int order, size_t numRoots, int8_t *buddyTree);
 
+	// Enables the per-CPU page caches. Must be called after the per-CPU
+	// data of all CPUs has been initialized.
+	void enablePerCpuCaches();
+
+	// Installs a handler that is called whenever an allocation leaves fewer than
+	// the given number of free pages. The handler is called with IRQs disabled
+	// (and potentially with other locks held) and must not allocate memory.
+	void setLowWatermark(size_t pages, void (*handler)());
+
 	PhysicalAddr allocate(size_t size, int addressBits = 64);
 	void free(PhysicalAddr address, size_t size);
 
 	size_t numTotalPages() {
 		return _totalPages.load(std::memory_order_relaxed);
 	}
+	// Pages that sit in per-CPU caches are counted as free (and not as used).
 	size_t numUsedPages() {
-		return _usedPages.load(std::memory_order_relaxed);
+		return _usedPages.load(std::memory_order_relaxed)
+				- _cachedPages.load(std::memory_order_relaxed);
 	}
 	size_t numFreePages() {
-		return _freePages.load(std::memory_order_relaxed);
+		return _freePages.load(std::memory_order_relaxed)
+				+ _cachedPages.load(std::memory_order_relaxed);
+	}
+	size_t numCachedPages() {
+		return _cachedPages.load(std::memory_order_relaxed);
+	}
+
+	// Statistics about the per-CPU caches.
+	uint64_t numCacheRefills() {
+		return _cacheRefills.load(std::memory_order_relaxed);
+	}
+	uint64_t numCacheDrains() {
+		return _cacheDrains.load(std::memory_order_relaxed);
 	}
 
 private:
+	// Allocates from the buddy allocator. Caller must hold _mutex.
+	PhysicalAddr _allocateLocked(int target, int addressBits);
+	// Returns memory to the buddy allocator. Caller must hold _mutex.
+	void _freeLocked(PhysicalAddr address, int target);
+
+	void _refillCache(PhysicalPageCache *cache);
+	void _drainCache(PhysicalPageCache *cache, size_t n);
+
+	// Invokes the low watermark handler if necessary. Must not be called with _mutex held.
+	void _checkWatermark() {
+		auto handler = _lowMemoryHandler.load(std::memory_order_relaxed);
+		if(handler && numFreePages() < _lowWatermark.load(std::memory_order_relaxed))
+			handler();
+	}
+
 	Mutex _mutex;
+	std::atomic<bool> _cachesEnabled{false};
 
 	struct Region {
 		PhysicalAddr physicalBase;
@@ -150,6 +203,12 @@ private:
 	std::atomic<size_t> _totalPages{0};
 	std::atomic<size_t> _usedPages{0};
 	std::atomic<size_t> _freePages{0};
+	std::atomic<size_t> _cachedPages{0};
+	std::atomic<uint64_t> _cacheRefills{0};
+	std::atomic<uint64_t> _cacheDrains{0};
+
+	std::atomic<size_t> _lowWatermark{0};
+	std::atomic<void (*)()> _lowMemoryHandler{nullptr};
 };
 
 extern constinit frg::manual_box<PhysicalChunkAllocator> physicalAllocator;
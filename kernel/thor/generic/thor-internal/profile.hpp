@@ -6,6 +6,24 @@ namespace thor {
 
 extern bool wantKernelProfile;
 
+// Each profiling sample is an array of uintptr_t:
+// Element 0 stores the number n of IPs, element 1 stores the number of kernel IPs.
+// Elements 2 and 3 identify the interrupted process and thread (or zero if no thread was
+// interrupted). These IDs are opaque and only meaningful within a single profile.
+// The remaining n elements store the IPs: kernel frames first (innermost first),
+// followed by the user frames (innermost first).
+inline constexpr size_t profileSampleHeader = 4;
+inline constexpr size_t maxProfileKernelDepth = 16;
+inline constexpr size_t maxProfileUserDepth = 32;
+inline constexpr size_t maxProfileSampleSize
+		= (profileSampleHeader + maxProfileKernelDepth + maxProfileUserDepth) * sizeof(uintptr_t);
+
+// Whether samples should include the user stack of the interrupted thread.
+extern bool wantProfileUserStacks;
+
+// Sampling period in nanoseconds.
+uint64_t getProfilePeriod();
+
 void initializeProfile();
 LogRingBuffer *getGlobalProfileRing();
 
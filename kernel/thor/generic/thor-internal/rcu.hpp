@@ -0,0 +1,73 @@
+#pragma once
+
+#include <assert.h>
+#include <atomic>
+#include <frg/list.hpp>
+#include <thor-internal/arch/ints.hpp>
+#include <thor-internal/cpu-data.hpp>
+
+namespace thor {
+
+// Minimal RCU that is used for wait-free lookups in data structures that are
+// otherwise protected by a lock (e.g., the descriptor table of a Universe).
+//
+// Readers enter a read-side critical section by constructing an RcuReadGuard.
+// Read-side critical sections must be entered with IRQs disabled (such that they
+// cannot migrate), they must be short and they must not block or take locks that
+// are held by rcuSynchronize() callers.
+//
+// Writers unpublish objects and then either call rcuSynchronize() before freeing them
+// or defer the free to rcuCall().
+
+struct RcuCpuState {
+	// Odd while this CPU is inside a read-side critical section.
+	std::atomic<uint64_t> sequence{0};
+	unsigned int nesting{0};
+};
+
+extern PerCpu<RcuCpuState> rcuCpuState;
+
+struct RcuReadGuard {
+	RcuReadGuard() {
+		assert(!intsAreEnabled());
+		auto state = &rcuCpuState.get();
+		if(!state->nesting++) {
+			state->sequence.fetch_add(1, std::memory_order_relaxed);
+			// Order the sequence update before all loads of the critical section.
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+	}
+
+	RcuReadGuard(const RcuReadGuard &) = delete;
+
+	RcuReadGuard &operator= (const RcuReadGuard &) = delete;
+
+	~RcuReadGuard() {
+		auto state = &rcuCpuState.get();
+		assert(state->nesting);
+		if(!--state->nesting)
+			state->sequence.fetch_add(1, std::memory_order_release);
+	}
+};
+
+// Waits until all read-side critical sections that were active at the time of the call
+// have ended. Must not be called from within a read-side critical section.
+// This spins; callers must not hold locks that readers might take.
+void rcuSynchronize();
+
+struct RcuCallback {
+	friend struct RcuReclaimer;
+
+	void setup(void (*run)(RcuCallback *));
+
+private:
+	void (*_run)(RcuCallback *);
+	frg::default_list_hook<RcuCallback> _hook;
+};
+
+// Runs the callback (from a kernel fiber) once all read-side critical sections
+// that were active at the time of the call have ended.
+// Does not block; hence, this can be called with IRQs disabled and locks held.
+void rcuCall(RcuCallback *callback);
+
+} // namespace thor
@@ -4,6 +4,7 @@
 #include <stddef.h>
 
 #include <async/recurring-event.hpp>
+#include <frg/span.hpp>
 #include <frg/tuple.hpp>
 #include <frg/utility.hpp>
 #include <thor-internal/cpu-data.hpp>
@@ -133,6 +134,112 @@ private:
 	std::atomic<uint64_t> headPtr_{0};
 };
 
+// Ring buffer with a single producer and a single consumer.
+// In contrast to the other ring buffers, records are written in place and records
+// that were not consumed yet are never overwritten; if the ring is full, new records
+// are dropped instead. Records never wrap around the end of the ring.
+struct SingleProducerRecordRing {
+	SingleProducerRecordRing(uintptr_t storage, size_t size)
+	: ringSize_{size}, buffer_{reinterpret_cast<char *>(storage)} {
+		assert(ringSize_ && (ringSize_ & (ringSize_ - 1)) == 0);
+	}
+
+	// Largest record size that reserve() accepts for a ring of the given size.
+	static constexpr size_t maxRecordSize(size_t ringSize) {
+		return ringSize / 2 - headerSize;
+	}
+
+	// Producer: reserve contiguous space for a record. Returns nullptr if the ring is full.
+	// The record becomes visible to the consumer on commit().
+	// Callers must ensure that recordSize does not exceed maxRecordSize(ringSize).
+	char *reserve(size_t recordSize) {
+		assert(recordSize <= maxRecordSize(ringSize_));
+		auto size = effectiveSize(recordSize);
+
+		auto enqPtr = headPtr_.load(std::memory_order_relaxed);
+		auto deqPtr = tailPtr_.load(std::memory_order_acquire);
+
+		// If the record does not fit before the end of the ring, skip to the start.
+		auto offset = enqPtr & (ringSize_ - 1);
+		size_t padding = 0;
+		if(offset + size > ringSize_)
+			padding = ringSize_ - offset;
+
+		if(enqPtr + padding + size - deqPtr > ringSize_) {
+			numDropped_.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		// Alignment guarantees that the padding marker fits.
+		if(padding)
+			memcpy(buffer_ + offset, &paddingMarker, sizeof(size_t));
+
+		reservedPtr_ = enqPtr + padding;
+		reservedSize_ = size;
+
+		auto recordOffset = reservedPtr_ & (ringSize_ - 1);
+		memcpy(buffer_ + recordOffset, &recordSize, sizeof(size_t));
+		return buffer_ + recordOffset + headerSize;
+	}
+
+	void commit() {
+		headPtr_.store(reservedPtr_ + reservedSize_, std::memory_order_release);
+	}
+
+	// Consumer: return the oldest record (or an empty span if there is none).
+	// The record stays valid until pop() is called.
+	frg::span<const char> front() {
+		auto deqPtr = tailPtr_.load(std::memory_order_relaxed);
+		auto validPtr = headPtr_.load(std::memory_order_acquire);
+		if(deqPtr == validPtr)
+			return {};
+
+		auto recordOffset = deqPtr & (ringSize_ - 1);
+		size_t recordSize;
+		memcpy(&recordSize, buffer_ + recordOffset, sizeof(size_t));
+		if(recordSize == paddingMarker) {
+			tailPtr_.store(deqPtr + (ringSize_ - recordOffset), std::memory_order_release);
+			return front();
+		}
+
+		return {buffer_ + recordOffset + headerSize, recordSize};
+	}
+
+	void pop() {
+		auto deqPtr = tailPtr_.load(std::memory_order_relaxed);
+		assert(deqPtr != headPtr_.load(std::memory_order_relaxed));
+
+		size_t recordSize;
+		memcpy(&recordSize, buffer_ + (deqPtr & (ringSize_ - 1)), sizeof(size_t));
+		assert(recordSize != paddingMarker);
+		tailPtr_.store(deqPtr + effectiveSize(recordSize), std::memory_order_release);
+	}
+
+	// Number of records that were dropped since the ring was full.
+	uint64_t numDropped() {
+		return numDropped_.load(std::memory_order_relaxed);
+	}
+
+private:
+	static constexpr size_t headerSize = sizeof(size_t);
+	static constexpr size_t recordAlign = sizeof(size_t);
+	static constexpr size_t paddingMarker = ~size_t{0};
+
+	size_t effectiveSize(size_t recordSize) {
+		return (headerSize + recordSize + recordAlign - 1) & ~(recordAlign - 1);
+	}
+
+	size_t ringSize_;
+	char *buffer_;
+	std::atomic<uint64_t> tailPtr_{0};
+	std::atomic<uint64_t> headPtr_{0};
+	std::atomic<uint64_t> numDropped_{0};
+
+	// Only accessed by the producer.
+	uint64_t reservedPtr_{0};
+	size_t reservedSize_{0};
+};
+
 struct SingleContextRecordRing {
 	void enqueue(const void *data, size_t recordSize) {
 		auto ringSize = size_t{1} << shift_;
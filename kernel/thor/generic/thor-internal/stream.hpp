@@ -14,6 +14,7 @@
 #include <thor-internal/cpu-data.hpp>
 #include <thor-internal/error.hpp>
 #include <thor-internal/kernel-heap.hpp>
+#include <thor-internal/memory-view.hpp>
 #include <thor-internal/thread.hpp>
 #include <thor-internal/universe.hpp>
 
@@ -48,7 +49,9 @@ enum {
 	kTagRecvKernelBuffer,
 	kTagRecvFlow,
 	kTagPushDescriptor,
-	kTagPullDescriptor
+	kTagPullDescriptor,
+	kTagSendPages,
+	kTagRecvPages
 };
 
 inline int getStreamOrientation(int tag) {
@@ -58,23 +61,29 @@ inline int getStreamOrientation(int tag) {
 	case kTagRecvKernelBuffer:
 	case kTagRecvFlow:
 	case kTagPullDescriptor:
+	case kTagRecvPages:
 		return -1;
 	case kTagOffer:
 	case kTagImbueCredentials:
 	case kTagSendKernelBuffer:
 	case kTagSendFlow:
 	case kTagPushDescriptor:
+	case kTagSendPages:
 		return 1;
 	}
 	return 0;
 }
 
 inline bool usesFlowProtocol(int tag) {
-	return tag == kTagSendFlow || tag == kTagRecvFlow;
+	return tag == kTagSendFlow || tag == kTagRecvFlow || tag == kTagRecvPages;
 }
 
 struct FlowPacket {
 	void *data = nullptr;
+	// Instead of data, senders can pass a part of a physical page that they keep locked
+	// until the packet is acked. The receiver copies directly from this page.
+	PhysicalAddr physical = PhysicalAddr(-1);
+	uintptr_t pageOffset = 0;
 	size_t size = 0;
 	bool terminate = false;
 	bool fault = false;
@@ -121,6 +130,12 @@ public:
 	size_t _maxLength;
 	frg::unique_memory<KernelAlloc> _inBuffer;
 	AnyDescriptor _inDescriptor;
+	// For kTagSendPages (and kTagSendFlow if sending from a memory object):
+	// memory that backs the sent data (length is _maxLength).
+	smarter::shared_ptr<MemoryView> _inView;
+	uintptr_t _inViewOffset = 0;
+	// For kTagSendPages: whether the sender's mapping of _inView was writable.
+	bool _inViewWritable = false;
 
 	StreamNode *peerNode = nullptr;
 
@@ -384,6 +384,26 @@ public:
 
 	uint32_t flags;
 
+	// Default slack of timers that are set up on behalf of the thread.
+	static constexpr uint64_t defaultTimerSlack = 50'000;
+
+	uint64_t timerSlack() {
+		return _timerSlack.load(std::memory_order_relaxed);
+	}
+
+	void setTimerSlack(uint64_t slack) {
+		_timerSlack.store(slack, std::memory_order_relaxed);
+	}
+
+	// Number of page faults on user addresses that this thread took.
+	uint64_t numPageFaults() {
+		return _numPageFaults.load(std::memory_order_relaxed);
+	}
+
+	void countPageFault() {
+		_numPageFaults.fetch_add(1, std::memory_order_relaxed);
+	}
+
 private:
 	typedef frg::ticket_spinlock Mutex;
 
@@ -430,6 +450,10 @@ private:
 	// (i.e., that we never block when we should not).
 	std::atomic<bool> _unblockLatch{false};
 
+	std::atomic<uint64_t> _timerSlack{defaultTimerSlack};
+
+	std::atomic<uint64_t> _numPageFaults{0};
+
 	Interrupt _lastInterrupt;
 	uint64_t _stateSeq;
 
@@ -43,6 +43,7 @@ struct PrecisionTimerNode {
 	};
 
 	friend struct CompareTimer;
+	friend struct CompareTimerStart;
 	friend struct PrecisionTimerEngine;
 
 	PrecisionTimerNode()
@@ -61,14 +62,31 @@ struct PrecisionTimerNode {
 		_elapsed = elapsed;
 	}
 
+	// The timer may elapse at any point in [deadline, deadline + slack].
+	// This allows the engine to handle timers with overlapping windows in a single IRQ.
+	void setSlack(uint64_t slack) {
+		_slack = slack;
+	}
+
 	bool wasCancelled() {
 		return _wasCancelled;
 	}
 
 	frg::pairing_heap_hook<PrecisionTimerNode> hook;
+	// Hook for the queue that is ordered by the start of the window.
+	frg::pairing_heap_hook<PrecisionTimerNode> startHook;
 
 private:
+	// End of the window in which the timer may elapse.
+	uint64_t _latest() const {
+		uint64_t latest;
+		if(__builtin_add_overflow(_deadline, _slack, &latest))
+			return UINT64_MAX;
+		return latest;
+	}
+
 	uint64_t _deadline;
+	uint64_t _slack = 0;
 	async::cancellation_token _cancelToken;
 	WorkQueue *_wq;
 	Worklet *_elapsed;
@@ -81,12 +99,31 @@ private:
 	async::cancellation_observer<CancelFunctor> _cancelCb;
 };
 
+// Timers are ordered by the end of their windows such that the top of the queue
+// determines the latest point in time at which the engine needs to be woken up.
 struct CompareTimer {
+	bool operator() (const PrecisionTimerNode *a, const PrecisionTimerNode *b) const {
+		return a->_latest() > b->_latest();
+	}
+};
+
+// Orders timers by the start of their windows, i.e., by their deadlines.
+// The top of this queue determines whether any timer can elapse.
+struct CompareTimerStart {
 	bool operator() (const PrecisionTimerNode *a, const PrecisionTimerNode *b) const {
 		return a->_deadline > b->_deadline;
 	}
 };
 
+struct TimerStatistics {
+	// Timer IRQs that were handled by the timer engines.
+	uint64_t alarms;
+	// Timers that elapsed.
+	uint64_t expirations;
+	// Timers that elapsed in the IRQ of another timer (i.e., wakeups that were saved).
+	uint64_t coalesced;
+};
+
 struct PrecisionTimerEngine final {
 	friend struct PrecisionTimerNode;
 
@@ -119,14 +156,17 @@ public:
 		PrecisionTimerEngine *self;
 		uint64_t deadline;
 		async::cancellation_token cancellation;
+		uint64_t slack;
 	};
 
-	SleepSender sleep(uint64_t deadline, async::cancellation_token cancellation = {}) {
-		return {this, deadline, cancellation};
+	SleepSender sleep(uint64_t deadline, async::cancellation_token cancellation = {},
+			uint64_t slack = 0) {
+		return {this, deadline, cancellation, slack};
 	}
 
-	SleepSender sleepFor(uint64_t nanos, async::cancellation_token cancellation = {}) {
-		return {this, getClockNanos() + nanos, cancellation};
+	SleepSender sleepFor(uint64_t nanos, async::cancellation_token cancellation = {},
+			uint64_t slack = 0) {
+		return {this, getClockNanos() + nanos, cancellation, slack};
 	}
 
 	template<typename R>
@@ -144,6 +184,7 @@ public:
 				async::execution::set_value(op->receiver_, !op->node_.wasCancelled());
 			});
 			node_.setup(s_.deadline, s_.cancellation, WorkQueue::generalQueue().get(), &worklet_);
+			node_.setSlack(s_.slack);
 			s_.self->installTimer(&node_);
 		}
 
@@ -167,8 +208,15 @@ private:
 public:
 	void firedAlarm();
 
+	void addStatistics(TimerStatistics &stats) {
+		stats.alarms += _numAlarms.load(std::memory_order_relaxed);
+		stats.expirations += _numExpirations.load(std::memory_order_relaxed);
+		stats.coalesced += _numCoalesced.load(std::memory_order_relaxed);
+	}
+
 private:
-	void _progress();
+	// Returns the number of timers that elapsed.
+	size_t _progress();
 
 	CpuData *_ourCpu;
 
@@ -184,7 +232,22 @@ private:
 		CompareTimer
 	> _timerQueue;
 
+	// Contains the same timers as _timerQueue.
+	frg::pairing_heap<
+		PrecisionTimerNode,
+		frg::locate_member<
+			PrecisionTimerNode,
+			frg::pairing_heap_hook<PrecisionTimerNode>,
+			&PrecisionTimerNode::startHook
+		>,
+		CompareTimerStart
+	> _startQueue;
+
 	size_t _activeTimers;
+
+	std::atomic<uint64_t> _numAlarms{0};
+	std::atomic<uint64_t> _numExpirations{0};
+	std::atomic<uint64_t> _numCoalesced{0};
 };
 
 inline void PrecisionTimerNode::CancelFunctor::operator() () {
@@ -193,6 +256,9 @@ inline void PrecisionTimerNode::CancelFunctor::operator() () {
 
 PrecisionTimerEngine *generalTimerEngine();
 
+// Sums up the statistics of the timer engines of all CPUs.
+TimerStatistics getTimerStatistics();
+
 // Schedules preemption to happen when the monotonic clock reaches the
 // deadline, or disarms preemption when deadline is frg::null_opt.
 void setPreemptionDeadline(frg::optional<uint64_t> deadline);
@@ -200,4 +266,8 @@ void setPreemptionDeadline(frg::optional<uint64_t> deadline);
 // is none.
 frg::optional<uint64_t> getPreemptionDeadline();
 
+// Schedules a timer-based profiling sample to be taken when the monotonic clock
+// reaches the deadline, or disarms profiling when deadline is frg::null_opt.
+void setProfileDeadline(frg::optional<uint64_t> deadline);
+
 } // namespace thor
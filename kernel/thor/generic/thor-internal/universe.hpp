@@ -1,9 +1,13 @@
 #pragma once
 
+#include <frg/dyn_array.hpp>
 #include <frg/variant.hpp>
+#include <frg/vector.hpp>
 #include <assert.h>
+#include <atomic>
 #include <smarter.hpp>
 #include <thor-internal/mm-rc.hpp>
+#include <thor-internal/rcu.hpp>
 #include <thor-internal/virtualization.hpp>
 
 namespace thor {
@@ -262,26 +266,76 @@ public:
 	typedef frg::ticket_spinlock Lock;
 	typedef frg::unique_lock<frg::ticket_spinlock> Guard;
 
+	// Lookups do not take the lock; they only need to be in an RCU read-side
+	// critical section. The returned descriptor remains valid until the end of
+	// that critical section.
+	typedef RcuReadGuard ReadGuard;
+
 	Universe();
 	~Universe();
 
 	Handle attachDescriptor(Guard &guard, AnyDescriptor descriptor);
 
-	AnyDescriptor *getDescriptor(Guard &guard, Handle handle);
+	AnyDescriptor *getDescriptor(ReadGuard &guard, Handle handle);
 
-	frg::optional<AnyDescriptor> detachDescriptor(Guard &guard, Handle handle);
+	// Returns false if there is no descriptor with this handle.
+	// The descriptor is released after an RCU grace period (outside of the lock).
+	bool detachDescriptor(Guard &guard, Handle handle);
 
 	Lock lock;
 
 private:
-	frg::hash_map<
-		Handle,
-		AnyDescriptor,
-		frg::hash<Handle>,
-		KernelAlloc
-	> _descriptorMap;
-
-	Handle _nextHandle;
+	// Descriptors are stored in a two-level table that is indexed by the handle.
+	// The second level consists of chunks of chunkSize descriptors.
+	// Readers access all levels without taking the lock; hence, descriptors,
+	// chunks and directories are only freed after an RCU grace period (via rcuCall()).
+	// Like file descriptors on POSIX, the lowest free handle is allocated first.
+	// Chunks (other than the first one) are freed once they become empty.
+	static constexpr int chunkShift = 8;
+	static constexpr size_t chunkSize = size_t{1} << chunkShift;
+
+	struct DescriptorNode {
+		DescriptorNode(AnyDescriptor descriptor)
+		: descriptor{std::move(descriptor)} { }
+
+		AnyDescriptor descriptor;
+		RcuCallback rcuCallback;
+	};
+
+	struct Chunk {
+		std::atomic<DescriptorNode *> slots[chunkSize]{};
+
+		// The following fields are protected by the lock.
+		uint64_t usedMask[chunkSize / 64]{};
+		size_t numUsed{0};
+
+		RcuCallback rcuCallback;
+	};
+
+	struct Directory {
+		Directory(size_t numChunks)
+		: chunks{numChunks, *kernelAlloc} { }
+
+		frg::dyn_array<std::atomic<Chunk *>, KernelAlloc> chunks;
+		RcuCallback rcuCallback;
+	};
+
+	std::atomic<DescriptorNode *> *_getSlot(Handle handle);
+
+	// Returns the chunk with the given index, allocating it if necessary.
+	Chunk *_ensureChunk(size_t index);
+
+	// Frees the chunk with the given index if it exists and is empty.
+	void _releaseChunkIfEmpty(size_t index);
+
+	Handle _allocateHandle();
+	void _freeHandle(Handle handle);
+
+	std::atomic<Directory *> _directory{nullptr};
+
+	// All chunks below this index are full.
+	// Apart from the chunk at this index, no allocated chunk is empty.
+	size_t _firstFreeChunk{0};
 };
 
 } // namespace thor
@@ -14,6 +14,7 @@ namespace {
 struct DeadlineState {
 	frg::optional<uint64_t> timerDeadline{};
 	frg::optional<uint64_t> preemptionDeadline{};
+	frg::optional<uint64_t> profileDeadline{};
 
 	frg::optional<uint64_t> currentDeadline{};
 };
@@ -36,6 +37,7 @@ void updateDeadline_() {
 
 	consider(state.timerDeadline);
 	consider(state.preemptionDeadline);
+	consider(state.profileDeadline);
 
 	// No need to do anything if the current deadline didn't change.
 
@@ -70,8 +72,14 @@ void setPreemptionDeadline(frg::optional<uint64_t> deadline) {
 	return deadlineState.get().preemptionDeadline;
 }
 
+void setProfileDeadline(frg::optional<uint64_t> deadline) {
+	assert(!intsAreEnabled());
+	deadlineState.get().profileDeadline = deadline;
+	updateDeadline_();
+}
 
-void handleTimerInterrupt() {
+
+bool handleTimerInterrupt() {
 	auto &state = deadlineState.get();
 	auto now = getClockNanos();
 
@@ -85,6 +93,7 @@ void handleTimerInterrupt() {
 
 	auto timerExpired = checkAndClear(state.timerDeadline);
 	auto preemptionExpired = checkAndClear(state.preemptionDeadline);
+	auto profileExpired = checkAndClear(state.profileDeadline);
 
 	// Update the timer hardware.
 	updateDeadline_();
@@ -95,6 +104,8 @@ void handleTimerInterrupt() {
 
 	if (preemptionExpired)
 		localScheduler.get().forcePreemptionCall();
+
+	return profileExpired;
 }
 
 
@@ -112,6 +123,7 @@ void PrecisionTimerEngine::installTimer(PrecisionTimerNode *timer) {
 	if(logTimers) {
 		auto current = getClockNanos();
 		infoLogger() << "thor: Setting timer at " << timer->_deadline
+				<< " with slack " << timer->_slack
 				<< " (counter is " << current << ")" << frg::endlog;
 	}
 
@@ -125,6 +137,7 @@ void PrecisionTimerEngine::installTimer(PrecisionTimerNode *timer) {
 	}
 
 	_timerQueue.push(timer);
+	_startQueue.push(timer);
 	_activeTimers++;
 	timer->_state = TimerState::queued;
 
@@ -137,6 +150,7 @@ void PrecisionTimerEngine::cancelTimer(PrecisionTimerNode *timer) {
 
 	if(timer->_state == TimerState::queued) {
 		_timerQueue.remove(timer);
+		_startQueue.remove(timer);
 		_activeTimers--;
 		timer->_wasCancelled = true;
 	}else{
@@ -153,33 +167,44 @@ void PrecisionTimerEngine::firedAlarm() {
 	auto irq_lock = frg::guard(&irqMutex());
 	auto lock = frg::guard(&_mutex);
 
-	_progress();
+	auto elapsed = _progress();
+	_numAlarms.fetch_add(1, std::memory_order_relaxed);
+	if(elapsed > 1)
+		_numCoalesced.fetch_add(elapsed - 1, std::memory_order_relaxed);
 }
 
 // This function unconditionally calls into setTimerEngineDeadline().
 // This is necessary since we assume that timer IRQs are one shot
 // and not necessarily perfectly accurate.
-void PrecisionTimerEngine::_progress() {
+// The IRQ is set up for the end of the earliest window. Once it fires, all timers
+// whose windows have already started are processed (not only the timer that determined
+// the IRQ), i.e., all timers whose windows overlap the current time elapse in the same IRQ.
+size_t PrecisionTimerEngine::_progress() {
 	assert(getCpuData() == _ourCpu);
 
+	size_t elapsed = 0;
 	auto current = getClockNanos();
 	do {
-		// Process all timers that elapsed in the past.
+		// Process all timers whose windows started in the past.
 		if(logProgress)
 			infoLogger() << "thor: Processing timers until " << current << frg::endlog;
 		while(true) {
-			if(_timerQueue.empty()) {
+			if(_startQueue.empty()) {
+				assert(_timerQueue.empty());
 				setTimerEngineDeadline(frg::null_opt);
-				return;
+				_numExpirations.fetch_add(elapsed, std::memory_order_relaxed);
+				return elapsed;
 			}
 
-			if(_timerQueue.top()->_deadline > current)
+			if(_startQueue.top()->_deadline > current)
 				break;
 
-			auto timer = _timerQueue.top();
+			auto timer = _startQueue.top();
 			assert(timer->_state == TimerState::queued);
-			_timerQueue.pop();
+			_startQueue.pop();
+			_timerQueue.remove(timer);
 			_activeTimers--;
+			elapsed++;
 			if(logProgress)
 				infoLogger() << "thor: Timer completed" << frg::endlog;
 			if(timer->_cancelCb.try_reset()) {
@@ -193,16 +218,26 @@ void PrecisionTimerEngine::_progress() {
 
 		// Setup the interrupt.
 		assert(!_timerQueue.empty());
-		setTimerEngineDeadline(_timerQueue.top()->_deadline);
+		setTimerEngineDeadline(_timerQueue.top()->_latest());
 
 		// We iterate if there was a race.
 		// Technically, this is optional but it may help to avoid unnecessary IRQs.
 		current = getClockNanos();
-	} while(_timerQueue.top()->_deadline <= current);
+	} while(_startQueue.top()->_deadline <= current);
+
+	_numExpirations.fetch_add(elapsed, std::memory_order_relaxed);
+	return elapsed;
 }
 
 PrecisionTimerEngine *generalTimerEngine() {
 	return &timerEngine.get();
 }
 
+TimerStatistics getTimerStatistics() {
+	TimerStatistics stats{};
+	for(size_t i = 0; i < getCpuCount(); i++)
+		timerEngine.get(getCpuData(i)).addStatistics(stats);
+	return stats;
+}
+
 } // namespace thor
@@ -1,3 +1,4 @@
+#include <frg/container_of.hpp>
 #include <thor-internal/universe.hpp>
 
 namespace thor {
@@ -6,32 +7,183 @@ namespace {
 	constexpr bool logCleanup = false;
 }
 
-Universe::Universe()
-: _descriptorMap{frg::hash<Handle>{}, *kernelAlloc}, _nextHandle{1} { }
+Universe::Universe() = default;
 
 Universe::~Universe() {
 	if(logCleanup)
 		debugLogger() << "thor: Universe is deallocated" << frg::endlog;
+
+	// There are no concurrent readers anymore.
+	auto directory = _directory.load(std::memory_order_relaxed);
+	if(!directory)
+		return;
+	for(auto &chunkPtr : directory->chunks) {
+		auto chunk = chunkPtr.load(std::memory_order_relaxed);
+		if(!chunk)
+			continue;
+		for(auto &slot : chunk->slots) {
+			auto node = slot.load(std::memory_order_relaxed);
+			if(node)
+				frg::destruct(*kernelAlloc, node);
+		}
+		frg::destruct(*kernelAlloc, chunk);
+	}
+	frg::destruct(*kernelAlloc, directory);
 }
 
 Handle Universe::attachDescriptor(Guard &guard, AnyDescriptor descriptor) {
 	assert(guard.protects(&lock));
 
-	Handle handle = _nextHandle++;
-	_descriptorMap.insert(handle, std::move(descriptor));
+	Handle handle = _allocateHandle();
+	auto slot = _getSlot(handle);
+	assert(!slot->load(std::memory_order_relaxed));
+	slot->store(frg::construct<DescriptorNode>(*kernelAlloc, std::move(descriptor)),
+			std::memory_order_release);
 	return handle;
 }
 
-AnyDescriptor *Universe::getDescriptor(Guard &guard, Handle handle) {
+AnyDescriptor *Universe::getDescriptor(ReadGuard &, Handle handle) {
+	auto slot = _getSlot(handle);
+	if(!slot)
+		return nullptr;
+	auto node = slot->load(std::memory_order_acquire);
+	if(!node)
+		return nullptr;
+	return &node->descriptor;
+}
+
+bool Universe::detachDescriptor(Guard &guard, Handle handle) {
 	assert(guard.protects(&lock));
 
-	return _descriptorMap.get(handle);
+	auto slot = _getSlot(handle);
+	if(!slot)
+		return false;
+	auto node = slot->exchange(nullptr, std::memory_order_relaxed);
+	if(!node)
+		return false;
+	_freeHandle(handle);
+
+	// Readers might still access the descriptor. Note that this also releases
+	// the descriptor outside of the lock.
+	node->rcuCallback.setup([] (RcuCallback *base) {
+		auto node = frg::container_of(base, &DescriptorNode::rcuCallback);
+		frg::destruct(*kernelAlloc, node);
+	});
+	rcuCall(&node->rcuCallback);
+	return true;
 }
 
-frg::optional<AnyDescriptor> Universe::detachDescriptor(Guard &guard, Handle handle) {
-	assert(guard.protects(&lock));
+std::atomic<Universe::DescriptorNode *> *Universe::_getSlot(Handle handle) {
+	if(handle <= 0)
+		return nullptr;
+	auto directory = _directory.load(std::memory_order_acquire);
+	if(!directory)
+		return nullptr;
+	size_t index = handle >> chunkShift;
+	if(index >= directory->chunks.size())
+		return nullptr;
+	auto chunk = directory->chunks[index].load(std::memory_order_acquire);
+	if(!chunk)
+		return nullptr;
+	return &chunk->slots[handle & (chunkSize - 1)];
+}
+
+Universe::Chunk *Universe::_ensureChunk(size_t index) {
+	auto directory = _directory.load(std::memory_order_relaxed);
+	if(!directory || index >= directory->chunks.size()) {
+		size_t numChunks = directory ? directory->chunks.size() : 1;
+		while(index >= numChunks)
+			numChunks *= 2;
+
+		auto newDirectory = frg::construct<Directory>(*kernelAlloc, numChunks);
+		if(directory) {
+			for(size_t i = 0; i < directory->chunks.size(); ++i)
+				newDirectory->chunks[i].store(
+						directory->chunks[i].load(std::memory_order_relaxed),
+						std::memory_order_relaxed);
+		}
+		_directory.store(newDirectory, std::memory_order_release);
+
+		// Readers may still access the old directory.
+		if(directory) {
+			directory->rcuCallback.setup([] (RcuCallback *base) {
+				auto directory = frg::container_of(base, &Directory::rcuCallback);
+				frg::destruct(*kernelAlloc, directory);
+			});
+			rcuCall(&directory->rcuCallback);
+		}
+		directory = newDirectory;
+	}
+
+	auto chunk = directory->chunks[index].load(std::memory_order_relaxed);
+	if(!chunk) {
+		chunk = frg::construct<Chunk>(*kernelAlloc);
+		// Handle zero is never allocated (it is kHelNullHandle).
+		// This also keeps the first chunk from ever becoming empty.
+		if(!index) {
+			chunk->usedMask[0] |= 1;
+			chunk->numUsed++;
+		}
+		directory->chunks[index].store(chunk, std::memory_order_release);
+	}
+	return chunk;
+}
+
+void Universe::_releaseChunkIfEmpty(size_t index) {
+	auto directory = _directory.load(std::memory_order_relaxed);
+	if(!directory || index >= directory->chunks.size())
+		return;
+	auto chunk = directory->chunks[index].load(std::memory_order_relaxed);
+	if(!chunk || chunk->numUsed)
+		return;
+	directory->chunks[index].store(nullptr, std::memory_order_relaxed);
+
+	// Readers may still access the chunk.
+	chunk->rcuCallback.setup([] (RcuCallback *base) {
+		auto chunk = frg::container_of(base, &Chunk::rcuCallback);
+		frg::destruct(*kernelAlloc, chunk);
+	});
+	rcuCall(&chunk->rcuCallback);
+}
+
+Handle Universe::_allocateHandle() {
+	for(size_t index = _firstFreeChunk; ; ++index) {
+		auto chunk = _ensureChunk(index);
+		if(chunk->numUsed == chunkSize)
+			continue;
+
+		for(size_t w = 0; w < chunkSize / 64; ++w) {
+			if(chunk->usedMask[w] == ~uint64_t{0})
+				continue;
+			size_t bit = __builtin_ctzll(~chunk->usedMask[w]);
+			chunk->usedMask[w] |= uint64_t{1} << bit;
+			chunk->numUsed++;
+			_firstFreeChunk = index;
+			return static_cast<Handle>((index << chunkShift) | (w * 64 + bit));
+		}
+		__builtin_unreachable();
+	}
+}
+
+void Universe::_freeHandle(Handle handle) {
+	size_t index = handle >> chunkShift;
+	size_t bit = handle & (chunkSize - 1);
+
+	auto chunk = _directory.load(std::memory_order_relaxed)->chunks[index].load(
+			std::memory_order_relaxed);
+	assert(chunk->usedMask[bit / 64] & (uint64_t{1} << (bit % 64)));
+	chunk->usedMask[bit / 64] &= ~(uint64_t{1} << (bit % 64));
+	chunk->numUsed--;
 
-	return _descriptorMap.remove(handle);
+	// Keep the chunk that we allocate from next (even if it is empty)
+	// such that we do not repeatedly free and allocate chunks at the boundary.
+	if(index < _firstFreeChunk) {
+		auto previous = _firstFreeChunk;
+		_firstFreeChunk = index;
+		_releaseChunkIfEmpty(previous);
+	}else if(index > _firstFreeChunk) {
+		_releaseChunkIfEmpty(index);
+	}
 }
 
 } // namespace thor
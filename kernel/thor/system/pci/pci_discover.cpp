@@ -785,8 +785,6 @@ void PciDevice::enableIrq() {
 }
 
 void PciDevice::setupMsi(MsiPin *msi, size_t index) {
-	auto io = parentBus->io;
-
 	if (msixIndex >= 0) {
 		// Setup the MSI-X table.
 		auto space = arch::mem_space{msixMapping}.subspace(index * 16);
@@ -799,38 +797,60 @@ void PciDevice::setupMsi(MsiPin *msi, size_t index) {
 
 		// TODO(qookie): support non-zero indices
 		assert(!index);
-		auto offset = caps[msiIndex].offset;
+		_writeMsiMessage(msi);
+		msiInstalled = true;
+	}
 
-		auto msgControl = io->readConfigHalf(parentBus,
-				slot, function, offset + 2);
+	msi->setProgrammer(this, index);
+}
 
-		bool is64Capable = msgControl & (1 << 7);
+void PciDevice::reprogramMsi(MsiPin *msi, size_t index) {
+	if (msixIndex >= 0) {
+		// Mask the vector while its message is updated such that the device
+		// does not observe a partially written message.
+		auto space = arch::mem_space{msixMapping}.subspace(index * 16);
+		auto vectorControl = space.load(msixVectorControl);
+		space.store(msixVectorControl, vectorControl | 1);
+		space.store(msixMessageAddress, msi->getMessageAddress());
+		space.store(msixMessageData, msi->getMessageData());
+		space.store(msixVectorControl, vectorControl);
+	} else {
+		assert(!index);
+		_writeMsiMessage(msi);
+	}
+}
 
-		io->writeConfigWord(parentBus,
-				slot, function, offset + 4, msi->getMessageAddress() & 0xFFFFFFFF);
+void PciDevice::_writeMsiMessage(MsiPin *msi) {
+	auto io = parentBus->io;
+	auto offset = caps[msiIndex].offset;
 
-		if (is64Capable) {
-			io->writeConfigWord(parentBus,
-				slot, function, offset + 8, msi->getMessageAddress() >> 32);
+	auto msgControl = io->readConfigHalf(parentBus,
+			slot, function, offset + 2);
 
-			io->writeConfigHalf(parentBus,
-				slot, function, offset + 12, msi->getMessageData());
-		} else {
-			assert(!(msi->getMessageAddress() >> 32));
+	bool is64Capable = msgControl & (1 << 7);
 
-			io->writeConfigHalf(parentBus,
-				slot, function, offset + 8, msi->getMessageData());
-		}
+	io->writeConfigWord(parentBus,
+			slot, function, offset + 4, msi->getMessageAddress() & 0xFFFFFFFF);
 
-		if (msiEnabled) {
-			// Enable MSI
-			msgControl |= 0x0001;
+	if (is64Capable) {
+		io->writeConfigWord(parentBus,
+			slot, function, offset + 8, msi->getMessageAddress() >> 32);
 
-			io->writeConfigHalf(parentBus,
-					slot, function, offset + 2, msgControl);
-		}
+		io->writeConfigHalf(parentBus,
+			slot, function, offset + 12, msi->getMessageData());
+	} else {
+		assert(!(msi->getMessageAddress() >> 32));
 
-		msiInstalled = true;
+		io->writeConfigHalf(parentBus,
+			slot, function, offset + 8, msi->getMessageData());
+	}
+
+	if (msiEnabled) {
+		// Enable MSI
+		msgControl |= 0x0001;
+
+		io->writeConfigHalf(parentBus,
+				slot, function, offset + 2, msgControl);
 	}
 }
 
@@ -354,7 +354,7 @@ struct PciBridge final : PciEntity {
 	async::oneshot_event mbusPublished;
 };
 
-struct PciDevice final : PciEntity {
+struct PciDevice final : PciEntity, MsiProgrammer {
 	PciDevice(PciBus *parentBus_, uint32_t seg, uint32_t bus, uint32_t slot, uint32_t function,
 			uint16_t vendor, uint16_t device_id, uint8_t revision,
 			uint8_t class_code, uint8_t sub_class, uint8_t interface, uint16_t subsystem_vendor, uint16_t subsystem_device)
@@ -377,6 +377,9 @@ struct PciDevice final : PciEntity {
 	void setupMsi(MsiPin *msi, size_t index);
 	void enableMsi();
 
+	// Called if the MSI is routed to a different CPU.
+	void reprogramMsi(MsiPin *msi, size_t index) override;
+
 	uint16_t subsystemVendor;
 	uint16_t subsystemDevice;
 
@@ -393,6 +396,10 @@ struct PciDevice final : PciEntity {
 	// Device attachments.
 	FbInfo *associatedFrameBuffer;
 	BootScreen *associatedScreen;
+
+private:
+	// Writes the message address and data to the MSI capability.
+	void _writeMsiMessage(MsiPin *msi);
 };
 
 enum {
@@ -36,8 +36,7 @@ parseElfPreamble(SharedFilePtr file) {
 
 	// Read the elf file header and verify the signature.
 	Elf64_Ehdr ehdr;
-	FRG_CO_TRY(co_await file->seek(0, VfsSeek::absolute));
-	FRG_CO_TRY(co_await file->readExactly(nullptr, &ehdr, sizeof(Elf64_Ehdr)));
+	FRG_CO_TRY(co_await file->preadExactly(nullptr, 0, &ehdr, sizeof(Elf64_Ehdr)));
 
 	if(!(ehdr.e_ident[0] == 0x7F
 			&& ehdr.e_ident[1] == 'E'
@@ -65,8 +64,7 @@ loadElfImage(SharedFilePtr file, VmContext *vmContext, uintptr_t base) {
 
 	// Read the elf file header and verify the signature.
 	Elf64_Ehdr ehdr;
-	FRG_CO_TRY(co_await file->seek(0, VfsSeek::absolute));
-	FRG_CO_TRY(co_await file->readExactly(nullptr, &ehdr, sizeof(Elf64_Ehdr)));
+	FRG_CO_TRY(co_await file->preadExactly(nullptr, 0, &ehdr, sizeof(Elf64_Ehdr)));
 
 	// Verify the ELF file again, since loadElfPreamble() is not necessarily called
 	// on every object that we load.
@@ -85,8 +83,7 @@ loadElfImage(SharedFilePtr file, VmContext *vmContext, uintptr_t base) {
 	// Read the elf program headers and load them into the address space.
 	std::vector<char> phdrBuffer;
 	phdrBuffer.resize(ehdr.e_phnum * ehdr.e_phentsize);
-	FRG_CO_TRY(co_await file->seek(ehdr.e_phoff, VfsSeek::absolute));
-	FRG_CO_TRY(co_await file->readExactly(nullptr,
+	FRG_CO_TRY(co_await file->preadExactly(nullptr, ehdr.e_phoff,
 			phdrBuffer.data(), ehdr.e_phnum * size_t(ehdr.e_phentsize)));
 
 	for(int i = 0; i < ehdr.e_phnum; i++) {
@@ -153,8 +150,7 @@ loadElfImage(SharedFilePtr file, VmContext *vmContext, uintptr_t base) {
 
 				// Read the segment contents from the file.
 				memset(window, 0, mapLength);
-				FRG_CO_TRY(co_await file->seek(phdr->p_offset, VfsSeek::absolute));
-				FRG_CO_TRY(co_await file->readExactly(nullptr,
+				FRG_CO_TRY(co_await file->preadExactly(nullptr, phdr->p_offset,
 						(char *)window + misalign, phdr->p_filesz));
 				HEL_CHECK(helUnmapMemory(kHelNullHandle, window, mapLength));
 			}
@@ -162,8 +158,7 @@ loadElfImage(SharedFilePtr file, VmContext *vmContext, uintptr_t base) {
 			info.phdrPtr = (char *)base + phdr->p_vaddr;
 		}else if(phdr->p_type == PT_INTERP) {
 			info.interpreter.resize(phdr->p_filesz);
-			FRG_CO_TRY(co_await file->seek(phdr->p_offset, VfsSeek::absolute));
-			FRG_CO_TRY(co_await file->readExactly(nullptr,
+			FRG_CO_TRY(co_await file->preadExactly(nullptr, phdr->p_offset,
 					info.interpreter.data(), phdr->p_filesz));
 			if(size_t n = info.interpreter.find('\0'); n != size_t(-1))
 				info.interpreter.resize(n);
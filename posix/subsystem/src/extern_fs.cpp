@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <async/cancellation.hpp>
 #include <sys/epoll.h>
+#include <list>
 #include <map>
+#include <optional>
 
 #include <bragi/helpers-std.hpp>
 #include <frg/std_compat.hpp>
@@ -19,6 +22,119 @@ namespace {
 struct Node;
 struct DirectoryNode;
 
+DentryCacheStats dentryCacheStats;
+PageCacheStats pageCacheStats;
+
+// Granularity at which servers size the memory objects of regular files.
+constexpr size_t pageSize = 0x1000;
+
+// Caches the results of name lookups in directories of the file system.
+// Positive entries keep the link alive; negative entries (link == nullptr) record
+// that a name does not exist. The cache is bounded and evicts entries in LRU order.
+struct DentryCache {
+	static constexpr size_t maxEntries = 4096;
+
+	// Returns std::nullopt on cache misses.
+	std::optional<std::shared_ptr<FsLink>> find(uint64_t directory, const std::string &name) {
+		if(!isCacheable(name))
+			return std::nullopt;
+
+		auto it = _entries.find({directory, name});
+		if(it == _entries.end()) {
+			dentryCacheStats.misses++;
+			return std::nullopt;
+		}
+
+		_lru.splice(_lru.begin(), _lru, it->second);
+		if(it->second->link) {
+			dentryCacheStats.hits++;
+		}else{
+			dentryCacheStats.negativeHits++;
+		}
+		return it->second->link;
+	}
+
+	// Lookups take a snapshot of generation() before they contact the server.
+	// If entries were invalidated in the meantime, the result may be stale and is dropped.
+	void insert(uint64_t directory, std::string name, std::shared_ptr<FsLink> link,
+			uint64_t generation) {
+		if(!isCacheable(name) || generation != _generation)
+			return;
+
+		auto it = _entries.find({directory, name});
+		if(it != _entries.end())
+			_erase(it);
+
+		if(_entries.size() == maxEntries) {
+			_erase(_entries.find(_lru.back().key));
+			dentryCacheStats.evictions++;
+		}
+
+		Key key{directory, std::move(name)};
+		if(!link)
+			dentryCacheStats.negativeEntries++;
+		dentryCacheStats.entries++;
+		_lru.push_front({key, std::move(link)});
+		_entries.emplace(std::move(key), _lru.begin());
+	}
+
+	void invalidate(uint64_t directory, const std::string &name) {
+		_generation++;
+		auto it = _entries.find({directory, name});
+		if(it == _entries.end())
+			return;
+		_erase(it);
+		dentryCacheStats.invalidations++;
+	}
+
+	// Invalidates all entries of a directory.
+	void invalidateDirectory(uint64_t directory) {
+		_generation++;
+		auto it = _entries.lower_bound({directory, std::string{}});
+		while(it != _entries.end() && it->first.first == directory) {
+			_erase(it++);
+			dentryCacheStats.invalidations++;
+		}
+	}
+
+	void clear() {
+		_generation++;
+		while(!_entries.empty())
+			_erase(_entries.begin());
+		dentryCacheStats.flushes++;
+	}
+
+	uint64_t generation() {
+		return _generation;
+	}
+
+private:
+	using Key = std::pair<uint64_t, std::string>;
+
+	struct Entry {
+		Key key;
+		std::shared_ptr<FsLink> link;
+	};
+
+	static bool isCacheable(const std::string &name) {
+		return !name.empty() && name != "." && name != "..";
+	}
+
+	void _erase(std::map<Key, std::list<Entry>::iterator>::iterator it) {
+		if(!it->second->link)
+			dentryCacheStats.negativeEntries--;
+		dentryCacheStats.entries--;
+		_lru.erase(it->second);
+		_entries.erase(it);
+	}
+
+	// Ordered by directory such that invalidateDirectory() can iterate over a range.
+	std::map<Key, std::list<Entry>::iterator> _entries;
+	// Most recently used entries come first.
+	std::list<Entry> _lru;
+	uint64_t _generation = 0;
+};
+
 struct Superblock final : FsSuperblock {
 	Superblock(helix::UniqueLane lane, std::shared_ptr<UnixDevice> device);
 
@@ -45,6 +161,12 @@ struct Superblock final : FsSuperblock {
 	std::shared_ptr<FsLink> internalizePeripheralLink(Node *parent, std::string name,
 			std::shared_ptr<Node> target);
 
+	// Applies invalidations that are sent by the server for changes
+	// that did not go through this superblock.
+	async::detached pollInvalidations();
+
+	DentryCache dentryCache;
+
 private:
 	helix::UniqueLane _lane;
 	std::map<uint64_t, std::weak_ptr<DirectoryNode>> _activeStructural;
@@ -189,6 +311,16 @@ private:
 	helix::UniqueLane _lane;
 };
 
+// posix' view of the page cache of a regular file (i.e., of the server's frontal memory).
+// Reads are served from the memory object directly. The file size is not cached:
+// requests on the passthrough lane (e.g., PT_WRITE, PT_TRUNCATE and PT_FALLOCATE)
+// bypass posix. Instead, we rely on the server keeping the memory object at the file size
+// rounded up to whole pages. All pages but the last one are thus entirely within the file;
+// reads that touch the last page are sent to the server.
+struct PageCache {
+	helix::UniqueDescriptor memory;
+};
+
 struct OpenFile final : File {
 private:
 	async::result<frg::expected<Error, off_t>> seek(off_t offset, VfsSeek whence) override {
@@ -209,6 +341,20 @@ private:
 		co_return res;
 	}
 
+	async::result<std::expected<size_t, Error>>
+	pread(Process *, int64_t offset, void *buffer, size_t length) override {
+		if(offset < 0)
+			co_return std::unexpected{Error::illegalArguments};
+
+		if(_pageCache) {
+			if(auto chunk = co_await _readCached(offset, buffer, length); chunk)
+				co_return *chunk;
+		}
+
+		auto res = co_await _file.pread(offset, buffer, length);
+		co_return res.transform_error(toPosixError);
+	}
+
 	// TODO: Ensure that the process is null? Pass credentials of the thread in the request?
 	async::result<std::expected<size_t, Error>>
 	readSome(Process *, void *data, size_t max_length, async::cancellation_token ce) override {
@@ -245,9 +391,11 @@ private:
 
 public:
 	OpenFile(helix::UniqueLane control, helix::UniqueLane lane,
-			std::shared_ptr<MountView> mount, std::shared_ptr<FsLink> link)
+			std::shared_ptr<MountView> mount, std::shared_ptr<FsLink> link,
+			std::shared_ptr<PageCache> pageCache = nullptr)
 	: File{FileKind::unknown, StructName::get("externfs.file"), std::move(mount), std::move(link)},
-			_control{std::move(control)}, _file{std::move(lane)} { }
+			_control{std::move(control)}, _file{std::move(lane)},
+			_pageCache{std::move(pageCache)} { }
 
 	~OpenFile() override {
 		// It's not necessary to do any cleanup here.
@@ -284,8 +432,37 @@ public:
 	}
 
 private:
+	// Returns std::nullopt if the read needs to be sent to the server.
+	async::result<std::optional<size_t>> _readCached(size_t offset, void *buffer, size_t length) {
+		if(!_pageCache->memory) {
+			auto memory = co_await _file.accessMemory();
+			if(!_pageCache->memory)
+				_pageCache->memory = std::move(memory);
+		}
+		// This is a syscall, not a request to the server.
+		size_t memorySize;
+		HEL_CHECK(helMemoryInfo(_pageCache->memory.getHandle(), &memorySize));
+		if(!length || memorySize < pageSize || offset + length > memorySize - pageSize) {
+			pageCacheStats.misses++;
+			co_return std::nullopt;
+		}
+
+		auto readMemory = co_await helix_ng::readMemory(_pageCache->memory,
+				offset, length, buffer);
+		if(readMemory.error()) {
+			// The memory object shrank, i.e., the file was truncated concurrently.
+			pageCacheStats.misses++;
+			co_return std::nullopt;
+		}
+
+		pageCacheStats.hits++;
+		co_return length;
+	}
+
 	helix::UniqueLane _control;
 	protocols::fs::File _file;
+	// Shared by all open files of a regular node; null for other files.
+	std::shared_ptr<PageCache> _pageCache;
 };
 
 struct RegularNode final : Node {
@@ -335,7 +512,8 @@ private:
 			co_return resp.error() | toPosixError;
 
 		auto file = smarter::make_shared<OpenFile>(pull_ctrl.descriptor(),
-				pull_passthrough.descriptor(), std::move(mount), std::move(link));
+				pull_passthrough.descriptor(), std::move(mount), std::move(link),
+				_pageCache);
 		file->setupWeakFile(file);
 		co_return File::constructHandle(std::move(file));
 	}
@@ -343,6 +521,10 @@ private:
 public:
 	RegularNode(Superblock *sb, uint64_t inode, helix::UniqueLane lane)
 	: Node{inode, std::move(lane), sb} { }
+
+private:
+	// The memory object is only acquired on the first read that posix performs.
+	std::shared_ptr<PageCache> _pageCache = std::make_shared<PageCache>();
 };
 
 struct SymlinkNode final : Node {
@@ -516,18 +698,22 @@ private:
 		managarm::fs::GetLinkOrCreateResponse resp;
 		resp.ParseFromArray(recv_resp.data(), recv_resp.length());
 		recv_resp.reset();
+		_sb->dentryCache.invalidate(getInode(), name);
 		if(resp.error() == managarm::fs::Errors::SUCCESS) {
 			HEL_CHECK(pull_node.error());
 
+			std::shared_ptr<FsLink> link;
 			if (resp.file_type() == managarm::fs::FileType::DIRECTORY) {
 				auto child = _sb->internalizeStructural(this, name,
 						resp.id(), pull_node.descriptor());
-				co_return child->treeLink();
+				link = child->treeLink();
 			}else{
 				auto child = _sb->internalizePeripheralNode(resp.file_type(), resp.id(),
 						pull_node.descriptor());
-				co_return _sb->internalizePeripheralLink(this, name, std::move(child));
+				link = _sb->internalizePeripheralLink(this, name, std::move(child));
 			}
+			_sb->dentryCache.insert(getInode(), name, link, _sb->dentryCache.generation());
+			co_return link;
 		} else {
 			co_return std::unexpected{resp.error() | toPosixError};
 		}
@@ -535,6 +721,18 @@ private:
 
 	async::result<frg::expected<Error, std::pair<std::shared_ptr<FsLink>, size_t>>>
 	traverseLinks(std::deque<std::string> path) override {
+		// Only the first component is resolved from the cache;
+		// the VFS calls us again for the remaining components.
+		if(!path.empty()) {
+			auto cached = _sb->dentryCache.find(getInode(), path.front());
+			if(cached) {
+				if(!*cached)
+					co_return Error::noSuchFile;
+				co_return std::make_pair(*cached, size_t{1});
+			}
+		}
+		auto generation = _sb->dentryCache.generation();
+
 		managarm::fs::NodeTraverseLinksRequest req;
 		for (auto &i : path)
 			req.add_path_segments(i);
@@ -575,8 +773,12 @@ private:
 		auto resp = *bragi::parse_head_tail<managarm::fs::NodeTraverseLinksResponse>(recv_resp, tail);
 		recv_resp.reset();
 
-		if(resp.error() != managarm::fs::Errors::SUCCESS)
+		if(resp.error() != managarm::fs::Errors::SUCCESS) {
+			// We do not know which component is missing unless there is only one.
+			if(resp.error() == managarm::fs::Errors::FILE_NOT_FOUND && path.size() == 1)
+				_sb->dentryCache.insert(getInode(), path.front(), nullptr, generation);
 			co_return resp.error() | toPosixError;
+		}
 
 		HEL_CHECK(pull_desc.error());
 		helix::UniqueLane pull_lane = pull_desc.descriptor();
@@ -584,6 +786,10 @@ private:
 		assert(resp.links_traversed());
 		assert(resp.links_traversed() <= path.size());
 
+		// The server pops a component for each "..", hence ids no longer line up with path.
+		bool cacheable = std::none_of(path.begin(), path.begin() + resp.links_traversed(),
+				[] (const std::string &segment) { return segment == "." || segment == ".."; });
+
 		std::shared_ptr<Node> parentNode{weakNode()};
 		for (size_t i = 0; i < resp.ids().size(); i++) {
 			auto [pull_node] = co_await helix_ng::exchangeMsgs(
@@ -593,19 +799,26 @@ private:
 
 			HEL_CHECK(pull_node.error());
 
+			std::shared_ptr<FsLink> childLink;
+			auto parentInode = parentNode->getInode();
 			if (i != resp.ids().size() - 1
 					|| resp.file_type() == managarm::fs::FileType::DIRECTORY) {
 				auto child = _sb->internalizeStructural(parentNode.get(), path[i],
 						resp.ids()[i], pull_node.descriptor());
+				childLink = child->treeLink();
 				if (i != resp.ids().size() - 1)
 					parentNode = child;
 				else
-					link = child->treeLink();
+					link = childLink;
 			}else{
 				auto child = _sb->internalizePeripheralNode(resp.file_type(), resp.ids()[i],
 						pull_node.descriptor());
-				link = _sb->internalizePeripheralLink(parentNode.get(), path[i], std::move(child));
+				childLink = _sb->internalizePeripheralLink(parentNode.get(), path[i], std::move(child));
+				link = childLink;
 			}
+
+			if(cacheable)
+				_sb->dentryCache.insert(parentInode, path[i], std::move(childLink), generation);
 		}
 
 		co_return std::make_pair(link, resp.links_traversed());
@@ -632,12 +845,15 @@ private:
 		managarm::fs::SvrResponse resp;
 		resp.ParseFromArray(recvResp.data(), recvResp.length());
 		recvResp.reset();
+		_sb->dentryCache.invalidate(getInode(), name);
 		if(resp.error() == managarm::fs::Errors::SUCCESS) {
 			HEL_CHECK(pullNode.error());
 
 			auto child = _sb->internalizeStructural(this, name,
 					resp.id(), pullNode.descriptor());
-			co_return child->treeLink();
+			auto link = child->treeLink();
+			_sb->dentryCache.insert(getInode(), name, link, _sb->dentryCache.generation());
+			co_return link;
 		} else {
 			co_return resp.error() | toPosixError;
 		}
@@ -670,12 +886,15 @@ private:
 		managarm::fs::SvrResponse resp;
 		resp.ParseFromArray(recvResp.data(), recvResp.length());
 		recvResp.reset();
+		_sb->dentryCache.invalidate(getInode(), name);
 		if(resp.error() == managarm::fs::Errors::SUCCESS) {
 			HEL_CHECK(pullNode.error());
 
 			auto child = _sb->internalizeStructural(this, name,
 					resp.id(), pullNode.descriptor());
-			co_return child->treeLink();
+			auto link = child->treeLink();
+			_sb->dentryCache.insert(getInode(), name, link, _sb->dentryCache.generation());
+			co_return link;
 		} else {
 			co_return resp.error() | toPosixError;
 		}
@@ -691,6 +910,14 @@ private:
 
 	async::result<frg::expected<Error, std::shared_ptr<FsLink>>>
 			getLink(std::string name) override {
+		auto cached = _sb->dentryCache.find(getInode(), name);
+		if(cached) {
+			if(!*cached)
+				co_return Error::noSuchFile;
+			co_return *cached;
+		}
+		auto generation = _sb->dentryCache.generation();
+
 		managarm::fs::GetLinkRequest req;
 		req.set_path(name);
 
@@ -713,16 +940,21 @@ private:
 		if(resp.error() == managarm::fs::Errors::SUCCESS) {
 			HEL_CHECK(pull_node.error());
 
+			std::shared_ptr<FsLink> link;
 			if(resp.file_type() == managarm::fs::FileType::DIRECTORY) {
 				auto child = _sb->internalizeStructural(this, name,
 						resp.id(), pull_node.descriptor());
-				co_return child->treeLink();
+				link = child->treeLink();
 			}else{
 				auto child = _sb->internalizePeripheralNode(resp.file_type(), resp.id(),
 						pull_node.descriptor());
-				co_return _sb->internalizePeripheralLink(this, name, std::move(child));
+				link = _sb->internalizePeripheralLink(this, name, std::move(child));
 			}
+			_sb->dentryCache.insert(getInode(), name, link, generation);
+			co_return link;
 		}else{
+			if(resp.error() == managarm::fs::Errors::FILE_NOT_FOUND)
+				_sb->dentryCache.insert(getInode(), name, nullptr, generation);
 			co_return resp.error() | toPosixError;
 		}
 	}
@@ -749,18 +981,22 @@ private:
 		managarm::fs::SvrResponse resp;
 		resp.ParseFromArray(recv_resp.data(), recv_resp.length());
 		recv_resp.reset();
+		_sb->dentryCache.invalidate(getInode(), name);
 		if(resp.error() == managarm::fs::Errors::SUCCESS) {
 			HEL_CHECK(pull_node.error());
 
+			std::shared_ptr<FsLink> link;
 			if(resp.file_type() == managarm::fs::FileType::DIRECTORY) {
 				auto child = _sb->internalizeStructural(this, name,
 						resp.id(), pull_node.descriptor());
-				co_return child->treeLink();
+				link = child->treeLink();
 			}else{
 				auto child = _sb->internalizePeripheralNode(resp.file_type(), resp.id(),
 						pull_node.descriptor());
-				co_return _sb->internalizePeripheralLink(this, name, std::move(child));
+				link = _sb->internalizePeripheralLink(this, name, std::move(child));
 			}
+			_sb->dentryCache.insert(getInode(), name, link, _sb->dentryCache.generation());
+			co_return link;
 		}else{
 			co_return nullptr;
 		}
@@ -785,6 +1021,7 @@ private:
 		managarm::fs::SvrResponse resp;
 		resp.ParseFromArray(recv_resp.data(), recv_resp.length());
 		recv_resp.reset();
+		_sb->dentryCache.invalidate(getInode(), name);
 		if(resp.error() != managarm::fs::Errors::SUCCESS)
 			co_return resp.error() | toPosixError;
 
@@ -810,6 +1047,7 @@ private:
 		managarm::fs::SvrResponse resp;
 		resp.ParseFromArray(recv_resp.data(), recv_resp.length());
 		recv_resp.reset();
+		_sb->dentryCache.invalidate(getInode(), name);
 
 		if(resp.error() != managarm::fs::Errors::SUCCESS)
 			co_return resp.error() | toPosixError;
@@ -949,6 +1187,8 @@ async::result<frg::expected<Error, std::shared_ptr<FsLink>>>
 	managarm::fs::SvrResponse resp;
 	resp.ParseFromArray(recv_resp.data(), recv_resp.length());
 	recv_resp.reset();
+	dentryCache.invalidate(source_node->getInode(), req.old_name());
+	dentryCache.invalidate(target_node->getInode(), name);
 	if(resp.error() == managarm::fs::Errors::SUCCESS) {
 		co_return internalizePeripheralLink(target_node, name, shared_node);
 	}else{
@@ -962,6 +1202,9 @@ std::shared_ptr<Node> Superblock::internalizeStructural(uint64_t id, helix::Uniq
 	if(intern)
 		return intern;
 
+	// Entries that are left over from a previous directory with the same inode number are stale.
+	dentryCache.invalidateDirectory(id);
+
 	auto node = std::make_shared<DirectoryNode>(this, id, std::move(lane));
 	node->setupWeakNode(node);
 	*entry = node;
@@ -975,6 +1218,8 @@ std::shared_ptr<Node> Superblock::internalizeStructural(Node *parent, std::strin
 	if(intern)
 		return intern;
 
+	dentryCache.invalidateDirectory(id);
+
 	auto owner = std::shared_ptr<Node>{parent->weakNode()};
 	auto node = std::make_shared<DirectoryNode>(this, owner, std::move(name), id, std::move(lane));
 	node->setupWeakNode(node);
@@ -1059,15 +1304,77 @@ async::result<frg::expected<Error, FsStats>> Superblock::getFsStats() {
 	co_return stats;
 }
 
+async::detached Superblock::pollInvalidations() {
+	uint64_t sequence = 0;
+	while(true) {
+		managarm::fs::AwaitInvalidationRequest req;
+		req.set_sequence(sequence);
+
+		auto [offer, send_req, recv_resp] = co_await helix_ng::exchangeMsgs(
+			_lane,
+			helix_ng::offer(
+				helix_ng::want_lane,
+				helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+				helix_ng::recvInline()
+			)
+		);
+		HEL_CHECK(offer.error());
+		auto conversation = offer.descriptor();
+		HEL_CHECK(send_req.error());
+		// File systems that do not support invalidations dismiss the request.
+		if(recv_resp.error() == kHelErrDismissed)
+			co_return;
+		HEL_CHECK(recv_resp.error());
+
+		auto preamble = bragi::read_preamble(recv_resp);
+		assert(!preamble.error());
+
+		std::vector<uint8_t> tail(preamble.tail_size());
+		auto [recv_tail] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvBuffer(tail.data(), tail.size())
+		);
+		HEL_CHECK(recv_tail.error());
+
+		auto resp = *bragi::parse_head_tail<managarm::fs::AwaitInvalidationResponse>(recv_resp, tail);
+		recv_resp.reset();
+		if(resp.error() != managarm::fs::Errors::SUCCESS)
+			co_return;
+
+		if(resp.overflow()) {
+			dentryCache.clear();
+		}else{
+			assert(resp.directories().size() == resp.names().size());
+			for(size_t i = 0; i < resp.directories().size(); i++) {
+				if(resp.names()[i].empty()) {
+					dentryCache.invalidateDirectory(resp.directories()[i]);
+				}else{
+					dentryCache.invalidate(resp.directories()[i], resp.names()[i]);
+				}
+			}
+		}
+		sequence = resp.sequence();
+	}
+}
+
 } // anonymous namespace
 
 std::shared_ptr<FsLink> createRoot(helix::UniqueLane sb_lane, helix::UniqueLane lane, std::shared_ptr<UnixDevice> device) {
 	auto sb = new Superblock{std::move(sb_lane), device};
+	sb->pollInvalidations();
 	// FIXME: 2 is the ext2fs root inode.
 	auto node = sb->internalizeStructural(2, std::move(lane));
 	return node->treeLink();
 }
 
+DentryCacheStats getDentryCacheStats() {
+	return dentryCacheStats;
+}
+
+PageCacheStats getPageCacheStats() {
+	return pageCacheStats;
+}
+
 smarter::shared_ptr<File, FileHandle>
 createFile(helix::UniqueLane lane, std::shared_ptr<MountView> mount, std::shared_ptr<FsLink> link) {
 	auto file = smarter::make_shared<OpenFile>(helix::UniqueLane{},
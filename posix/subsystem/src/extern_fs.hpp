@@ -5,6 +5,29 @@
 
 namespace extern_fs {
 
+struct DentryCacheStats {
+	uint64_t entries = 0;
+	uint64_t negativeEntries = 0;
+	uint64_t hits = 0;
+	uint64_t negativeHits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+	uint64_t invalidations = 0;
+	uint64_t flushes = 0;
+};
+
+// Returns the statistics of the lookup caches of all extern_fs superblocks.
+DentryCacheStats getDentryCacheStats();
+
+struct PageCacheStats {
+	// Reads whose data was served from the page cache (i.e., without a read request to the server).
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+};
+
+// Returns the statistics of reads that posix itself performs on extern_fs files.
+PageCacheStats getPageCacheStats();
+
 std::shared_ptr<FsLink> createRoot(helix::UniqueLane sb_lane, helix::UniqueLane lane, std::shared_ptr<UnixDevice> device);
 
 smarter::shared_ptr<File, FileHandle>
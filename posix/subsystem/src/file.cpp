@@ -266,6 +266,26 @@ async::result<frg::expected<Error>> File::readExactly(Process *process,
 	co_return {};
 }
 
+async::result<frg::expected<Error>> File::preadExactly(Process *process,
+		int64_t offset, void *data, size_t length) {
+	size_t progress = 0;
+	while(progress < length) {
+		auto result = co_await pread(process, offset + progress,
+				(char *)data + progress, length - progress);
+		if (!result.has_value())
+			co_return Error::eof;
+
+		if (!result.value()) {
+			std::println("posix: pread returned zero unexpectedly!");
+			co_return Error::eof;
+		}
+
+		progress += result.value();
+	}
+
+	co_return {};
+}
+
 async::result<std::expected<size_t, Error>>
 File::readSome(Process *, void *, size_t, async::cancellation_token) {
 	std::cout << "\e[35mposix \e[1;34m" << structName()
@@ -468,6 +468,11 @@ public:
 
 	async::result<frg::expected<Error>> readExactly(Process *process, void *data, size_t length);
 
+	// Like readExactly() but uses pread(), i.e., it does not modify the file offset.
+	// Files that are backed by a page cache can serve this without a server round trip.
+	async::result<frg::expected<Error>> preadExactly(Process *process,
+			int64_t offset, void *data, size_t length);
+
 	virtual async::result<frg::expected<Error, off_t>>
 	seek(off_t offset, VfsSeek whence);
 
@@ -1,3 +1,5 @@
+#include <helix/clock.hpp>
+
 #include "interval-timer.hpp"
 
 namespace {
@@ -43,8 +45,7 @@ async::detached IntervalTimer::arm(std::shared_ptr<IntervalTimer> timer) {
 }
 
 void IntervalTimer::getTime(uint64_t &initial, uint64_t &interval) {
-	uint64_t now;
-	HEL_CHECK(helGetClock(&now));
+	auto now = helix::getClockNanos();
 
 	if(nextExpiration_ > now)
 		initial = nextExpiration_ - now;
@@ -109,3 +109,15 @@ MemoryFile::readSome(Process *, void *data, size_t max_length, async::cancellati
 	_offset += read_len;
 	co_return read_len;
 }
+
+async::result<std::expected<size_t, Error>>
+MemoryFile::pread(Process *, int64_t offset, void *buffer, size_t length) {
+	if(offset < 0)
+		co_return std::unexpected{Error::illegalArguments};
+	if(static_cast<size_t>(offset) >= _fileSize)
+		co_return std::unexpected{Error::eof};
+
+	auto read_len = std::min(_fileSize - offset, length);
+	memcpy(buffer, reinterpret_cast<std::byte *>(_mapping.get()) + offset, read_len);
+	co_return read_len;
+}
@@ -36,6 +36,9 @@ public:
 	async::result<std::expected<size_t, Error>>
 	readSome(Process *process, void *data, size_t max_length, async::cancellation_token ct) override;
 
+	async::result<std::expected<size_t, Error>>
+	pread(Process *process, int64_t offset, void *buffer, size_t length) override;
+
 	FutureMaybe<helix::UniqueDescriptor> accessMemory() override;
 
 	helix::BorrowedDescriptor getPassthroughLane() override {
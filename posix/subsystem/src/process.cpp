@@ -180,7 +180,9 @@ VmContext::mapFile(uintptr_t hint, helix::UniqueDescriptor memory,
 	Area area;
 	area.copyOnWrite = copyOnWrite;
 	area.areaSize = alignedSize;
-	area.nativeFlags = nativeFlags;
+	// Populating only applies to the initial mapping, not to mappings
+	// that are re-created by fork() or mremap().
+	area.nativeFlags = nativeFlags & ~uint32_t{kHelMapPopulate};
 	area.fileView = std::move(memory);
 	area.copyView = std::move(copyView);
 	area.file = std::move(file);
@@ -8,6 +8,7 @@
 
 #include <core/clock.hpp>
 #include "common.hpp"
+#include "extern_fs.hpp"
 #include "procfs.hpp"
 #include "process.hpp"
 #include "protocols/fs/common.hpp"
@@ -311,6 +312,8 @@ std::shared_ptr<Link> DirectoryNode::createRootDirectory() {
 	auto kernel = std::static_pointer_cast<DirectoryNode>(kernelLink->getTarget());
 	auto randomLink = kernel->directMkdir("random");
 	auto random = std::static_pointer_cast<DirectoryNode>(randomLink->getTarget());
+	auto fsLink = sys->directMkdir("fs");
+	auto fs = std::static_pointer_cast<DirectoryNode>(fsLink->getTarget());
 
 	kernel->directMkregular("ostype", std::make_shared<OstypeNode>());
 	kernel->directMkregular("osrelease", std::make_shared<OsreleaseNode>());
@@ -318,6 +321,9 @@ std::shared_ptr<Link> DirectoryNode::createRootDirectory() {
 
 	random->directMkregular("boot_id", std::make_shared<BootIdNode>());
 
+	fs->directMkregular("dentry-stats", std::make_shared<DentryStatsNode>());
+	fs->directMkregular("page-cache-stats", std::make_shared<PageCacheStatsNode>());
+
 	return link;
 }
 
@@ -595,6 +601,43 @@ async::result<void> BootIdNode::store(std::string) {
 	co_return;
 }
 
+async::result<std::expected<std::string, Error>> DentryStatsNode::show(Process *) {
+	// Statistics of the lookup cache for extern (i.e., disk-based) file systems.
+	auto stats = extern_fs::getDentryCacheStats();
+	std::stringstream stream;
+	stream << "entries: " << stats.entries << "\n";
+	stream << "negative_entries: " << stats.negativeEntries << "\n";
+	stream << "hits: " << stats.hits << "\n";
+	stream << "negative_hits: " << stats.negativeHits << "\n";
+	stream << "misses: " << stats.misses << "\n";
+	stream << "evictions: " << stats.evictions << "\n";
+	stream << "invalidations: " << stats.invalidations << "\n";
+	stream << "flushes: " << stats.flushes << "\n";
+	co_return stream.str();
+}
+
+async::result<void> DentryStatsNode::store(std::string) {
+	// TODO: proper error reporting.
+	std::cout << "posix: Can't store to a /proc/sys/fs/dentry-stats file" << std::endl;
+	co_return;
+}
+
+async::result<std::expected<std::string, Error>> PageCacheStatsNode::show(Process *) {
+	// Reads that posix performs on extern files (e.g., during exec).
+	// Each hit is a read that was served without any request to the file system server.
+	auto stats = extern_fs::getPageCacheStats();
+	std::stringstream stream;
+	stream << "hits: " << stats.hits << "\n";
+	stream << "misses: " << stats.misses << "\n";
+	co_return stream.str();
+}
+
+async::result<void> PageCacheStatsNode::store(std::string) {
+	// TODO: proper error reporting.
+	std::cout << "posix: Can't store to a /proc/sys/fs/page-cache-stats file" << std::endl;
+	co_return;
+}
+
 expected<std::string> SelfLink::readSymlink(FsLink *, Process *process) {
 	co_return "/proc/" + std::to_string(process->pid());
 }
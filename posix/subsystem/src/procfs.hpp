@@ -289,6 +289,20 @@ struct ArchNode final : RegularNode {
 	async::result<void> store(std::string) override;
 };
 
+struct DentryStatsNode final : RegularNode {
+	DentryStatsNode() {}
+
+	async::result<std::expected<std::string, Error>> show(Process *) override;
+	async::result<void> store(std::string) override;
+};
+
+struct PageCacheStatsNode final : RegularNode {
+	PageCacheStatsNode() {}
+
+	async::result<std::expected<std::string, Error>> show(Process *) override;
+	async::result<void> store(std::string) override;
+};
+
 struct BootIdNode final : RegularNode {
 	BootIdNode();
 
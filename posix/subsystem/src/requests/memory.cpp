@@ -41,6 +41,9 @@ async::result<void> handleVmMap(RequestContext& ctx) {
 	else if(req->flags() & MAP_FIXED)
 		nativeFlags |= kHelMapFixed;
 
+	if(req->flags() & MAP_POPULATE)
+		nativeFlags |= kHelMapPopulate;
+
 	bool copyOnWrite;
 	if((req->flags() & (MAP_PRIVATE | MAP_SHARED)) == MAP_PRIVATE) {
 		copyOnWrite = true;
@@ -27,6 +27,7 @@ struct File {
 	async::result<int64_t> seekEof(int64_t offset);
 
 	async::result<ReadResult> readSome(void *data, size_t max_length, async::cancellation_token);
+	async::result<ReadResult> pread(int64_t offset, void *data, size_t length);
 	async::result<size_t> writeSome(const void *data, size_t max_length);
 
 	async::result<frg::expected<Error, PollWaitResult>>
@@ -76,6 +76,16 @@ using AcceptResult = std::pair<helix::UniqueLane, helix::UniqueLane>;
 using MkdirResult = std::pair<std::shared_ptr<void>, int64_t>;
 using SymlinkResult = std::pair<std::shared_ptr<void>, int64_t>;
 
+// Range of a memory object (usually the page cache of a file) that holds the result of a read.
+// The memory object must stay alive until the range has been sent.
+struct ReadMemoryRange {
+	helix::BorrowedDescriptor memory;
+	uintptr_t offset;
+	size_t length;
+};
+
+using ReadMemoryResult = std::expected<ReadMemoryRange, Error>;
+
 using TraverseLinksResult = frg::expected<Error, std::tuple<std::vector<std::pair<std::shared_ptr<void>, int64_t>>, FileType, size_t>>;
 
 struct FileOperations {
@@ -99,6 +109,16 @@ struct FileOperations {
 		read = f;
 		return *this;
 	}
+	constexpr FileOperations &withReadMemory(async::result<ReadMemoryResult> (*f)(void *object,
+			helix_ng::CredentialsView, size_t length, async::cancellation_token cancellation)) {
+		readMemory = f;
+		return *this;
+	}
+	constexpr FileOperations &withPreadMemory(async::result<ReadMemoryResult> (*f)(void *object,
+			int64_t offset, helix_ng::CredentialsView, size_t length)) {
+		preadMemory = f;
+		return *this;
+	}
 	constexpr FileOperations &withWrite(async::result<frg::expected<protocols::fs::Error, size_t>> (*f)(void *object,
 			helix_ng::CredentialsView, const void *buffer, size_t length)) {
 		write = f;
@@ -174,6 +194,14 @@ struct FileOperations {
 			void *buffer, size_t length, async::cancellation_token cancellation) = nullptr;
 	async::result<ReadResult> (*pread)(void *object, int64_t offset, helix_ng::CredentialsView credentials,
 			void *buffer, size_t length) = nullptr;
+	// Alternatives to read and pread that return the data as a range of a memory object.
+	// If present, they are preferred since the kernel copies the data directly from the
+	// memory object into the client's buffer. readMemory advances the file offset by the
+	// length of the range; if the file shrinks before the data is sent, the server rewinds it.
+	async::result<ReadMemoryResult> (*readMemory)(void *object, helix_ng::CredentialsView credentials,
+			size_t length, async::cancellation_token cancellation) = nullptr;
+	async::result<ReadMemoryResult> (*preadMemory)(void *object, int64_t offset,
+			helix_ng::CredentialsView credentials, size_t length) = nullptr;
 	async::result<frg::expected<protocols::fs::Error, size_t>> (*write)(void *object, helix_ng::CredentialsView credentials,
 			const void *buffer, size_t length) = nullptr;
 	async::result<frg::expected<protocols::fs::Error, size_t>> (*pwrite)(void *object, int64_t offset, helix_ng::CredentialsView credentials,
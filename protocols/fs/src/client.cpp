@@ -102,6 +102,7 @@ File::readSome(void *data, size_t max_length, async::cancellation_token ct) {
 	uint8_t buffer[128];
 	managarm::fs::SvrResponse resp;
 	size_t actualLength = 0;
+	bool remoteFault = false;
 
 	co_await async::race_and_cancel(
 		async::lambda([&](auto) -> async::result<void> {
@@ -120,9 +121,14 @@ File::readSome(void *data, size_t max_length, async::cancellation_token ct) {
 			HEL_CHECK(send_req.error());
 			HEL_CHECK(imbue_creds.error());
 			HEL_CHECK(recv_resp.error());
-			HEL_CHECK(recv_data.error());
 
 			resp.ParseFromArray(buffer, recv_resp.actualLength());
+			// The server fails to send the data if it cannot read it (e.g., on I/O errors).
+			if(recv_data.error() == kHelErrRemoteFault) {
+				remoteFault = true;
+				co_return;
+			}
+			HEL_CHECK(recv_data.error());
 			actualLength = recv_data.actualLength();
 		}),
 		async::lambda([&, ct, this](auto c) -> async::result<void> {
@@ -151,6 +157,9 @@ File::readSome(void *data, size_t max_length, async::cancellation_token ct) {
 	if (resp.error() == managarm::fs::Errors::INTERRUPTED)
 		co_return std::unexpected{Error::interrupted};
 
+	if (remoteFault)
+		co_return std::unexpected{Error::internalError};
+
 	if (resp.error() == managarm::fs::Errors::END_OF_FILE || (max_length && actualLength == 0))
 		co_return std::unexpected{Error::endOfFile};
 
@@ -158,6 +167,45 @@ File::readSome(void *data, size_t max_length, async::cancellation_token ct) {
 	co_return actualLength;
 }
 
+async::result<ReadResult> File::pread(int64_t offset, void *data, size_t length) {
+	managarm::fs::CntRequest req;
+	req.set_req_type(managarm::fs::CntReqType::PT_PREAD);
+	req.set_offset(offset);
+	req.set_size(length);
+
+	auto ser = req.SerializeAsString();
+	uint8_t buffer[128];
+
+	auto [offer, send_req, imbue_creds, recv_resp, recv_data] =
+		co_await helix_ng::exchangeMsgs(
+			_lane,
+			helix_ng::offer(
+				helix_ng::sendBuffer(ser.data(), ser.size()),
+				helix_ng::imbueCredentials(credsToken_),
+				helix_ng::recvBuffer(buffer, 128),
+				helix_ng::recvBuffer(data, length)
+			)
+		);
+
+	HEL_CHECK(offer.error());
+	HEL_CHECK(send_req.error());
+	HEL_CHECK(imbue_creds.error());
+	HEL_CHECK(recv_resp.error());
+
+	managarm::fs::SvrResponse resp;
+	resp.ParseFromArray(buffer, recv_resp.actualLength());
+
+	// On errors, the server does not send any data.
+	if (resp.error() != managarm::fs::Errors::SUCCESS)
+		co_return std::unexpected{resp.error() | toFsProtoError};
+
+	// The server fails to send the data if it cannot read it (e.g., on I/O errors).
+	if (recv_data.error() == kHelErrRemoteFault)
+		co_return std::unexpected{Error::internalError};
+	HEL_CHECK(recv_data.error());
+	co_return recv_data.actualLength();
+}
+
 async::result<size_t> File::writeSome(const void *data, size_t maxLength) {
 	managarm::fs::CntRequest req;
 	req.set_req_type(managarm::fs::CntReqType::WRITE);
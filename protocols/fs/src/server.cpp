@@ -3,6 +3,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <iostream>
+#include <optional>
 #include <print>
 #include <vector>
 
@@ -182,7 +183,7 @@ async::detached handlePassthrough(smarter::shared_ptr<void> file,
 		);
 		HEL_CHECK(extract_creds.error());
 
-		if(!file_ops->read) {
+		if(!file_ops->read && !file_ops->readMemory) {
 			managarm::fs::SvrResponse resp;
 			resp.set_error(managarm::fs::Errors::ILLEGAL_OPERATION_TARGET);
 
@@ -196,8 +197,9 @@ async::detached handlePassthrough(smarter::shared_ptr<void> file,
 			co_return;
 		}
 
+		// If the file supports it, we send straight from its memory object.
 		std::string data;
-		data.resize(req.size());
+		std::optional<ReadMemoryRange> range;
 		ReadResult res = std::unexpected{Error::internalError};
 
 		{
@@ -217,13 +219,29 @@ async::detached handlePassthrough(smarter::shared_ptr<void> file,
 				co_return;
 			}
 
-			res = co_await file_ops->read(
-				file.get(),
-				extract_creds.credentials(),
-				data.data(),
-				req.size(),
-				cancelEvent
-			);
+			if(file_ops->readMemory) {
+				auto memoryRes = co_await file_ops->readMemory(
+					file.get(),
+					extract_creds.credentials(),
+					req.size(),
+					cancelEvent
+				);
+				if(memoryRes) {
+					range = memoryRes.value();
+					res = range->length;
+				}else{
+					res = std::unexpected{memoryRes.error()};
+				}
+			}else{
+				data.resize(req.size());
+				res = co_await file_ops->read(
+					file.get(),
+					extract_creds.credentials(),
+					data.data(),
+					req.size(),
+					cancelEvent
+				);
+			}
 		}
 
 		managarm::fs::SvrResponse resp;
@@ -236,13 +254,34 @@ async::detached handlePassthrough(smarter::shared_ptr<void> file,
 		}
 
 		auto ser = resp.SerializeAsString();
-		auto [send_resp, send_data] = co_await helix_ng::exchangeMsgs(
-			conversation,
-			helix_ng::sendBuffer(ser.data(), ser.size()),
-			helix_ng::sendBuffer(data.data(), size)
-		);
-		HEL_CHECK(send_resp.error());
-		HEL_CHECK(send_data.error());
+		if(range && size) {
+			auto [send_resp, send_data] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBuffer(ser.data(), ser.size()),
+				helix_ng::sendFromMemory(range->memory, range->offset, size)
+			);
+			HEL_CHECK(send_resp.error());
+			// The kernel fails the transfer if it cannot fetch the data;
+			// the client sees a remote fault in this case.
+			if(send_data.error() != kHelErrFault) {
+				HEL_CHECK(send_data.error());
+
+				// The file can shrink (e.g., due to a concurrent truncation) before
+				// the kernel transfers the data. The kernel then truncates the transfer
+				// and the client sees a short read; undo the rest of the offset update.
+				auto sent = send_data.actualLength();
+				if(sent < size && file_ops->seekRel)
+					co_await file_ops->seekRel(file.get(), -static_cast<int64_t>(size - sent));
+			}
+		}else{
+			auto [send_resp, send_data] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBuffer(ser.data(), ser.size()),
+				helix_ng::sendBuffer(data.data(), size)
+			);
+			HEL_CHECK(send_resp.error());
+			HEL_CHECK(send_data.error());
+		}
 		logBragiSerializedReply(ser);
 	}else if(req.req_type() == managarm::fs::CntReqType::PT_PREAD) {
 		auto [extract_creds] = co_await helix_ng::exchangeMsgs(
@@ -251,7 +290,7 @@ async::detached handlePassthrough(smarter::shared_ptr<void> file,
 		);
 		HEL_CHECK(extract_creds.error());
 
-		if(!file_ops->pread) {
+		if(!file_ops->pread && !file_ops->preadMemory) {
 			managarm::fs::SvrResponse resp;
 			resp.set_error(managarm::fs::Errors::ILLEGAL_OPERATION_TARGET);
 
@@ -265,10 +304,24 @@ async::detached handlePassthrough(smarter::shared_ptr<void> file,
 			co_return;
 		}
 
+		// If the file supports it, we send straight from its memory object.
 		std::string data;
-		data.resize(req.size());
-		auto res = co_await file_ops->pread(file.get(), req.offset(), extract_creds.credentials(),
-				data.data(), req.size());
+		std::optional<ReadMemoryRange> range;
+		ReadResult res = std::unexpected{Error::internalError};
+		if(file_ops->preadMemory) {
+			auto memoryRes = co_await file_ops->preadMemory(file.get(), req.offset(),
+					extract_creds.credentials(), req.size());
+			if(memoryRes) {
+				range = memoryRes.value();
+				res = range->length;
+			}else{
+				res = std::unexpected{memoryRes.error()};
+			}
+		}else{
+			data.resize(req.size());
+			res = co_await file_ops->pread(file.get(), req.offset(), extract_creds.credentials(),
+					data.data(), req.size());
+		}
 
 		managarm::fs::SvrResponse resp;
 		if (!res.has_value()) {
@@ -285,13 +338,26 @@ async::detached handlePassthrough(smarter::shared_ptr<void> file,
 			resp.set_error(managarm::fs::Errors::SUCCESS);
 
 			auto ser = resp.SerializeAsString();
-			auto [send_resp, send_data] = co_await helix_ng::exchangeMsgs(
-				conversation,
-				helix_ng::sendBuffer(ser.data(), ser.size()),
-				helix_ng::sendBuffer(data.data(), res.value())
-			);
-			HEL_CHECK(send_resp.error());
-			HEL_CHECK(send_data.error());
+			size_t size = res.value();
+			if(range && size) {
+				// If the file shrinks, the kernel truncates the transfer (see the READ case above).
+				auto [send_resp, send_data] = co_await helix_ng::exchangeMsgs(
+					conversation,
+					helix_ng::sendBuffer(ser.data(), ser.size()),
+					helix_ng::sendFromMemory(range->memory, range->offset, size)
+				);
+				HEL_CHECK(send_resp.error());
+				if(send_data.error() != kHelErrFault)
+					HEL_CHECK(send_data.error());
+			}else{
+				auto [send_resp, send_data] = co_await helix_ng::exchangeMsgs(
+					conversation,
+					helix_ng::sendBuffer(ser.data(), ser.size()),
+					helix_ng::sendBuffer(data.data(), size)
+				);
+				HEL_CHECK(send_resp.error());
+				HEL_CHECK(send_data.error());
+			}
 			logBragiSerializedReply(ser);
 		}
 	}else if(req.req_type() == managarm::fs::CntReqType::WRITE) {
@@ -29,6 +29,9 @@ bitflags::bitflags! {
         /// already exists at the same address, it will not be replaced
         /// and the mapping will fail.
         const FIXED_NO_REPLACE = hel_sys::kHelMapFixedNoReplace;
+        /// The memory is touched and all pages of the mapping are
+        /// mapped before the mapping call returns (best effort).
+        const POPULATE = hel_sys::kHelMapPopulate;
     }
 }
 
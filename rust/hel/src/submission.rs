@@ -120,6 +120,9 @@ pub fn sleep_until_with_executor(
             let header = hel_sys::HelSqAwaitClock {
                 counter: time.nanos(),
                 cancellationTag: 0, // No cancellation needed
+                flags: 0,
+                reserved: 0,
+                slack: 0,
             };
             let header_bytes: &[u8] = unsafe {
                 std::slice::from_raw_parts(
@@ -159,6 +162,9 @@ pub fn sleep_for_with_executor(
             let header = hel_sys::HelSqAwaitClock {
                 counter: time?.nanos(),
                 cancellationTag: 0, // No cancellation needed
+                flags: 0,
+                reserved: 0,
+                slack: 0,
             };
             let header_bytes: &[u8] = unsafe {
                 std::slice::from_raw_parts(
@@ -0,0 +1,128 @@
+// Microbenchmark for the Internet checksum.
+// Compares Checksum against the previous word-at-a-time implementation.
+
+#include <chrono>
+#include <cstring>
+#include <print>
+#include <random>
+#include <vector>
+
+#include "ip/checksum.hpp"
+
+namespace {
+
+// The word-at-a-time implementation that Checksum used to be.
+struct ScalarChecksum {
+	void update(uint16_t word) {
+		state_ += word;
+		while (state_ >> 16 != 0)
+			state_ = (state_ >> 16) + (state_ & 0xffff);
+	}
+
+	void update(const void *data, size_t size) {
+		auto iter = static_cast<const unsigned char *>(data);
+		if (size % 2 != 0) {
+			size--;
+			update(iter[size] << 8);
+		}
+		auto end = iter + size;
+		for (; iter < end; iter += 2)
+			update(iter[0] << 8 | iter[1]);
+	}
+
+	uint16_t finalize() {
+		return ~state_;
+	}
+
+private:
+	uint32_t state_ = 0;
+};
+
+std::mt19937 prng;
+
+void verify() {
+	std::vector<unsigned char> buffer(16384 + 64);
+	std::vector<unsigned char> copy(buffer.size());
+	for (auto &b : buffer)
+		b = prng();
+
+	for (size_t size = 0; size < 16384; size = size < 256 ? size + 1 : size * 3 / 2) {
+		for (size_t offset = 0; offset < 8; offset++) {
+			ScalarChecksum reference;
+			reference.update(buffer.data() + offset, size);
+
+			Checksum csum;
+			csum.update(buffer.data() + offset, size);
+			if (csum.finalize() != reference.finalize()) {
+				std::println("checksum-bench: Mismatch for size {}, offset {}", size, offset);
+				exit(1);
+			}
+
+			// Split the buffer at an arbitrary (possibly odd) position and copy it.
+			size_t split = size ? prng() % size : 0;
+			Checksum copyCsum;
+			copyCsum.updateCopy(copy.data(), buffer.data() + offset, split);
+			copyCsum.updateCopy(copy.data() + split, buffer.data() + offset + split, size - split);
+			if (copyCsum.finalize() != reference.finalize()
+					|| memcmp(copy.data(), buffer.data() + offset, size)) {
+				std::println("checksum-bench: Copy mismatch for size {}, offset {}, split {}",
+						size, offset, split);
+				exit(1);
+			}
+		}
+	}
+}
+
+template<typename F>
+void measure(const char *name, size_t size, F function) {
+	constexpr size_t totalBytes = size_t{1} << 30;
+	size_t iterations = totalBytes / size;
+
+	auto before = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++)
+		function();
+	auto after = std::chrono::steady_clock::now();
+
+	std::chrono::duration<double> seconds = after - before;
+	std::println("checksum-bench: {:>10} {:>6} bytes: {:8.1f} MiB/s",
+			name, size, iterations * size / seconds.count() / (1 << 20));
+}
+
+} // anonymous namespace
+
+int main() {
+	verify();
+	std::println("checksum-bench: Using {} kernel", Checksum::implementation());
+
+	// Typical MTU and jumbo frame payload sizes.
+	for (size_t size : {1480, 8980}) {
+		std::vector<unsigned char> buffer(size);
+		std::vector<unsigned char> copy(size);
+		for (auto &b : buffer)
+			b = prng();
+
+		volatile uint16_t sink;
+		measure("scalar", size, [&] {
+			ScalarChecksum csum;
+			csum.update(buffer.data(), size);
+			sink = csum.finalize();
+		});
+		measure("update", size, [&] {
+			Checksum csum;
+			csum.update(buffer.data(), size);
+			sink = csum.finalize();
+		});
+		measure("memcpy+sum", size, [&] {
+			memcpy(copy.data(), buffer.data(), size);
+			Checksum csum;
+			csum.update(copy.data(), size);
+			sink = csum.finalize();
+		});
+		measure("updateCopy", size, [&] {
+			Checksum csum;
+			csum.updateCopy(copy.data(), buffer.data(), size);
+			sink = csum.finalize();
+		});
+		(void)sink;
+	}
+}
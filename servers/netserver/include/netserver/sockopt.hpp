@@ -0,0 +1,7 @@
+#pragma once
+
+// Managarm-specific IPPROTO_TCP option that sets the drop probability (in permille)
+// of incoming packets on a socket. Used to test loss recovery.
+// The value is chosen to be far away from the Linux TCP options.
+// netserver only accepts this option if it is built with -Dnetserver_test_options=true.
+constexpr int TCP_DEBUG_LOSS_PERMILLE = 0x4d01;
@@ -1,6 +1,195 @@
 #include "checksum.hpp"
 
 #include <arch/bit.hpp>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// The kernels below sum a buffer as a sequence of native-endian words and
+// return an unfolded 64-bit sum; an odd trailing byte is padded with zero.
+// As the one's complement sum is independent of the byte order and of the
+// word size (RFC 1071), folding the result yields the 16-bit checksum
+// in native byte order. If Copy is set, the buffer is copied to dest as well.
+using SumFunction = uint64_t (*)(void *dest, const void *src, size_t size);
+
+uint64_t addWithCarry(uint64_t a, uint64_t b) {
+	uint64_t sum = a + b;
+	return sum + (sum < a);
+}
+
+uint16_t fold(uint64_t sum) {
+	sum = (sum >> 32) + (sum & 0xFFFFFFFF);
+	sum = (sum >> 32) + (sum & 0xFFFFFFFF);
+	sum = (sum >> 16) + (sum & 0xFFFF);
+	sum = (sum >> 16) + (sum & 0xFFFF);
+	return sum;
+}
+
+template<bool Copy>
+uint64_t sumScalar(void *dest, const void *src, size_t size) {
+	auto d = static_cast<unsigned char *>(dest);
+	auto s = static_cast<const unsigned char *>(src);
+
+	uint64_t sum = 0;
+	while(size >= 8) {
+		uint64_t word;
+		memcpy(&word, s, 8);
+		if constexpr (Copy)
+			memcpy(d, &word, 8);
+		sum = addWithCarry(sum, word);
+		d += 8;
+		s += 8;
+		size -= 8;
+	}
+
+	if(size) {
+		uint64_t word = 0;
+		memcpy(&word, s, size);
+		if constexpr (Copy)
+			memcpy(d, s, size);
+		sum = addWithCarry(sum, word);
+	}
+	return sum;
+}
+
+#if defined(__x86_64__)
+
+// SSE2 is part of the x86_64 baseline.
+// 32-bit words are zero-extended and accumulated into 64-bit lanes.
+template<bool Copy>
+uint64_t sumSse2(void *dest, const void *src, size_t size) {
+	auto d = static_cast<unsigned char *>(dest);
+	auto s = static_cast<const unsigned char *>(src);
+
+	auto zero = _mm_setzero_si128();
+	auto acc0 = _mm_setzero_si128();
+	auto acc1 = _mm_setzero_si128();
+	while(size >= 32) {
+		auto v0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+		auto v1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 16));
+		if constexpr (Copy) {
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(d), v0);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(d + 16), v1);
+		}
+		acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v0, zero));
+		acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v0, zero));
+		acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v1, zero));
+		acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v1, zero));
+		d += 32;
+		s += 32;
+		size -= 32;
+	}
+
+	alignas(16) uint64_t lanes[4];
+	_mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc0);
+	_mm_store_si128(reinterpret_cast<__m128i *>(lanes + 2), acc1);
+
+	uint64_t sum = sumScalar<Copy>(d, s, size);
+	for(auto lane : lanes)
+		sum = addWithCarry(sum, lane);
+	return sum;
+}
+
+template<bool Copy>
+[[gnu::target("avx2")]]
+uint64_t sumAvx2(void *dest, const void *src, size_t size) {
+	auto d = static_cast<unsigned char *>(dest);
+	auto s = static_cast<const unsigned char *>(src);
+
+	auto zero = _mm256_setzero_si256();
+	auto acc0 = _mm256_setzero_si256();
+	auto acc1 = _mm256_setzero_si256();
+	while(size >= 64) {
+		auto v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s));
+		auto v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + 32));
+		if constexpr (Copy) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(d), v0);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(d + 32), v1);
+		}
+		acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v0, zero));
+		acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v0, zero));
+		acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v1, zero));
+		acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v1, zero));
+		d += 64;
+		s += 64;
+		size -= 64;
+	}
+
+	alignas(32) uint64_t lanes[8];
+	_mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc0);
+	_mm256_store_si256(reinterpret_cast<__m256i *>(lanes + 4), acc1);
+
+	uint64_t sum = sumSse2<Copy>(d, s, size);
+	for(auto lane : lanes)
+		sum = addWithCarry(sum, lane);
+	return sum;
+}
+
+#elif defined(__aarch64__)
+
+// NEON is part of the AArch64 baseline.
+// Pairs of 32-bit words are added and accumulated into 64-bit lanes.
+template<bool Copy>
+uint64_t sumNeon(void *dest, const void *src, size_t size) {
+	auto d = static_cast<unsigned char *>(dest);
+	auto s = static_cast<const unsigned char *>(src);
+
+	auto acc0 = vdupq_n_u64(0);
+	auto acc1 = vdupq_n_u64(0);
+	while(size >= 32) {
+		auto v0 = vld1q_u8(s);
+		auto v1 = vld1q_u8(s + 16);
+		if constexpr (Copy) {
+			vst1q_u8(d, v0);
+			vst1q_u8(d + 16, v1);
+		}
+		acc0 = vpadalq_u32(acc0, vreinterpretq_u32_u8(v0));
+		acc1 = vpadalq_u32(acc1, vreinterpretq_u32_u8(v1));
+		d += 32;
+		s += 32;
+		size -= 32;
+	}
+
+	uint64_t sum = sumScalar<Copy>(d, s, size);
+	sum = addWithCarry(sum, vgetq_lane_u64(acc0, 0));
+	sum = addWithCarry(sum, vgetq_lane_u64(acc0, 1));
+	sum = addWithCarry(sum, vgetq_lane_u64(acc1, 0));
+	sum = addWithCarry(sum, vgetq_lane_u64(acc1, 1));
+	return sum;
+}
+
+#endif
+
+struct Kernel {
+	const char *name;
+	SumFunction sum;
+	SumFunction sumCopy;
+};
+
+const Kernel &selectKernel() {
+	static Kernel kernel = [] () -> Kernel {
+#if defined(__x86_64__)
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx2"))
+			return {"avx2", &sumAvx2<false>, &sumAvx2<true>};
+		return {"sse2", &sumSse2<false>, &sumSse2<true>};
+#elif defined(__aarch64__)
+		return {"neon", &sumNeon<false>, &sumNeon<true>};
+#else
+		return {"scalar", &sumScalar<false>, &sumScalar<true>};
+#endif
+	}();
+	return kernel;
+}
+
+} // anonymous namespace
 
 void Checksum::update(uint16_t word)  {
 	state_ += word;
@@ -10,23 +199,34 @@ void Checksum::update(uint16_t word)  {
 }
 
 void Checksum::update(const void *data, size_t size) {
-	using namespace arch;
-	auto iter = static_cast<const unsigned char*>(data);
-	if (size % 2 != 0) {
-		size--;
-		update(iter[size] << 8);
-	}
-	auto end = iter + size;
-	for (; iter < end; iter += 2) {
-		update(iter[0] << 8 | iter[1]);
-	}
+	addPartial_(selectKernel().sum(nullptr, data, size), size);
 }
 
 void Checksum::update(arch::dma_buffer_view view) {
 	update(view.data(), view.size());
 }
 
+void Checksum::updateCopy(void *dest, const void *src, size_t size) {
+	addPartial_(selectKernel().sumCopy(dest, src, size), size);
+}
+
 uint16_t Checksum::finalize() {
 	auto state_ = this->state_;
 	return ~state_;
 }
+
+const char *Checksum::implementation() {
+	return selectKernel().name;
+}
+
+void Checksum::addPartial_(uint64_t sum, size_t size) {
+	// The kernels sum native-endian words but the checksum is defined on big-endian words.
+	auto partial = fold(sum);
+	if constexpr (std::endian::native == std::endian::little)
+		partial = std::byteswap(partial);
+	// Data that starts at an odd offset ends up in the opposite byte lane.
+	if (odd_)
+		partial = std::byteswap(partial);
+	update(partial);
+	odd_ ^= size & 1;
+}
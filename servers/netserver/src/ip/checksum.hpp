@@ -9,8 +9,17 @@ struct Checksum {
 	void update(uint16_t word);
 	void update(const void *mem, size_t size);
 	void update(arch::dma_buffer_view area);
+	// Copies size bytes from src to dest and adds them to the checksum in a single pass.
+	void updateCopy(void *dest, const void *src, size_t size);
 	uint16_t finalize();
 
+	// Name of the summation kernel that was selected at runtime.
+	static const char *implementation();
+
 private:
+	void addPartial_(uint64_t sum, size_t size);
+
 	uint32_t state_ = 0;
+	// Whether an odd number of bytes was added so far.
+	bool odd_ = false;
 };
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cmath>
+
+#include "tcp4-congestion.hpp"
+
+namespace {
+
+// Slow start with appropriate byte counting (RFC 3465), limited to L = 2 * SMSS per ACK.
+void slowStart(TcpCongestionState &state, uint32_t ackedBytes) {
+	uint64_t cwnd = state.cwnd + std::min(ackedBytes, 2 * state.mss);
+	state.cwnd = std::min(cwnd, uint64_t{UINT32_MAX / 2});
+}
+
+// NewReno (RFC 5681, RFC 6582). The fast recovery part lives in Tcp4Socket.
+struct RenoCongestionControl final : TcpCongestionControl {
+	std::string_view name() override {
+		return "reno";
+	}
+
+	void onAck(TcpCongestionState &state, uint32_t ackedBytes, uint64_t) override {
+		if(state.cwnd < state.ssthresh) {
+			slowStart(state, ackedBytes);
+			return;
+		}
+
+		// Congestion avoidance: grow by one SMSS per cwnd of acknowledged bytes.
+		bytesAcked_ += ackedBytes;
+		if(bytesAcked_ >= state.cwnd) {
+			bytesAcked_ -= state.cwnd;
+			state.cwnd = std::min(state.cwnd + state.mss, uint32_t{UINT32_MAX / 2});
+		}
+	}
+
+	uint32_t onLoss(TcpCongestionState &state, uint32_t flightSize, uint64_t) override {
+		bytesAcked_ = 0;
+		return std::max(flightSize / 2, 2 * state.mss);
+	}
+
+private:
+	uint32_t bytesAcked_ = 0;
+};
+
+// CUBIC (RFC 9438). Window sizes are computed in segments, time in seconds.
+struct CubicCongestionControl final : TcpCongestionControl {
+	static constexpr double cubicC = 0.4;
+	static constexpr double cubicBeta = 0.7;
+	static constexpr double cubicAlpha = 3 * (1 - cubicBeta) / (1 + cubicBeta);
+
+	std::string_view name() override {
+		return "cubic";
+	}
+
+	void onAck(TcpCongestionState &state, uint32_t ackedBytes, uint64_t now) override {
+		if(state.cwnd < state.ssthresh) {
+			slowStart(state, ackedBytes);
+			return;
+		}
+
+		double mss = state.mss;
+		double cwnd = state.cwnd / mss;
+
+		// Start a new congestion avoidance epoch.
+		if(!epochStart_) {
+			epochStart_ = now;
+			if(wMax_ <= cwnd) {
+				wMax_ = cwnd;
+				k_ = 0;
+			}else{
+				k_ = std::cbrt((wMax_ - cwnd) / cubicC);
+			}
+			wEst_ = cwnd;
+		}
+
+		double t = (now - epochStart_) / 1e9;
+		double rtt = state.srtt / 1e9;
+		double acked = ackedBytes / mss;
+
+		// Reno-friendly region: estimate the window that Reno would have.
+		wEst_ += cubicAlpha * acked / cwnd;
+
+		double next;
+		if(window_(t) < wEst_) {
+			next = wEst_;
+		}else{
+			auto target = std::clamp(window_(t + rtt), cwnd, 1.5 * cwnd);
+			next = cwnd + (target - cwnd) / cwnd * acked;
+		}
+
+		state.cwnd = static_cast<uint32_t>(
+				std::clamp(next * mss, mss, static_cast<double>(UINT32_MAX / 2)));
+	}
+
+	uint32_t onLoss(TcpCongestionState &state, uint32_t, uint64_t) override {
+		double mss = state.mss;
+		double cwnd = state.cwnd / mss;
+
+		epochStart_ = 0;
+		// Fast convergence: release bandwidth to new flows.
+		if(cwnd < wMax_) {
+			wMax_ = cwnd * (1 + cubicBeta) / 2;
+		}else{
+			wMax_ = cwnd;
+		}
+
+		return static_cast<uint32_t>(std::max(cwnd * cubicBeta * mss, 2 * mss));
+	}
+
+private:
+	double window_(double t) {
+		return cubicC * (t - k_) * (t - k_) * (t - k_) + wMax_;
+	}
+
+	uint64_t epochStart_ = 0;
+	double wMax_ = 0;
+	double wEst_ = 0;
+	double k_ = 0;
+};
+
+} // anonymous namespace
+
+std::unique_ptr<TcpCongestionControl> makeTcpCongestionControl(std::string_view name) {
+	if(name == "reno" || name == "newreno")
+		return std::make_unique<RenoCongestionControl>();
+	if(name == "cubic")
+		return std::make_unique<CubicCongestionControl>();
+	return nullptr;
+}
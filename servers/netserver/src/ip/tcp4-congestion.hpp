@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string_view>
+
+// Congestion state of a TCP connection that is shared with the congestion control algorithm.
+// All window sizes are in bytes.
+struct TcpCongestionState {
+	uint32_t mss = 0;
+	uint32_t cwnd = 0;
+	uint32_t ssthresh = UINT32_MAX;
+	// Smoothed RTT in nanoseconds (0 if there is no RTT sample yet).
+	uint64_t srtt = 0;
+};
+
+// Interface for congestion control algorithms, i.e., for the window growth function
+// and the multiplicative decrease on loss. Fast retransmit and fast recovery (RFC 5681,
+// RFC 6582) are implemented by the socket itself.
+struct TcpCongestionControl {
+	virtual ~TcpCongestionControl() = default;
+
+	virtual std::string_view name() = 0;
+
+	// Called for ACKs that acknowledge new data outside of fast recovery.
+	virtual void onAck(TcpCongestionState &state, uint32_t ackedBytes, uint64_t now) = 0;
+
+	// Called when loss is detected (either by duplicate ACKs or by the retransmission timer).
+	// Returns the new slow start threshold.
+	virtual uint32_t onLoss(TcpCongestionState &state, uint32_t flightSize, uint64_t now) = 0;
+};
+
+inline constexpr std::string_view defaultTcpCongestionControl = "reno";
+
+// Returns nullptr if no algorithm with the given name exists.
+std::unique_ptr<TcpCongestionControl> makeTcpCongestionControl(std::string_view name);
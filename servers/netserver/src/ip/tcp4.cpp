@@ -3,28 +3,79 @@
 #include <async/result.hpp>
 #include <arch/bit.hpp>
 #include <arch/variable.hpp>
+#include <helix/clock.hpp>
+#include <helix/timer.hpp>
 #include <protocols/fs/server.hpp>
 #include <cstring>
 #include <format>
 #include <iomanip>
+#include <optional>
 #include <random>
+#include <utility>
 #include <fcntl.h>
 #include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netinet/ip.h>
+#include <netinet/tcp.h>
+#include <netserver/sockopt.hpp>
 
 #include <bragi/helpers-std.hpp>
 
 #include "checksum.hpp"
 #include "ip4.hpp"
 #include "tcp4.hpp"
+#include "tcp4-congestion.hpp"
 
 namespace {
 
 constexpr bool debugTcp = false;
 
+// Size of the send and receive rings. Windows larger than 64 KiB require window scaling.
+constexpr int ringShift = 18;
+
+// Largest segment that we send or accept.
+// TODO: Perform path MTU discovery.
+constexpr uint32_t maxSegmentSize = 1280;
+// Segment size that is assumed if the remote side does not send an MSS option (RFC 9293).
+constexpr uint32_t defaultSegmentSize = 536;
+
+// Retransmission timeout parameters (RFC 6298), in nanoseconds.
+// Like other implementations, we use a lower minimum RTO than the 1s suggested by the RFC.
+constexpr uint64_t initialRto = 1'000'000'000;
+constexpr uint64_t minRto = 200'000'000;
+constexpr uint64_t maxRto = 60'000'000'000;
+constexpr uint64_t clockGranularity = 1'000'000;
+
+// Number of consecutive retransmission timeouts after which we give up.
+constexpr int maxRetransmits = 15;
+// Number of duplicate ACKs that trigger fast retransmit (RFC 5681).
+constexpr unsigned int dupAckThreshold = 3;
+// Maximal number of out-of-order segments that we buffer.
+constexpr size_t maxOutOfOrderSegments = 64;
+
+// Comparison of sequence numbers modulo 2^32.
+bool seqBefore(uint32_t a, uint32_t b) {
+	return static_cast<int32_t>(a - b) < 0;
+}
+
+bool seqAfter(uint32_t a, uint32_t b) {
+	return static_cast<int32_t>(a - b) > 0;
+}
+
+uint64_t clockNanos() {
+	return helix::getClockNanos();
+}
+
+// Window scale (RFC 7323) that is needed to announce the full receive ring.
+constexpr int ownWindowShift() {
+	int shift = 0;
+	while((size_t{0xFFFF} << shift) < (size_t{1} << ringShift) && shift < 14)
+		shift++;
+	return shift;
+}
+
 struct stl_allocator {
 	void *allocate(size_t size) {
 		return operator new(size);
@@ -91,6 +142,17 @@ struct RingBuffer {
 		memcpy(p + bytesUntilEnd, storage_, size - bytesUntilEnd);
 	}
 
+	// Like dequeueLookahead() but also adds the data to a checksum.
+	void dequeueLookahead(size_t offset, void *data, size_t size, Checksum &csum) {
+		assert(offset + size <= availableToDequeue());
+		size_t ringSize = size_t{1} << shift_;
+		auto wrappedPtr = (deqPtr_ + offset) & (ringSize - 1);
+		auto p = reinterpret_cast<char *>(data);
+		size_t bytesUntilEnd = std::min(size, ringSize - wrappedPtr);
+		csum.updateCopy(p, storage_ + wrappedPtr, bytesUntilEnd);
+		csum.updateCopy(p + bytesUntilEnd, storage_, size - bytesUntilEnd);
+	}
+
 	void dequeueAdvance(size_t size) {
 		deqPtr_ += size;
 	}
@@ -125,12 +187,57 @@ struct TcpHeader {
 
 static_assert(sizeof(TcpHeader) == 20);
 
+// TCP options that we understand. Only relevant for SYN segments.
+struct TcpOptions {
+	std::optional<uint16_t> mss;
+	std::optional<uint8_t> windowShift;
+};
+
+enum {
+	TCP_OPT_END = 0,
+	TCP_OPT_NOP = 1,
+	TCP_OPT_MSS = 2,
+	TCP_OPT_WINDOW_SCALE = 3
+};
+
 struct TcpPacket {
 	arch::dma_buffer_view payload() {
 		auto words = header.flags.load() & TcpHeader::headerWords;
 		return packet->payload().subview(words * 4);
 	}
 
+	TcpOptions options() {
+		TcpOptions result;
+		auto words = header.flags.load() & TcpHeader::headerWords;
+		auto p = reinterpret_cast<const uint8_t *>(packet->payload().data());
+		size_t end = words * 4;
+		size_t i = sizeof(TcpHeader);
+		while(i < end) {
+			auto kind = p[i];
+			if(kind == TCP_OPT_END)
+				break;
+			if(kind == TCP_OPT_NOP) {
+				++i;
+				continue;
+			}
+
+			if(i + 1 >= end)
+				break;
+			auto length = p[i + 1];
+			if(length < 2 || i + length > end)
+				break;
+
+			if(kind == TCP_OPT_MSS && length == 4) {
+				result.mss = static_cast<uint16_t>((p[i + 2] << 8) | p[i + 3]);
+			}else if(kind == TCP_OPT_WINDOW_SCALE && length == 3) {
+				// RFC 7323 limits the shift to 14.
+				result.windowShift = std::min(p[i + 2], uint8_t{14});
+			}
+			i += length;
+		}
+		return result;
+	}
+
 	bool parse(smarter::shared_ptr<const Ip4Packet> packet) {
 		auto ipPayload = packet->payload();
 		if (ipPayload.size() < sizeof(TcpHeader))
@@ -191,14 +298,15 @@ static async::result<void> serveLanes(
 
 struct Tcp4Socket {
 	Tcp4Socket(Tcp4 *parent, bool nonBlock)
-	: parent_(parent), nonBlock_{nonBlock}, recvRing_{14}, sendRing_{14} {}
+	: parent_(parent), nonBlock_{nonBlock}, recvRing_{ringShift}, sendRing_{ringShift},
+		cc_{makeTcpCongestionControl(defaultTcpCongestionControl)} {}
 
 	~Tcp4Socket() {
 		parent_->unbind(localEp_);
 	}
 
 	async::result<void> disconnect() {
-		if(localClosed_)
+		if(localClosed_ || connectState_ == ConnectState::closed)
 			co_return;
 
 		if (connectState_ != ConnectState::connected) {
@@ -209,15 +317,21 @@ struct Tcp4Socket {
 
 		localClosed_ = true;
 
-		while (localSettledSn_ < localFlushedSn_)
+		// Note that localFlushedSn_ may be rewound by retransmissions.
+		while (localSettledSn_ != localMaxSn_ || sendRing_.availableToDequeue()) {
+			if (connectState_ == ConnectState::closed)
+				co_return;
 			co_await settleEvent_.async_wait();
+		}
 
 		connectState_ = ConnectState::sendFin;
 		flushEvent_.raise();
 
 		// TODO: Wait for disconnect to finish?
-		while (localSettledSn_ < localFlushedSn_)
+		while (connectState_ == ConnectState::sendFin)
 			co_await settleEvent_.async_wait();
+		if (connectState_ == ConnectState::closed)
+			co_return;
 		std::println("netserver: TCP FIN was acknowledged");
 	}
 
@@ -225,6 +339,7 @@ struct Tcp4Socket {
 		auto s = smarter::make_shared<Tcp4Socket>(parent, nonBlock);
 		s->holder_ = s;
 		async::detach(s->flushOutPackets_());
+		async::detach(s->retransmitTimer_());
 		return s;
 	}
 
@@ -367,6 +482,7 @@ struct Tcp4Socket {
 		// Connect to the remote.
 		self->connectState_ = ConnectState::sendSyn;
 		self->remoteEp_ = connectEp;
+		self->chooseInitialSn_();
 		self->flushEvent_.raise();
 
 		while(true) {
@@ -374,6 +490,8 @@ struct Tcp4Socket {
 				break;
 			co_await self->settleEvent_.async_wait();
 		}
+		if(self->connectState_ == ConnectState::closed)
+			co_return self->takeError_(protocols::fs::Error::notConnected);
 		co_return protocols::fs::Error::none;
 	}
 
@@ -445,6 +563,13 @@ struct Tcp4Socket {
 			if(!available) {
 				if(progress || self->remoteClosed_)
 					break;
+				// Report the error once, afterwards, reads return EOF.
+				if(self->connectState_ == ConnectState::closed) {
+					auto error = self->takeError_(protocols::fs::Error::none);
+					if(error != protocols::fs::Error::none)
+						co_return error;
+					break;
+				}
 				if(self->nonBlock_ || flags & MSG_DONTWAIT)
 					co_return protocols::fs::Error::wouldBlock;
 				co_await self->inEvent_.async_wait();
@@ -487,6 +612,12 @@ struct Tcp4Socket {
 
 		size_t progress = 0;
 		while(progress < size) {
+			if(self->connectState_ == ConnectState::closed) {
+				if(progress)
+					break;
+				co_return self->takeError_(protocols::fs::Error::brokenPipe);
+			}
+
 			size_t space = self->sendRing_.spaceForEnqueue();
 			if(!space) {
 				if(self->nonBlock_) {
@@ -547,6 +678,8 @@ struct Tcp4Socket {
 			active |= EPOLLOUT;
 		if(self->remoteClosed_)
 			active |= EPOLLHUP;
+		if(self->connectState_ == ConnectState::closed)
+			active |= EPOLLHUP | EPOLLERR;
 
 		co_return protocols::fs::PollStatusResult{self->currentSeq_, active};
 	}
@@ -590,7 +723,30 @@ struct Tcp4Socket {
 				self->boundInterface_ = nic;
 				co_return {};
 			}
+		}else if(layer == IPPROTO_TCP && number == TCP_CONGESTION) {
+			std::string name{optbuf.data(), strnlen(optbuf.data(), optbuf.size())};
+
+			auto cc = makeTcpCongestionControl(name);
+			if(!cc)
+				co_return protocols::fs::Error::fileNotFound;
+
+			// The new algorithm continues with the current cwnd and ssthresh.
+			self->cc_ = std::move(cc);
+			co_return {};
+		}
+#ifdef NETSERVER_TEST_OPTIONS
+		else if(layer == IPPROTO_TCP && number == TCP_DEBUG_LOSS_PERMILLE) {
+			unsigned int permille;
+			if(optbuf.size() != sizeof(permille))
+				co_return protocols::fs::Error::illegalArguments;
+			memcpy(&permille, optbuf.data(), sizeof(permille));
+			if(permille > 1000)
+				co_return protocols::fs::Error::illegalArguments;
+
+			self->lossPermille_ = permille;
+			co_return {};
 		}
+#endif
 
 		std::cout << std::format("netserver: unhandled TCP socket setsockopt layer {} number {}\n",
 			layer, number);
@@ -611,7 +767,18 @@ struct Tcp4Socket {
 			optbuf.resize(size);
 			if (size)
 				memcpy(optbuf.data(), self->boundInterface_->name().data(), size);
-		} else {
+		} else if(layer == IPPROTO_TCP && number == TCP_CONGESTION) {
+			std::string name{self->cc_->name()};
+			optbuf.resize(std::min(optbuf.size(), name.size() + 1));
+			memcpy(optbuf.data(), name.c_str(), optbuf.size());
+		}
+#ifdef NETSERVER_TEST_OPTIONS
+		else if(layer == IPPROTO_TCP && number == TCP_DEBUG_LOSS_PERMILLE) {
+			optbuf.resize(std::min(optbuf.size(), sizeof(self->lossPermille_)));
+			memcpy(optbuf.data(), &self->lossPermille_, optbuf.size());
+		}
+#endif
+		else {
 			std::cout << std::format("netserver: unhandled TCP socket getsockopt layer {} number {}\n",
 				layer, number);
 			co_return protocols::fs::Error::invalidProtocolOption;
@@ -658,8 +825,37 @@ struct Tcp4Socket {
 private:
 	async::result<void> flushOutPackets_();
 
+	// Builds a segment that starts at Out-SN sn and updates the sender state accordingly.
+	// The payload is taken from sendRing_ at the given offset.
+	std::vector<char> buildSegment_(uint32_t source, uint32_t sn, size_t offset, size_t chunk,
+			bool syn, bool ack, bool fin);
+
+	void chooseInitialSn_();
+
+	// Applies the MSS and window scale options of the remote's SYN.
+	void applySynOptions_(TcpOptions options);
+
+	// Retransmission timer (RFC 6298).
+	async::result<void> retransmitTimer_();
+	void armRetransmitTimer_();
+	void handleRetransmitTimeout_();
+	void updateRto_(uint64_t rtt);
+
+	void handleAck_(TcpPacket &packet);
+	void handleDuplicateAck_(uint64_t now);
+
+	// Moves received data to recvRing_. Returns the number of bytes that fit into the ring.
+	size_t acceptPayload_(void *data, size_t size);
+	void storeOutOfOrder_(uint32_t sn, arch::dma_buffer_view payload);
+	void drainOutOfOrder_();
+
 	void handleInPacket_(TcpPacket packet);
 
+	// Closes the connection without a FIN handshake and fails all pending operations.
+	void abort_(protocols::fs::Error error);
+	// Returns (and clears) the error that closed the connection or fallback if there is none.
+	protocols::fs::Error takeError_(protocols::fs::Error fallback);
+
 private:
 	friend struct Tcp4;
 
@@ -670,6 +866,8 @@ private:
 		connected,
 		sendFin,
 		finAcked,
+		// The connection was aborted (e.g., after too many retransmissions).
+		closed,
 	};
 
 	struct PendingConnection {
@@ -677,6 +875,12 @@ private:
 		uint32_t remoteIp;
 		uint16_t remotePort;
 		uint32_t sequence;
+		TcpOptions options;
+	};
+
+	struct OutOfOrderSegment {
+		uint32_t sn;
+		std::vector<char> data;
 	};
 
 	async::result<void> handleIncomingConnection(PendingConnection c);
@@ -689,6 +893,8 @@ private:
 	std::vector<smarter::shared_ptr<Tcp4Socket>> pendingConnections_;
 
 	ConnectState connectState_ = ConnectState::none;
+	// Error that caused the connection to be closed; reported once to users.
+	protocols::fs::Error pendingError_ = protocols::fs::Error::none;
 	bool remoteClosed_ = false;
 	bool localClosed_ = false;
 	bool listening_ = false;
@@ -696,7 +902,10 @@ private:
 	// Out-SN corresponding to the front of sendRing_.
 	uint32_t localSettledSn_ = 0;
 	// Out-SN that has already been flushed to the IP layer (>= localSettledSn_).
+	// Rewound to localSettledSn_ on retransmission timeout.
 	uint32_t localFlushedSn_ = 0;
+	// Highest Out-SN that was ever flushed to the IP layer (>= localFlushedSn_).
+	uint32_t localMaxSn_ = 0;
 	// Out-SN of the end of the remote window (>= localSettledSn_).
 	uint32_t localWindowSn_ = 0;
 	// In-SN that we already acknowledged.
@@ -705,6 +914,43 @@ private:
 	uint32_t remoteKnownSn_ = 0;
 	// Size of received window that we announced to the remote side.
 	uint32_t announcedWindow_ = 0;
+	// Whether we need to send an ACK even if remoteAckedSn_ == remoteKnownSn_
+	// (e.g., to acknowledge out-of-order or duplicate segments).
+	bool forceAck_ = false;
+	std::vector<OutOfOrderSegment> outOfOrder_;
+
+	// Window scaling (RFC 7323). Both shifts are zero unless both sides sent the option.
+	bool windowScaling_ = false;
+	// Applied to windows received from the remote side.
+	int sendWindowShift_ = 0;
+	// Applied to windows that we announce.
+	int recvWindowShift_ = 0;
+
+	// RTT estimation (RFC 6298). All times are in nanoseconds.
+	uint64_t rttvar_ = 0;
+	uint64_t rto_ = initialRto;
+	bool rttTiming_ = false;
+	// Out-SN whose acknowledgement completes the RTT measurement in progress.
+	uint32_t rttSn_ = 0;
+	uint64_t rttStart_ = 0;
+
+	// Retransmission timer. A deadline of zero means that the timer is disarmed.
+	uint64_t rtoDeadline_ = 0;
+	int retransmits_ = 0;
+	// Set by the timer to send a zero window probe.
+	bool probeWindow_ = false;
+	async::recurring_event timerEvent_;
+
+	// Congestion control (RFC 5681) and fast recovery (RFC 6582).
+	std::unique_ptr<TcpCongestionControl> cc_;
+	// Drop probability (in permille) of incoming packets, see TCP_DEBUG_LOSS_PERMILLE.
+	unsigned int lossPermille_ = 0;
+	TcpCongestionState ccState_{.mss = defaultSegmentSize};
+	unsigned int dupAcks_ = 0;
+	bool inRecovery_ = false;
+	uint32_t recoverSn_ = 0;
+	// Set to retransmit the segment at localSettledSn_.
+	bool retransmitFirst_ = false;
 
 	RingBuffer recvRing_;
 	RingBuffer sendRing_;
@@ -725,25 +971,133 @@ private:
 	std::shared_ptr<nic::Link> boundInterface_ = {};
 };
 
+void Tcp4Socket::chooseInitialSn_() {
+	auto randomSn = globalPrng();
+	localSettledSn_ = randomSn;
+	localFlushedSn_ = randomSn;
+	localMaxSn_ = randomSn;
+	recoverSn_ = randomSn;
+}
+
+void Tcp4Socket::applySynOptions_(TcpOptions options) {
+	ccState_.mss = std::min(uint32_t{options.mss.value_or(defaultSegmentSize)}, maxSegmentSize);
+	// Guard against bogus MSS values.
+	ccState_.mss = std::max(ccState_.mss, uint32_t{64});
+
+	if(options.windowShift) {
+		windowScaling_ = true;
+		sendWindowShift_ = *options.windowShift;
+		recvWindowShift_ = ownWindowShift();
+	}
+
+	// Initial window (RFC 6928).
+	ccState_.cwnd = std::min(10 * ccState_.mss, std::max(2 * ccState_.mss, uint32_t{14600}));
+}
+
+std::vector<char> Tcp4Socket::buildSegment_(uint32_t source, uint32_t sn,
+		size_t offset, size_t chunk, bool syn, bool ack, bool fin) {
+	// SYN segments carry the MSS and window scale options.
+	// The latter is only sent in SYN-ACKs if the remote side sent it as well.
+	bool withMss = syn;
+	bool withWindowScale = syn && (!ack || windowScaling_);
+	size_t optionsSize = (withMss ? 4 : 0) + (withWindowScale ? 4 : 0);
+
+	std::vector<char> buf;
+	buf.resize(sizeof(TcpHeader) + optionsSize + chunk);
+
+	// The window field of SYN segments is never scaled.
+	int shift = syn ? 0 : recvWindowShift_;
+	size_t window = std::min(recvRing_.spaceForEnqueue() >> shift, size_t{0xFFFF});
+
+	auto header = new (buf.data()) TcpHeader {
+		.srcPort = localEp_.port,
+		.destPort = remoteEp_.port,
+		.seqNumber = sn,
+		.ackNumber = ack ? remoteKnownSn_ : 0,
+		.flags = {},
+		.window = static_cast<uint16_t>(window),
+		.checksum = 0,
+		.urgentPointer = 0,
+	};
+	header->flags.store(TcpHeader::headerWords((sizeof(TcpHeader) + optionsSize) / 4)
+			| TcpHeader::synFlag(syn)
+			| TcpHeader::ackFlag(ack)
+			| TcpHeader::finFlag(fin));
+
+	auto opts = reinterpret_cast<uint8_t *>(buf.data() + sizeof(TcpHeader));
+	if(withMss) {
+		opts[0] = TCP_OPT_MSS;
+		opts[1] = 4;
+		opts[2] = maxSegmentSize >> 8;
+		opts[3] = maxSegmentSize & 0xFF;
+		opts += 4;
+	}
+	if(withWindowScale) {
+		opts[0] = TCP_OPT_NOP;
+		opts[1] = TCP_OPT_WINDOW_SCALE;
+		opts[2] = 3;
+		opts[3] = ownWindowShift();
+	}
+
+	// Fill in the checksum. The payload is summed while copying it out of the ring.
+	PseudoHeader pseudo {
+		.src = source,
+		.dst = remoteEp_.ipAddress,
+		.len = buf.size()
+	};
+	Checksum csum;
+	csum.update(&pseudo, sizeof(PseudoHeader));
+	csum.update(buf.data(), sizeof(TcpHeader) + optionsSize);
+	if (chunk)
+		sendRing_.dequeueLookahead(offset, buf.data() + sizeof(TcpHeader) + optionsSize,
+				chunk, csum);
+	header->checksum = csum.finalize();
+
+	if(ack) {
+		remoteAckedSn_ = remoteKnownSn_;
+		announcedWindow_ = window << shift;
+		forceAck_ = false;
+	}
+
+	// Update RTT measurement and retransmission timer if the segment occupies sequence space.
+	uint32_t end = sn + chunk + (syn ? 1 : 0) + (fin ? 1 : 0);
+	if(end != sn) {
+		if(seqBefore(sn, localMaxSn_)) {
+			// Karn's algorithm: do not sample the RTT of retransmitted segments.
+			rttTiming_ = false;
+		}else if(!rttTiming_) {
+			rttTiming_ = true;
+			rttSn_ = end;
+			rttStart_ = clockNanos();
+		}
+
+		if(seqAfter(end, localMaxSn_))
+			localMaxSn_ = end;
+		if(!rtoDeadline_)
+			armRetransmitTimer_();
+	}
+
+	return buf;
+}
+
 async::result<void> Tcp4Socket::flushOutPackets_() {
 	while(true) {
+		if(connectState_ == ConnectState::closed)
+			co_return;
+
 		if(connectState_ == ConnectState::none) {
 			co_await flushEvent_.async_wait();
 			continue;
 		}
 
-		if(connectState_ == ConnectState::sendSyn) {
+		if(connectState_ == ConnectState::sendSyn
+				|| connectState_ == ConnectState::sendSynAck) {
+			// The SYN is (re-)transmitted whenever localFlushedSn_ is rewound.
 			if(localSettledSn_ != localFlushedSn_) {
 				co_await flushEvent_.async_wait();
 				continue;
 			}
 
-			// Obtain a new random sequence number.
-			auto randomSn = globalPrng();
-			localSettledSn_ = randomSn;
-			localFlushedSn_ = randomSn;
-
-			// Construct and transmit the initial SYN packet.
 			auto targetInfo = co_await ip4().targetByRemote(remoteEp_.ipAddress, boundInterface_);
 			if (!targetInfo) {
 				// TODO: Return an error to users.
@@ -751,95 +1105,17 @@ async::result<void> Tcp4Socket::flushOutPackets_() {
 				co_return;
 			}
 
-			std::vector<char> buf;
-			buf.resize(sizeof(TcpHeader));
-
-			auto header = new (buf.data()) TcpHeader {
-				.srcPort = localEp_.port,
-				.destPort = remoteEp_.port,
-				.seqNumber = localFlushedSn_,
-				.ackNumber = 0,
-				.flags = {},
-				.window = 0,
-				.checksum = 0,
-				.urgentPointer = 0,
-			};
-			header->flags.store(TcpHeader::headerWords(sizeof(TcpHeader) / 4)
-					| TcpHeader::synFlag(true));
-
-			// Fill in the checksum.
-			PseudoHeader pseudo {
-				.src = targetInfo->source,
-				.dst = remoteEp_.ipAddress,
-				.len = buf.size()
-			};
-			Checksum csum;
-			csum.update(&pseudo, sizeof(PseudoHeader));
-			csum.update(buf.data(), buf.size());
-			header->checksum = csum.finalize();
-
-			++localFlushedSn_;
-
-			if(debugTcp)
-				std::cout << "netserver: Sending TCP SYN" << std::endl;
-			auto error = co_await ip4().sendFrame(std::move(*targetInfo),
-				buf.data(), buf.size(), static_cast<uint16_t>(IpProto::tcp));
-			if (error != protocols::fs::Error::none) {
-				// TODO: Return an error to users.
-				std::cout << "netserver: Could not send TCP packet" << std::endl;
-				co_return;
-			}
-		}else if(connectState_ == ConnectState::sendSynAck) {
-			if(localSettledSn_ != localFlushedSn_) {
-				co_await flushEvent_.async_wait();
+			// Re-check the state since targetByRemote() can suspend.
+			if(localSettledSn_ != localFlushedSn_)
 				continue;
-			}
-
-			// Obtain a new random sequence number.
-			auto randomSn = globalPrng();
-			localSettledSn_ = randomSn;
-			localFlushedSn_ = randomSn;
-
-			// Construct and transmit the initial SYN-ACK packet.
-			auto targetInfo = co_await ip4().targetByRemote(remoteEp_.ipAddress, boundInterface_);
-			if (!targetInfo) {
-				// TODO: Return an error to users.
-				std::cout << "netserver: Destination unreachable" << std::endl;
-				co_return;
-			}
-
-			std::vector<char> buf;
-			buf.resize(sizeof(TcpHeader));
-
-			auto header = new (buf.data()) TcpHeader {
-				.srcPort = localEp_.port,
-				.destPort = remoteEp_.port,
-				.seqNumber = localFlushedSn_,
-				.ackNumber = remoteKnownSn_,
-				.flags = {},
-				.window = 0,
-				.checksum = 0,
-				.urgentPointer = 0,
-			};
-			header->flags.store(TcpHeader::headerWords(sizeof(TcpHeader) / 4)
-					| TcpHeader::synFlag(true)
-					| TcpHeader::ackFlag(true));
-
-			// Fill in the checksum.
-			PseudoHeader pseudo {
-				.src = targetInfo->source,
-				.dst = remoteEp_.ipAddress,
-				.len = buf.size()
-			};
-			Checksum csum;
-			csum.update(&pseudo, sizeof(PseudoHeader));
-			csum.update(buf.data(), buf.size());
-			header->checksum = csum.finalize();
 
+			// Construct and transmit the SYN or SYN-ACK packet.
+			bool synAck = connectState_ == ConnectState::sendSynAck;
+			auto buf = buildSegment_(targetInfo->source, localFlushedSn_, 0, 0, true, synAck, false);
 			++localFlushedSn_;
 
 			if(debugTcp)
-				std::cout << "netserver: Sending TCP SYN-ACK" << std::endl;
+				std::cout << "netserver: Sending TCP " << (synAck ? "SYN-ACK" : "SYN") << std::endl;
 			auto error = co_await ip4().sendFrame(std::move(*targetInfo),
 				buf.data(), buf.size(), static_cast<uint16_t>(IpProto::tcp));
 			if (error != protocols::fs::Error::none) {
@@ -852,29 +1128,73 @@ async::result<void> Tcp4Socket::flushOutPackets_() {
 				|| connectState_ == ConnectState::sendFin
 				|| connectState_ == ConnectState::finAcked);
 
-			auto targetInfo = co_await ip4().targetByRemote(remoteEp_.ipAddress);
+			auto targetInfo = co_await ip4().targetByRemote(remoteEp_.ipAddress, boundInterface_);
 			if (!targetInfo) {
 				// TODO: Return an error to users.
 				std::cout << "netserver: Destination unreachable" << std::endl;
 				co_return;
 			}
 
+			auto mss = ccState_.mss;
+			size_t bytesAvailable = sendRing_.availableToDequeue();
+
+			// Fast retransmit or NewReno partial ACK: resend the first unacknowledged segment.
+			if(retransmitFirst_) {
+				retransmitFirst_ = false;
+
+				size_t outstanding = localMaxSn_ - localSettledSn_;
+				size_t chunk = std::min({bytesAvailable, outstanding, size_t{mss}});
+				// In sendFin state, all data is acknowledged and only the FIN can be outstanding.
+				bool resendFin = connectState_ == ConnectState::sendFin && !chunk && outstanding;
+
+				if(chunk || resendFin) {
+					auto buf = buildSegment_(targetInfo->source, localSettledSn_, 0, chunk,
+							false, true, resendFin);
+					if(seqBefore(localFlushedSn_, localSettledSn_ + chunk + resendFin))
+						localFlushedSn_ = localSettledSn_ + chunk + resendFin;
+
+					if(debugTcp)
+						std::cout << "netserver: Retransmitting TCP data ("
+								<< chunk << " bytes)" << std::endl;
+					auto error = co_await ip4().sendFrame(std::move(*targetInfo),
+						buf.data(), buf.size(),
+						static_cast<uint16_t>(IpProto::tcp));
+					if (error != protocols::fs::Error::none) {
+						// TODO: Return an error to users.
+						std::cout << "netserver: Could not send TCP packet" << std::endl;
+						co_return;
+					}
+					continue;
+				}
+			}
+
 			size_t flushPointer = localFlushedSn_ - localSettledSn_;
-			size_t windowPointer = localWindowSn_ - localSettledSn_;
+			// The amount of data in flight is limited by both the remote window and cwnd.
+			size_t windowPointer = std::min(size_t{localWindowSn_ - localSettledSn_},
+					size_t{ccState_.cwnd});
 
 			size_t chunk = 0; // Size of payload that we are going to send.
 			if (connectState_ == ConnectState::connected) {
-				size_t bytesAvailable = sendRing_.availableToDequeue();
 				assert(bytesAvailable >= flushPointer);
 
 				if (bytesAvailable > flushPointer && windowPointer > flushPointer) {
 					chunk = std::min({
 						bytesAvailable - flushPointer,
 						windowPointer - flushPointer,
-						size_t{1280} // TODO: Perform path MTU discovery.
+						size_t{mss}
 					});
+
+					// Sender-side silly window avoidance: do not send small segments
+					// due to the window while data is in flight.
+					if (chunk < mss && chunk < bytesAvailable - flushPointer && flushPointer)
+						chunk = 0;
 				}
+
+				// Probe a zero window with a single byte.
+				if (probeWindow_ && !chunk && bytesAvailable > flushPointer)
+					chunk = 1;
 			}
+			probeWindow_ = false;
 
 			bool sendFin = false;
 			if (connectState_ == ConnectState::sendFin) {
@@ -884,54 +1204,28 @@ async::result<void> Tcp4Socket::flushOutPackets_() {
 			}
 
 			// Check whether we need to send a packet.
-			// TODO: Add retransmission here.
-			bool wantAck = (remoteAckedSn_ != remoteKnownSn_);
-			bool wantWindowUpdate = (announcedWindow_ < recvRing_.spaceForEnqueue());
+			size_t space = recvRing_.spaceForEnqueue();
+			bool wantAck = (remoteAckedSn_ != remoteKnownSn_) || forceAck_;
+			bool wantWindowUpdate = space >= announcedWindow_ + std::min(size_t{mss}, space / 2)
+					|| (!announcedWindow_ && (space >> recvWindowShift_));
 
 			if(chunk == 0 && !sendFin && !wantAck && !wantWindowUpdate) {
+				// Arm the timer to probe the remote window if it is zero (persist timer).
+				if (connectState_ == ConnectState::connected && bytesAvailable > flushPointer
+						&& localWindowSn_ == localSettledSn_ && !rtoDeadline_)
+					armRetransmitTimer_();
 				co_await flushEvent_.async_wait();
 				continue;
 			}
 
 			// Construct and transmit the TCP packet.
-			std::vector<char> buf;
-			buf.resize(sizeof(TcpHeader) + chunk);
-
-			auto header = new (buf.data()) TcpHeader {
-				.srcPort = localEp_.port,
-				.destPort = remoteEp_.port,
-				.seqNumber = localFlushedSn_,
-				.ackNumber = remoteKnownSn_,
-				.flags = {},
-				.window = std::min(recvRing_.spaceForEnqueue(), size_t{0xFFFF}),
-				.checksum = 0,
-				.urgentPointer = 0,
-			};
-			header->flags.store(TcpHeader::headerWords(sizeof(TcpHeader) / 4)
-					| TcpHeader::ackFlag(true)
-					| TcpHeader::finFlag(sendFin));
-
-			if (chunk)
-				sendRing_.dequeueLookahead(flushPointer, buf.data() + sizeof(TcpHeader), chunk);
-
-			// Fill in the checksum.
-			PseudoHeader pseudo {
-				.src = targetInfo->source,
-				.dst = remoteEp_.ipAddress,
-				.len = buf.size()
-			};
-			Checksum csum;
-			csum.update(&pseudo, sizeof(PseudoHeader));
-			csum.update(buf.data(), buf.size());
-			header->checksum = csum.finalize();
+			auto buf = buildSegment_(targetInfo->source, localFlushedSn_, flushPointer, chunk,
+					false, true, sendFin);
 
 			localFlushedSn_ += chunk;
 			if (sendFin)
 				++localFlushedSn_;
 
-			remoteAckedSn_ = remoteKnownSn_;
-			announcedWindow_ = recvRing_.spaceForEnqueue();
-
 			if(debugTcp)
 				std::cout << "netserver: Sending TCP data (" << chunk << " bytes)" << std::endl;
 			auto error = co_await ip4().sendFrame(std::move(*targetInfo),
@@ -946,6 +1240,259 @@ async::result<void> Tcp4Socket::flushOutPackets_() {
 	}
 }
 
+void Tcp4Socket::armRetransmitTimer_() {
+	bool wasDisarmed = !rtoDeadline_;
+	rtoDeadline_ = clockNanos() + rto_;
+	// If the timer was already armed, retransmitTimer_() notices the new deadline
+	// when the old one expires. This avoids re-programming the timer on every ACK.
+	if(wasDisarmed)
+		timerEvent_.raise();
+}
+
+async::result<void> Tcp4Socket::retransmitTimer_() {
+	while(true) {
+		if(!rtoDeadline_) {
+			co_await timerEvent_.async_wait();
+			continue;
+		}
+
+		auto now = clockNanos();
+		if(now < rtoDeadline_) {
+			async::cancellation_event ev;
+			helix::TimeoutCancellation timer{rtoDeadline_ - now, ev};
+			co_await timerEvent_.async_wait(ev);
+			co_await timer.retire();
+			continue;
+		}
+
+		rtoDeadline_ = 0;
+		handleRetransmitTimeout_();
+	}
+}
+
+void Tcp4Socket::handleRetransmitTimeout_() {
+	if(connectState_ == ConnectState::none || connectState_ == ConnectState::finAcked
+			|| connectState_ == ConnectState::closed)
+		return;
+
+	// RFC 6298 (5.5): back off the timer.
+	rto_ = std::min(2 * rto_, maxRto);
+
+	bool zeroWindow = localWindowSn_ == localSettledSn_ && localFlushedSn_ == localSettledSn_;
+	if(localMaxSn_ == localSettledSn_ || zeroWindow) {
+		// Nothing can be sent: the timer was armed to probe a zero window.
+		probeWindow_ = true;
+		flushEvent_.raise();
+		return;
+	}
+
+	if(++retransmits_ > maxRetransmits) {
+		if(debugTcp)
+			std::println("netserver: TCP connection timed out");
+		// Linux reports ETIMEDOUT here. We use EHOSTUNREACH (which Linux also reports
+		// if the retransmissions triggered ICMP errors) since the protocols lack a timeout error.
+		abort_(protocols::fs::Error::hostUnreachable);
+		return;
+	}
+
+	if(debugTcp)
+		std::println("netserver: TCP retransmission timeout (RTO {} ms)", rto_ / 1'000'000);
+
+	// RFC 5681 (4): reduce ssthresh and restart from the loss window.
+	if(connectState_ == ConnectState::connected || connectState_ == ConnectState::sendFin) {
+		uint32_t flightSize = localMaxSn_ - localSettledSn_;
+		ccState_.ssthresh = cc_->onLoss(ccState_, flightSize, clockNanos());
+		ccState_.cwnd = ccState_.mss;
+	}
+
+	// RFC 6582 (4): do not enter fast recovery for losses of the current window.
+	inRecovery_ = false;
+	recoverSn_ = localMaxSn_;
+	dupAcks_ = 0;
+	rttTiming_ = false;
+
+	// Go back and resend everything starting at the first unacknowledged Out-SN.
+	// The timer is re-armed once the segment is resent (RFC 6298 (5.6)).
+	localFlushedSn_ = localSettledSn_;
+	retransmitFirst_ = false;
+	flushEvent_.raise();
+}
+
+void Tcp4Socket::updateRto_(uint64_t rtt) {
+	// RFC 6298 (2.2) and (2.3).
+	if(!ccState_.srtt) {
+		ccState_.srtt = rtt;
+		rttvar_ = rtt / 2;
+	}else{
+		uint64_t delta = (ccState_.srtt > rtt) ? ccState_.srtt - rtt : rtt - ccState_.srtt;
+		rttvar_ = (3 * rttvar_ + delta) / 4;
+		ccState_.srtt = (7 * ccState_.srtt + rtt) / 8;
+	}
+
+	rto_ = std::clamp(ccState_.srtt + std::max(clockGranularity, 4 * rttvar_), minRto, maxRto);
+}
+
+void Tcp4Socket::handleAck_(TcpPacket &packet) {
+	uint32_t ackSn = packet.header.ackNumber.load();
+	uint32_t window = uint32_t{packet.header.window.load()} << sendWindowShift_;
+
+	size_t validWindow = localMaxSn_ - localSettledSn_;
+	size_t ackPointer = ackSn - localSettledSn_;
+	if(ackPointer > validWindow) {
+		// Old duplicate ACKs are common once segments are retransmitted.
+		if(debugTcp)
+			std::cout << "netserver: Rejecting ack-number outside of valid window"
+					<< std::endl;
+		return;
+	}
+
+	auto now = clockNanos();
+
+	if(!ackPointer) {
+		// RFC 5681 (2): only pure ACKs that do not change the window count as duplicates.
+		auto flags = packet.header.flags.load();
+		bool duplicate = localMaxSn_ != localSettledSn_
+				&& !packet.payload().size()
+				&& !(flags & TcpHeader::synFlag)
+				&& !(flags & TcpHeader::finFlag)
+				&& window
+				&& localSettledSn_ + window == localWindowSn_;
+
+		if(localSettledSn_ + window != localWindowSn_) {
+			localWindowSn_ = localSettledSn_ + window;
+			flushEvent_.raise();
+		}
+		if(duplicate)
+			handleDuplicateAck_(now);
+		return;
+	}
+
+	// Karn's algorithm: rttTiming_ is reset when segments are retransmitted.
+	if(rttTiming_ && !seqBefore(ackSn, rttSn_)) {
+		rttTiming_ = false;
+		updateRto_(now - rttStart_);
+	}
+	retransmits_ = 0;
+
+	// The acknowledged sequence space may include our FIN.
+	size_t dataAcked = std::min(ackPointer, sendRing_.availableToDequeue());
+	sendRing_.dequeueAdvance(dataAcked);
+	localSettledSn_ = ackSn;
+	if(seqBefore(localFlushedSn_, localSettledSn_))
+		localFlushedSn_ = localSettledSn_;
+	localWindowSn_ = localSettledSn_ + window;
+
+	if(inRecovery_) {
+		if(!seqBefore(ackSn, recoverSn_)) {
+			// Full acknowledgement, exit fast recovery (RFC 6582 (3.2) step 3).
+			inRecovery_ = false;
+			uint32_t flightSize = localMaxSn_ - localSettledSn_;
+			ccState_.cwnd = std::min(ccState_.ssthresh,
+					std::max(flightSize, ccState_.mss) + ccState_.mss);
+		}else{
+			// Partial acknowledgement: retransmit the next segment and deflate cwnd.
+			retransmitFirst_ = true;
+			uint32_t deflated = (ccState_.cwnd > ackPointer) ? ccState_.cwnd - ackPointer : 0;
+			if(ackPointer >= ccState_.mss)
+				deflated += ccState_.mss;
+			ccState_.cwnd = std::max(deflated, ccState_.mss);
+		}
+	}else if(connectState_ == ConnectState::connected) {
+		cc_->onAck(ccState_, ackPointer, now);
+	}
+	dupAcks_ = 0;
+
+	// In sendFin state, all data was acknowledged before the FIN was sent.
+	if(connectState_ == ConnectState::sendFin)
+		connectState_ = ConnectState::finAcked;
+
+	// RFC 6298 (5.2) and (5.3).
+	if(localSettledSn_ == localMaxSn_) {
+		rtoDeadline_ = 0;
+	}else{
+		armRetransmitTimer_();
+	}
+
+	outSeq_ = ++currentSeq_;
+	settleEvent_.raise();
+	flushEvent_.raise();
+	pollEvent_.raise();
+}
+
+void Tcp4Socket::handleDuplicateAck_(uint64_t now) {
+	++dupAcks_;
+
+	if(inRecovery_) {
+		// Inflate cwnd for each segment that left the network (RFC 5681 (3.2) step 4).
+		ccState_.cwnd += ccState_.mss;
+		flushEvent_.raise();
+		return;
+	}
+
+	// RFC 6582 (4.1): do not start fast recovery for losses in the previous recovery window.
+	if(dupAcks_ != dupAckThreshold || !seqAfter(localSettledSn_, recoverSn_))
+		return;
+
+	if(debugTcp)
+		std::println("netserver: TCP fast retransmit");
+
+	uint32_t flightSize = localMaxSn_ - localSettledSn_;
+	ccState_.ssthresh = cc_->onLoss(ccState_, flightSize, now);
+	ccState_.cwnd = ccState_.ssthresh + dupAckThreshold * ccState_.mss;
+	inRecovery_ = true;
+	recoverSn_ = localMaxSn_;
+	retransmitFirst_ = true;
+	flushEvent_.raise();
+}
+
+size_t Tcp4Socket::acceptPayload_(void *data, size_t size) {
+	size_t chunk = std::min(size, recvRing_.spaceForEnqueue());
+	if(!chunk)
+		return 0;
+
+	recvRing_.enqueue(data, chunk);
+	remoteKnownSn_ += chunk;
+	if(announcedWindow_ < chunk) {
+		announcedWindow_ = 0;
+	}else{
+		announcedWindow_ -= chunk;
+	}
+	return chunk;
+}
+
+void Tcp4Socket::storeOutOfOrder_(uint32_t sn, arch::dma_buffer_view payload) {
+	if(outOfOrder_.size() >= maxOutOfOrderSegments)
+		return;
+	// Only keep segments that fit into the receive window.
+	if(size_t{sn - remoteKnownSn_} + payload.size() > recvRing_.spaceForEnqueue())
+		return;
+	for(auto &segment : outOfOrder_) {
+		if(segment.sn == sn)
+			return;
+	}
+
+	auto p = reinterpret_cast<const char *>(payload.data());
+	outOfOrder_.push_back({sn, std::vector<char>(p, p + payload.size())});
+}
+
+void Tcp4Socket::drainOutOfOrder_() {
+	bool progress = true;
+	while(progress && !outOfOrder_.empty()) {
+		progress = false;
+		for(auto it = outOfOrder_.begin(); it != outOfOrder_.end(); ) {
+			if(seqAfter(it->sn, remoteKnownSn_)) {
+				++it;
+				continue;
+			}
+
+			size_t lead = remoteKnownSn_ - it->sn;
+			if(lead < it->data.size() && acceptPayload_(it->data.data() + lead, it->data.size() - lead))
+				progress = true;
+			it = outOfOrder_.erase(it);
+		}
+	}
+}
+
 async::result<void> Tcp4Socket::handleIncomingConnection(PendingConnection c) {
 	auto sock = Tcp4Socket::makeSocket(this->parent_, 0);
 
@@ -962,10 +1509,16 @@ async::result<void> Tcp4Socket::handleIncomingConnection(PendingConnection c) {
 		co_return;
 	}
 
+	// Accepted sockets inherit the congestion control algorithm and the debug loss rate.
+	sock->cc_ = makeTcpCongestionControl(cc_->name());
+	sock->lossPermille_ = lossPermille_;
+
 	// Connect to the remote.
 	sock->connectState_ = ConnectState::sendSynAck;
 	sock->remoteAckedSn_ = c.sequence + 1;
 	sock->remoteKnownSn_ = c.sequence + 1;
+	sock->applySynOptions_(c.options);
+	sock->chooseInitialSn_();
 
 	sock->flushEvent_.raise();
 
@@ -982,7 +1535,38 @@ async::result<void> Tcp4Socket::handleIncomingConnection(PendingConnection c) {
 	co_return;
 }
 
+void Tcp4Socket::abort_(protocols::fs::Error error) {
+	connectState_ = ConnectState::closed;
+	pendingError_ = error;
+	rtoDeadline_ = 0;
+
+	// Wake up all pending operations; they observe the closed state.
+	inSeq_ = ++currentSeq_;
+	outSeq_ = currentSeq_;
+	hupSeq_ = currentSeq_;
+	inEvent_.raise();
+	flushEvent_.raise();
+	settleEvent_.raise();
+	timerEvent_.raise();
+	pollEvent_.raise();
+}
+
+protocols::fs::Error Tcp4Socket::takeError_(protocols::fs::Error fallback) {
+	if(pendingError_ == protocols::fs::Error::none)
+		return fallback;
+	return std::exchange(pendingError_, protocols::fs::Error::none);
+}
+
 void Tcp4Socket::handleInPacket_(TcpPacket packet) {
+	if(connectState_ == ConnectState::closed)
+		return;
+
+	if(lossPermille_) {
+		std::uniform_int_distribution<unsigned int> lossDist{0, 999};
+		if(lossDist(globalPrng) < lossPermille_)
+			return;
+	}
+
 	if(boundInterface_ && boundInterface_->index() != packet.packet->link.lock()->index())
 		return;
 
@@ -1004,7 +1588,8 @@ void Tcp4Socket::handleInPacket_(TcpPacket packet) {
 				.localIp = localIp,
 				.remoteIp = ip,
 				.remotePort = port,
-				.sequence = packet.header.seqNumber.load()
+				.sequence = packet.header.seqNumber.load(),
+				.options = packet.options()
 			}));
 		}else {
 			std::cout << "netserver: Rejecting packet on listening socket"
@@ -1015,7 +1600,7 @@ void Tcp4Socket::handleInPacket_(TcpPacket packet) {
 	}
 
 	if(connectState_ == ConnectState::sendSyn) {
-		if(localSettledSn_ == localFlushedSn_) {
+		if(localSettledSn_ == localMaxSn_) {
 			std::cout << "netserver: Rejecting packet before SYN is sent [sendSyn]"
 					<< std::endl;
 			return;
@@ -1037,21 +1622,42 @@ void Tcp4Socket::handleInPacket_(TcpPacket packet) {
 			return;
 		}
 
+		if(rttTiming_) {
+			rttTiming_ = false;
+			updateRto_(clockNanos() - rttStart_);
+		}
+		rtoDeadline_ = 0;
+		retransmits_ = 0;
+
+		applySynOptions_(packet.options());
+
 		++localSettledSn_;
+		localFlushedSn_ = localSettledSn_;
 		localWindowSn_ = localSettledSn_ + packet.header.window.load();
 		remoteAckedSn_ = packet.header.seqNumber.load();
 		remoteKnownSn_ = packet.header.seqNumber.load() + 1; // SYN counts as one byte.
 		connectState_ = ConnectState::connected;
 		flushEvent_.raise();
 		settleEvent_.raise();
-	}else if(connectState_ == ConnectState::sendSynAck) {
-		if(localSettledSn_ == localFlushedSn_) {
+		return;
+	}
+
+	if(connectState_ == ConnectState::sendSynAck) {
+		if(localSettledSn_ == localMaxSn_) {
 			std::cout << "netserver: Rejecting packet before SYN-ACK is sent [sendSynAck]"
 					<< std::endl;
 			return;
 		}
 
 		if(!(packet.header.flags.load() & TcpHeader::ackFlag)) {
+			// The remote side retransmitted its SYN; our SYN-ACK was probably lost.
+			if((packet.header.flags.load() & TcpHeader::synFlag)
+					&& packet.header.seqNumber.load() + 1 == remoteKnownSn_) {
+				localFlushedSn_ = localSettledSn_;
+				flushEvent_.raise();
+				return;
+			}
+
 			std::cout << "netserver: Rejecting packet without ACK [sendSynAck]"
 					<< std::endl;
 			return;
@@ -1069,33 +1675,51 @@ void Tcp4Socket::handleInPacket_(TcpPacket packet) {
 			return;
 		}
 
+		if(rttTiming_) {
+			rttTiming_ = false;
+			updateRto_(clockNanos() - rttStart_);
+		}
+		rtoDeadline_ = 0;
+		retransmits_ = 0;
+
 		++localSettledSn_;
-		localWindowSn_ = localSettledSn_ + packet.header.window.load();
+		localFlushedSn_ = localSettledSn_;
+		localWindowSn_ = localSettledSn_
+				+ (uint32_t{packet.header.window.load()} << sendWindowShift_);
 		connectState_ = ConnectState::connected;
 		flushEvent_.raise();
 		settleEvent_.raise();
-	}else if(connectState_ == ConnectState::connected
+
+		// The ACK may already carry data, fall through to process it.
+	}
+
+	if(connectState_ == ConnectState::connected
 			|| connectState_ == ConnectState::sendFin
 			|| connectState_ == ConnectState::finAcked) {
-		if(packet.header.seqNumber.load() == remoteKnownSn_) {
+		auto flags = packet.header.flags.load();
+		auto sn = packet.header.seqNumber.load();
+		auto payload = packet.payload();
+		bool fin = flags & TcpHeader::finFlag;
+
+		// Number of payload bytes that we already received.
+		size_t lead = remoteKnownSn_ - sn;
+		if(!seqAfter(sn, remoteKnownSn_) && lead <= payload.size() && !remoteClosed_) {
 			bool gotUpdate = false;
 
-			auto payload = packet.payload();
-			size_t chunk = std::min(payload.size(), recvRing_.spaceForEnqueue());
+			size_t fresh = payload.size() - lead;
+			size_t chunk = acceptPayload_(payload.subview(lead).data(), fresh);
 			if(chunk) {
-				recvRing_.enqueue(payload.data(), chunk);
-				remoteKnownSn_ += chunk;
-				if(announcedWindow_ < chunk) {
-					announcedWindow_ = 0;
-				}else{
-					announcedWindow_ -= chunk;
-				}
+				drainOutOfOrder_();
 
 				inSeq_ = ++currentSeq_;
 				gotUpdate = true;
 			}
 
-			if(packet.header.flags.load() & TcpHeader::finFlag) {
+			// Acknowledge duplicate data and data that does not fit into the ring immediately.
+			if(chunk < fresh || (lead && !chunk))
+				forceAck_ = true;
+
+			if(fin && chunk == fresh) {
 				++remoteKnownSn_; // FIN counts as one byte.
 				remoteClosed_ = true;
 
@@ -1105,38 +1729,22 @@ void Tcp4Socket::handleInPacket_(TcpPacket packet) {
 
 			if(gotUpdate) {
 				inEvent_.raise();
-				flushEvent_.raise();
 				pollEvent_.raise();
 			}
+			if(gotUpdate || forceAck_)
+				flushEvent_.raise();
+		}else if(payload.size() || fin || (flags & TcpHeader::synFlag)) {
+			// Out-of-order or duplicate segment.
+			// Send an immediate (duplicate) ACK such that the remote can fast retransmit.
+			if(seqAfter(sn, remoteKnownSn_) && payload.size())
+				storeOutOfOrder_(sn, payload);
+
+			forceAck_ = true;
+			flushEvent_.raise();
 		}
 
-		if(packet.header.flags.load() & TcpHeader::ackFlag) {
-			if (connectState_ == ConnectState::connected) {
-				size_t validWindow = localFlushedSn_ - localSettledSn_;
-				size_t ackPointer = packet.header.ackNumber.load() - localSettledSn_;
-				if(ackPointer <= validWindow) {
-					localSettledSn_ += ackPointer;
-					localWindowSn_ = localSettledSn_ + packet.header.window.load();
-					sendRing_.dequeueAdvance(ackPointer);
-					outSeq_ = ++currentSeq_;
-					settleEvent_.raise();
-					pollEvent_.raise();
-				}else{
-					std::cout << "netserver: Rejecting ack-number outside of valid window"
-							<< std::endl;
-				}
-			} else if (connectState_ == ConnectState::sendFin) {
-				if(packet.header.ackNumber.load() == localSettledSn_ + 1) {
-					connectState_ = ConnectState::finAcked;
-					++localSettledSn_;
-					localWindowSn_ = localSettledSn_ + packet.header.window.load();
-					settleEvent_.raise();
-				}else if(packet.header.ackNumber.load() != localSettledSn_) {
-					std::cout << "netserver: Rejecting packet with bad ack-number [sendFin]"
-							<< std::endl;
-				}
-			}
-		}
+		if(flags & TcpHeader::ackFlag)
+			handleAck_(packet);
 	}
 }
 
@@ -461,7 +461,7 @@ struct Udp4Socket {
 		};
 		chk.update(&psh, sizeof(psh));
 		chk.update(&header, sizeof(header));
-		chk.update(data, len);
+		chk.updateCopy(buf.data() + sizeof(header), data, len);
 		header.chk = convert_endian<endian::big>(chk.finalize());
 
 		if (dumpHeader)
@@ -480,7 +480,6 @@ struct Udp4Socket {
 		}
 
 		std::memcpy(buf.data(), &header, sizeof(header));
-		std::memcpy(buf.data() + sizeof(header), data, len);
 
 		auto error = co_await ip4().sendFrame(std::move(*ti),
 			buf.data(), buf.size(), std::to_underlying(IpProto::udp));
@@ -1,11 +1,16 @@
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <async/result.hpp>
 #include <async/algorithm.hpp>
 #include <async/wait-group.hpp>
+#include <helix/clock.hpp>
 #include <helix/ipc.hpp>
 
+#include <algorithm>
 #include <atomic>
+#include <climits>
 #include <print>
 #include <thread>
 #include <vector>
@@ -68,6 +73,31 @@ void doNopBenchmark() {
 	bench.finalizeStatistics();
 }
 
+// Compares helGetClock() to reading the clock page.
+void doGetClockBenchmark(bool useClockPage) {
+	std::cout << (useClockPage ? "clock page reads" : "helGetClock() calls") << std::endl;
+
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		uint64_t n = 0;
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			for(int i = 0; i < 100; ++i) {
+				uint64_t now;
+				if(useClockPage) {
+					now = helix::getClockNanos();
+				}else{
+					HEL_CHECK(helGetClock(&now));
+				}
+				asm volatile ("" : : "r"(now));
+				++n;
+			}
+		}
+		bench.announceIterations(n);
+	}
+	bench.finalizeStatistics();
+}
+
 async::result<void> doAsyncNopBenchmark() {
 	std::cout << "ipc ops" << std::endl;
 
@@ -119,6 +149,50 @@ async::result<void> doMultiSubmitAsyncNopBenchmark() {
 	bench.finalizeStatistics();
 }
 
+// Submits batches of async nops either through one syscall per operation
+// or as SQ elements that are consumed by a single helDriveQueue() call.
+void doBatchedAsyncNopBenchmark(bool useSq) {
+	constexpr int batchSize = 64;
+	std::cout << "ipc ops, batches of " << batchSize << " ("
+			<< (useSq ? "submission queue" : "syscall per op") << ")" << std::endl;
+
+	struct CountingContext final : helix::Context {
+		void complete(helix::ElementHandle element) override {
+			auto result = reinterpret_cast<HelSimpleResult *>(element.data());
+			HEL_CHECK(result->error);
+			++completed;
+		}
+
+		uint64_t completed = 0;
+	};
+
+	auto &dispatcher = helix::Dispatcher::global();
+	auto queue = dispatcher.acquire();
+
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		CountingContext context;
+		auto contextPtr = reinterpret_cast<uintptr_t>(static_cast<helix::Context *>(&context));
+		uint64_t n = 0;
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			for(int i = 0; i < batchSize; ++i) {
+				if(useSq) {
+					std::span<const std::span<const std::byte>> segments;
+					dispatcher.pushSq(kHelSubmitAsyncNop, contextPtr, segments);
+				}else{
+					HEL_CHECK(helSubmitAsyncNop(queue, contextPtr));
+				}
+			}
+			n += batchSize;
+			while(context.completed < n)
+				dispatcher.wait();
+		}
+		bench.announceIterations(n);
+	}
+	bench.finalizeStatistics();
+}
+
 void doParallelAsyncNopBenchmark() {
 	unsigned int numCpus = std::thread::hardware_concurrency();
 	std::cout << "ipc ops (parallel, " << numCpus << " threads)" << std::endl;
@@ -196,6 +270,240 @@ void doFutexBenchmark() {
 	bench.finalizeStatistics();
 }
 
+// Two threads that alternately wake each other; this mostly measures context switches.
+void doFutexPingPongBenchmark() {
+	std::cout << "futex ping-pong round trips" << std::endl;
+
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		std::atomic<int> turn{0};
+		std::atomic<bool> stop{false};
+		auto futex = reinterpret_cast<int *>(&turn);
+
+		// Waits for our turn, then passes the turn to the other thread.
+		auto play = [&] (int self) -> uint64_t {
+			uint64_t n = 0;
+			while(true) {
+				int t;
+				while((t = turn.load(std::memory_order_acquire)) != self) {
+					if(stop.load(std::memory_order_relaxed))
+						return n;
+					HEL_CHECK(helFutexWait(futex, t, -1));
+				}
+				turn.store(1 - self, std::memory_order_release);
+				HEL_CHECK(helFutexWake(futex, 1));
+				++n;
+			}
+		};
+
+		uint64_t roundTrips = 0;
+		bench.launchRepetition();
+		std::thread ping{[&] { roundTrips = play(0); }};
+		std::thread pong{[&] { play(1); }};
+		while(!bench.isRepetitionDone())
+			std::this_thread::sleep_for(std::chrono::milliseconds{10});
+		stop.store(true, std::memory_order_relaxed);
+		turn.store(2, std::memory_order_release);
+		HEL_CHECK(helFutexWake(futex, INT_MAX));
+		ping.join();
+		pong.join();
+		bench.announceIterations(roundTrips);
+	}
+	bench.finalizeStatistics();
+}
+
+// Three-state futex mutex (0: unlocked, 1: locked, 2: locked with waiters).
+struct FutexMutex {
+	void lock() {
+		int c = 0;
+		if(state.compare_exchange_strong(c, 1, std::memory_order_acquire))
+			return;
+		lockContended();
+	}
+
+	// Also used by threads that were requeued from a condition variable to the mutex.
+	void lockContended() {
+		while(state.exchange(2, std::memory_order_acquire))
+			HEL_CHECK(helFutexWait(futex(), 2, -1));
+	}
+
+	void unlock() {
+		if(state.exchange(0, std::memory_order_release) == 2)
+			HEL_CHECK(helFutexWake(futex(), 1));
+	}
+
+	int *futex() {
+		return reinterpret_cast<int *>(&state);
+	}
+
+	std::atomic<int> state{0};
+};
+
+void doContendedMutexBenchmark() {
+	unsigned int numCpus = std::thread::hardware_concurrency();
+	std::cout << "contended futex mutex (" << numCpus << " threads)" << std::endl;
+
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		FutexMutex mutex;
+		std::atomic<bool> stop{false};
+		std::atomic<uint64_t> totalIterations{0};
+
+		auto worker = [&] {
+			uint64_t n = 0;
+			while(!stop.load(std::memory_order_relaxed)) {
+				for(int i = 0; i < 100; ++i) {
+					mutex.lock();
+					mutex.unlock();
+				}
+				n += 100;
+			}
+			totalIterations.fetch_add(n, std::memory_order_relaxed);
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(numCpus);
+		bench.launchRepetition();
+		for(unsigned int c = 0; c < numCpus; ++c)
+			threads.emplace_back(worker);
+		while(!bench.isRepetitionDone())
+			std::this_thread::sleep_for(std::chrono::milliseconds{10});
+		stop.store(true, std::memory_order_relaxed);
+		for(auto &t : threads)
+			t.join();
+		bench.announceIterations(totalIterations.load(std::memory_order_relaxed));
+	}
+	bench.finalizeStatistics();
+}
+
+// Condition variable broadcasts that either wake all waiters (which then contend on the mutex)
+// or wake one waiter and requeue the others to the mutex.
+void doCondvarBroadcastBenchmark(bool useRequeue) {
+	unsigned int numWaiters = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	std::cout << "condvar broadcast wake-ups (" << (useRequeue ? "requeue" : "wake all")
+			<< ", " << numWaiters << " waiters)" << std::endl;
+
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		FutexMutex mutex;
+		std::atomic<int> cond{0};
+		std::atomic<bool> stop{false};
+		std::atomic<uint64_t> totalIterations{0};
+
+		// Must be called with the mutex held.
+		auto broadcast = [&] {
+			int seq = cond.fetch_add(1, std::memory_order_relaxed) + 1;
+			auto futex = reinterpret_cast<int *>(&cond);
+			if(useRequeue) {
+				unsigned int count;
+				HEL_CHECK(helFutexRequeue(futex, mutex.futex(), 1, INT_MAX,
+						seq, kHelFutexRequeueCompare, &count));
+				// Requeued waiters are only woken if unlock() sees the contended state.
+				if(count > 1)
+					mutex.state.store(2, std::memory_order_relaxed);
+			}else{
+				HEL_CHECK(helFutexWake(futex, INT_MAX));
+			}
+		};
+
+		auto waiter = [&] {
+			uint64_t n = 0;
+			mutex.lock();
+			while(!stop.load(std::memory_order_relaxed)) {
+				int seq = cond.load(std::memory_order_relaxed);
+				mutex.unlock();
+				HEL_CHECK(helFutexWait(reinterpret_cast<int *>(&cond), seq, -1));
+				mutex.lockContended();
+				++n;
+			}
+			mutex.unlock();
+			totalIterations.fetch_add(n, std::memory_order_relaxed);
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(numWaiters);
+		for(unsigned int c = 0; c < numWaiters; ++c)
+			threads.emplace_back(waiter);
+
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			mutex.lock();
+			broadcast();
+			mutex.unlock();
+		}
+
+		mutex.lock();
+		stop.store(true, std::memory_order_relaxed);
+		broadcast();
+		mutex.unlock();
+		for(auto &t : threads)
+			t.join();
+		bench.announceIterations(totalIterations.load(std::memory_order_relaxed));
+	}
+	bench.finalizeStatistics();
+}
+
+// Each thread resolves its own handle such that only the shared universe is contended.
+void doParallelDescriptorLookupBenchmark() {
+	unsigned int numCpus = std::thread::hardware_concurrency();
+	std::cout << "descriptor lookups (parallel, " << numCpus << " threads)" << std::endl;
+
+	IterationsPerSecondBenchmark bench;
+	std::atomic<unsigned int> barrier{0};
+	std::atomic<int> iter{-1};
+	std::atomic<bool> stop{false};
+	std::atomic<uint64_t> totalIterations{0};
+
+	auto worker = [&](unsigned int c) {
+		HelHandle handle;
+		HEL_CHECK(helAllocateMemory(0x1000, 0, nullptr, &handle));
+
+		for(int k = 0; k < 5; ++k) {
+			if (barrier.fetch_add(1, std::memory_order_acquire) + 1 == numCpus) {
+				barrier.store(0, std::memory_order_relaxed);
+				stop.store(false, std::memory_order_relaxed);
+				totalIterations.store(0, std::memory_order_relaxed);
+				iter.store(k, std::memory_order_release);
+			}
+			while(iter.load(std::memory_order_acquire) < k)
+				;
+
+			if (!c) {
+				bench.launchRepetition();
+			}
+
+			while (true) {
+				if (!c) {
+					if (bench.isRepetitionDone()) {
+						stop.store(true, std::memory_order_relaxed);
+						bench.announceIterations(totalIterations.load(std::memory_order_acquire));
+						break;
+					}
+				} else {
+					if (stop.load(std::memory_order_relaxed))
+						break;
+				}
+				int n = 100;
+				for(int i = 0; i < n; ++i) {
+					size_t size;
+					HEL_CHECK(helMemoryInfo(handle, &size));
+				}
+				totalIterations.fetch_add(n, std::memory_order_release);
+			}
+		}
+
+		HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(numCpus);
+	for(unsigned int c = 0; c < numCpus; ++c)
+		threads.emplace_back(worker, c);
+	for(auto &t : threads)
+		t.join();
+	bench.finalizeStatistics();
+}
+
 void doAllocateBenchmark(size_t size) {
 	std::cout << "allocate memory, size = " << (size / (1024 * 1024)) << " MiB" << std::endl;
 
@@ -270,8 +578,9 @@ void doMapPopulatedBenchmark(size_t size) {
 	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
 }
 
-void doPageFaultBenchmark(size_t size) {
-	std::cout << "page faults (mapping size = " << (size / (1024 * 1024)) << " MiB)" << std::endl;
+void doPageFaultBenchmark(size_t size, uint32_t mapFlags) {
+	std::cout << "page faults (" << ((mapFlags & kHelMapPopulate) ? "populated, " : "")
+			<< "mapping size = " << (size / (1024 * 1024)) << " MiB)" << std::endl;
 
 	IterationsPerSecondBenchmark bench;
 	for(int k = 0; k < 5; ++k) {
@@ -282,7 +591,7 @@ void doPageFaultBenchmark(size_t size) {
 			HEL_CHECK(helAllocateMemory(size, 0, nullptr, &handle));
 			void *window;
 			HEL_CHECK(helMapMemory(handle, kHelNullHandle, nullptr, 0, size,
-					kHelMapProtRead | kHelMapProtWrite, &window));
+					kHelMapProtRead | kHelMapProtWrite | mapFlags, &window));
 
 			// Touch all mapped pages.
 			auto p = reinterpret_cast<volatile std::byte *>(window);
@@ -299,6 +608,149 @@ void doPageFaultBenchmark(size_t size) {
 	bench.finalizeStatistics();
 }
 
+// Reads memory through a mapping whose pages were made present through another mapping
+// after the first mapping was established. This is similar to a dynamic loader that maps
+// shared objects that are concurrently read into the page cache: without fault-around,
+// every page takes a separate fault.
+void doFaultAroundBenchmark(size_t size) {
+	std::cout << "read faults on present memory (mapping size = "
+			<< (size / (1024 * 1024)) << " MiB)" << std::endl;
+
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		uint64_t n = 0;
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			HelHandle handle;
+			HEL_CHECK(helAllocateMemory(size, 0, nullptr, &handle));
+			void *window;
+			HEL_CHECK(helMapMemory(handle, kHelNullHandle, nullptr, 0, size,
+					kHelMapProtRead, &window));
+			void *otherWindow;
+			HEL_CHECK(helMapMemory(handle, kHelNullHandle, nullptr, 0, size,
+					kHelMapProtRead | kHelMapProtWrite, &otherWindow));
+
+			// Make all pages present without mapping them into the first window.
+			auto q = reinterpret_cast<volatile std::byte *>(otherWindow);
+			for(size_t progress = 0; progress < size; progress += 0x1000)
+				q[progress] = static_cast<std::byte>(0);
+
+			// Read all pages through the first window.
+			auto p = reinterpret_cast<volatile std::byte *>(window);
+			for(size_t progress = 0; progress < size; progress += 0x1000) {
+				(void)p[progress];
+				++n;
+			}
+
+			HEL_CHECK(helUnmapMemory(kHelNullHandle, otherWindow, size));
+			HEL_CHECK(helUnmapMemory(kHelNullHandle, window, size));
+			HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+		}
+		bench.announceIterations(n);
+	}
+	bench.finalizeStatistics();
+}
+
+void doLargePageTouchBenchmark(size_t size, uint32_t flags) {
+	std::cout << "touch fresh memory (" << ((flags & kHelAllocLargePages) ? "large" : "small")
+			<< " pages, mapping size = " << (size / (1024 * 1024)) << " MiB)" << std::endl;
+
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		uint64_t n = 0;
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			HelHandle handle;
+			HEL_CHECK(helAllocateMemory(size, flags, nullptr, &handle));
+			void *window;
+			HEL_CHECK(helMapMemory(handle, kHelNullHandle, nullptr, 0, size,
+					kHelMapProtRead | kHelMapProtWrite, &window));
+
+			// Touch all mapped pages twice: the first pass faults, the second one
+			// measures TLB pressure.
+			auto p = reinterpret_cast<volatile std::byte *>(window);
+			for(int pass = 0; pass < 2; ++pass) {
+				for(size_t progress = 0; progress < size; progress += 0x1000)
+					p[progress] = static_cast<std::byte>(0);
+			}
+			n += size / 0x1000;
+
+			HEL_CHECK(helUnmapMemory(kHelNullHandle, window, size));
+			HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+		}
+		bench.announceIterations(n);
+	}
+	bench.finalizeStatistics();
+}
+
+void doParallelPageFaultBenchmark(size_t size) {
+	unsigned int numCpus = std::thread::hardware_concurrency();
+	std::cout << "page faults (parallel, " << numCpus << " threads, mapping size = "
+			<< (size / (1024 * 1024)) << " MiB)" << std::endl;
+
+	IterationsPerSecondBenchmark bench;
+	std::atomic<unsigned int> barrier{0};
+	std::atomic<int> iter{-1};
+	std::atomic<bool> stop{false};
+	std::atomic<uint64_t> totalIterations{0};
+
+	auto worker = [&](unsigned int c) {
+		for(int k = 0; k < 5; ++k) {
+			if (barrier.fetch_add(1, std::memory_order_acquire) + 1 == numCpus) {
+				barrier.store(0, std::memory_order_relaxed);
+				stop.store(false, std::memory_order_relaxed);
+				totalIterations.store(0, std::memory_order_relaxed);
+				iter.store(k, std::memory_order_release);
+			}
+			while(iter.load(std::memory_order_acquire) < k)
+				;
+
+			if (!c) {
+				bench.launchRepetition();
+			}
+
+			while (true) {
+				if (!c) {
+					if (bench.isRepetitionDone()) {
+						stop.store(true, std::memory_order_relaxed);
+						bench.announceIterations(totalIterations.load(std::memory_order_acquire));
+						break;
+					}
+				} else {
+					if (stop.load(std::memory_order_relaxed))
+						break;
+				}
+
+				HelHandle handle;
+				HEL_CHECK(helAllocateMemory(size, 0, nullptr, &handle));
+				void *window;
+				HEL_CHECK(helMapMemory(handle, kHelNullHandle, nullptr, 0, size,
+						kHelMapProtRead | kHelMapProtWrite, &window));
+
+				// Touch all mapped pages.
+				uint64_t n = 0;
+				auto p = reinterpret_cast<volatile std::byte *>(window);
+				for(size_t progress = 0; progress < size; progress += 0x1000) {
+					p[progress] = static_cast<std::byte>(0);
+					++n;
+				}
+
+				HEL_CHECK(helUnmapMemory(kHelNullHandle, window, size));
+				HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+				totalIterations.fetch_add(n, std::memory_order_release);
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(numCpus);
+	for(unsigned int c = 0; c < numCpus; ++c)
+		threads.emplace_back(worker, c);
+	for(auto &t : threads)
+		t.join();
+	bench.finalizeStatistics();
+}
+
 async::result<void> doSendRecvBufferBenchmark(size_t size) {
 	auto [lane1, lane2] = helix::createStream();
 	std::vector<std::byte> sBuf(size);
@@ -341,6 +793,69 @@ async::result<void> doSendRecvBufferBenchmark(size_t size) {
 	bench.finalizeStatistics();
 }
 
+// Same as doSendRecvBufferBenchmark() but moves pages instead of copying the data.
+// Since the pages are unmapped from the sender, the received pages are sent again
+// in the next iteration.
+async::result<void> doSendRecvPagesBenchmark(size_t size) {
+	auto [lane1, lane2] = helix::createStream();
+
+	HelHandle handle;
+	HEL_CHECK(helAllocateMemory(size, 0, nullptr, &handle));
+	void *sBuf;
+	HEL_CHECK(helMapMemory(handle, kHelNullHandle, nullptr, 0, size,
+			kHelMapProtRead | kHelMapProtWrite, &sBuf));
+	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+	memset(sBuf, 0, size);
+
+	if(size < 1024 * 1024) {
+		std::cout << "pages, size = " << (size / 1024) << " KiB" << std::endl;
+	}else{
+		std::cout << "pages, size = " << (size / (1024 * 1024)) << " MiB" << std::endl;
+	}
+
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		uint64_t n = 0;
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			for(int i = 0; i < 100; ++i) {
+				// Stamp each page such that stale data is detected by the receiver.
+				for(size_t off = 0; off < size; off += 4096)
+					memcpy(reinterpret_cast<char *>(sBuf) + off, &n, sizeof(uint64_t));
+
+				co_await async::when_all(
+					async::transform(
+						helix_ng::exchangeMsgs(lane1, helix_ng::sendPages(sBuf, size)
+					), [&] (auto result) {
+						auto [send] = std::move(result);
+						HEL_CHECK(send.error());
+					}),
+					async::transform(
+						helix_ng::exchangeMsgs(lane2, helix_ng::recvPages(size)
+					), [&] (auto result) {
+						auto [recv] = std::move(result);
+						HEL_CHECK(recv.error());
+						assert(recv.actualLength() == size);
+						for(size_t off = 0; off < size; off += 4096) {
+							if(memcmp(reinterpret_cast<char *>(recv.data()) + off,
+									&n, sizeof(uint64_t))) {
+								std::cout << "Received pages do not match sent data" << std::endl;
+								abort();
+							}
+						}
+						sBuf = recv.data();
+					})
+				);
+				++n;
+			}
+		}
+		bench.announceIterations(n);
+	}
+	bench.finalizeStatistics();
+
+	HEL_CHECK(helUnmapMemory(kHelNullHandle, sBuf, size));
+}
+
 void doCrossThreadSendRecvBufferBenchmark(size_t size) {
 	auto [lane1, lane2] = helix::createStream();
 
@@ -419,19 +934,38 @@ void doCrossThreadSendRecvBufferBenchmark(size_t size) {
 
 int main() {
 	doNopBenchmark();
+	doGetClockBenchmark(false);
+	doGetClockBenchmark(true);
 	doFutexBenchmark();
+	doFutexPingPongBenchmark();
+	doContendedMutexBenchmark();
+	doCondvarBroadcastBenchmark(false);
+	doCondvarBroadcastBenchmark(true);
 	async::run(doAsyncNopBenchmark(), helix::currentDispatcher);
 	async::run(doMultiSubmitAsyncNopBenchmark(), helix::currentDispatcher);
+	doBatchedAsyncNopBenchmark(false);
+	doBatchedAsyncNopBenchmark(true);
 	doParallelAsyncNopBenchmark();
+	doParallelDescriptorLookupBenchmark();
 	doAllocateBenchmark(1 << 20);
 	doMapBenchmark(1 << 20);
 	doMapPopulatedBenchmark(1 << 20);
-	doPageFaultBenchmark(1 << 20);
+	doPageFaultBenchmark(1 << 20, 0);
+	doPageFaultBenchmark(1 << 20, kHelMapPopulate);
+	doFaultAroundBenchmark(1 << 20);
+	doParallelPageFaultBenchmark(1 << 20);
+	doLargePageTouchBenchmark(64 << 20, 0);
+	doLargePageTouchBenchmark(64 << 20, kHelAllocLargePages);
 	async::run(doSendRecvBufferBenchmark(1), helix::currentDispatcher);
 	async::run(doSendRecvBufferBenchmark(4096), helix::currentDispatcher);
 	async::run(doSendRecvBufferBenchmark(16 * 1024), helix::currentDispatcher);
 	async::run(doSendRecvBufferBenchmark(64 * 1024), helix::currentDispatcher);
 	async::run(doSendRecvBufferBenchmark(1024 * 1024), helix::currentDispatcher);
+	async::run(doSendRecvPagesBenchmark(4096), helix::currentDispatcher);
+	async::run(doSendRecvPagesBenchmark(16 * 1024), helix::currentDispatcher);
+	async::run(doSendRecvPagesBenchmark(64 * 1024), helix::currentDispatcher);
+	async::run(doSendRecvPagesBenchmark(256 * 1024), helix::currentDispatcher);
+	async::run(doSendRecvPagesBenchmark(1024 * 1024), helix::currentDispatcher);
 	doCrossThreadSendRecvBufferBenchmark(1);
 	doCrossThreadSendRecvBufferBenchmark(4096);
 	doCrossThreadSendRecvBufferBenchmark(16 * 1024);
@@ -0,0 +1,49 @@
+#include <cassert>
+#include <iostream>
+#include <vector>
+
+#include <hel.h>
+#include <hel-syscalls.h>
+
+#include "testsuite.hpp"
+
+#ifdef __x86_64__
+
+// ISA IRQ that is usually not used by any device.
+constexpr int unusedIrq = 5;
+
+DEFINE_TEST(irqAffinity, ([] {
+	HelHandle handle;
+	HEL_CHECK(helAccessIrq(unusedIrq, &handle));
+
+	HelIrqStats stats;
+	HEL_CHECK(helQueryIrqStats(handle, &stats, nullptr, 0));
+	assert(stats.targetCpu < stats.numCpus);
+
+	std::vector<uint8_t> mask((stats.numCpus + 7) / 8);
+
+	// An empty mask does not contain any CPU that the IRQ could be routed to.
+	assert(helSetIrqAffinity(handle, mask.data(), mask.size()) == kHelErrIllegalArgs);
+
+	// Masks larger than the number of CPUs are rejected.
+	std::vector<uint8_t> largeMask(mask.size() + 1, 0xFF);
+	assert(helSetIrqAffinity(handle, largeMask.data(), largeMask.size()) == kHelErrOutOfBounds);
+
+	// Route the IRQ to the last CPU, i.e., away from the BSP if there are multiple CPUs.
+	uint32_t cpu = stats.numCpus - 1;
+	mask[cpu / 8] |= 1 << (cpu % 8);
+	auto error = helSetIrqAffinity(handle, mask.data(), mask.size());
+	if(error == kHelErrNoHardwareSupport) {
+		std::cout << "kernel-tests: IRQ controller does not support IRQ affinity" << std::endl;
+		HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+		return;
+	}
+	HEL_CHECK(error);
+
+	HEL_CHECK(helQueryIrqStats(handle, &stats, nullptr, 0));
+	assert(stats.targetCpu == cpu);
+
+	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+}))
+
+#endif // __x86_64__
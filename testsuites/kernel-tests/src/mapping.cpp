@@ -49,3 +49,30 @@ DEFINE_TEST(unmapPartialPreserve, ([] {
 	HEL_CHECK(helUnmapMemory(kHelNullHandle, p, 0x1000));
 	HEL_CHECK(helUnmapMemory(kHelNullHandle, p + 0x2000, 0x1000));
 }))
+
+DEFINE_TEST(populateLarge, ([] {
+	// Large enough that touchRange() cannot populate it in a single chunk.
+	constexpr size_t size = 8 << 20;
+
+	HelHandle handle;
+	HEL_CHECK(helAllocateMemory(size, 0, nullptr, &handle));
+	void *window;
+	HEL_CHECK(helMapMemory(handle, kHelNullHandle, nullptr, 0, size,
+			kHelMapProtRead | kHelMapProtWrite | kHelMapPopulate, &window));
+
+	HelThreadStats before;
+	HEL_CHECK(helQueryThreadStats(kHelThisThread, &before));
+
+	// Touch every page. Since the whole mapping is populated, this must not fault.
+	auto p = reinterpret_cast<std::byte *>(window);
+	for(size_t off = 0; off < size; off += 0x1000)
+		p[off] = static_cast<std::byte>(1);
+
+	HelThreadStats after;
+	HEL_CHECK(helQueryThreadStats(kHelThisThread, &after));
+	assert(after.numPageFaults == before.numPageFaults);
+
+	// Clean up.
+	HEL_CHECK(helUnmapMemory(kHelNullHandle, window, size));
+	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+}))
@@ -75,3 +75,47 @@ DEFINE_TEST(mkdir_trailing_dot, ([] {
 
 	rmdir("a");
 }))
+
+DEFINE_TEST(lookup_after_create_unlink_rename, ([] {
+	struct stat st;
+	unlink("lookup-a");
+	unlink("lookup-b");
+	unlink("lookup-dir/file");
+	rmdir("lookup-dir");
+
+	// Look up missing names twice such that they end up in the negative lookup cache.
+	for(int i = 0; i < 2; i++) {
+		assert(stat("lookup-a", &st) == -1);
+		assert(errno == ENOENT);
+		assert(stat("lookup-b", &st) == -1);
+		assert(errno == ENOENT);
+	}
+
+	int fd = open("lookup-a", O_RDWR | O_CREAT | O_EXCL, 0666);
+	assert(fd >= 0);
+	close(fd);
+	assert(!stat("lookup-a", &st));
+
+	assert(!rename("lookup-a", "lookup-b"));
+	assert(stat("lookup-a", &st) == -1);
+	assert(errno == ENOENT);
+	assert(!stat("lookup-b", &st));
+
+	assert(!unlink("lookup-b"));
+	assert(stat("lookup-b", &st) == -1);
+	assert(errno == ENOENT);
+
+	// Entries of a removed directory must not survive in a new directory of the same name.
+	assert(!mkdir("lookup-dir", 0777));
+	assert(stat("lookup-dir/file", &st) == -1);
+	assert(errno == ENOENT);
+	assert(!rmdir("lookup-dir"));
+	assert(!mkdir("lookup-dir", 0777));
+	fd = open("lookup-dir/file", O_RDWR | O_CREAT | O_EXCL, 0666);
+	assert(fd >= 0);
+	close(fd);
+	assert(!stat("lookup-dir/file", &st));
+
+	assert(!unlink("lookup-dir/file"));
+	assert(!rmdir("lookup-dir"));
+}))
@@ -6,14 +6,19 @@
 #include <stdio.h>
 #include <string.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/poll.h>
 #include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <netserver/sockopt.hpp>
+
 #include "testsuite.hpp"
 
 DEFINE_TEST(socket_accept_timeout, ([] {
@@ -376,3 +381,123 @@ DEFINE_TEST(socket_connect_dgram, ([] {
 	close(server_fd);
 	unlink(server_addr.sun_path);
 }));
+
+namespace {
+
+// Transfers data over a TCP connection on the loopback interface and reports the goodput.
+// If lossPermille is non-zero, both endpoints drop incoming packets with that probability.
+void tcpLoopbackGoodput(const char *congestion, unsigned int lossPermille = 0,
+		size_t transferSize = 8 << 20) {
+	constexpr size_t chunkSize = 16 << 10;
+
+	int server = socket(AF_INET, SOCK_STREAM, 0);
+	assert_errno("socket", server >= 0);
+
+	// Accepted sockets inherit the loss rate from the listening socket.
+	// The option is only available if netserver is built with test options.
+	if(lossPermille && setsockopt(server, IPPROTO_TCP, TCP_DEBUG_LOSS_PERMILLE,
+			&lossPermille, sizeof(lossPermille))) {
+		assert_errno("setsockopt", errno == ENOPROTOOPT);
+		fprintf(stderr, "tcp (%s): loss injection is not supported, skipping\n", congestion);
+		close(server);
+		return;
+	}
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = 0;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	assert_errno("bind", !bind(server, (struct sockaddr *) &addr, sizeof(addr)));
+	assert_errno("listen", !listen(server, 1));
+
+	socklen_t addrLength = sizeof(addr);
+	assert_errno("getsockname", !getsockname(server, (struct sockaddr *) &addr, &addrLength));
+
+	pid_t child = fork();
+	assert_errno("fork", child >= 0);
+
+	if(!child) {
+		int client = socket(AF_INET, SOCK_STREAM, 0);
+		if(client < 0)
+			exit(1);
+		if(setsockopt(client, IPPROTO_TCP, TCP_CONGESTION, congestion, strlen(congestion)))
+			exit(1);
+		if(lossPermille && setsockopt(client, IPPROTO_TCP, TCP_DEBUG_LOSS_PERMILLE,
+				&lossPermille, sizeof(lossPermille)))
+			exit(1);
+		if(connect(client, (struct sockaddr *) &addr, sizeof(addr)))
+			exit(1);
+
+		char buffer[chunkSize];
+		size_t progress = 0;
+		while(progress < transferSize) {
+			for(size_t i = 0; i < chunkSize; i++)
+				buffer[i] = static_cast<char>((progress + i) * 7);
+			ssize_t written = write(client, buffer, chunkSize);
+			if(written < 0)
+				exit(1);
+			progress += written;
+			if(static_cast<size_t>(written) != chunkSize)
+				exit(1);
+		}
+		close(client);
+		exit(0);
+	}
+
+	int conn = accept(server, nullptr, nullptr);
+	assert_errno("accept", conn >= 0);
+
+	char name[16] = {};
+	socklen_t nameLength = sizeof(name);
+	assert_errno("getsockopt", !getsockopt(conn, IPPROTO_TCP, TCP_CONGESTION, name, &nameLength));
+
+	if(lossPermille) {
+		unsigned int connLoss = 0;
+		socklen_t lossLength = sizeof(connLoss);
+		assert_errno("getsockopt", !getsockopt(conn, IPPROTO_TCP, TCP_DEBUG_LOSS_PERMILLE,
+				&connLoss, &lossLength));
+		assert(connLoss == lossPermille);
+	}
+
+	struct timespec before;
+	clock_gettime(CLOCK_MONOTONIC, &before);
+
+	char buffer[chunkSize];
+	size_t progress = 0;
+	while(progress < transferSize) {
+		ssize_t received = read(conn, buffer, chunkSize);
+		assert_errno("read", received >= 0);
+		assert(received > 0);
+		for(ssize_t i = 0; i < received; i++)
+			assert(buffer[i] == static_cast<char>((progress + i) * 7));
+		progress += received;
+	}
+
+	struct timespec after;
+	clock_gettime(CLOCK_MONOTONIC, &after);
+
+	int status;
+	assert_errno("waitpid", waitpid(child, &status, 0) == child);
+	assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+	double seconds = (after.tv_sec - before.tv_sec) + (after.tv_nsec - before.tv_nsec) / 1e9;
+	fprintf(stderr, "tcp (%s, listener uses %s, %u permille loss): %zu bytes in %.3f sec, %.2f MiB/s\n",
+			congestion, name, lossPermille, progress, seconds, progress / seconds / (1 << 20));
+
+	close(conn);
+	close(server);
+}
+
+} // anonymous namespace
+
+DEFINE_TEST(tcp_loopback_goodput, ([] {
+	tcpLoopbackGoodput("reno");
+	tcpLoopbackGoodput("cubic");
+}));
+
+// Exercises retransmission and loss recovery; the data is verified by tcpLoopbackGoodput().
+DEFINE_TEST(tcp_loopback_loss, ([] {
+	tcpLoopbackGoodput("reno", 20, 1 << 20);
+	tcpLoopbackGoodput("cubic", 20, 1 << 20);
+}));
@@ -14,6 +14,10 @@ parser.add_argument('--line', action='store_true')
 parser.add_argument('--isn', action='store_true')
 parser.add_argument('--flamegraph', action='store_true',
 	help="output folded stacks for flamegraph.pl")
+parser.add_argument('--by-thread', action='store_true',
+	help="root folded stacks at the sampled process and thread")
+parser.add_argument('--user-binary', type=str,
+	help="resolve user IPs against the symbols of this (non-PIE) binary")
 
 args = parser.parse_args()
 
@@ -41,6 +45,25 @@ else:
 		encoding='ascii',
 		stdin=subprocess.PIPE, stdout=subprocess.PIPE)
 
+user_sym_table = []
+if args.user_binary:
+	# Undefined symbols (e.g., imports from shared libraries) have no address.
+	nm = subprocess.check_output(['llvm-nm', '-nC', '--defined-only', args.user_binary],
+			encoding='ascii')
+	for line in nm.splitlines():
+		fields = line.split(' ', 2)
+		if len(fields) != 3:
+			continue
+		start, attr, symbol = fields
+		user_sym_table.append((int(start, 16), symbol))
+user_sym_index = [e[0] for e in user_sym_table]
+
+def resolve_user_ip(ip):
+	idx = bisect.bisect_right(user_sym_index, ip)
+	if idx == 0:
+		return hex(ip)
+	return user_sym_table[idx - 1][1]
+
 def resolve_ip(ip):
 	if args.aggregate_by == 'symbol':
 		idx = bisect.bisect_right(sym_index, ip)
@@ -65,29 +88,34 @@ n_user = 0
 n_kernel = 0
 n_resolved = 0
 
+def read_words(f, n):
+	data = f.read(8 * n)
+	if len(data) < 8 * n:
+		return None
+	return struct.unpack(f'{n}Q', data)
+
+# See kernel/thor/generic/thor-internal/profile.hpp for the format of samples.
 with open(args.profile_path, 'rb') as f:
 	while True:
-		rec = f.read(8)
-		if not rec:
+		header = read_words(f, 4)
+		if not header:
 			break
-		count = struct.unpack('Q', rec)[0]
+		count, kernel_count, pid, tid = header
 
-		ips = []
-		for i in range(count):
-			rec = f.read(8)
-			if not rec:
-				break
-			ips.append(struct.unpack('Q', rec)[0])
+		ips = read_words(f, count)
+		if ips is None:
+			break
+		kernel_ips = ips[:kernel_count]
+		user_ips = ips[kernel_count:]
+
+		if not kernel_ips:
+			n_user += 1
 
 		if args.flamegraph:
 			# Resolve all IPs in the stack trace
 			symbols = []
-			for ip in ips:
-				if ip < (1 << 63):
-					n_user += 1
-					continue
-				else:
-					n_kernel += 1
+			for ip in kernel_ips:
+				n_kernel += 1
 
 				symbol = resolve_ip(ip)
 				if symbol:
@@ -95,6 +123,15 @@ with open(args.profile_path, 'rb') as f:
 						raise RuntimeError(f"Unexpected semicolon in symbol: {symbol}")
 					symbols.append(symbol)
 					n_resolved += 1
+			for ip in user_ips:
+				symbols.append(resolve_user_ip(ip).replace(';', ':'))
+
+			if args.by_thread:
+				if tid:
+					symbols.append(f"thread {tid:#x}")
+					symbols.append(f"process {pid:#x}")
+				else:
+					symbols.append("kernel")
 
 			if symbols:
 				# Reverse to get bottom of stack first.
@@ -104,12 +141,8 @@ with open(args.profile_path, 'rb') as f:
 				else:
 					profile[loc] = 1
 		else:
-			for ip in ips:
-				if ip < (1 << 63):
-					n_user += 1
-					continue
-				else:
-					n_kernel += 1
+			for ip in kernel_ips:
+				n_kernel += 1
 
 				loc = resolve_ip(ip)
 				if not loc: